@@ -19,6 +19,14 @@
  * Memory object. Mostly an interface to the LMM. The malloc implementation
  * in the C library will look for this interface in the registry, and use it
  * to allocate memory.
+ *
+ * Small requests are not handed to the LMM directly. Instead they are
+ * satisfied from a set of segregated size classes, each of which carves
+ * page sized slabs out of the LMM and keeps a free list of fixed sized
+ * objects in each slab. This avoids the first-fit walk of the LMM free
+ * list (which gets longer and longer as the heap fragments) for the vast
+ * majority of malloc/free calls, and keeps small objects from chopping up
+ * the LMM into tiny pieces.
  */
 #include <oskit/com.h>
 #include <oskit/com/mem.h>
@@ -29,6 +37,7 @@
 #include <stdio.h>
 #include <malloc.h>			/* mem_lock - BOGUS! */
 #include <oskit/machine/phys_lmm.h>
+#include <oskit/machine/page.h>
 
 /* A common symbol that is overridden by the kernel library */
 lmm_t			malloc_lmm;
@@ -60,6 +69,267 @@ static oskit_mem_t	oskit_mem  = { &mem_ops };
 #define DPRINTF(fmt, args... )
 #endif
 
+/*
+ * Slab front end.
+ *
+ * Each slab is one page, aligned on a page boundary, with a small header
+ * at the front and the rest of the page divided into objects of a single
+ * size class. Slabs with free objects are kept on a doubly linked list
+ * hanging off their class. To find the slab (if any) that a freed pointer
+ * belongs to, slabs are also entered into a small hash table indexed by
+ * page number; anything not found there came straight from the LMM.
+ *
+ * Only unconstrained allocations go through here. Anything with memory
+ * type flags (ISADMA and friends), or an alignment request, goes to the
+ * LMM as before.
+ */
+#define SLAB_SHIFT	PAGE_SHIFT
+#define SLAB_SIZE	(1 << SLAB_SHIFT)
+#define SLAB_MASK	(SLAB_SIZE - 1)
+#define SLAB_MAXSIZE	512		/* Largest size class */
+#define SLAB_HASHSIZE	256		/* Must be a power of two */
+
+/*
+ * Number of completely free slabs each class hangs onto before giving
+ * pages back to the LMM. Keeps a class that is bouncing around a slab
+ * boundary from thrashing the LMM.
+ */
+#define SLAB_KEEP_EMPTY	1
+
+struct mem_slab {
+	struct mem_slab	*next;		/* Slabs with free objects */
+	struct mem_slab	*prev;
+	struct mem_slab	*hnext;		/* Hash chain */
+	void		*freelist;	/* Free objects in this slab */
+	oskit_u16_t	class;		/* Index into slab_classes */
+	oskit_u16_t	inuse;		/* Number of allocated objects */
+};
+
+/* Objects start at the first 8 byte boundary after the header */
+#define SLAB_HDRSIZE	((sizeof(struct mem_slab) + 7) & ~7)
+
+struct mem_slab_class {
+	oskit_u32_t	size;		/* Object size */
+	oskit_u32_t	perslab;	/* Objects per slab */
+	struct mem_slab	*partial;	/* Slabs with free objects */
+	oskit_u32_t	nslabs;		/* Slabs currently owned */
+	oskit_u32_t	nempty;		/* Of those, how many are empty */
+	oskit_u32_t	inuse;		/* Objects currently allocated */
+	oskit_u32_t	allocs;		/* Statistics */
+	oskit_u32_t	frees;
+};
+
+/*
+ * The size classes. Multiples of 8 so that objects keep the same
+ * alignment the LMM would have given them.
+ */
+static struct mem_slab_class slab_classes[] = {
+	{ 16 }, { 24 }, { 32 }, { 48 }, { 64 }, { 96 },
+	{ 128 }, { 192 }, { 256 }, { 384 }, { SLAB_MAXSIZE },
+};
+#define SLAB_NCLASSES	(sizeof(slab_classes) / sizeof(slab_classes[0]))
+
+/* Maps (size + 7) / 8 to a class index; filled in on first use */
+static oskit_u8_t	slab_sizemap[(SLAB_MAXSIZE >> 3) + 1];
+static int		slab_inited;
+
+static struct mem_slab	*slab_hash[SLAB_HASHSIZE];
+
+#define SLAB_HASH(addr) \
+	((((oskit_addr_t)(addr)) >> SLAB_SHIFT) & (SLAB_HASHSIZE - 1))
+
+static void
+slab_init(void)
+{
+	int	i, c;
+
+	for (i = 0, c = 0; i <= (SLAB_MAXSIZE >> 3); i++) {
+		while (slab_classes[c].size < (i << 3))
+			c++;
+		slab_sizemap[i] = c;
+	}
+	for (c = 0; c < SLAB_NCLASSES; c++)
+		slab_classes[c].perslab =
+			(SLAB_SIZE - SLAB_HDRSIZE) / slab_classes[c].size;
+
+	slab_inited = 1;
+}
+
+static inline struct mem_slab *
+slab_lookup(void *ptr)
+{
+	struct mem_slab *slab;
+	oskit_addr_t	 base = (oskit_addr_t)ptr & ~SLAB_MASK;
+
+	for (slab = slab_hash[SLAB_HASH(base)]; slab; slab = slab->hnext)
+		if ((oskit_addr_t)slab == base)
+			return slab;
+	return 0;
+}
+
+/*
+ * Get a new slab for a class from the LMM, and carve it up into objects.
+ * Returns null if the LMM is out of memory; the caller does the morecore.
+ */
+static struct mem_slab *
+slab_create(int class)
+{
+	struct mem_slab_class *sc = &slab_classes[class];
+	struct mem_slab	*slab;
+	char		*obj;
+	void		**link;
+	int		i;
+
+	slab = lmm_alloc_aligned(&malloc_lmm, SLAB_SIZE, 0, SLAB_SHIFT, 0);
+	if (slab == 0)
+		return 0;
+
+	slab->class = class;
+	slab->inuse = 0;
+
+	link = &slab->freelist;
+	obj  = (char *)slab + SLAB_HDRSIZE;
+	for (i = 0; i < sc->perslab; i++, obj += sc->size) {
+		*link = obj;
+		link  = (void **)obj;
+	}
+	*link = 0;
+
+	slab->hnext = slab_hash[SLAB_HASH(slab)];
+	slab_hash[SLAB_HASH(slab)] = slab;
+
+	slab->prev = 0;
+	slab->next = sc->partial;
+	if (sc->partial)
+		sc->partial->prev = slab;
+	sc->partial = slab;
+
+	sc->nslabs++;
+	sc->nempty++;
+	return slab;
+}
+
+/*
+ * Give an empty slab back to the LMM.
+ */
+static void
+slab_destroy(struct mem_slab *slab)
+{
+	struct mem_slab_class *sc = &slab_classes[slab->class];
+	struct mem_slab	**sp;
+
+	for (sp = &slab_hash[SLAB_HASH(slab)]; *sp != slab; sp = &(*sp)->hnext)
+		;
+	*sp = slab->hnext;
+
+	if (slab->prev)
+		slab->prev->next = slab->next;
+	else
+		sc->partial = slab->next;
+	if (slab->next)
+		slab->next->prev = slab->prev;
+
+	sc->nslabs--;
+	sc->nempty--;
+	lmm_free(&malloc_lmm, slab, SLAB_SIZE);
+}
+
+static void *
+slab_alloc(oskit_u32_t size)
+{
+	struct mem_slab_class *sc;
+	struct mem_slab	*slab;
+	void		*obj;
+	int		class;
+
+	if (!slab_inited)
+		slab_init();
+
+	class = slab_sizemap[(size + 7) >> 3];
+	sc    = &slab_classes[class];
+
+	if ((slab = sc->partial) == 0 && (slab = slab_create(class)) == 0)
+		return 0;
+
+	obj = slab->freelist;
+	slab->freelist = *(void **)obj;
+	if (slab->inuse++ == 0)
+		sc->nempty--;
+
+	/* Full slabs come off the list until something is freed */
+	if (slab->freelist == 0) {
+		sc->partial = slab->next;
+		if (slab->next)
+			slab->next->prev = 0;
+	}
+
+	sc->inuse++;
+	sc->allocs++;
+	return obj;
+}
+
+static void
+slab_free(struct mem_slab *slab, void *obj)
+{
+	struct mem_slab_class *sc = &slab_classes[slab->class];
+
+	if (slab->freelist == 0) {
+		slab->prev = 0;
+		slab->next = sc->partial;
+		if (sc->partial)
+			sc->partial->prev = slab;
+		sc->partial = slab;
+	}
+
+	*(void **)obj  = slab->freelist;
+	slab->freelist = obj;
+
+	sc->inuse--;
+	sc->frees++;
+
+	if (--slab->inuse == 0 && ++sc->nempty > SLAB_KEEP_EMPTY)
+		slab_destroy(slab);
+}
+
+/*
+ * Common allocation and free routines, called with the mem lock held.
+ * These decide whether a chunk comes from (or goes back to) a slab
+ * or the LMM proper.
+ */
+static inline void *
+chunk_alloc(oskit_u32_t size, lmm_flags_t lmm_flags)
+{
+	if (size <= SLAB_MAXSIZE && lmm_flags == 0)
+		return slab_alloc(size);
+
+	return lmm_alloc(&malloc_lmm, size, lmm_flags);
+}
+
+static inline void
+chunk_free(void *chunk, oskit_u32_t size)
+{
+	struct mem_slab	*slab;
+
+	if (size <= SLAB_MAXSIZE && (slab = slab_lookup(chunk)) != 0)
+		slab_free(slab, chunk);
+	else
+		lmm_free(&malloc_lmm, chunk, size);
+}
+
+/*
+ * Return the size of the chunk that was actually handed out for a
+ * request of the given size, or zero if it came from the LMM.
+ */
+static inline oskit_u32_t
+chunk_slabsize(void *chunk, oskit_u32_t size)
+{
+	struct mem_slab	*slab;
+
+	if (size <= SLAB_MAXSIZE && (slab = slab_lookup(chunk)) != 0)
+		return slab_classes[slab->class].size;
+	return 0;
+}
+
 static OSKIT_COMDECL
 mem_query(oskit_mem_t *m, const oskit_iid_t *iid, void **out_ihandle)
 {
@@ -100,14 +370,14 @@ mem_alloc(oskit_mem_t *m, oskit_u32_t size, oskit_u32_t flags)
 	if (flags & OSKIT_MEM_AUTO_SIZE) {
 		size += sizeof(oskit_u32_t);
 
-		while (!(chunk = lmm_alloc(&malloc_lmm, size, lmm_flags))) {
+		while (!(chunk = chunk_alloc(size, lmm_flags))) {
 			MORECORE(size, lmm_flags);
 		}
 
 		*chunk++ = size;
 	}
 	else {
-		while (!(chunk = lmm_alloc(&malloc_lmm, size, lmm_flags))) {
+		while (!(chunk = chunk_alloc(size, lmm_flags))) {
 			MORECORE(size, lmm_flags);
 		}
 	}
@@ -134,26 +404,36 @@ mem_realloc(oskit_mem_t *m, void *ptr,
 		oldsize  = *--op;
 		newsize += sizeof(oskit_u32_t);
 
-		while (!(chunk = lmm_alloc(&malloc_lmm, newsize, lmm_flags))) {
+		/*
+		 * If the new size still fits in the slab object the
+		 * old chunk came from, there is nothing to do.
+		 */
+		if (lmm_flags == 0 && newsize <= chunk_slabsize(op, oldsize)) {
+			*op = newsize;
+			mem_unlock();
+			return ptr;
+		}
+
+		while (!(chunk = chunk_alloc(newsize, lmm_flags))) {
 			MORECORE(newsize, lmm_flags);
 		}
 
 		DPRINTF("0: %p %p %d %d\n", ptr, chunk, oldsize, newsize);
 
 		memcpy(chunk, op, oldsize < newsize ? oldsize : newsize);
-		lmm_free(&malloc_lmm, op, oldsize);
+		chunk_free(op, oldsize);
 
 		*chunk++ = newsize;
 	}
 	else {
-		while (!(chunk = lmm_alloc(&malloc_lmm, newsize, lmm_flags))) {
+		while (!(chunk = chunk_alloc(newsize, lmm_flags))) {
 			MORECORE(newsize, lmm_flags);
 		}
 
 		DPRINTF("1: %p %p %d %d\n", ptr, chunk, oldsize, newsize);
 
 		memcpy(chunk, ptr, oldsize < newsize ? oldsize : newsize);
-		lmm_free(&malloc_lmm, ptr, oldsize);
+		chunk_free(ptr, oldsize);
 	}
 	mem_unlock();
 
@@ -214,12 +494,12 @@ mem_free(oskit_mem_t *m, void *ptr, oskit_u32_t size, oskit_u32_t flags)
 
 		DPRINTF("0: %p %d 0x%x\n", ptr, *chunk, flags);
 
-		lmm_free(&malloc_lmm, chunk, *chunk);
+		chunk_free(chunk, *chunk);
 	}
 	else {
 		DPRINTF("1: %p %d 0x%x\n", ptr, size, flags);
 
-		lmm_free(&malloc_lmm, ptr, size);
+		chunk_free(ptr, size);
 	}
 	mem_unlock();
 }
@@ -286,8 +566,19 @@ mem_avail(oskit_mem_t *m, oskit_u32_t flags)
 static OSKIT_COMDECL_V
 mem_dump(oskit_mem_t *m)
 {
+	int	c;
+
 	mem_lock();
 	lmm_dump(&malloc_lmm);
+
+	printf("slab  size perslab  slabs  empty    inuse     allocs      frees\n");
+	for (c = 0; c < SLAB_NCLASSES; c++) {
+		struct mem_slab_class *sc = &slab_classes[c];
+
+		printf("%4d %5d %7d %6d %6d %8d %10u %10u\n",
+		       c, sc->size, sc->perslab, sc->nslabs, sc->nempty,
+		       sc->inuse, sc->allocs, sc->frees);
+	}
 	mem_unlock();
 }
 
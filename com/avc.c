@@ -22,6 +22,8 @@
 #include <oskit/dev/osenv.h>
 #include <oskit/dev/osenv_mem.h>
 #include <oskit/dev/osenv_log.h>
+#include <oskit/dev/osenv_intr.h>
+#include <oskit/machine/atomic.h>
 #include <oskit/flask/avc.h>
 #include <oskit/flask/avc_ss.h>
 #include <oskit/flask/security.h>
@@ -42,13 +44,37 @@ typedef struct avc_callback_node
 } avc_callback_node_t;
 
 
+typedef struct avc_stat_node {
+	oskit_avc_stats_t st;
+	struct avc_stat_node *next;
+}               avc_stat_node_t;
+
 typedef struct avc_node {
 	struct oskit_avc_entry ae;
 	struct avc_node *next;
+	avc_stat_node_t *stat;		/* counters for this triple, or NULL */
 }               avc_node_t;
 
-#define AVC_CACHE_SLOTS 128
-#define AVC_CACHE_MAXNODES 102
+/*
+ * The hash table. The mask lives with the slots so that a lookup gets a
+ * matching pair from one load of avc->table, even if the table is being
+ * replaced by a bigger one.
+ */
+typedef struct avc_table {
+	unsigned int	mask;
+	struct avc_table *retired;	/* next old table awaiting free */
+	avc_node_t	*slots[1];
+}               avc_table_t;
+
+#define AVC_TABLE_SIZE(nslots) \
+	(offsetof(avc_table_t, slots) + (nslots) * sizeof(avc_node_t *))
+
+#define AVC_CACHE_SLOTS 128		/* initial hash table size */
+#define AVC_CACHE_NODES 102		/* entries allocated up front */
+#define AVC_CACHE_MAXNODES 1024		/* default limit on entries */
+
+#define AVC_STATS_SLOTS 256
+#define AVC_STATS_PERNODE 4		/* triples tracked per allowed entry */
 
 
 typedef struct {
@@ -57,11 +83,19 @@ typedef struct {
 	unsigned count;
 	oskit_osenv_mem_t *mem;
 	oskit_osenv_log_t *log;
+	oskit_osenv_intr_t *intr;
 	avc_callback_node_t *callbacks;
-	avc_node_t     *slots[AVC_CACHE_SLOTS];
+	avc_table_t * volatile table;
+	avc_table_t	*retired;	/* replaced tables lookups may be using */
+	volatile unsigned int seq;	/* odd while the cache is changing */
+	atomic_t	readers;	/* lookups in progress */
 	avc_node_t     *freelist;
 	unsigned int    lru_hint;	/* LRU hint for reclaim scan */
 	unsigned int    activeNodes;
+	unsigned int	nnodes;		/* entries allocated */
+	unsigned int	maxnodes;	/* and the most we will allocate */
+	avc_stat_node_t *stats[AVC_STATS_SLOTS];
+	unsigned int	nstats;
 	oskit_u32_t	latest_notif;
 }               avc_cache_t;
 
@@ -77,6 +111,57 @@ static struct oskit_avc_ss_ops avc_ss_ops;
 #define	offsetof(type, member)	((oskit_size_t)(&((type *)0)->member))
 #endif
 
+/*
+ * Lookups do not lock the cache. Anything that changes the table or the
+ * entries in it does so with interrupts disabled, which keeps writers
+ * from running over each other, and bumps the sequence count before and
+ * after; a lookup that sees the count change under it starts over. A
+ * lookup can only see the count odd if it was preempted by the writer,
+ * so on the uniprocessors we run on a compiler barrier is all the
+ * ordering required.
+ */
+#define AVC_BARRIER()	__asm__ __volatile__("" : : : "memory")
+
+#define AVC_WRITE_BEGIN(avc,flags) \
+	flags = oskit_osenv_intr_save_disable((avc)->intr); \
+	(avc)->seq++; \
+	AVC_BARRIER();
+
+#define AVC_WRITE_END(avc,flags) \
+	AVC_BARRIER(); \
+	(avc)->seq++; \
+	if (flags) oskit_osenv_intr_enable((avc)->intr);
+
+static inline unsigned int avc_read_begin(avc_cache_t *avc)
+{
+	unsigned int seq;
+
+	while ((seq = avc->seq) & 1)
+		continue;
+	AVC_BARRIER();
+	return seq;
+}
+
+static inline int avc_read_retry(avc_cache_t *avc, unsigned int seq)
+{
+	AVC_BARRIER();
+	return avc->seq != seq;
+}
+
+
+static avc_node_t *avc_alloc_node(avc_cache_t *avc)
+{
+	avc_node_t	*new;
+
+	new = (avc_node_t *) 
+		oskit_osenv_mem_alloc(avc->mem, sizeof(avc_node_t), 0, 0);
+	if (!new)
+		return NULL;
+	memset(new, 0, sizeof(avc_node_t));
+	avc->nnodes++;
+	return new;
+}
+
 
 oskit_error_t oskit_avc_create(oskit_services_t *osenv,
 			       struct oskit_security *security,
@@ -84,6 +169,7 @@ oskit_error_t oskit_avc_create(oskit_services_t *osenv,
 {	
 	oskit_osenv_log_t *log;
 	oskit_osenv_mem_t *mem;
+	oskit_osenv_intr_t *intr;
 	avc_cache_t 	*avc;
 	avc_node_t	*new;
 	int             i;
@@ -99,11 +185,26 @@ oskit_error_t oskit_avc_create(oskit_services_t *osenv,
 	if (!mem)
 		return OSKIT_EINVAL;
 
+	oskit_services_lookup_first(osenv, &oskit_osenv_intr_iid, 
+				    (void **) &intr);
+	if (!intr)
+		return OSKIT_EINVAL;
+
 	avc = oskit_osenv_mem_alloc(mem, sizeof(avc_cache_t), 0, 0);
 	if (!avc)
 		return OSKIT_ENOMEM;
 
 	memset(avc, 0, sizeof(avc_cache_t));
+	avc->table = oskit_osenv_mem_alloc(mem, 
+					   AVC_TABLE_SIZE(AVC_CACHE_SLOTS), 0, 0);
+	if (!avc->table) {
+		oskit_osenv_mem_free(mem, avc, 0, sizeof(avc_cache_t));
+		return OSKIT_ENOMEM;
+	}
+	memset(avc->table, 0, AVC_TABLE_SIZE(AVC_CACHE_SLOTS));
+	avc->table->mask = AVC_CACHE_SLOTS - 1;
+	avc->maxnodes = AVC_CACHE_MAXNODES;
+
 	avc->avci.ops = &avc_ops;
 	avc->avci.security = security;
 	oskit_security_addref(security);
@@ -116,22 +217,24 @@ oskit_error_t oskit_avc_create(oskit_services_t *osenv,
 	avc->mem = mem;	
 	oskit_osenv_mem_addref(mem);
 
-	for (i = 0; i < AVC_CACHE_MAXNODES; i++) {
-		new = (avc_node_t *) 
-			oskit_osenv_mem_alloc(avc->mem,sizeof(avc_node_t),0,0);
+	avc->intr = intr;
+	oskit_osenv_intr_addref(intr);
+
+	for (i = 0; i < AVC_CACHE_NODES; i++) {
+		new = avc_alloc_node(avc);
 		if (!new) {
 		        oskit_osenv_log_log(avc->log, OSENV_LOG_WARNING, 
 			    "avc:  only able to allocate %d nodes\n", i);
 			break;
 		}
-		memset(new, 0, sizeof(avc_node_t));
 		new->next = avc->freelist;
 		avc->freelist = new;
 	}
 
 	oskit_osenv_log_log(avc->log, OSENV_LOG_INFO,
 		    "AVC:  allocated %d bytes during initialization.\n", 
-		    sizeof(avc_cache_t) + i * sizeof(avc_node_t));
+		    sizeof(avc_cache_t) + AVC_TABLE_SIZE(AVC_CACHE_SLOTS) +
+		    i * sizeof(avc_node_t));
 
 	*out_avc = &avc->avci;
 
@@ -139,8 +242,11 @@ oskit_error_t oskit_avc_create(oskit_services_t *osenv,
 }
 
 
-#define AVC_HASH(ssid,tsid,tclass) \
-((ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_CACHE_SLOTS - 1))
+#define AVC_HASH(ssid,tsid,tclass,mask) \
+((ssid ^ (tsid<<2) ^ (tclass<<4)) & (mask))
+
+#define AVC_STATS_HASH(ssid,tsid,tclass) \
+	AVC_HASH(ssid,tsid,tclass,AVC_STATS_SLOTS - 1)
 
 
 static OSKIT_COMDECL_V avc_log_stats(oskit_avc_t *a, 
@@ -170,6 +276,14 @@ static OSKIT_COMDECL_V avc_log_stats(oskit_avc_t *a,
 	       tag,
 	       a->stats[OSKIT_AVC_CAV_PROBES],
 	       a->stats[OSKIT_AVC_CAV_HITS]);
+
+	oskit_osenv_log_log(avc->log, priority,
+	    "%s avc:  %d/%d/%d active/allocated/max nodes, %d slots, "
+	    "%d triples\n",
+	       tag,
+	       avc->activeNodes, avc->nnodes, avc->maxnodes,
+	       avc->table->mask + 1,
+	       avc->nstats);
 #endif
 }
 
@@ -271,6 +385,7 @@ static OSKIT_COMDECL_V avc_log_contents(oskit_avc_t *a,
 					char *tag)
 {
 	avc_cache_t *avc = (avc_cache_t *) a;
+	avc_table_t    *tab = avc->table;
 	int             i, chain_len, max_chain_len, slots_used;
 	avc_node_t     *node;
 
@@ -281,8 +396,8 @@ static OSKIT_COMDECL_V avc_log_contents(oskit_avc_t *a,
 
 	slots_used = 0;
 	max_chain_len = 0;
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
-		node = avc->slots[i];
+	for (i = 0; i <= tab->mask; i++) {
+		node = tab->slots[i];
 		if (node) {
 			oskit_osenv_log_log(avc->log, priority, 
 					    "\n%s avc:  slot %d:\n", tag, i);
@@ -317,8 +432,124 @@ static OSKIT_COMDECL_V avc_log_contents(oskit_avc_t *a,
 }
 
 
+/*
+ * Free the tables retired by avc_grow_table, once no lookup can still
+ * be looking at them.
+ */
+static void avc_free_retired(avc_cache_t *avc)
+{
+	avc_table_t    *tab;
+
+	if (atomic_read(&avc->readers))
+		return;
+
+	while ((tab = avc->retired) != NULL) {
+		avc->retired = tab->retired;
+		oskit_osenv_mem_free(avc->mem, tab, 0,
+				     AVC_TABLE_SIZE(tab->mask + 1));
+	}
+}
+
+
+/*
+ * Double the hash table. The nodes are moved over one at a time; a
+ * lookup walking a chain of the old table may wander into a chain of
+ * the new one, but every chain still ends, and the lookup will see the
+ * sequence count has moved and try again. The old table is kept until
+ * there are no lookups in progress.
+ */
+static void avc_grow_table(avc_cache_t *avc)
+{
+	avc_table_t    *old = avc->table, *new;
+	avc_node_t     *node;
+	unsigned int    nslots = (old->mask + 1) * 2;
+	int             i, hvalue;
+
+	new = oskit_osenv_mem_alloc(avc->mem, AVC_TABLE_SIZE(nslots), 0, 0);
+	if (!new)
+		return;		/* just live with longer chains */
+	memset(new, 0, AVC_TABLE_SIZE(nslots));
+	new->mask = nslots - 1;
+
+	for (i = 0; i <= old->mask; i++) {
+		while ((node = old->slots[i]) != NULL) {
+			old->slots[i] = node->next;
+			hvalue = AVC_HASH(node->ae.ssid, node->ae.tsid,
+					  node->ae.tclass, new->mask);
+			node->next = new->slots[hvalue];
+			new->slots[hvalue] = node;
+		}
+	}
+
+	avc->table = new;
+	avc->lru_hint = 0;
+	old->retired = avc->retired;
+	avc->retired = old;
+	avc_free_retired(avc);
+}
+
+
+#if OSKIT_AVC_KEEP_STATS
+static avc_stat_node_t *avc_find_stat(
+	avc_cache_t *avc,
+	oskit_security_id_t ssid,
+	oskit_security_id_t tsid,
+	oskit_security_class_t tclass)
+{
+	avc_stat_node_t *cur;
+
+	cur = avc->stats[AVC_STATS_HASH(ssid, tsid, tclass)];
+	while (cur != NULL &&
+	       (ssid != cur->st.ssid ||
+		tclass != cur->st.tclass ||
+		tsid != cur->st.tsid))
+		cur = cur->next;
+
+	return cur;
+}
+
+
+/*
+ * Find or make the counters for a triple. Once there are more triples
+ * than the cache could hold several times over, new ones go uncounted.
+ */
+static avc_stat_node_t *avc_claim_stat(
+	avc_cache_t *avc,
+	oskit_security_id_t ssid,
+	oskit_security_id_t tsid,
+	oskit_security_class_t tclass)
+{
+	avc_stat_node_t *new;
+	int             hvalue;
+
+	new = avc_find_stat(avc, ssid, tsid, tclass);
+	if (new)
+		return new;
+
+	if (avc->nstats >= avc->maxnodes * AVC_STATS_PERNODE)
+		return NULL;
+
+	new = oskit_osenv_mem_alloc(avc->mem, sizeof(avc_stat_node_t), 0, 0);
+	if (!new)
+		return NULL;
+	memset(new, 0, sizeof(avc_stat_node_t));
+	new->st.ssid = ssid;
+	new->st.tsid = tsid;
+	new->st.tclass = tclass;
+
+	hvalue = AVC_STATS_HASH(ssid, tsid, tclass);
+	new->next = avc->stats[hvalue];
+	avc->stats[hvalue] = new;
+	avc->nstats++;
+
+	return new;
+}
+#endif
+
+
 extern inline avc_node_t *avc_reclaim_node(avc_cache_t *avc)
 {
+	avc_table_t    *tab = avc->table;
 	avc_node_t     *prev, *cur;
 	int             hvalue, try;
 
@@ -327,7 +558,7 @@ extern inline avc_node_t *avc_reclaim_node(avc_cache_t *avc)
 	for (try = 0; try < 2; try++) {
 		do {
 			prev = NULL;
-			cur = avc->slots[hvalue];
+			cur = tab->slots[hvalue];
 			while (cur) {
 				if (!cur->ae.used)
 					goto found;
@@ -337,7 +568,7 @@ extern inline avc_node_t *avc_reclaim_node(avc_cache_t *avc)
 				prev = cur;
 				cur = cur->next;
 			}
-			hvalue = (hvalue + 1) & (AVC_CACHE_SLOTS - 1);
+			hvalue = (hvalue + 1) & tab->mask;
 		} while (hvalue != avc->lru_hint);
 	}
 
@@ -347,15 +578,25 @@ found:
 	avc->lru_hint = hvalue;
 
 	if (prev == NULL)
-		avc->slots[hvalue] = cur->next;
+		tab->slots[hvalue] = cur->next;
 	else
 		prev->next = cur->next;
 
+#if OSKIT_AVC_KEEP_STATS
+	if (cur->stat)
+		cur->stat->st.reclaims++;
+#endif
+
 	return cur;
 }
 
 
-extern inline avc_node_t *avc_claim_node(
+/*
+ * Called with the cache write-locked. Use a free node if there is one,
+ * or allocate another if we are under the limit; only then throw out
+ * an old entry. Grow the table to keep the chains short.
+ */
+static avc_node_t *avc_claim_node(
 	avc_cache_t *avc,
 	oskit_security_id_t ssid,
 	oskit_security_id_t tsid,
@@ -365,23 +606,35 @@ extern inline avc_node_t *avc_claim_node(
 	int             hvalue;
 
 
-	hvalue = AVC_HASH(ssid, tsid, tclass);
 	if (avc->freelist) {
 		new = avc->freelist;
 		avc->freelist = avc->freelist->next;
 		avc->activeNodes++;
+	} else if (avc->nnodes < avc->maxnodes &&
+		   (new = avc_alloc_node(avc)) != NULL) {
+		avc->activeNodes++;
 	} else {
+		if (avc->activeNodes == 0)
+			return NULL;
 		new = avc_reclaim_node(avc);
 		if (!new)
 			return NULL;
 	}
 
+	/* Keep the load factor where the original fixed sizes put it */
+	if (avc->activeNodes * 5 > (avc->table->mask + 1) * 4)
+		avc_grow_table(avc);
+
 	new->ae.used = TRUE;
 	new->ae.ssid = ssid;
 	new->ae.tsid = tsid;
 	new->ae.tclass = tclass;
-	new->next = avc->slots[hvalue];
-	avc->slots[hvalue] = new;
+#if OSKIT_AVC_KEEP_STATS
+	new->stat = avc_claim_stat(avc, ssid, tsid, tclass);
+#endif
+	hvalue = AVC_HASH(ssid, tsid, tclass, avc->table->mask);
+	new->next = avc->table->slots[hvalue];
+	avc->table->slots[hvalue] = new;
 
 	return new;
 }
@@ -397,6 +650,7 @@ extern inline avc_node_t *avc_search_node(
 #endif
 	)
 {
+	avc_table_t    *tab = avc->table;
 	avc_node_t     *cur;
 	int             hvalue;
 #if OSKIT_AVC_KEEP_STATS
@@ -404,8 +658,8 @@ extern inline avc_node_t *avc_search_node(
 #endif
 
 
-	hvalue = AVC_HASH(ssid, tsid, tclass);
-	cur = avc->slots[hvalue];
+	hvalue = AVC_HASH(ssid, tsid, tclass, tab->mask);
+	cur = tab->slots[hvalue];
 	while (cur != NULL &&
 	       (ssid != cur->ae.ssid ||
 		tclass != cur->ae.tclass ||
@@ -433,6 +687,9 @@ extern inline avc_node_t *avc_search_node(
 }
 
 
+/*
+ * The read path. No lock is taken; see AVC_WRITE_BEGIN.
+ */
 static OSKIT_COMDECL avc_lookup(
 	oskit_avc_t *a,
 	oskit_security_id_t ssid,		/* IN */
@@ -443,24 +700,39 @@ static OSKIT_COMDECL avc_lookup(
 {
 	avc_cache_t    *avc = (avc_cache_t *) a;
 	avc_node_t     *node;
+	unsigned int    seq;
+	int             hit;
 #if OSKIT_AVC_KEEP_STATS
-	int             probes;
+	avc_stat_node_t *stat = NULL;
+	int             probes = 0;
 #endif
 
 #if OSKIT_AVC_KEEP_STATS
 	a->stats[OSKIT_AVC_CAV_LOOKUPS]++;
 #endif
 
-	node = avc_search_node(avc, ssid, tsid, tclass
+	atomic_inc(&avc->readers);
+	do {
+		seq = avc_read_begin(avc);
+		node = avc_search_node(avc, ssid, tsid, tclass
+#if OSKIT_AVC_KEEP_STATS
+				       ,&probes
+#endif
+			);
+		hit = node && ((node->ae.decided & requested) == requested);
 #if OSKIT_AVC_KEEP_STATS
-			       ,&probes
+		if (hit)
+			stat = node->stat;
 #endif
-		);
+	} while (avc_read_retry(avc, seq));
+	atomic_dec(&avc->readers);
 
-	if (node && ((node->ae.decided & requested) == requested)) {
+	if (hit) {
 #if OSKIT_AVC_KEEP_STATS
 		a->stats[OSKIT_AVC_CAV_HITS]++;
 		a->stats[OSKIT_AVC_CAV_PROBES] += probes;
+		if (stat)
+			stat->st.hits++;
 #endif
 		out_aeref->ae = &node->ae;
 		return 0;
@@ -474,6 +746,36 @@ static OSKIT_COMDECL avc_lookup(
 }
 
 
+/*
+ * Called with the cache write-locked. Make an entry for a decision
+ * obtained from the security server.
+ */
+static avc_node_t *avc_fill_node(
+	avc_cache_t *avc,
+	oskit_security_id_t ssid,
+	oskit_security_id_t tsid,
+	oskit_security_class_t tclass,
+	oskit_avc_entry_t *ae)
+{
+	avc_node_t     *node;
+
+	node = avc_claim_node(avc, ssid, tsid, tclass);
+	if (!node)
+		return NULL;
+
+	node->ae.allowed = ae->allowed;
+	node->ae.decided = ae->decided;
+	node->ae.auditallow = ae->auditallow;
+	node->ae.auditdeny = ae->auditdeny;
+	node->ae.notify = ae->notify;
+#if OSKIT_AVC_KEEP_STATS
+	if (node->stat)
+		node->stat->st.misses++;
+#endif
+	return node;
+}
+
+
 static OSKIT_COMDECL avc_insert(
 	oskit_avc_t *a,
 	oskit_security_id_t ssid,		/* IN */
@@ -485,6 +787,7 @@ static OSKIT_COMDECL avc_insert(
 {
 	avc_cache_t    *avc = (avc_cache_t *) a;
 	avc_node_t     *node;
+	int             flags;
 
 	if (seqno < avc->latest_notif) {
 		oskit_osenv_log_log(avc->log, OSENV_LOG_WARNING, 
@@ -494,16 +797,14 @@ static OSKIT_COMDECL avc_insert(
 		return OSKIT_EAGAIN;
 	}
 
-	node = avc_claim_node(avc, ssid, tsid, tclass);
-	if (!node) {
+	AVC_WRITE_BEGIN(avc, flags);
+	if (avc->retired)
+		avc_free_retired(avc);
+	node = avc_fill_node(avc, ssid, tsid, tclass, ae);
+	AVC_WRITE_END(avc, flags);
+
+	if (!node)
 		return OSKIT_ENOMEM;
-	}
-	
-	node->ae.allowed = ae->allowed;
-	node->ae.decided = ae->decided;
-	node->ae.auditallow = ae->auditallow;
-	node->ae.auditdeny = ae->auditdeny;
-	node->ae.notify = ae->notify;
 
 	out_aeref->ae = &node->ae;
 	return 0;
@@ -530,6 +831,240 @@ static OSKIT_COMDECL_V avc_audit(
 }
 
 
+#define AVC_ENTRY_MATCHES(ae,c) \
+	((ae)->ssid == (c)->ssid && (ae)->tsid == (c)->tsid && \
+	 (ae)->tclass == (c)->tclass && \
+	 (((ae)->decided & (c)->requested) == (c)->requested))
+
+/*
+ * Make a number of permission checks at once. Each check goes the way
+ * of oskit_avc_has_perm_ref, except that the cache is searched for all
+ * of them in one read section, the decisions that are missing are all
+ * fetched from the security server before any of them go into the
+ * cache, and they all go in under one write lock. The checks are then
+ * decided in order, stopping at the first one denied, so that just what
+ * a series of has_perm calls would audit gets audited.
+ */
+static OSKIT_COMDECL avc_has_perm_batch(
+	oskit_avc_t *a,
+	oskit_avc_check_t *checks,		/* IN */
+	oskit_u32_t nchecks,			/* IN */
+	oskit_u32_t *out_failed)		/* OUT */
+{
+	avc_cache_t    *avc = (avc_cache_t *) a;
+	oskit_avc_check_t *c;
+	oskit_avc_entry_t *ae[OSKIT_AVC_BATCH_MAX];	/* in the cache */
+	oskit_avc_entry_t entry[OSKIT_AVC_BATCH_MAX];	/* copies */
+	oskit_u32_t     seqno[OSKIT_AVC_BATCH_MAX];
+	oskit_error_t   rcs[OSKIT_AVC_BATCH_MAX];
+	int             byref[OSKIT_AVC_BATCH_MAX];	/* valid reference */
+	int             src[OSKIT_AVC_BATCH_MAX];	/* check that was filled */
+	avc_node_t     *node;
+	unsigned int    seq;
+	int             i, j, flags, misses;
+	oskit_error_t   rc;
+#if OSKIT_AVC_KEEP_STATS
+	avc_stat_node_t *stat[OSKIT_AVC_BATCH_MAX];
+	int             probes[OSKIT_AVC_BATCH_MAX];
+#endif
+
+	if (nchecks > OSKIT_AVC_BATCH_MAX)
+		return OSKIT_EINVAL;
+
+	/*
+	 * Entry references first; they do not touch the cache at all.
+	 */
+	misses = 0;
+	for (i = 0; i < nchecks; i++) {
+		c = &checks[i];
+		rcs[i] = 0;
+		src[i] = -1;
+#if OSKIT_AVC_KEEP_STATS
+		a->stats[OSKIT_AVC_ENTRY_LOOKUPS]++;
+#endif
+		ae[i] = c->aeref ? c->aeref->ae : NULL;
+		byref[i] = ae[i] && AVC_ENTRY_MATCHES(ae[i], c);
+		if (byref[i]) {
+#if OSKIT_AVC_KEEP_STATS
+			a->stats[OSKIT_AVC_ENTRY_HITS]++;
+#endif
+			ae[i]->used = TRUE;
+			entry[i] = *ae[i];
+			continue;
+		}
+#if OSKIT_AVC_KEEP_STATS
+		if (ae[i])
+			a->stats[OSKIT_AVC_ENTRY_DISCARDS]++;
+		a->stats[OSKIT_AVC_ENTRY_MISSES]++;
+#endif
+		misses++;
+	}
+
+	/*
+	 * Then the cache, for all the rest together.
+	 */
+	if (misses) {
+		atomic_inc(&avc->readers);
+		do {
+			seq = avc_read_begin(avc);
+			for (i = 0; i < nchecks; i++) {
+				if (byref[i])
+					continue;
+				c = &checks[i];
+				node = avc_search_node(avc, c->ssid, c->tsid,
+						       c->tclass
+#if OSKIT_AVC_KEEP_STATS
+						       ,&probes[i]
+#endif
+					);
+				if (node && ((node->ae.decided & c->requested)
+					     == c->requested)) {
+					ae[i] = &node->ae;
+					entry[i] = node->ae;
+#if OSKIT_AVC_KEEP_STATS
+					stat[i] = node->stat;
+#endif
+				} else
+					ae[i] = NULL;
+			}
+		} while (avc_read_retry(avc, seq));
+		atomic_dec(&avc->readers);
+
+		misses = 0;
+		for (i = 0; i < nchecks; i++) {
+			if (byref[i])
+				continue;
+#if OSKIT_AVC_KEEP_STATS
+			a->stats[OSKIT_AVC_CAV_LOOKUPS]++;
+			if (ae[i]) {
+				a->stats[OSKIT_AVC_CAV_HITS]++;
+				a->stats[OSKIT_AVC_CAV_PROBES] += probes[i];
+				if (stat[i])
+					stat[i]->st.hits++;
+			} else
+				a->stats[OSKIT_AVC_CAV_MISSES]++;
+#endif
+			if (!ae[i])
+				misses++;
+		}
+	}
+
+	/*
+	 * Ask the security server about what is still missing. Checks on
+	 * the same triple often come together (read and write on a file,
+	 * say); one answer does for all of them.
+	 */
+	if (misses) {
+		for (i = 0; i < nchecks; i++) {
+			if (byref[i] || ae[i])
+				continue;
+			c = &checks[i];
+			for (j = 0; j < i; j++) {
+				if (src[j] == j && rcs[j] == 0 &&
+				    AVC_ENTRY_MATCHES(&entry[j], c))
+					break;
+			}
+			if (j < i) {
+				src[i] = j;
+				continue;
+			}
+			src[i] = i;
+			entry[i].ssid = c->ssid;
+			entry[i].tsid = c->tsid;
+			entry[i].tclass = c->tclass;
+			rcs[i] = oskit_security_compute_av(a->security,
+					   c->ssid, c->tsid, c->tclass,
+					   c->requested,
+					   &entry[i].allowed,
+					   &entry[i].decided,
+					   &entry[i].auditallow,
+					   &entry[i].auditdeny,
+					   &entry[i].notify,
+					   &seqno[i]);
+			if (rcs[i] == 0 && seqno[i] < avc->latest_notif) {
+				oskit_osenv_log_log(avc->log, OSENV_LOG_WARNING, 
+					    "avc:  seqno %d < latest_notif %d\n", 
+					    seqno[i],
+					    avc->latest_notif);		
+				rcs[i] = OSKIT_EAGAIN;
+			}
+		}
+
+		AVC_WRITE_BEGIN(avc, flags);
+		if (avc->retired)
+			avc_free_retired(avc);
+		for (i = 0; i < nchecks; i++) {
+			if (src[i] != i || rcs[i])
+				continue;
+			node = avc_fill_node(avc, checks[i].ssid,
+					     checks[i].tsid,
+					     checks[i].tclass, &entry[i]);
+			if (!node)
+				rcs[i] = OSKIT_ENOMEM;
+			ae[i] = node ? &node->ae : NULL;
+		}
+		AVC_WRITE_END(avc, flags);
+	}
+
+	/*
+	 * Now decide, from the copies: the fills could have reclaimed any
+	 * of the entries found along the way.
+	 */
+	for (i = 0; i < nchecks; i++) {
+		oskit_avc_entry_t *d;
+
+		c = &checks[i];
+		if (src[i] >= 0) {
+			j = src[i];
+			if (rcs[j]) {
+				rc = rcs[j];
+				goto out;
+			}
+			d = &entry[j];
+			ae[i] = ae[j];
+		} else
+			d = &entry[i];
+		if (ae[i] && !AVC_ENTRY_MATCHES(ae[i], c))
+			ae[i] = NULL;
+
+#if OSKIT_AVC_ALWAYS_ALLOW
+		if (a->always_allow) {
+			if ((c->requested & d->allowed) != c->requested) {
+				avc_audit(a, c->ssid, c->tsid, c->tclass, 
+					  c->requested, d,
+					  OSKIT_AVC_AUDITDENY);
+				d->allowed |= c->requested;
+				if (ae[i])
+					ae[i]->allowed |= c->requested;
+			}
+		}
+#endif
+
+		if ((c->requested & d->allowed) != c->requested) {
+			if (c->requested & d->auditdeny)
+				avc_audit(a, c->ssid, c->tsid, c->tclass, 
+					  c->requested, d,
+					  OSKIT_AVC_AUDITDENY);
+			rc = OSKIT_EACCES;
+			goto out;
+		}
+
+		if (c->requested & d->auditallow)
+			avc_audit(a, c->ssid, c->tsid, c->tclass, 
+				  c->requested, d, OSKIT_AVC_AUDITALLOW);
+
+		if (c->aeref && ae[i])
+			c->aeref->ae = ae[i];
+	}
+	rc = 0;
+
+  out:
+	if (out_failed)
+		*out_failed = i;
+	return rc;
+}
+
+
 static OSKIT_COMDECL avc_add_callback(
 	oskit_avc_t *a,
 	struct oskit_avc_callback *c,
@@ -637,13 +1172,16 @@ static int avc_update_cache(
 	oskit_security_class_t tclass,	/* IN */
 	oskit_access_vector_t perms)		/* IN */
 {
+	avc_table_t    *tab;
 	avc_node_t     *node;	
-	int i;
+	int i, flags;
 
+	AVC_WRITE_BEGIN(avc, flags);
+	tab = avc->table;
 	if (ssid == OSKIT_SECSID_WILD || tsid == OSKIT_SECSID_WILD) {
 		/* apply to all matching nodes */
-		for (i = 0; i < AVC_CACHE_SLOTS; i++) {
-			for (node = avc->slots[i]; node; 
+		for (i = 0; i <= tab->mask; i++) {
+			for (node = tab->slots[i]; node; 
 			     node = node->next) {
 				if (AVC_SIDCMP(ssid, node->ae.ssid) && 
 				    AVC_SIDCMP(tsid, node->ae.tsid) &&
@@ -663,6 +1201,7 @@ static int avc_update_cache(
 			avc_update_node(event,node,perms);
 		}
 	}
+	AVC_WRITE_END(avc, flags);
 
 	return 0;
 }
@@ -768,12 +1307,15 @@ static OSKIT_COMDECL avc_ss_reset(oskit_avc_ss_t *a,
 	avc_cache_t *avc = (avc_cache_t *) ((char *) a - offsetof(avc_cache_t, avc_ssi));
 	avc_callback_node_t *c;
 	int rc;
+	avc_table_t    *tab;
 	avc_node_t     *node, *tmp;
-	int             i;
+	int             i, flags;
 
 
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
-		node = avc->slots[i];
+	AVC_WRITE_BEGIN(avc, flags);
+	tab = avc->table;
+	for (i = 0; i <= tab->mask; i++) {
+		node = tab->slots[i];
 		while (node) {
 			tmp = node;
 			node = node->next;
@@ -783,13 +1325,15 @@ static OSKIT_COMDECL avc_ss_reset(oskit_avc_ss_t *a,
 			tmp->ae.auditallow = tmp->ae.auditdeny = 0;
 			tmp->ae.notify = 0;
 			tmp->ae.used = FALSE;
+			tmp->stat = NULL;
 			tmp->next = avc->freelist;
 			avc->freelist = tmp;
 			avc->activeNodes--;
 		}
-		avc->slots[i] = 0;
+		tab->slots[i] = 0;
 	}
 	avc->lru_hint = 0;
+	AVC_WRITE_END(avc, flags);
 
 	for (c = avc->callbacks; c; c = c->next) {
 		if (c->events & OSKIT_AVC_CALLBACK_RESET) {
@@ -865,6 +1409,71 @@ static OSKIT_COMDECL avc_ss_set_notify(
 }
 
 
+static OSKIT_COMDECL avc_set_size(oskit_avc_t *a,
+				  oskit_u32_t maxnodes)
+{
+	avc_cache_t *avc = (avc_cache_t *) a;
+
+	if (maxnodes == 0)
+		return OSKIT_EINVAL;
+
+	/*
+	 * Nodes are never freed while the cache is alive, since entry
+	 * references may still point at them; a lower limit just stops
+	 * the cache from growing any further.
+	 */
+	avc->maxnodes = maxnodes;
+	return 0;
+}
+
+
+static OSKIT_COMDECL avc_lookup_stats(
+	oskit_avc_t *a,
+	oskit_security_id_t ssid,		/* IN */
+	oskit_security_id_t tsid,		/* IN */
+	oskit_security_class_t tclass,		/* IN */
+	oskit_avc_stats_t *out_stats)		/* OUT */
+{
+#if OSKIT_AVC_KEEP_STATS
+	avc_cache_t *avc = (avc_cache_t *) a;
+	avc_stat_node_t *st;
+
+	st = avc_find_stat(avc, ssid, tsid, tclass);
+	if (!st)
+		return OSKIT_ENOENT;
+
+	*out_stats = st->st;
+	return 0;
+#else
+	return OSKIT_E_NOTIMPL;
+#endif
+}
+
+
+static OSKIT_COMDECL avc_get_stats(
+	oskit_avc_t *a,
+	oskit_avc_stats_t *out_stats,		/* OUT */
+	oskit_u32_t count,			/* IN */
+	oskit_u32_t *out_count)			/* OUT */
+{
+#if OSKIT_AVC_KEEP_STATS
+	avc_cache_t *avc = (avc_cache_t *) a;
+	avc_stat_node_t *st;
+	int i, n = 0;
+
+	for (i = 0; i < AVC_STATS_SLOTS; i++) {
+		for (st = avc->stats[i]; st && n < count; st = st->next)
+			out_stats[n++] = st->st;
+	}
+
+	*out_count = avc->nstats;
+	return 0;
+#else
+	return OSKIT_E_NOTIMPL;
+#endif
+}
+
+
 static OSKIT_COMDECL avc_query(oskit_avc_t *a,
 			       const struct oskit_guid *iid,
 			       void **out_ihandle)
@@ -902,6 +1511,7 @@ static OSKIT_COMDECL_U avc_release(oskit_avc_t *a)
 	avc_cache_t *avc = (avc_cache_t *) a;
 	oskit_osenv_mem_t *mem;
 	avc_node_t *node, *ntmp;
+	avc_stat_node_t *st, *sttmp;
 	avc_callback_node_t *c, *ctmp;		
 	unsigned newcount;
 	int i;
@@ -911,8 +1521,9 @@ static OSKIT_COMDECL_U avc_release(oskit_avc_t *a)
 	{
 		oskit_security_release(avc->avci.security);
 		oskit_osenv_log_release(avc->log);
-		for (i = 0; i < AVC_CACHE_SLOTS; i++) {
-			node = avc->slots[i];
+		oskit_osenv_intr_release(avc->intr);
+		for (i = 0; i <= avc->table->mask; i++) {
+			node = avc->table->slots[i];
 			while (node) {
 				ntmp = node;
 				node = node->next;
@@ -920,6 +1531,18 @@ static OSKIT_COMDECL_U avc_release(oskit_avc_t *a)
 						     sizeof(avc_node_t));
 			}
 		}
+		oskit_osenv_mem_free(avc->mem, avc->table, 0,
+				     AVC_TABLE_SIZE(avc->table->mask + 1));
+		avc_free_retired(avc);
+		for (i = 0; i < AVC_STATS_SLOTS; i++) {
+			st = avc->stats[i];
+			while (st) {
+				sttmp = st;
+				st = st->next;
+				oskit_osenv_mem_free(avc->mem, sttmp, 0, 
+						     sizeof(avc_stat_node_t));
+			}
+		}
 		node = avc->freelist;
 		while (node) {
 			ntmp = node;
@@ -977,7 +1600,11 @@ static struct oskit_avc_ops avc_ops = {
     avc_add_callback,
     avc_remove_callback,
     avc_log_contents,
-    avc_log_stats
+    avc_log_stats,
+    avc_set_size,
+    avc_lookup_stats,
+    avc_get_stats,
+    avc_has_perm_batch
 };
 
 static struct oskit_avc_ss_ops avc_ss_ops = {
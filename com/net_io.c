@@ -30,6 +30,8 @@ struct client_netio {
 	oskit_netio_t	ioi;		/* COM I/O Interface */
 	unsigned 	count;		/* reference count */
 	oskit_error_t	(*func)(void *data, oskit_bufio_t *b, oskit_size_t size);
+	oskit_error_t	(*batchfunc)(void *data, oskit_bufio_t **bufs,
+				     oskit_size_t *sizes, unsigned count);
 	void		*data;
 	void		(*cleanup)(void *data); /* cleanup destructor */
 };
@@ -113,6 +115,31 @@ net_push(oskit_netio_t *ioi, oskit_bufio_t *b, oskit_size_t pkt_size)
 	return po->func(po->data, b, pkt_size);
 }
 
+/*
+ * Receive a batch of packets, all at once if the client said how.
+ */
+static OSKIT_COMDECL
+net_push_batch(oskit_netio_t *ioi, oskit_bufio_t **bufs, oskit_size_t *sizes,
+	       unsigned count)
+{
+	struct client_netio *po = (struct client_netio *)ioi;
+	oskit_error_t rc, err = 0;
+	unsigned i;
+
+	assert(po != NULL);
+	assert(po->count != 0);
+
+	if (po->batchfunc)
+		return po->batchfunc(po->data, bufs, sizes, count);
+
+	for (i = 0; i < count; i++) {
+		rc = po->func(po->data, bufs[i], sizes[i]);
+		if (rc && !err)
+			err = rc;
+	}
+	return err;
+}
+
 /*
  * Unimplemented bufio allocator
  */
@@ -129,12 +156,15 @@ struct oskit_netio_ops client_netio_ops = {
 	net_addref, 
 	net_release,
 	net_push,
-	net_alloc_bufio
+	net_alloc_bufio,
+	net_push_batch
 };
 
 oskit_netio_t *
-oskit_netio_create_cleanup(oskit_error_t (*func)(void *data, oskit_bufio_t *b,
+oskit_netio_create_batch(oskit_error_t (*func)(void *data, oskit_bufio_t *b,
 				   oskit_size_t pkt_size),
+	      oskit_error_t (*batchfunc)(void *data, oskit_bufio_t **bufs,
+				   oskit_size_t *sizes, unsigned count),
 	      void *data, void (*destructor)(void *data))
 {
 	struct client_netio *c;
@@ -146,12 +176,21 @@ oskit_netio_create_cleanup(oskit_error_t (*func)(void *data, oskit_bufio_t *b,
         c->ioi.ops = &client_netio_ops;
         c->count = 1;
 	c->func = func;
+	c->batchfunc = batchfunc;
 	c->data = data;
 	c->cleanup = destructor;
 
         return &c->ioi;
 }
 
+oskit_netio_t *
+oskit_netio_create_cleanup(oskit_error_t (*func)(void *data, oskit_bufio_t *b,
+				   oskit_size_t pkt_size),
+	      void *data, void (*destructor)(void *data))
+{
+	return oskit_netio_create_batch(func, NULL, data, destructor);
+}
+
 oskit_netio_t *
 oskit_netio_create(oskit_error_t (*func)(void *data, oskit_bufio_t *b,
 				   oskit_size_t pkt_size),
@@ -15,7 +15,12 @@
  * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
  */
 /*
- * Maintained in ascending order.
+ * A binary heap, kept in an array of pointers to nodes. Each node knows
+ * where it is in the heap, and the nodes are also hashed on the object
+ * pointer, so that removing an arbitrary object is O(log n) like
+ * everything else.
+ *
+ * Equal keys come out in the order they went in.
  */
 
 #include <oskit/com/pqueue.h>
@@ -28,16 +33,152 @@ struct pqueue {
 	oskit_u32_t		p_count;
 
 	oskit_size_t		p_size;
-	struct pqueue_node	*p_head;
+	struct pqueue_node	**p_heap;	/* p_heap[0] is the front */
+	oskit_size_t		p_heapsize;	/* slots in p_heap */
+	struct pqueue_node	**p_hash;	/* index on pn_obj */
+	oskit_size_t		p_hashsize;	/* buckets, a power of 2 */
+	struct pqueue_node	*p_free;	/* spare nodes */
+	oskit_size_t		*p_frontier;	/* for first_satisfying */
+	oskit_u32_t		p_seq;		/* for ordering equal keys */
 };
 
 struct pqueue_node {
 	oskit_iunknown_t	*pn_obj;
 	oskit_pqueue_key_t	pn_val;
-	struct pqueue_node	*pn_next;
+	oskit_u32_t		pn_seq;
+	oskit_size_t		pn_index;	/* where in p_heap */
+	struct pqueue_node	*pn_next;	/* hash chain or free list */
 };
 
-
+#define MIN_SLOTS	16
+
+/*
+ * first_satisfying never has more than about half the heap on its
+ * frontier at once.
+ */
+#define FRONTIER_SLOTS(slots)	((slots) / 2 + 2)
+
+#define BEFORE(a, b) \
+	((a)->pn_val < (b)->pn_val || \
+	 ((a)->pn_val == (b)->pn_val && (int)((a)->pn_seq - (b)->pn_seq) < 0))
+
+#define HASH(pq, obj) \
+	((((oskit_addr_t)(obj) >> 3) * 2654435761U) & ((pq)->p_hashsize - 1))
+
+static inline void
+heap_set(struct pqueue *pq, oskit_size_t i, struct pqueue_node *node)
+{
+	pq->p_heap[i] = node;
+	node->pn_index = i;
+}
+
+static void
+sift_up(struct pqueue *pq, oskit_size_t i)
+{
+	struct pqueue_node *node = pq->p_heap[i];
+	oskit_size_t parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (!BEFORE(node, pq->p_heap[parent]))
+			break;
+		heap_set(pq, i, pq->p_heap[parent]);
+		i = parent;
+	}
+	heap_set(pq, i, node);
+}
+
+static void
+sift_down(struct pqueue *pq, oskit_size_t i)
+{
+	struct pqueue_node *node = pq->p_heap[i];
+	oskit_size_t child;
+
+	while ((child = 2 * i + 1) < pq->p_size) {
+		if (child + 1 < pq->p_size &&
+		    BEFORE(pq->p_heap[child + 1], pq->p_heap[child]))
+			child++;
+		if (!BEFORE(pq->p_heap[child], node))
+			break;
+		heap_set(pq, i, pq->p_heap[child]);
+		i = child;
+	}
+	heap_set(pq, i, node);
+}
+
+/*
+ * Double the heap array, and the hash table and frontier with it.
+ */
+static oskit_error_t
+grow(struct pqueue *pq)
+{
+	struct pqueue_node **heap, **hash, **bucket, *node;
+	oskit_size_t slots, i, *frontier;
+
+	slots = pq->p_heapsize ? pq->p_heapsize * 2 : MIN_SLOTS;
+
+	heap = malloc(slots * sizeof *heap);
+	if (heap == NULL)
+		return OSKIT_E_OUTOFMEMORY;
+	hash = malloc(slots * sizeof *hash);
+	if (hash == NULL) {
+		free(heap);
+		return OSKIT_E_OUTOFMEMORY;
+	}
+	frontier = malloc(FRONTIER_SLOTS(slots) * sizeof *frontier);
+	if (frontier == NULL) {
+		free(hash);
+		free(heap);
+		return OSKIT_E_OUTOFMEMORY;
+	}
+	if (pq->p_frontier)
+		free(pq->p_frontier);
+	pq->p_frontier = frontier;
+
+	if (pq->p_heap) {
+		memcpy(heap, pq->p_heap, pq->p_size * sizeof *heap);
+		free(pq->p_heap);
+	}
+	pq->p_heap = heap;
+	pq->p_heapsize = slots;
+
+	/*
+	 * Every node is in the heap, so rehash from there.
+	 */
+	memset(hash, 0, slots * sizeof *hash);
+	if (pq->p_hash)
+		free(pq->p_hash);
+	pq->p_hash = hash;
+	pq->p_hashsize = slots;
+	for (i = 0; i < pq->p_size; i++) {
+		node = pq->p_heap[i];
+		bucket = &pq->p_hash[HASH(pq, node->pn_obj)];
+		node->pn_next = *bucket;
+		*bucket = node;
+	}
+	return 0;
+}
+
+/*
+ * Find the node for the first occurrence of OBJ, if any.
+ * Returns a pointer to the hash chain link that points to it.
+ */
+static struct pqueue_node **
+lookup(struct pqueue *pq, oskit_iunknown_t *obj)
+{
+	struct pqueue_node **link, **best = NULL;
+
+	if (pq->p_hashsize == 0)
+		return NULL;
+
+	for (link = &pq->p_hash[HASH(pq, obj)]; *link;
+	     link = &(*link)->pn_next)
+		if ((*link)->pn_obj == obj &&
+		    (best == NULL || BEFORE(*link, *best)))
+			best = link;
+	return best;
+}
+
 static OSKIT_COMDECL
 pqueue_query(oskit_pqueue_t *_, const oskit_iid_t *iid, void **out_ihandle)
 {
@@ -70,20 +211,28 @@ static OSKIT_COMDECL_U
 pqueue_release(oskit_pqueue_t *_)
 {
 	struct pqueue *pq = (void *)_;
-	struct pqueue_node *cur, *next;
+	struct pqueue_node *cur;
 
 	assert(pq && pq->p_count);
 
 	if (--pq->p_count)
 		return pq->p_count;
 
-	cur = pq->p_head;
-	while (cur) {
-		next = cur->pn_next;
+	while (pq->p_size) {
+		cur = pq->p_heap[--pq->p_size];
 		oskit_iunknown_release(cur->pn_obj);
 		free(cur);
-		cur = next;
 	}
+	while ((cur = pq->p_free) != NULL) {
+		pq->p_free = cur->pn_next;
+		free(cur);
+	}
+	if (pq->p_heap)
+		free(pq->p_heap);
+	if (pq->p_hash)
+		free(pq->p_hash);
+	if (pq->p_frontier)
+		free(pq->p_frontier);
 	free(pq);
 	return 0;
 }
@@ -92,44 +241,34 @@ static OSKIT_COMDECL
 pqueue_enqueue(oskit_pqueue_t *_, oskit_iunknown_t *obj, oskit_pqueue_key_t val)
 {
 	struct pqueue *pq = (void *)_;
-	struct pqueue_node *node, *prev, *cur;
+	struct pqueue_node *node, **bucket;
+	oskit_error_t rc;
 
         if (pq == NULL || pq->p_count == 0)
                 return OSKIT_E_INVALIDARG;
 
+	if (pq->p_size == pq->p_heapsize && (rc = grow(pq)) != 0)
+		return rc;
+
 	/*
-	 * Make a node we'll glue in somewhere.
+	 * Reuse a node from the last remove if there is one;
+	 * schedulers tend to take something off and put it straight back.
 	 */
-	node = malloc(sizeof *node);
-	if (node == NULL)
+	if ((node = pq->p_free) != NULL)
+		pq->p_free = node->pn_next;
+	else if ((node = malloc(sizeof *node)) == NULL)
 		return OSKIT_E_OUTOFMEMORY;
 	node->pn_obj = obj;
 	oskit_iunknown_addref(obj);
 	node->pn_val = val;
+	node->pn_seq = pq->p_seq++;
 
-	/*
-	 * Is OBJ gonna be the new head?
-	 */
-	if (pq->p_head == NULL || val < pq->p_head->pn_val) {
-		node->pn_next = pq->p_head;
-		pq->p_head = node;
-		pq->p_size++;
-		return 0;
-	}
+	bucket = &pq->p_hash[HASH(pq, obj)];
+	node->pn_next = *bucket;
+	*bucket = node;
 
-	/*
-	 * OBJ must go somewhere after the head.
-	 * Find a guy larger than (or equal to) us and get in front of him.
-	 * If we're the largest, get in back.
-	 */
-	cur = pq->p_head;
-	do {
-		prev = cur;
-		cur = cur->pn_next;
-	} while (cur && cur->pn_val < val);
-	node->pn_next = cur;
-	prev->pn_next = node;
-	pq->p_size++;
+	heap_set(pq, pq->p_size++, node);
+	sift_up(pq, node->pn_index);
 	return 0;
 }
 
@@ -145,52 +284,52 @@ pqueue_front(oskit_pqueue_t *_, oskit_pqueue_key_t *valp)
 		return NULL;
 
 	if (valp)
-		*valp = pq->p_head->pn_val;
-	oskit_iunknown_addref(pq->p_head->pn_obj);
-	return pq->p_head->pn_obj;
+		*valp = pq->p_heap[0]->pn_val;
+	oskit_iunknown_addref(pq->p_heap[0]->pn_obj);
+	return pq->p_heap[0]->pn_obj;
 }
 
 static OSKIT_COMDECL
 pqueue_remove(oskit_pqueue_t *_, oskit_iunknown_t *obj)
 {
 	struct pqueue *pq = (void *)_;
-	struct pqueue_node *prev, *cur, *victim;
+	struct pqueue_node **link, *victim, *last;
+	oskit_size_t i;
 
         if (pq == NULL || pq->p_count == 0)
                 return OSKIT_E_INVALIDARG;
 
 	/*
-	 * Empty queue?
+	 * Empty queue, or not in it?
 	 */
-	if (pq->p_size == 0)
+	if (pq->p_size == 0 || (link = lookup(pq, obj)) == NULL)
 		return OSKIT_E_FAIL;
+	victim = *link;
+	*link = victim->pn_next;
 
 	/*
-	 * Removing the head?
+	 * Move the last node into the hole and let it find its level.
 	 */
-	if (pq->p_head->pn_obj == obj) {
-		victim = pq->p_head;
-		pq->p_head = pq->p_head->pn_next;
-		goto found;
+	i = victim->pn_index;
+	last = pq->p_heap[--pq->p_size];
+	if (last != victim) {
+		heap_set(pq, i, last);
+		if (i > 0 && BEFORE(last, pq->p_heap[(i - 1) / 2]))
+			sift_up(pq, i);
+		else
+			sift_down(pq, i);
 	}
 
+	oskit_iunknown_release(victim->pn_obj);
+
 	/*
-	 * Otherwise removing part of the body.
+	 * Keep one spare node around; free the rest.
 	 */
-	prev = cur = pq->p_head;
-	while (cur && cur->pn_obj != obj) {
-		prev = cur;
-		cur = cur->pn_next;
-	}
-	if (cur == NULL)
-		return OSKIT_E_FAIL;
-	victim = cur;
-	prev->pn_next = cur->pn_next;
-
- found:
-	oskit_iunknown_release(victim->pn_obj);
-	free(victim);
-	pq->p_size--;
+	if (pq->p_free == NULL) {
+		victim->pn_next = NULL;
+		pq->p_free = victim;
+	} else
+		free(victim);
 	return 0;
 }
 
@@ -204,23 +343,71 @@ pqueue_size(oskit_pqueue_t *_)
 	return pq->p_size;
 }
 
+/*
+ * The predicate has to be tried in ascending order, and the caller is
+ * entitled to expect that. Walk the heap best-first: keep a little heap
+ * of the heap slots that have not been looked at yet but whose parents
+ * have, and always look at the smallest. That way we only go as far
+ * down the heap as we have to.
+ */
+#define FBEFORE(i, j)	BEFORE(pq->p_heap[i], pq->p_heap[j])
+
 static oskit_iunknown_t * OSKIT_COMCALL
 pqueue_first_satisfying(oskit_pqueue_t *_,
 			oskit_bool_t (*predicate)(oskit_iunknown_t *,
 						  oskit_pqueue_key_t))
 {
 	struct pqueue *pq = (void *)_;
-	struct pqueue_node *cur;
+	struct pqueue_node *cur, *found = NULL;
+	oskit_size_t *front = pq->p_frontier;
+	oskit_size_t n, i, j, k, child, tmp;
 
 	assert(pq && pq->p_count);
 
-	if (pq->p_head)
-		for (cur = pq->p_head; cur; cur = cur->pn_next)
-			if (predicate(cur->pn_obj, cur->pn_val)) {
-				oskit_iunknown_addref(cur->pn_obj);
-				return cur->pn_obj;
+	if (pq->p_size == 0)
+		return NULL;
+
+	n = 0;
+	front[n++] = 0;
+	while (n) {
+		/*
+		 * Pop the smallest slot off the frontier.
+		 */
+		i = front[0];
+		front[0] = front[--n];
+		for (j = 0; (child = 2 * j + 1) < n; j = child) {
+			if (child + 1 < n && FBEFORE(front[child + 1],
+						     front[child]))
+				child++;
+			if (!FBEFORE(front[child], front[j]))
+				break;
+			tmp = front[j], front[j] = front[child],
+				front[child] = tmp;
+		}
+
+		cur = pq->p_heap[i];
+		if (predicate(cur->pn_obj, cur->pn_val)) {
+			found = cur;
+			break;
+		}
+
+		/*
+		 * Now its children are candidates.
+		 */
+		for (k = 2 * i + 1; k <= 2 * i + 2 && k < pq->p_size; k++) {
+			front[j = n++] = k;
+			while (j > 0 && FBEFORE(front[j], front[(j - 1) / 2])) {
+				tmp = front[j], front[j] = front[(j - 1) / 2],
+					front[(j - 1) / 2] = tmp;
+				j = (j - 1) / 2;
 			}
-	return NULL;
+		}
+	}
+
+	if (found == NULL)
+		return NULL;
+	oskit_iunknown_addref(found->pn_obj);
+	return found->pn_obj;
 }
 
 
@@ -235,7 +422,7 @@ static struct oskit_pqueue_ops pqueue_ops = {
 	pqueue_first_satisfying,
 };
 
-
+
 oskit_error_t
 oskit_pqueue_create(oskit_pqueue_t **out_pq)
 {
@@ -248,7 +435,13 @@ oskit_pqueue_create(oskit_pqueue_t **out_pq)
 	pq->p_ioi.ops = &pqueue_ops;
 	pq->p_count = 1;
 	pq->p_size = 0;
-	pq->p_head = NULL;
+	pq->p_heap = NULL;
+	pq->p_heapsize = 0;
+	pq->p_hash = NULL;
+	pq->p_hashsize = 0;
+	pq->p_free = NULL;
+	pq->p_frontier = NULL;
+	pq->p_seq = 0;
 
 	*out_pq = &pq->p_ioi;
 	return 0;
@@ -261,20 +454,22 @@ oskit_pqueue_dump(oskit_pqueue_t *_)
 {
 	struct pqueue *pq = (void *)_;
 	struct pqueue_node *cur;
+	oskit_size_t i;
 
 	assert(pq && pq->p_count);
 
 	printf("%d: ( ", pq->p_size);
-	if (pq->p_head)
-		for (cur = pq->p_head; cur; cur = cur->pn_next)
-			if (sizeof(oskit_pqueue_key_t) == sizeof(oskit_u64_t))
-				printf("<%p,0x%x%08x> ",
-				       cur->pn_obj,
-				       (oskit_u32_t)(cur->pn_val >> 32),
-				       (oskit_u32_t)(cur->pn_val & 0xffffffff));
-			else
-				printf("<%p,0x%08x> ",
-				       cur->pn_obj, cur->pn_val);
+	for (i = 0; i < pq->p_size; i++) {
+		cur = pq->p_heap[i];
+		if (sizeof(oskit_pqueue_key_t) == sizeof(oskit_u64_t))
+			printf("<%p,0x%x%08x> ",
+			       cur->pn_obj,
+			       (oskit_u32_t)(cur->pn_val >> 32),
+			       (oskit_u32_t)(cur->pn_val & 0xffffffff));
+		else
+			printf("<%p,0x%08x> ",
+			       cur->pn_obj, cur->pn_val);
+	}
 	printf(")\n");
 }
 #endif
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 1996, 1998, 1999 University of Utah and the Flux Group.
+ * Copyright (c) 1996, 1998, 1999, 2002 University of Utah and the Flux Group.
  * All rights reserved.
  * 
  * This file is part of the Flux OSKit.  The OSKit is free software, also known
@@ -23,39 +23,54 @@
  * Interfaces will be returned in the order in which they were registered.
  * It's harmless to register an interface multiple times;
  * only a single entry in the table will be retained.
- * Currently just does everything with simple lists;
- * if we end up having lots of objects, we may need smarter algorithms.
+ * The IIDs are kept in a small hash table, so a lookup costs the same
+ * however many different interfaces have been registered.
  */
 
 /*
- * Locking! This is not thread safe, which is *going* to cause problems.
+ * Locking! Lookups take no lock, and may run at any time, including
+ * from an interrupt handler that has preempted a registration or
+ * removal. A registration fills in a node before linking it in, and a
+ * removed node keeps its link, so a lookup walking the list always
+ * finds its way to the end; removed nodes are only released and freed
+ * once no lookup is in progress. Registrations and removals are not
+ * serialized against each other; callers that do those from more than
+ * one thread must still provide their own lock.
  */
 
 #include <oskit/com.h>
 #include <oskit/com/services.h>
 #include <oskit/com/mem.h>
+#include <oskit/machine/atomic.h>
 #include <oskit/c/stdlib.h>
 #include <oskit/c/assert.h>
 #include <oskit/c/string.h>
 
 static struct oskit_services_ops services_ops;
 
+#define SERVICES_HASH_BITS	6
+#define SERVICES_HASH		(1 << SERVICES_HASH_BITS)	/* IID buckets */
+
+/* Keep the compiler from moving stores across a publication. */
+#define SERVICES_BARRIER()	__asm__ __volatile__("" : : : "memory")
+
 /*
  * One of these nodes represents each registered COM interface (object)
  */
 struct objnode {
-	struct objnode *next;
+	struct objnode * volatile next;
 	oskit_iunknown_t *intf;
+	struct objnode *retired;	/* removed, waiting to be freed */
 };
 
 /*
  * We keep one iidnode for each unique IID we see
  */
 struct iidnode {
-	struct iidnode *next;
+	struct iidnode *next;		/* hash chain */
 	oskit_guid_t iid;
-	struct objnode *objs;
-	int objcount;
+	struct objnode * volatile objs;	/* first one is "the" service */
+	volatile int objcount;
 };
 
 /*
@@ -65,10 +80,66 @@ struct iidnode {
 struct db {
 	oskit_services_t	servi;		/* COM interface */
 	int			count;		/* Reference count */
-	struct iidnode		*iids;		/* DB pointer */
+	struct iidnode * volatile iids[SERVICES_HASH];
+	struct objnode		*retired;	/* removed objnodes */
+	atomic_t		readers;	/* lookups in progress */
 	oskit_mem_t		*memi;		/* Memory object to use */
 };
 
+/*
+ * Most of the OSKit's IIDs differ only in the first word, and mostly
+ * in its low bits, so mix the words and take the top bits of the
+ * product.
+ */
+static inline unsigned
+iid_hash(const oskit_guid_t *iid)
+{
+	const oskit_u32_t *w = (const oskit_u32_t *) iid;
+
+	return ((w[0] ^ w[1] ^ w[2] ^ w[3]) * 0x9e3779b1U)
+		>> (32 - SERVICES_HASH_BITS);
+}
+
+static inline int
+iid_equal(const oskit_guid_t *a, const oskit_guid_t *b)
+{
+	const oskit_u32_t *x = (const oskit_u32_t *) a;
+	const oskit_u32_t *y = (const oskit_u32_t *) b;
+
+	return x[0] == y[0] && x[1] == y[1] && x[2] == y[2] && x[3] == y[3];
+}
+
+static inline struct iidnode *
+iid_find(struct db *s, const oskit_guid_t *iid)
+{
+	struct iidnode *in;
+
+	for (in = s->iids[iid_hash(iid)]; in; in = in->next)
+		if (iid_equal(&in->iid, iid))
+			break;
+	return in;
+}
+
+/*
+ * Drop the references held by the removed objnodes and free them, once
+ * no lookup can still be looking at them. Until then a lookup may find
+ * the interface and take its own reference, so ours has to stay.
+ */
+static void
+free_retired(struct db *s)
+{
+	struct objnode	*on;
+
+	if (atomic_read(&s->readers))
+		return;
+
+	while ((on = s->retired) != NULL) {
+		s->retired = on->retired;
+		oskit_iunknown_release(on->intf);
+		oskit_mem_free(s->memi, (void *) on, sizeof(*on), 0);
+	}
+}
+
 static OSKIT_COMDECL
 services_query(oskit_services_t *si,
 	       const oskit_iid_t *iid, void **out_ihandle)
@@ -106,25 +177,30 @@ services_release(oskit_services_t *si)
 		oskit_mem_t	*memi = s->memi;
 		struct iidnode  *in, *nin;
 		struct objnode  *on, *non;
+		int		i;
 
 		/*
 		 * Must free up all the registered interface objects.
 		 */
-		in = s->iids;
-		while (in) {
-			on = in->objs;
-			while (on) {
-				oskit_iunknown_release(on->intf);
-				non = on->next;
-				oskit_mem_free(memi,
-					       (void *) on, sizeof(*on), 0);
-				on  = non;
+		for (i = 0; i < SERVICES_HASH; i++) {
+			in = s->iids[i];
+			while (in) {
+				on = in->objs;
+				while (on) {
+					oskit_iunknown_release(on->intf);
+					non = on->next;
+					oskit_mem_free(memi, (void *) on,
+						       sizeof(*on), 0);
+					on  = non;
+				}
+
+				nin = in->next;
+				oskit_mem_free(memi, (void *) in,
+					       sizeof(*in), 0);
+				in  = nin;
 			}
-
-			nin = in->next;
-			oskit_mem_free(memi, (void *) in, sizeof(*in), 0);
-			in  = nin;
 		}
+		free_retired(s);
 
 		oskit_mem_free(memi, (void *)s, sizeof(*s), 0);
 		oskit_mem_release(memi);
@@ -144,23 +220,24 @@ services_addservice(oskit_services_t *si,
 	struct db	 *s = (struct db *) si;
 	oskit_iunknown_t *iu = (oskit_iunknown_t*)interface;
 	struct iidnode   *in;
-	struct objnode   *on, **onp;
+	struct objnode   *on;
+	struct objnode * volatile *onp;
+
+	free_retired(s);
 
 	/* Find or create the appropriate iidnode */
-	for (in = s->iids; ; in = in->next) {
-		if (in == NULL) {
-			in = oskit_mem_alloc(s->memi, sizeof(*in), 0);
-			if (in == NULL)
-				return OSKIT_E_OUTOFMEMORY;
-			in->iid = *iid;
-			in->objs = NULL;
-			in->objcount = 0;
-			in->next = s->iids;
-			s->iids = in;
-			break;
-		}
-		if (memcmp(&in->iid, iid, sizeof(*iid)) == 0)
-			break;
+	if ((in = iid_find(s, iid)) == NULL) {
+		unsigned h = iid_hash(iid);
+
+		in = oskit_mem_alloc(s->memi, sizeof(*in), 0);
+		if (in == NULL)
+			return OSKIT_E_OUTOFMEMORY;
+		in->iid = *iid;
+		in->objs = NULL;
+		in->objcount = 0;
+		in->next = s->iids[h];
+		SERVICES_BARRIER();
+		s->iids[h] = in;
 	}
 
 	/* Make sure this interface isn't already registered */
@@ -174,7 +251,9 @@ services_addservice(oskit_services_t *si,
 	if (on == NULL)
 		return OSKIT_E_OUTOFMEMORY;
 	on->next = NULL;
+	on->retired = NULL;
 	on->intf = iu;	oskit_iunknown_addref(iu);
+	SERVICES_BARRIER();
 	*onp = on;
 	in->objcount++;
 
@@ -183,6 +262,8 @@ services_addservice(oskit_services_t *si,
 
 /*
  * Unregister a previously registered interface.
+ * The objnode keeps its link and its reference, for any lookup
+ * standing on it.
  */
 OSKIT_COMDECL
 services_remservice(oskit_services_t *si,
@@ -190,15 +271,14 @@ services_remservice(oskit_services_t *si,
 {
 	struct db	 *s = (struct db *) si;
 	struct iidnode   *in;
-	struct objnode   *on, **onp;
+	struct objnode   *on;
+	struct objnode * volatile *onp;
+
+	free_retired(s);
 
 	/* Find the appropriate iidnode */
-	for (in = s->iids; ; in = in->next) {
-		if (in == NULL)
-			return OSKIT_E_INVALIDARG;
-		if (memcmp(&in->iid, iid, sizeof(*iid)) == 0)
-			break;
-	}
+	if ((in = iid_find(s, iid)) == NULL)
+		return OSKIT_E_INVALIDARG;
 
 	/* Find and remove the objnode */
 	for (onp = &in->objs; ; onp = &on->next) {
@@ -209,10 +289,12 @@ services_remservice(oskit_services_t *si,
 			break;
 	}
 	*onp = on->next;
-	oskit_iunknown_release(on->intf);
-	oskit_mem_free(s->memi, (void *) on, sizeof(*on), 0);
 	in->objcount--;
 
+	on->retired = s->retired;
+	s->retired = on;
+	free_retired(s);
+
 	return 0;
 }
 
@@ -227,18 +309,14 @@ services_lookup(oskit_services_t *si,
 	struct iidnode *in;
 	struct objnode *on;
 	void **arr;
-	int i;
+	int i, count;
+
+	atomic_inc(&s->readers);
 
 	/* Find the appropriate iidnode */
-	for (in = s->iids; ; in = in->next) {
-		if (in == NULL) {
-			*out_interface_array = NULL;
-			return 0;
-		}
-		if (memcmp(&in->iid, iid, sizeof(*iid)) == 0)
-			break;
-	}
-	if (in->objcount == 0) {
+	in = iid_find(s, iid);
+	if (in == NULL || (count = in->objcount) <= 0) {
+		atomic_dec(&s->readers);
 		*out_interface_array = NULL;
 		return 0;
 	}
@@ -248,25 +326,34 @@ services_lookup(oskit_services_t *si,
 	 * Note that we *do* use malloc here, since the caller is responsible
 	 * for freeing up the array.
 	 */
-	arr = malloc(sizeof(*arr)*in->objcount);
-	if (arr == NULL)
+	arr = malloc(sizeof(*arr)*count);
+	if (arr == NULL) {
+		atomic_dec(&s->readers);
 		return OSKIT_E_OUTOFMEMORY;
+	}
 
-	/* Fill it in */
-	for (i = 0, on = in->objs; i < in->objcount; i++, on = on->next) {
-		assert(on != NULL);
+	/*
+	 * Fill it in. Something may have been removed since we
+	 * counted, so the list can run out first.
+	 */
+	for (i = 0, on = in->objs; i < count && on; i++, on = on->next) {
 		arr[i] = on->intf;
 		oskit_iunknown_addref(on->intf);
 	}
-	assert(on == NULL);
+	atomic_dec(&s->readers);
 
+	if (i == 0) {
+		free(arr);
+		arr = NULL;
+	}
 	*out_interface_array = arr;
-	return in->objcount;
+	return i;
 }
 
 /*
  * Lookup the first interface registered for a given IID.
- * This is typically used to look up "the" instance of a service
+ * This is typically used to look up "the" instance of a service,
+ * so it is just a hash probe and a load.
  */
 OSKIT_COMDECL
 services_lookup_first(oskit_services_t *si,
@@ -274,24 +361,17 @@ services_lookup_first(oskit_services_t *si,
 {
 	struct db	 *s = (struct db *) si;
 	struct iidnode *in;
-	oskit_iunknown_t *intf;
+	struct objnode *on;
+	oskit_iunknown_t *intf = NULL;
 
-	/* Find the appropriate iidnode */
-	for (in = s->iids; ; in = in->next) {
-		if (in == NULL) {
-			*out_intf = NULL;
-			return 0;
-		}
-		if (memcmp(&in->iid, iid, sizeof(*iid)) == 0)
-			break;
-	}
-	if (in->objcount == 0) {
-		*out_intf = NULL;
-		return 0;
+	atomic_inc(&s->readers);
+	if ((in = iid_find(s, iid)) != NULL && (on = in->objs) != NULL) {
+		intf = on->intf;
+		oskit_iunknown_addref(intf);
 	}
+	atomic_dec(&s->readers);
 
-	*out_intf = intf = in->objs->intf;
-	oskit_iunknown_addref(intf);
+	*out_intf = intf;
 	return 0;
 }
 
@@ -303,29 +383,28 @@ services_clone(oskit_services_t *si, oskit_services_t **out_intf)
 	struct iidnode  *in;
 	struct objnode  *on;
 	oskit_error_t	rc;
+	int		i;
 
 	ns = oskit_mem_alloc(s->memi, sizeof(*ns), 0);
 	if (ns == NULL)
 		return OSKIT_E_OUTOFMEMORY;
 
+	memset(ns, 0, sizeof(*ns));
 	ns->count     = 1;
 	ns->memi      = s->memi;
 	ns->servi.ops = &services_ops;
-	ns->iids      = 0;
 	oskit_mem_addref(ns->memi);
 
-	in = s->iids;
-	while (in) {
-		on = in->objs;
-		while (on) {
-			if ((rc = services_addservice(&ns->servi,
-						      &in->iid, on->intf))
-			    != NULL) {
-				panic("services_clone");
+	for (i = 0; i < SERVICES_HASH; i++) {
+		for (in = s->iids[i]; in; in = in->next) {
+			for (on = in->objs; on; on = on->next) {
+				if ((rc = services_addservice(&ns->servi,
+							&in->iid, on->intf))
+				    != NULL) {
+					panic("services_clone");
+				}
 			}
-			on = on->next;
 		}
-		in = in->next;
 	}
 
 	*out_intf = &ns->servi;
@@ -368,10 +447,10 @@ oskit_services_create(oskit_mem_t *memi, oskit_services_t **out_intf)
 	if (s == NULL)
 		return OSKIT_E_OUTOFMEMORY;
 
+	memset(s, 0, sizeof(*s));
 	s->count     = 1;
 	s->memi      = memi;
 	s->servi.ops = &services_ops;
-	s->iids      = 0;
 	oskit_mem_addref(memi);
 
 	*out_intf = &s->servi;
@@ -162,5 +162,33 @@ oskit_error_t sopenfile_create(struct sfiledir *sfile,
 			       OSKIT_PERM_FILE__##_perm, \
 			       &((_sopenfile)->file_avcr))
 
+/*
+ * For operations that need several checks: fill in an array of
+ * oskit_avc_check_t and hand it to SFS_HAS_PERMS, which makes them
+ * all with one call to the AVC.
+ */
+#define SFS_FS_CHECK(_c, _csid, _sfs, _perm) \
+	OSKIT_AVC_CHECK_INIT((_c), (_csid), (_sfs)->sid, \
+			     OSKIT_SECCLASS_FILESYSTEM, \
+			     OSKIT_PERM_FILESYSTEM__##_perm, NULL)
+
+#define SFS_FILE_CHECK(_c, _csid, _sfile, _perms) \
+	OSKIT_AVC_CHECK_INIT((_c), (_csid), (_sfile)->sid, (_sfile)->sclass, \
+			     (_perms), &((_sfile)->avcr))
+
+#define SFS_FD_CHECK(_c, _csid, _sopenfile, _perm) \
+	OSKIT_AVC_CHECK_INIT((_c), (_csid), (_sopenfile)->sid, \
+			     OSKIT_SECCLASS_FD, OSKIT_PERM_FD__##_perm, \
+			     &((_sopenfile)->avcr))
+
+#define SFS_FD_FILE_CHECK(_c, _csid, _sopenfile, _perm) \
+	OSKIT_AVC_CHECK_INIT((_c), (_csid), (_sopenfile)->sfile->sid, \
+			     (_sopenfile)->sfile->sclass, \
+			     OSKIT_PERM_FILE__##_perm, \
+			     &((_sopenfile)->file_avcr))
+
+#define SFS_HAS_PERMS(_sfs, _checks, _n, _out_failed) \
+	oskit_avc_has_perm_batch((_sfs)->avc, (_checks), (_n), (_out_failed))
+
 #endif _OSKIT__COM_SFS_H_
 
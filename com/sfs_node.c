@@ -673,6 +673,7 @@ dir_link(oskit_dir_t * d, char *name,
 	 oskit_file_t * f)
 {
 	struct sfiledir *sdir, *sfile;
+	oskit_avc_check_t checks[2];
 	oskit_error_t   rc;
 	oskit_security_id_t   csid;
 
@@ -685,11 +686,10 @@ dir_link(oskit_dir_t * d, char *name,
 		return OSKIT_EINVAL;
 
 	CSID(&csid);
-	rc = SFS_DIR_HAS_PERM2(csid, sdir, SEARCH, ADD_NAME);
-	if (rc)
-		return rc;
-
-	rc = SFS_FILE_HAS_PERM(csid, sfile, LINK);
+	SFS_FILE_CHECK(&checks[0], csid, sdir,
+		       OSKIT_PERM_DIR__SEARCH | OSKIT_PERM_DIR__ADD_NAME);
+	SFS_FILE_CHECK(&checks[1], csid, sfile, OSKIT_PERM_FILE__LINK);
+	rc = SFS_HAS_PERMS(sdir->sfs, checks, 2, NULL);
 	if (rc)
 		return rc;
 
@@ -735,6 +735,7 @@ dir_rename(oskit_dir_t * old_d, char *old_name,
 	   oskit_dir_t * new_d, char *new_name)
 {
 	struct sfiledir *sdirf, *sdirt, *sfilef, *sfilet;
+	oskit_avc_check_t checks[2];
 	oskit_security_id_t   csid;
 	oskit_error_t   rc;
 
@@ -745,9 +746,11 @@ dir_rename(oskit_dir_t * old_d, char *old_name,
 	sdirt = (struct sfiledir *) new_d;
 
 	CSID(&csid);
-	rc = SFS_DIR_HAS_PERM2(csid, sdirf, SEARCH, REMOVE_NAME);
-	if (!rc)
-		rc = SFS_DIR_HAS_PERM2(csid, sdirt, SEARCH, ADD_NAME);
+	SFS_FILE_CHECK(&checks[0], csid, sdirf,
+		       OSKIT_PERM_DIR__SEARCH | OSKIT_PERM_DIR__REMOVE_NAME);
+	SFS_FILE_CHECK(&checks[1], csid, sdirt,
+		       OSKIT_PERM_DIR__SEARCH | OSKIT_PERM_DIR__ADD_NAME);
+	rc = SFS_HAS_PERMS(sdirf->sfs, checks, 2, NULL);
 	if (rc)
 		return rc;
 
@@ -800,18 +803,15 @@ file_create_checks(oskit_security_id_t csid,
 		   oskit_security_class_t tclass,
 		   oskit_security_id_t new_fsid)
 {
-	oskit_error_t   rc;
-
-	rc = SFS_DIR_HAS_PERM2(csid, sdir, SEARCH, ADD_NAME);
-	if (rc)
-		return rc;
+	oskit_avc_check_t checks[3];
 
-	rc = oskit_avc_has_perm(sdir->sfs->avc, csid, new_fsid,
-				tclass, OSKIT_PERM_FILE__CREATE);
-	if (rc)
-		return rc;
+	SFS_FILE_CHECK(&checks[0], csid, sdir,
+		       OSKIT_PERM_DIR__SEARCH | OSKIT_PERM_DIR__ADD_NAME);
+	OSKIT_AVC_CHECK_INIT(&checks[1], csid, new_fsid, tclass,
+			     OSKIT_PERM_FILE__CREATE, NULL);
+	SFS_FS_CHECK(&checks[2], new_fsid, sdir->sfs, ASSOCIATE);
 
-	return SFS_FS_HAS_PERM(new_fsid, sdir->sfs, ASSOCIATE);
+	return SFS_HAS_PERMS(sdir->sfs, checks, 3, NULL);
 }
 
 
@@ -1262,34 +1262,32 @@ file_open_checks(oskit_security_id_t csid,
 		 oskit_security_id_t ofsid,
 		 oskit_oflags_t oflags)
 {
+	oskit_avc_check_t checks[3];
+	oskit_u32_t	n = 0, failed, write = ~0;
 	oskit_error_t   rc;
 
 
-	if (csid != ofsid) {
-		rc = oskit_avc_has_perm(sfile->sfs->avc, csid, ofsid,
-					OSKIT_SECCLASS_FD,
-					OSKIT_PERM_FD__CREATE);
-		if (rc)
-			return rc;
+	if (csid != ofsid)
+		OSKIT_AVC_CHECK_INIT(&checks[n++], csid, ofsid,
+				     OSKIT_SECCLASS_FD, OSKIT_PERM_FD__CREATE,
+				     NULL);
+	if (oflags & OSKIT_O_RDONLY)
+		SFS_FILE_CHECK(&checks[n++], ofsid, sfile,
+			       OSKIT_PERM_FILE__READ);
+	if ((oflags & OSKIT_O_WRONLY) && sfile->filei.ops == &file_ops) {
+		write = n;
+		SFS_FILE_CHECK(&checks[n++], ofsid, sfile,
+			       OSKIT_PERM_FILE__WRITE);
 	}
 
-	if (oflags & OSKIT_O_RDONLY) {
-		rc = SFS_FILE_HAS_PERM(ofsid, sfile, READ);
-		if (rc)
-			return rc;
-	}
-	if (oflags & OSKIT_O_WRONLY) {
-		if (sfile->filei.ops != &file_ops)
-			return OSKIT_EISDIR;
+	rc = SFS_HAS_PERMS(sfile->sfs, checks, n, &failed);
+	if (rc && failed == write && (oflags & OSKIT_O_APPEND))
+		rc = SFS_FILE_HAS_PERM(ofsid, sfile, APPEND);
+	if (rc)
+		return rc;
 
-		rc = SFS_FILE_HAS_PERM(ofsid, sfile, WRITE);
-		if (rc) {
-			if (oflags & OSKIT_O_APPEND)
-				rc = SFS_FILE_HAS_PERM(ofsid, sfile, APPEND);
-		}
-		if (rc)
-			return rc;
-	}
+	if ((oflags & OSKIT_O_WRONLY) && sfile->filei.ops != &file_ops)
+		return OSKIT_EISDIR;
 	return 0;
 }
 
@@ -1350,6 +1348,7 @@ sfile_chsid(oskit_file_secure_t * f,
 	    oskit_security_id_t newsid)
 {
 	struct sfiledir *sfile;
+	oskit_avc_check_t checks[4];
 	oskit_security_id_t   csid;
 	oskit_security_id_t   fsid;
 	oskit_error_t   rc;
@@ -1360,21 +1359,13 @@ sfile_chsid(oskit_file_secure_t * f,
 
 	CSID(&csid);
 
-	rc = SFS_FILE_HAS_PERM(csid, sfile, RELABELFROM);
-	if (rc)
-		return rc;
-
-	rc = oskit_avc_has_perm(sfile->sfs->avc, sfile->sid, newsid,
-				sfile->sclass, OSKIT_PERM_FILE__TRANSITION);
-	if (rc)
-		return rc;
-
-	rc = oskit_avc_has_perm(sfile->sfs->avc, csid, newsid,
-				sfile->sclass, OSKIT_PERM_FILE__RELABELTO);
-	if (rc)
-		return rc;
-
-	rc = SFS_FS_HAS_PERM(newsid, sfile->sfs, ASSOCIATE);
+	SFS_FILE_CHECK(&checks[0], csid, sfile, OSKIT_PERM_FILE__RELABELFROM);
+	OSKIT_AVC_CHECK_INIT(&checks[1], sfile->sid, newsid, sfile->sclass,
+			     OSKIT_PERM_FILE__TRANSITION, NULL);
+	OSKIT_AVC_CHECK_INIT(&checks[2], csid, newsid, sfile->sclass,
+			     OSKIT_PERM_FILE__RELABELTO, NULL);
+	SFS_FS_CHECK(&checks[3], newsid, sfile->sfs, ASSOCIATE);
+	rc = SFS_HAS_PERMS(sfile->sfs, checks, 4, NULL);
 	if (rc)
 		return rc;
 
@@ -172,21 +172,17 @@ ofile_release(oskit_openfile_t * f)
 static inline oskit_error_t
 ofile_read_checks(struct sopenfile * sofile)
 {
+	oskit_avc_check_t checks[2];
 	oskit_security_id_t   csid;
-	oskit_error_t   rc;
 
 	if (!(sofile->flags & OSKIT_O_RDONLY))
 		return OSKIT_EBADF;
 
 	CSID(&csid);
 	if (csid != sofile->sid) {
-		rc = SFS_FD_HAS_PERM(csid, sofile, SETATTR);
-		if (rc)
-			return rc;
-
-		rc = SFS_FD_FILE_HAS_PERM(csid, sofile, READ);
-		if (rc)
-			return rc;
+		SFS_FD_CHECK(&checks[0], csid, sofile, SETATTR);
+		SFS_FD_FILE_CHECK(&checks[1], csid, sofile, READ);
+		return SFS_HAS_PERMS(sofile->sfile->sfs, checks, 2, NULL);
 	}
 	return 0;
 }
@@ -215,7 +211,9 @@ ofile_read(oskit_openfile_t * f, void *buf, oskit_u32_t len,
 static inline oskit_error_t
 ofile_write_checks(struct sopenfile * sofile)
 {
+	oskit_avc_check_t checks[2];
 	oskit_security_id_t   csid;
+	oskit_u32_t	failed;
 	oskit_error_t   rc;
 
 	if (!(sofile->flags & OSKIT_O_WRONLY))
@@ -223,16 +221,11 @@ ofile_write_checks(struct sopenfile * sofile)
 
 	CSID(&csid);
 	if (csid != sofile->sid) {
-		rc = SFS_FD_HAS_PERM(csid, sofile, SETATTR);
-		if (rc)
-			return rc;
-
-		rc = SFS_FD_FILE_HAS_PERM(csid, sofile, WRITE);
-		if (rc) {
-			if (sofile->flags & OSKIT_O_APPEND) {
-				rc = SFS_FD_FILE_HAS_PERM(csid, sofile, APPEND);
-			}
-		}
+		SFS_FD_CHECK(&checks[0], csid, sofile, SETATTR);
+		SFS_FD_FILE_CHECK(&checks[1], csid, sofile, WRITE);
+		rc = SFS_HAS_PERMS(sofile->sfile->sfs, checks, 2, &failed);
+		if (rc && failed == 1 && (sofile->flags & OSKIT_O_APPEND))
+			rc = SFS_FD_FILE_HAS_PERM(csid, sofile, APPEND);
 
 		if (rc)
 			return rc;
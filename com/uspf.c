@@ -128,6 +128,57 @@ net_push(oskit_netio_t *io, oskit_bufio_t *b, oskit_size_t pkt_size)
 	return rc;
 }
 
+/*
+ * Filter a batch, and forward the packets that match as a batch.
+ */
+static OSKIT_COMDECL
+net_push_batch(oskit_netio_t *io, oskit_bufio_t **bufs, oskit_size_t *sizes,
+	       unsigned count)
+{
+	struct uspf_netio_impl *po = (struct uspf_netio_impl *)io;
+	oskit_bufio_t *match[OSKIT_NETIO_BATCH];
+	oskit_size_t matchsize[OSKIT_NETIO_BATCH];
+	unsigned char *frame;
+	oskit_error_t err, rc = 0;
+	unsigned i, n = 0;
+
+	assert (po != NULL);
+	assert (po->count != 0);
+
+	for (i = 0; i < count; i++) {
+		err = oskit_bufio_map(bufs[i], (void **)&frame, 0, sizes[i]);
+
+		/* XXX read in if map fails */
+		if (err) {
+			if (!rc)
+				rc = err;
+			continue;
+		}
+		if (po->func(frame, sizes[i])) {
+			match[n] = bufs[i];
+			matchsize[n] = sizes[i];
+			n++;
+		}
+		err = oskit_bufio_unmap(bufs[i], (void *)frame, 0, sizes[i]);
+		assert(!err);
+
+		if (n == OSKIT_NETIO_BATCH || (n && i == count - 1)) {
+			err = oskit_netio_push_batch(po->forward_to,
+						     match, matchsize, n);
+			if (err && !rc)
+				rc = err;
+			n = 0;
+		}
+	}
+	if (n) {
+		err = oskit_netio_push_batch(po->forward_to,
+					     match, matchsize, n);
+		if (err && !rc)
+			rc = err;
+	}
+	return rc;
+}
+
 /*
  * Unimplemented bufio allocator
  */
@@ -146,7 +197,8 @@ static struct oskit_netio_ops uspf_netio_impl_ops = {
 	net_addref, 
 	net_release,
 	net_push,
-	net_alloc_bufio
+	net_alloc_bufio,
+	net_push_batch
 };
 
 
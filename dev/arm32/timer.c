@@ -20,6 +20,7 @@
 
 #include <oskit/dev/dev.h>
 #include <oskit/debug.h>
+#include <oskit/c/string.h>
 #include <oskit/arm32/pio.h>
 #include <oskit/arm32/proc_reg.h>
 #include "pit_param.h"
@@ -167,6 +168,32 @@ osenv_timer_unregister(void (*func)(void), int freq)
 }
 
 
+/*
+ * There is no one-shot support for the RTC, so no tickless mode.
+ */
+int
+osenv_timer_tickless(int (*next)(void))
+{
+	return next ? OSKIT_E_NOTIMPL : 0;
+}
+
+void
+osenv_timer_reprogram()
+{
+}
+
+int
+osenv_timer_lag()
+{
+	return 0;
+}
+
+void
+osenv_timer_getstats(struct osenv_timer_stats *out_stats)
+{
+	memset(out_stats, 0, sizeof *out_stats);
+}
+
 /*
  * Spin for a small amount of time, specified in nanoseconds,
  * without blocking or enabling interrupts.
@@ -58,6 +58,12 @@
 #define oskit_osenv_timer_spin(a,b) osenv_timer_spin((b))
 #undef oskit_osenv_timer_register
 #define oskit_osenv_timer_register(a,b,c) osenv_timer_register((b),(c))
+#undef oskit_osenv_timer_tickless
+#define oskit_osenv_timer_tickless(a,b) osenv_timer_tickless((b))
+#undef oskit_osenv_timer_reprogram
+#define oskit_osenv_timer_reprogram(a) osenv_timer_reprogram()
+#undef oskit_osenv_timer_lag
+#define oskit_osenv_timer_lag(a) osenv_timer_lag()
 
 #else /* !KNIT */
 /*
@@ -102,19 +108,45 @@ static oskit_osenv_log_t	*clock_osenv_log;
  *		2. periodic timers that are being reloaded.
  */
 
+/*
+ * The one-shot timers live in a hierarchical timing wheel, like the
+ * one in BSD and Linux. Level 0 has a slot for each of the next 256
+ * ticks. Each of the levels above covers 64 times as much time as the
+ * one below it. Its timers are moved ("cascaded") down a level each
+ * time the level below wraps around. Arming and cancelling a timer
+ * are O(1), and a tick only looks at the timers that are due.
+ */
+#define WHEEL0_BITS	8
+#define WHEELN_BITS	6
+#define WHEEL0_SIZE	(1 << WHEEL0_BITS)
+#define WHEELN_SIZE	(1 << WHEELN_BITS)
+#define WHEEL0_MASK	(WHEEL0_SIZE - 1)
+#define WHEELN_MASK	(WHEELN_SIZE - 1)
+#define WHEEL_LEVELS	4		/* above level 0 */
+
+/* slot in level n+1 for a given tick */
+#define WHEEL_INDEX(t, n) \
+	(((t) >> (WHEEL0_BITS + (n) * WHEELN_BITS)) & WHEELN_MASK)
+
+/* timer_impl::queue */
+#define TIMER_IDLE	0		/* not armed */
+#define TIMER_EVERYTIME	1		/* on the every-tick list */
+#define TIMER_WHEEL	2		/* in the wheel */
+
 /*
  * this describes the data structure used to represent a timer
  */
 typedef struct timer_impl {
 	oskit_timer_t		iot;		/* COM timer interface */
 	unsigned 		count;		/* reference count */
-	oskit_s32_t 		left;		/* ticks to next alarm */
+	oskit_u32_t 		expires;	/* tick of next alarm */
 	oskit_s32_t 		reload;		/* the reload value in ticks */
 	struct oskit_listener 	*listener;	/* my listener */
 	oskit_itimerspec_t	itimer;		/* our itimerspec  */
 	struct clock_impl	*clock;		/* our clock */
-	struct timer_impl 	**clocklist;	/* head of list we're on */
+	int			queue;		/* which list we're on */
 	struct timer_impl 	*next;
+	struct timer_impl 	**prevp;	/* what points to us */
 } timer_impl_t;
 
 /*
@@ -142,16 +174,28 @@ typedef struct clock_impl {
 	 * the interrupt code, so changes to them must be protected.
 	 */
 
-	/* this is our "callout" queue for one-shot timers - a differential
-	 * list of events essentially. This list is ordered by
-	 * timer_impl::left. Negative values indicate overdue events.
+	/*
+	 * The wheel for everything else. ticks counts clock interrupts;
+	 * wheel_ticks is the next tick whose level 0 slot has not been
+	 * run yet, normally ticks + 1.
 	 */
-	struct timer_impl	*callout;
+	oskit_u32_t		ticks;
+	oskit_u32_t		wheel_ticks;
+	struct timer_impl	*wheel0[WHEEL0_SIZE];
+	struct timer_impl	*wheel[WHEEL_LEVELS][WHEELN_SIZE];
 
 	/*
 	 * these timers are triggered at every clock interrupt
 	 */
 	struct timer_impl	*everytime;
+
+	/*
+	 * In tickless mode the timer only interrupts when something is
+	 * due, and ticks can go by before they are delivered to us.
+	 * next_event is the tick the timer was last told to wake us at.
+	 */
+	int			tickless;
+	oskit_u32_t		next_event;
 } clock_impl_t;
 
 /*
@@ -163,9 +207,10 @@ clock_impl_t	*oskit_system_clock;
 
 /* forward declarations */
 static timer_impl_t * create_timer(clock_impl_t *clock);
-static void add_synchronous_timer(oskit_osenv_intr_t *intr, timer_impl_t **head, timer_impl_t *t);
-static void add_oneshot_timer(oskit_osenv_intr_t *intr, timer_impl_t **head,
-	timer_impl_t *n, oskit_s32_t ticks);
+static void add_synchronous_timer(clock_impl_t *clock, timer_impl_t *t);
+static void add_oneshot_timer(clock_impl_t *clock, timer_impl_t *t,
+	oskit_s32_t ticks);
+static OSKIT_COMDECL_U timer_release(oskit_timer_t *io);
 
 
 /*
@@ -203,196 +248,262 @@ timer_intr()
 }
 
 /*
- * take any action that needs to be taken at a (hardware) clock tick
+ * Doubly linked timer lists, so that a timer can take itself off
+ * whatever list it is on without looking for itself.
  */
-static void
-fdev_handle_clock(clock_impl_t *clock)
+static inline void
+list_insert(timer_impl_t **head, timer_impl_t *t)
 {
-	timer_impl_t  *th;
-	int	mustcallout = 0;
+	t->next = *head;
+	if (t->next)
+		t->next->prevp = &t->next;
+	t->prevp = head;
+	*head = t;
+}
 
-	/* update our current time */
-	ADDNANO2TIMESPEC(NANOPERTICK, &clock->time);
+static inline void
+list_remove(timer_impl_t *t)
+{
+	*t->prevp = t->next;
+	if (t->next)
+		t->next->prevp = t->prevp;
+	t->next = 0;
+	t->prevp = 0;
+}
 
-	/* handle simple, synchronously running timers */
-	for (th = clock->everytime; th; th = th->next)
-		oskit_listener_notify(th->listener, (oskit_iunknown_t *)th);
+/*
+ * Move a whole list to a new head.
+ */
+static inline void
+list_move(timer_impl_t **from, timer_impl_t **to)
+{
+	*to = *from;
+	*from = 0;
+	if (*to)
+		(*to)->prevp = to;
+}
 
-	/* handle callout queue */
-	for (th = clock->callout; th; th = th->next) {
-		if (--th->left > 0)
-			break;
-		mustcallout = 1;
-		if (th->left == 0)
-			break;
+/*
+ * Put a timer in the right slot of the wheel for its expiry time.
+ * Interrupts are disabled.
+ */
+static void
+wheel_insert(clock_impl_t *clock, timer_impl_t *t)
+{
+	oskit_s32_t	idx = t->expires - clock->wheel_ticks;
+	timer_impl_t	**head;
+	int		n;
+
+	if (idx < 0) {
+		/* overdue; go off at the next tick */
+		head = &clock->wheel0[clock->wheel_ticks & WHEEL0_MASK];
+	} else if (idx < WHEEL0_SIZE) {
+		head = &clock->wheel0[t->expires & WHEEL0_MASK];
+	} else {
+		for (n = 0; n < WHEEL_LEVELS - 1; n++)
+			if (idx < 1 << (WHEEL0_BITS + (n + 1) * WHEELN_BITS))
+				break;
+		head = &clock->wheel[n][WHEEL_INDEX(t->expires, n)];
 	}
 
-	if (!mustcallout)
-		return;
+	list_insert(head, t);
+	t->queue = TIMER_WHEEL;
+}
 
-	/* Call and remove all handlers that are due */
-	while (((th = clock->callout) != NULL) && th->left <= 0) {
+/*
+ * Redistribute the timers in one slot of level n+1 over the levels
+ * below it. Returns the slot number, so that the caller knows whether
+ * this level has wrapped too.
+ */
+static int
+wheel_cascade(clock_impl_t *clock, int n, int index)
+{
+	timer_impl_t	*work, *t;
 
-		/* remove it from list */
-		clock->callout = th->next;
-		th->next = 0;
-		th->clocklist = 0;
+	list_move(&clock->wheel[n][index], &work);
+	while ((t = work) != 0) {
+		list_remove(t);
+		wheel_insert(clock, t);
+	}
+	return index;
+}
 
-		/* notify the object */
-		oskit_listener_notify(th->listener, (oskit_iunknown_t *)th);
+/*
+ * Fire everything in the wheel that is due by now.
+ */
+static void
+wheel_run(clock_impl_t *clock)
+{
+	timer_impl_t	*work, *th;
+	int		index, n;
+
+	while ((oskit_s32_t)(clock->ticks - clock->wheel_ticks) >= 0) {
+		index = clock->wheel_ticks & WHEEL0_MASK;
+		if (index == 0)
+			for (n = 0; n < WHEEL_LEVELS; n++)
+				if (wheel_cascade(clock, n,
+				    WHEEL_INDEX(clock->wheel_ticks, n)) != 0)
+					break;
+
+		list_move(&clock->wheel0[index], &work);
+		clock->wheel_ticks++;
 
 		/*
-		 * reload timer if necessary
+		 * A listener may cancel or re-arm any timer, including
+		 * ones still on the work list, or drop the last reference
+		 * to the one it was called for.
 		 */
-		if (th->reload) {
-#ifdef KNIT
-		        if (th->reload == 1)
-				add_synchronous_timer(0,
-						      &clock->everytime, th);
-			else
-				add_oneshot_timer(0,
-						  &clock->callout, th,
-						  th->reload);
-#else /* !KNIT */
-			if (th->reload == 1)
-				add_synchronous_timer(clock->intr,
-						      &clock->everytime, th);
-			else
-				add_oneshot_timer(clock->intr,
-						  &clock->callout, th,
-						  th->reload);
-#endif /* !KNIT */
+		while ((th = work) != 0) {
+			list_remove(th);
+			th->queue = TIMER_IDLE;
+			th->count++;
+
+			/* notify the object */
+			oskit_listener_notify(th->listener,
+					      (oskit_iunknown_t *)th);
+
+			/*
+			 * reload timer if necessary
+			 */
+			if (th->reload && th->queue == TIMER_IDLE) {
+				if (th->reload == 1)
+					add_synchronous_timer(clock, th);
+				else
+					add_oneshot_timer(clock, th,
+							  th->reload);
+			}
+			timer_release(&th->iot);
 		}
 	}
 }
 
-#if VERBOSITY > 0
 /*
- * for debugging - print out the contents of a queue
+ * How many ticks from the last one delivered until something needs to
+ * be done: either a timer goes off, or the wheel has to cascade. Used
+ * by the osenv timer in tickless mode. Interrupts are disabled.
  */
-static void
-print_queue(timer_impl_t **head)
+static int
+clock_next_event(void)
 {
-	timer_impl_t	*t = *head;
-	while (t) {
-		osenv_log(OSENV_LOG_DEBUG, "(%d, %d, %p) ", t->left, t->reload,
-			t->clocklist);
-		t = t->next;
+	clock_impl_t	*clock = oskit_system_clock;
+	oskit_u32_t	t;
+	int		i, n, upper = 0;
+
+	if (clock == 0)
+		return 0x7fffffff;
+	if (clock->everytime) {
+		clock->next_event = clock->ticks + 1;
+		return 1;
 	}
-	osenv_log(OSENV_LOG_DEBUG, "\n");
+
+	for (n = 0; n < WHEEL_LEVELS && !upper; n++)
+		for (i = 0; i < WHEELN_SIZE; i++)
+			if (clock->wheel[n][i]) {
+				upper = 1;
+				break;
+			}
+
+	for (i = 0; i < WHEEL0_SIZE; i++) {
+		t = clock->wheel_ticks + i;
+		if ((upper && (t & WHEEL0_MASK) == 0) ||
+		    clock->wheel0[t & WHEEL0_MASK]) {
+			clock->next_event = t;
+			return t - clock->ticks;
+		}
+	}
+
+	clock->next_event = clock->ticks + 0x7fffffff;
+	return 0x7fffffff;
 }
-#endif
 
 /*
- * add a timer to an unordered list of timers
+ * The current time, counting ticks that have gone by in tickless mode
+ * but not been delivered yet.
  */
 static void
-add_synchronous_timer(oskit_osenv_intr_t *intr, timer_impl_t **head, timer_impl_t *t)
+current_time(clock_impl_t *clock, oskit_timespec_t *out_time)
 {
-	unsigned int flags;
-	BEGIN_CRITICAL_SECTION(intr, flags);
-	t->clocklist = head;
-	t->next = *head;
-	*head = t;
-	t->left = t->reload;
-	END_CRITICAL_SECTION(intr, flags);
+	int lag = 0;
+
+	if (clock->tickless)
+		lag = oskit_osenv_timer_lag(clock->timer);
+
+	*out_time = clock->time;
+	if (lag) {
+		out_time->tv_sec += lag / TIMER_FREQ;
+		ADDNANO2TIMESPEC((lag % TIMER_FREQ) * NANOPERTICK, out_time);
+	}
 }
 
 /*
- * remove a timer from an unordered list of timers
+ * take any action that needs to be taken at a (hardware) clock tick
  */
 static void
-remove_synchronous_timer(oskit_osenv_intr_t *intr, timer_impl_t **head, timer_impl_t *t)
+fdev_handle_clock(clock_impl_t *clock)
 {
-	unsigned int flags;
-	BEGIN_CRITICAL_SECTION(intr, flags);
-	while (*head) {
-		if (*head == t) {
-			*head = t->next;
-			t->clocklist = 0;
-			break;
-		}
-		head = &(*head)->next;
+	timer_impl_t  *th, *next;
+
+	/* update our current time */
+	ADDNANO2TIMESPEC(NANOPERTICK, &clock->time);
+	clock->ticks++;
+
+	/* handle simple, synchronously running timers */
+	for (th = clock->everytime; th; th = next) {
+		next = th->next;
+		oskit_listener_notify(th->listener, (oskit_iunknown_t *)th);
 	}
-	END_CRITICAL_SECTION(intr, flags);
+
+	/* handle the wheel */
+	wheel_run(clock);
 }
 
 /*
- * add a timer to be fired in "ticks"
- * this is programmed analogous to BSD's timeout function
+ * add a timer to the list of timers that go off at every tick
  */
 static void
-add_oneshot_timer(oskit_osenv_intr_t *intr, timer_impl_t **head, timer_impl_t *n, oskit_s32_t ticks)
+add_synchronous_timer(clock_impl_t *clock, timer_impl_t *t)
 {
-	timer_impl_t	*t, **p;
 	unsigned int flags;
-
-	BEGIN_CRITICAL_SECTION(intr, flags);
-	n->clocklist = head;
-
-	/* walk through list, finding spot, adjusting ticks parameter */
-	for (p = head; (t = *p) && ticks > t->left; p = &t->next)
-		if (t->left > 0)
-			ticks -= t->left;
-
-	n->left = ticks;
-	/* adjust next entry */
-	if (t)
-		t->left -= ticks;
-
-	n->next = t;
-	*p = n;
-	END_CRITICAL_SECTION(intr, flags);
+	BEGIN_CRITICAL_SECTION(clock->intr, flags);
+	list_insert(&clock->everytime, t);
+	t->queue = TIMER_EVERYTIME;
+	if (clock->tickless)
+		oskit_osenv_timer_reprogram(clock->timer);
+	END_CRITICAL_SECTION(clock->intr, flags);
 }
 
 /*
- * remove a one-shot timer, correcting the next queue entry
+ * add a timer to be fired in "ticks"
  */
 static void
-remove_oneshot_timer(oskit_osenv_intr_t *intr, timer_impl_t **head, timer_impl_t *f)
+add_oneshot_timer(clock_impl_t *clock, timer_impl_t *t, oskit_s32_t ticks)
 {
-	timer_impl_t    *t, **p;
 	unsigned int flags;
 
-	BEGIN_CRITICAL_SECTION(intr, flags);
-	for (p = head; (t = *p) != NULL; p = &t->next) {
-		if (t == f) {
-			if (t->next && t->left > 0)
-				t->next->left += t->left;
-			*p = t->next;
-			f->clocklist = 0;
-			f->next = 0;
-			break;
-		}
-	}
-	END_CRITICAL_SECTION(intr, flags);
+	BEGIN_CRITICAL_SECTION(clock->intr, flags);
+	t->expires = clock->ticks + ticks;
+	if (clock->tickless) {
+		t->expires += oskit_osenv_timer_lag(clock->timer);
+		wheel_insert(clock, t);
+		if ((oskit_s32_t)(t->expires - clock->next_event) < 0)
+			oskit_osenv_timer_reprogram(clock->timer);
+	} else
+		wheel_insert(clock, t);
+	END_CRITICAL_SECTION(clock->intr, flags);
 }
 
 /*
- * figure out how much many ticks are left on a particular timer
+ * figure out how many ticks are left on a particular timer
  */
 static oskit_s32_t
-ticks_left_on_oneshot_timer(timer_impl_t *t, timer_impl_t *f)
+ticks_left_on_oneshot_timer(timer_impl_t *t)
 {
-	unsigned int flags;
-	oskit_s32_t left = 0;
+	clock_impl_t *clock = t->clock;
+	oskit_s32_t left = t->expires - clock->ticks;
 
-	BEGIN_CRITICAL_SECTION(f->clock->intr, flags);
-
-	while (t) {
-		if (t->left > 0)
-			left += t->left;
-		if (t == f)
-			break;
-		t = t->next;
-	}
-
-	END_CRITICAL_SECTION(f->clock->intr,flags);
-	/*
-	 * if we didn't find t, lets return zero instead of returning
-	 * the accumulated sum of all time diffs
-	 */
-	return t ? left : 0;
+	if (clock->tickless)
+		left -= oskit_osenv_timer_lag(clock->timer);
+	return left > 0 ? left : 0;
 }
 
 /*
@@ -402,22 +513,17 @@ static void
 remove_from_clocklist(timer_impl_t *ti)
 {
 	clock_impl_t *clock = ti->clock;
-#ifdef KNIT
-	if (ti->clocklist == &ti->clock->everytime)
-		remove_synchronous_timer(0, &clock->everytime, ti);
-	else
-	if (ti->clocklist == &ti->clock->callout)
-		remove_oneshot_timer(0, &clock->callout, ti);
-#else
-	if (ti->clocklist == &ti->clock->everytime)
-		remove_synchronous_timer(clock->intr, &clock->everytime, ti);
-	else
-	if (ti->clocklist == &ti->clock->callout)
-		remove_oneshot_timer(clock->intr, &clock->callout, ti);
-#endif
+	unsigned int flags;
+
+	BEGIN_CRITICAL_SECTION(clock->intr, flags);
+	if (ti->queue != TIMER_IDLE) {
+		list_remove(ti);
+		ti->queue = TIMER_IDLE;
+	}
+	END_CRITICAL_SECTION(clock->intr, flags);
 }
 
-
+
 /*************************************************************************
  *
  *	oskit_timer COM interface implementation
@@ -477,7 +583,7 @@ timer_release(oskit_timer_t *io)
 	newcount = --ti->count;
 	if (newcount == 0) {
 		/* if we're still on a list, remove ourselves! */
-		if (ti->clocklist)
+		if (ti->queue != TIMER_IDLE)
 			remove_from_clocklist(ti);
 		if (ti->listener)
 			oskit_listener_release(ti->listener);
@@ -521,10 +627,11 @@ timer_settime(oskit_timer_t *timer, int flags,
 	 */
 	ti->itimer = *value;
 	if (flags & OSKIT_TIMER_ABSTIME) {
-		oskit_timespec_t	exp;
+		oskit_timespec_t	now, exp;
 
 		/* get time from clock and subtract from value->it_value */
-		SUBTIMESPEC(&value->it_value, &clock->time, &exp);
+		current_time(clock, &now);
+		SUBTIMESPEC(&value->it_value, &now, &exp);
 		ti->itimer.it_value = exp;
 	}
 	left = TIMESPEC2TICKS(&ti->itimer.it_value);
@@ -545,9 +652,17 @@ timer_settime(oskit_timer_t *timer, int flags,
 	/*
 	 * Step 2: remove ourselves from any lists - should we be on one
 	 */
-	if (ti->clocklist)
+	if (ti->queue != TIMER_IDLE)
 		remove_from_clocklist(ti);
 
+	/*
+	 * set reload in any event so that one-shot timers with a period
+	 * can be inserted in the periodic queue after they first expire,
+	 * and so that a timer cancelled from its own listener stays
+	 * cancelled.
+	 */
+	ti->reload = reload;
+
 	/*
 	 * If left and reload are zero, do nothing. Might have been a
 	 * timer removal.
@@ -555,32 +670,16 @@ timer_settime(oskit_timer_t *timer, int flags,
 	if (left == 0 && reload == 0)
 		return 0;
 
-	/*
-	 * set reload in any event so that one-shot timers with a period
-	 * can be inserted in the periodic queue after they first expire
-	 */
-	ti->reload = reload;
-
 	/*
 	 * Step 3: Figure out just what kind of a timer we are
 	 */
-#ifdef KNIT
-	if (left == 1 && left == reload) {
-		/* this timer expires at every clock tick */
-		add_synchronous_timer(0, &clock->everytime, ti);
-	} else {
-		/* this timer starts out as a one-shot timer */
-		add_oneshot_timer(0, &clock->callout, ti, left);
-	}
-#else
 	if (left == 1 && left == reload) {
 		/* this timer expires at every clock tick */
-		add_synchronous_timer(clock->intr, &clock->everytime, ti);
+		add_synchronous_timer(clock, ti);
 	} else {
 		/* this timer starts out as a one-shot timer */
-		add_oneshot_timer(clock->intr, &clock->callout, ti, left);
+		add_oneshot_timer(clock, ti, left);
 	}
-#endif
 
 	return 0;
 }
@@ -601,11 +700,11 @@ timer_gettime(oskit_timer_t *timer, struct oskit_itimerspec *out_value)
 	/*
 	 * try to figure out how much time is left to next expiration
 	 */
-	if (ti->clocklist == &ti->clock->everytime)
+	if (ti->queue == TIMER_EVERYTIME)
 		left = 1;		/* one tick is left */
 	else
-	if (ti->clocklist == &ti->clock->callout)
-		left = ticks_left_on_oneshot_timer(ti->clock->callout, ti);
+	if (ti->queue == TIMER_WHEEL)
+		left = ticks_left_on_oneshot_timer(ti);
 
 	/* set expiration time left */
 	TICKS2TIMESPEC(left, &out_value->it_value);
@@ -678,6 +777,8 @@ clock_release(oskit_clock_t *io)
 
 	newcount = --po->count;
 	if (newcount == 0) {
+		if (po->tickless)
+			oskit_osenv_timer_tickless(po->timer, 0);
 #ifdef KNIT
 		osenv_timer_unregister(timer_intr, TIMER_FREQ);
 		osenv_mem_free(po, 0, sizeof(*po));
@@ -747,7 +848,7 @@ clock_gettime(oskit_clock_t *dev, struct oskit_timespec *out_time)
 	osenv_assert(po != NULL);
 	osenv_assert(po->count != 0);
 
-	*out_time = po->time;
+	current_time(po, out_time);
 }
 
 /*
@@ -954,6 +1055,7 @@ oskit_clock_init()
 	memset(c, 0, sizeof *c);
         c->ioc.ops = &oskit_clock_ops;
         c->count = 1;
+	c->wheel_ticks = c->ticks + 1;
 #ifndef KNIT
         c->mem   = mem;
         c->timer = timer;
@@ -967,6 +1069,29 @@ oskit_clock_init()
 	return &c->ioc;
 }
 
+/*
+ * Have the system clock's timer interrupt only when a timer is due,
+ * rather than at every tick, if the osenv timer can do that.
+ */
+oskit_error_t
+oskit_clock_tickless(oskit_clock_t *dev, int enable)
+{
+	clock_impl_t	*po = (clock_impl_t *)dev;
+	oskit_error_t	rc;
+
+	osenv_assert(po != NULL);
+	osenv_assert(po->count != 0);
+
+	if (enable == po->tickless)
+		return 0;
+
+	po->tickless = enable;
+	rc = oskit_osenv_timer_tickless(po->timer, enable ? clock_next_event : 0);
+	if (rc)
+		po->tickless = 0;
+	return rc;
+}
+
 #ifdef KNIT
 oskit_error_t
 init(void)
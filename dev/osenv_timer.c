@@ -87,6 +87,24 @@ timer_unregister(oskit_osenv_timer_t *o, void (*func)(void), int freq)
 	osenv_timer_unregister(func, freq);
 }
 
+static OSKIT_COMDECL
+timer_tickless(oskit_osenv_timer_t *o, int (*next)(void))
+{
+	return osenv_timer_tickless(next);
+}
+
+static OSKIT_COMDECL_V
+timer_reprogram(oskit_osenv_timer_t *o)
+{
+	osenv_timer_reprogram();
+}
+
+static OSKIT_COMDECL_U
+timer_lag(oskit_osenv_timer_t *o)
+{
+	return osenv_timer_lag();
+}
+
 static struct oskit_osenv_timer_ops osenv_timer_ops = {
 	timer_query,
 	timer_addref,
@@ -96,6 +114,9 @@ static struct oskit_osenv_timer_ops osenv_timer_ops = {
 	timer_spin,
 	timer_register,
 	timer_unregister,
+	timer_tickless,
+	timer_reprogram,
+	timer_lag,
 };
 
 /*
@@ -24,6 +24,12 @@
 #include <oskit/x86/proc_reg.h>
 #include "pit_param.h"
 
+/*
+ * Handlers are taken from this many static entries first, so that
+ * registering works before there is a memory allocator. After that
+ * they are allocated as needed. Entries are never freed, only put
+ * back on the free list.
+ */
 #define NTIMERS		10
 
 
@@ -41,16 +47,114 @@ struct timer_handler {
 static struct timer_handler *timer_head, *timer_free;
 static struct timer_handler timer_data[NTIMERS];
 
+/*
+ * Set while run_handlers is walking the list. A handler unregistered
+ * during the walk is only marked dead (its func cleared) and left on
+ * the list, so the walk never steps onto an entry that has been put
+ * back on the free list and reused; the walk takes it off at the end.
+ */
+static int timer_walking;
+static int timer_dead;
+
+/*
+ * Tickless mode. The PIT is run one-shot, and programmed to go off at
+ * the next tick anybody wants. Time is kept in PIT counts from the last
+ * tick delivered to the handlers: oneshot_base counts had gone by when
+ * the one-shot was programmed, for oneshot_ticks ticks from that tick.
+ * oneshot_done is how many of those the interrupt handler has delivered
+ * so far. The few counts between reading the PIT and reprogramming it
+ * are lost, so the clock runs a little slow in this mode.
+ */
+static int (*tickless_next)(void);
+static int oneshot_ticks;
+static int oneshot_base;
+static int oneshot_done;
+
+static struct osenv_timer_stats stats;
+
+static void
+run_handlers()
+{
+	struct timer_handler *th, **prev;
+
+	timer_walking = 1;
+	for (th = timer_head; th; th = th->next)
+		if (th->func)
+			(*th->func)();
+	timer_walking = 0;
+
+	/* free the ones that were unregistered along the way */
+	for (prev = &timer_head; timer_dead && (th = *prev) != 0; ) {
+		if (th->func) {
+			prev = &th->next;
+			continue;
+		}
+		*prev = th->next;
+		th->next = timer_free;
+		timer_free = th;
+		timer_dead--;
+	}
+	stats.ticks++;
+}
+
+/*
+ * Program the one-shot for the next tick that is wanted,
+ * LEFTOVER counts into the current tick.
+ */
+static void
+program_oneshot(int leftover)
+{
+	int n, max;
+
+	n = (*tickless_next)();
+	if (n < 1)
+		n = 1;
+	max = (osenv_timer_pit_oneshot_max() + leftover) / TIMER_VALUE;
+	if (n > max)
+		n = max;
+
+	oneshot_base = leftover;
+	oneshot_ticks = n;
+	oneshot_done = 0;
+	osenv_timer_pit_oneshot(n * TIMER_VALUE - leftover);
+}
+
 /*
  * Generic timer interrupt handler.
  */
 static void
 timer_intr()
 {
-	struct timer_handler *th;
+	int elapsed, late;
 
-	for (th = timer_head; th; th = th->next)
-		(*th->func)();
+	stats.interrupts++;
+	if (tickless_next == 0) {
+		run_handlers();
+		return;
+	}
+
+	elapsed = oneshot_base + osenv_timer_pit_elapsed();
+	late = (elapsed - oneshot_ticks * TIMER_VALUE) * PIT_NS;
+	if (late > (int) stats.maxlate)
+		stats.maxlate = late;
+
+	/*
+	 * Catch up on every tick that has gone by, including any that
+	 * went by while the handlers were running. Handlers that arm
+	 * timers may call osenv_timer_reprogram; that is left until
+	 * we are done here.
+	 */
+	while (oneshot_done < oneshot_ticks ||
+	       elapsed >= (oneshot_done + 1) * TIMER_VALUE) {
+		oneshot_done++;
+		run_handlers();
+		if (tickless_next == 0)
+			return;
+		elapsed = oneshot_base + osenv_timer_pit_elapsed();
+	}
+
+	elapsed -= oneshot_done * TIMER_VALUE;
+	program_oneshot(elapsed > 0 ? elapsed : 0);
 }
 
 /*
@@ -104,8 +208,6 @@ osenv_timer_register(void (*func)(void), int freq)
 	osenv_timer_init();
 #endif
 
-	if (timer_free == 0)
-		osenv_panic("%s:%d: ran out of entries", __FILE__, __LINE__);
 	/*
 	 * XXX
 	 */
@@ -116,8 +218,17 @@ osenv_timer_register(void (*func)(void), int freq)
 
 	flags = osenv_intr_save_disable();
 
-	th = timer_free;
-	timer_free = th->next;
+	if ((th = timer_free) != 0)
+		timer_free = th->next;
+	else {
+		if (flags)
+			osenv_intr_enable();
+		th = osenv_mem_alloc(sizeof *th, 0, 0);
+		if (th == 0)
+			osenv_panic("%s:%d: ran out of entries",
+				    __FILE__, __LINE__);
+		flags = osenv_intr_save_disable();
+	}
 	th->next = timer_head;
 	timer_head = th;
 	th->func = func;
@@ -153,6 +264,10 @@ osenv_timer_unregister(void (*func)(void), int freq)
 	}
 	if (!th) {
 		osenv_log(OSENV_LOG_WARNING, "Timer handler not found\n");
+	} else if (timer_walking) {
+		/* run_handlers will free it when it is done */
+		th->func = 0;
+		timer_dead++;
 	} else {
 		/* have the active list skip over it */
 		*prev = th->next;
@@ -167,6 +282,90 @@ osenv_timer_unregister(void (*func)(void), int freq)
 }
 
 
+/*
+ * Switch to tickless mode, or back to a fixed rate if NEXT is null.
+ * Either way the current tick starts over, so up to a tick is lost.
+ */
+int
+osenv_timer_tickless(int (*next)(void))
+{
+	int flags;
+
+	flags = osenv_intr_save_disable();
+	if (next) {
+		tickless_next = next;
+		program_oneshot(0);
+	} else if (tickless_next) {
+		tickless_next = 0;
+		osenv_timer_pit_periodic(TIMER_FREQ);
+	}
+	if (flags)
+		osenv_intr_enable();
+	return 0;
+}
+
+/*
+ * Something has been added that may be due before the one-shot goes
+ * off, so cut it short if need be. It is never made longer here; that
+ * waits for the next interrupt. Interrupts are disabled.
+ */
+void
+osenv_timer_reprogram()
+{
+	int n, elapsed;
+
+	if (tickless_next == 0)
+		return;
+
+	n = (*tickless_next)();
+	if (n < 1)
+		n = 1;
+	if (n >= oneshot_ticks || oneshot_done)
+		return;
+
+	elapsed = oneshot_base + osenv_timer_pit_elapsed();
+	if (n * TIMER_VALUE <= elapsed)
+		n = elapsed / TIMER_VALUE + 1;
+	if (n >= oneshot_ticks)
+		return;
+
+	oneshot_base = elapsed;
+	oneshot_ticks = n;
+	osenv_timer_pit_oneshot(n * TIMER_VALUE - elapsed);
+	stats.reprograms++;
+}
+
+/*
+ * Return how many whole ticks have gone by since the last one
+ * delivered. Always zero unless in tickless mode.
+ */
+int
+osenv_timer_lag()
+{
+	int flags, lag;
+
+	if (tickless_next == 0)
+		return 0;
+
+	flags = osenv_intr_save_disable();
+	lag = (oneshot_base + osenv_timer_pit_elapsed()) / TIMER_VALUE
+		- oneshot_done;
+	if (flags)
+		osenv_intr_enable();
+	return lag > 0 ? lag : 0;
+}
+
+void
+osenv_timer_getstats(struct osenv_timer_stats *out_stats)
+{
+	int flags;
+
+	flags = osenv_intr_save_disable();
+	*out_stats = stats;
+	if (flags)
+		osenv_intr_enable();
+}
+
 /*
  * Spin for a small amount of time, specified in nanoseconds,
  * without blocking or enabling interrupts.
@@ -179,7 +378,8 @@ osenv_timer_spin(long nanosec)
 	while (nanosec > 0) {
 		int val = osenv_timer_pit_read();
 		if (val > prev_val)
-			prev_val += TIMER_VALUE;
+			/* a one-shot counts down from 0xffff after it goes off */
+			prev_val += tickless_next ? 0x10000 : TIMER_VALUE;
 		nanosec -= (prev_val - val) * PIT_NS;
 		prev_val = val;
 	}
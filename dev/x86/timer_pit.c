@@ -57,6 +57,51 @@ osenv_timer_pit_shutdown()
 }
 
 
+/*
+ * One-shot mode. Counter 0 is put in mode 0, so it interrupts once when
+ * it gets to zero and then carries on counting down from 0xffff, which
+ * lets us see how late the interrupt was handled.
+ */
+static int oneshot_counts;
+
+int
+osenv_timer_pit_oneshot_max()
+{
+	return 0xffff;
+}
+
+void
+osenv_timer_pit_oneshot(int counts)
+{
+	if (counts > 0xffff)
+		counts = 0xffff;
+	if (counts < 1)
+		counts = 1;
+	pit_set(0, PIT_INTTC, counts);
+	oneshot_counts = counts;
+}
+
+/*
+ * Counts since the last call to osenv_timer_pit_oneshot.
+ * Interrupts are disabled.
+ */
+int
+osenv_timer_pit_elapsed()
+{
+	int value = pit_read(0);
+
+	if (value <= oneshot_counts)
+		return oneshot_counts - value;
+	return oneshot_counts + (0x10000 - value);
+}
+
+void
+osenv_timer_pit_periodic(int freq)
+{
+	pit_init(freq);
+	oneshot_counts = 0;
+}
+
 int
 osenv_timer_pit_read()
 {
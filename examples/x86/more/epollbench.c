@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * epoll test.
+ *
+ * Makes 10000 idle and 100 active pipes and puts the read end of every
+ * one in an epoll set.  Each round writes a byte into each active pipe,
+ * then calls epoll_wait until it has seen all 100 and reads the bytes
+ * back.  Reports the cycles per round and per epoll_wait, level and
+ * edge triggered.  select can't do this at all, since FD_SETSIZE is
+ * 256.  Also builds in unix mode.
+ */
+
+#include <oskit/clientos.h>
+#include <oskit/machine/proc_reg.h>
+#include <sys/epoll.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define NIDLE		10000
+#define NACTIVE		100
+#define NROUNDS		1000
+
+static int	rfd[NIDLE + NACTIVE], wfd[NIDLE + NACTIVE];
+
+static void
+run(const char *name, unsigned flags)
+{
+	struct epoll_event	ev, events[NACTIVE];
+	unsigned long long	before, round = 0, wait = 0, t;
+	int			ep, i, n, r, got, waits = 0;
+	char			c = 0;
+
+	if ((ep = epoll_create(NIDLE + NACTIVE)) < 0)
+		bench_fail("epoll_create", errno);
+
+	before = get_tsc();
+	for (i = 0; i < NIDLE + NACTIVE; i++) {
+		ev.events = EPOLLIN | flags;
+		ev.data.u32 = i;
+		if (epoll_ctl(ep, EPOLL_CTL_ADD, rfd[i], &ev) < 0)
+			bench_fail("epoll_ctl", errno);
+	}
+	t = get_tsc() - before;
+	printf("%s: %u cycles per EPOLL_CTL_ADD\n",
+	       name, (unsigned) (t / (NIDLE + NACTIVE)));
+
+	for (r = 0; r < NROUNDS; r++) {
+		before = get_tsc();
+		for (i = NIDLE; i < NIDLE + NACTIVE; i++)
+			if (write(wfd[i], &c, 1) != 1)
+				bench_fail("write", errno);
+
+		for (got = 0; got < NACTIVE; got += n) {
+			t = get_tsc();
+			n = epoll_wait(ep, events, NACTIVE, -1);
+			wait += get_tsc() - t;
+			waits++;
+			if (n < 0)
+				bench_fail("epoll_wait", errno);
+			for (i = 0; i < n; i++)
+				if (read(rfd[events[i].data.u32], &c, 1) != 1)
+					bench_fail("read", errno);
+		}
+		round += get_tsc() - before;
+	}
+	printf("%s: %u cycles per round, %u per epoll_wait, %d waits\n",
+	       name, (unsigned) (round / NROUNDS), (unsigned) (wait / waits),
+	       waits);
+
+	close(ep);
+}
+
+int
+main(int argc, char **argv)
+{
+	int	i, fds[2];
+
+	oskit_clientos_init();
+
+	for (i = 0; i < NIDLE + NACTIVE; i++) {
+		if (pipe(fds) < 0)
+			bench_fail("pipe", errno);
+		rfd[i] = fds[0];
+		wfd[i] = fds[1];
+	}
+
+	run("level", 0);
+	run("edge", EPOLLET);
+
+	exit(0);
+	return 0;
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * fsnamespace name cache benchmark.
+ *
+ * Builds a source-tree-like hierarchy in a memfs, with long names, and
+ * then does what a compiler does: for each header, try each directory
+ * on the include path in turn until it is found. Most of those lookups
+ * fail, so this exercises the negative entries as well as the ordinary
+ * ones. The run is repeated with the name cache turned off, and with a
+ * few different memory budgets.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <oskit/fs/memfs.h>
+#include <oskit/fs/filesystem.h>
+#include <oskit/fs/fsnamespace.h>
+#include <oskit/fs/dir.h>
+#include <oskit/fs/file.h>
+#include <oskit/clientos.h>
+#include <oskit/startup.h>
+#include <oskit/machine/proc_reg.h>
+
+#include "bench.h"
+
+#define NINCDIRS	8		/* Directories on the include path */
+#define NHEADERS	200		/* Headers in each of them */
+#define NLOOKUPS	20000		/* Headers looked for per run */
+
+static oskit_size_t budgets[] = { 0, 16 * 1024, 128 * 1024, 1024 * 1024 };
+
+static void
+incdir(char *buf, int d)
+{
+	sprintf(buf, "/usr/src/build/component_library_number_%d/include", d);
+}
+
+static void
+header(char *buf, int h)
+{
+	sprintf(buf, "generated_interface_definitions_%d.h", h);
+}
+
+/*
+ * Make dirs along a path, like mkdir -p.
+ */
+static oskit_dir_t *
+mkpath(oskit_dir_t *root, const char *path)
+{
+	oskit_dir_t	*dir = root, *sub;
+	oskit_file_t	*file;
+	oskit_error_t	rc;
+	char		comp[128];
+	int		i;
+
+	oskit_dir_addref(dir);
+	while (*path) {
+		while (*path == '/')
+			path++;
+		for (i = 0; *path && *path != '/'; )
+			comp[i++] = *path++;
+		comp[i] = 0;
+
+		rc = oskit_dir_mkdir(dir, comp, 0755);
+		if (rc && rc != OSKIT_EEXIST)
+			bench_fail("mkdir", rc);
+		if ((rc = oskit_dir_lookup(dir, comp, &file)) != 0)
+			bench_fail("lookup", rc);
+		if ((rc = oskit_file_query(file, &oskit_dir_iid,
+					   (void **)&sub)) != 0)
+			bench_fail("query dir", rc);
+		oskit_file_release(file);
+		oskit_dir_release(dir);
+		dir = sub;
+	}
+	return dir;
+}
+
+/*
+ * Header h lives only in include directory h % NINCDIRS.
+ */
+static void
+populate(oskit_dir_t *root)
+{
+	oskit_dir_t	*dir;
+	oskit_file_t	*file;
+	oskit_error_t	rc;
+	char		name[128];
+	int		d, h;
+
+	for (d = 0; d < NINCDIRS; d++) {
+		incdir(name, d);
+		dir = mkpath(root, name);
+		for (h = d; h < NHEADERS * NINCDIRS; h += NINCDIRS) {
+			header(name, h);
+			if ((rc = oskit_dir_create(dir, name, 1, 0644,
+						   &file)) != 0)
+				bench_fail("create", rc);
+			oskit_file_release(file);
+		}
+		oskit_dir_release(dir);
+	}
+}
+
+static void
+run(oskit_fsnamespace_t *fsn, oskit_size_t budget)
+{
+	struct oskit_fsnamespace_cache_stats stats;
+	unsigned long long before, cycles;
+	oskit_file_t	*file;
+	oskit_error_t	rc;
+	char		path[256], *p;
+	int		n, d, h, lookups = 0;
+
+	oskit_fsnamespace_cache_setsize(fsn, 0);
+	oskit_fsnamespace_cache_setsize(fsn, budget);
+	oskit_fsnamespace_cache_stats(fsn, &stats);
+
+	bench_srandom(1);
+	before = get_tsc();
+	for (n = 0; n < NLOOKUPS; n++) {
+		h = bench_random() % (NHEADERS * NINCDIRS);
+		for (d = 0; d < NINCDIRS; d++) {
+			incdir(path, d);
+			p = path + strlen(path);
+			*p++ = '/';
+			header(p, h);
+
+			lookups++;
+			rc = oskit_fsnamespace_lookup(fsn, path,
+						      FSLOOKUP_FOLLOW, &file);
+			if (rc == 0) {
+				oskit_file_release(file);
+				break;
+			}
+			if (rc != OSKIT_ENOENT)
+				bench_fail("fsnamespace lookup", rc);
+		}
+		if (d != h % NINCDIRS)
+			printf("Found header %d in the wrong place!\n", h);
+	}
+	cycles = get_tsc() - before;
+
+	{
+		struct oskit_fsnamespace_cache_stats end;
+
+		oskit_fsnamespace_cache_stats(fsn, &end);
+		printf("%8u %10u %8u %8u %8u %8u %8u\n",
+		       (unsigned) budget,
+		       (unsigned) (cycles / lookups),
+		       end.hits - stats.hits,
+		       end.neghits - stats.neghits,
+		       end.misses - stats.misses,
+		       end.evictions - stats.evictions,
+		       end.entries);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	oskit_filesystem_t *fs;
+	oskit_fsnamespace_t *fsn;
+	oskit_dir_t	*root;
+	oskit_error_t	rc;
+	int		i;
+
+#ifndef KNIT
+	oskit_clientos_init();
+	rc = oskit_memfs_init(start_osenv(), &fs);
+#else
+	rc = oskit_memfs_init(&fs);
+#endif
+	if (rc)
+		bench_fail("oskit_memfs_init", rc);
+	if ((rc = oskit_filesystem_getroot(fs, &root)) != 0)
+		bench_fail("getroot", rc);
+	if ((rc = oskit_create_fsnamespace(root, root, &fsn)) != 0)
+		bench_fail("oskit_create_fsnamespace", rc);
+
+	populate(root);
+
+	printf("%d header searches over %d include dirs\n",
+	       NLOOKUPS, NINCDIRS);
+	printf("%8s %10s %8s %8s %8s %8s %8s\n", "budget", "cycles",
+	       "hits", "neghits", "misses", "evicted", "entries");
+	for (i = 0; i < sizeof budgets / sizeof budgets[0]; i++)
+		run(fsn, budgets[i]);
+
+	oskit_fsnamespace_release(fsn);
+	oskit_dir_release(root);
+	oskit_filesystem_release(fs);
+	return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * H-PFQ packet rate benchmark.
+ *
+ * Builds share trees with hundreds of leaf classes and measures how many
+ * cycles the scheduler spends per packet. There is no real link: the root
+ * pushes into a netio that just counts, and we play the transmit-done
+ * interrupt ourselves by calling pfq_reset_path after every packet. Each
+ * time a packet goes out, another one arrives on a random leaf, so every
+ * class stays backlogged and the virtual queues stay full.
+ *
+ * Two shapes are timed: a flat tree with all the leaves under the root
+ * (one big virtual queue), and a two level tree with the leaves spread
+ * over a number of intermediate nodes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <oskit/hpfq.h>
+#include <oskit/io/netio.h>
+#include <oskit/io/bufio.h>
+#include <oskit/clientos.h>
+#include <oskit/startup.h>
+#include <oskit/machine/proc_reg.h>
+
+#include "bench.h"
+
+#define PACKETS		200000		/* Packets sent per run */
+#define BACKLOG		2		/* Packets queued on each leaf */
+#define GROUPS		16		/* Intermediate nodes, two level tree */
+#define MAXLEAVES	1000
+
+static int nleaves[] = { 10, 100, 300, 1000 };
+
+static int sizes[] = { 64, 576, 1500 };
+#define NSIZES		(sizeof sizes / sizeof sizes[0])
+
+static oskit_bufio_t	*packets[NSIZES];
+static pfq_sched_t	*groups[GROUPS];
+static pfq_sched_t	*parents[MAXLEAVES];
+static pfq_leaf_t	*leaves[MAXLEAVES];
+static oskit_netio_t	*nios[MAXLEAVES];
+static unsigned int	sent;
+
+/*
+ * The link. Packets go nowhere.
+ */
+static oskit_error_t
+link_push(void *data, oskit_bufio_t *b, oskit_size_t size)
+{
+	sent++;
+	return 0;
+}
+
+/*
+ * Give leaf i a packet of a random size.
+ */
+static void
+arrive(int i)
+{
+	oskit_error_t	rc;
+	int		s = bench_random() % NSIZES;
+
+	rc = oskit_netio_push(nios[i], packets[s], sizes[s]);
+	if (rc)
+		bench_fail("push", rc);
+}
+
+/*
+ * Hang N leaves off the root, or off NGROUPS intermediate nodes if
+ * NGROUPS is not zero. Every eighth class gets four times the share
+ * of the others.
+ */
+static void
+build(pfq_sched_t *root, int n, int ngroups)
+{
+	oskit_error_t	rc;
+	float		unit;
+	int		i, g, per;
+
+	for (g = 0; g < ngroups; g++) {
+		if ((rc = pfq_sff_create(&groups[g])) != 0)
+			bench_fail("pfq_sff_create", rc);
+		if ((rc = pfq_sched_add_child(root, groups[g],
+					      1.0 / ngroups)) != 0)
+			bench_fail("add_child", rc);
+	}
+
+	per = ngroups ? (n + ngroups - 1) / ngroups : n;
+	unit = 1.0 / (per + 3 * (per + 7) / 8);
+	for (i = 0; i < n; i++) {
+		parents[i] = ngroups ? groups[i % ngroups] : root;
+		if ((rc = pfq_leaf_create(&leaves[i])) != 0)
+			bench_fail("pfq_leaf_create", rc);
+		rc = pfq_sched_add_child(parents[i], (pfq_sched_t *) leaves[i],
+					 (i % 8) ? unit : 4 * unit);
+		if (rc)
+			bench_fail("add_child", rc);
+		if ((rc = pfq_leaf_get_netio(leaves[i], &nios[i])) != 0)
+			bench_fail("get_netio", rc);
+	}
+}
+
+static void
+teardown(pfq_sched_t *root, int n, int ngroups)
+{
+	int	i, g;
+
+	for (i = 0; i < n; i++) {
+		oskit_netio_release(nios[i]);
+		pfq_sched_remove_child(parents[i], (pfq_sched_t *) leaves[i]);
+		pfq_leaf_release(leaves[i]);
+	}
+	for (g = 0; g < ngroups; g++) {
+		pfq_sched_remove_child(root, groups[g]);
+		pfq_sched_release(groups[g]);
+	}
+}
+
+static void
+run(int n, int ngroups)
+{
+	unsigned long long before, cycles;
+	oskit_netio_t	*link;
+	pfq_sched_t	*root;
+	oskit_error_t	rc;
+	int		i, j;
+
+	link = oskit_netio_create(link_push, 0);
+	if (link == NULL)
+		bench_fail("oskit_netio_create", OSKIT_E_OUTOFMEMORY);
+	if ((rc = pfq_ssf_create_root(link, &root)) != 0)
+		bench_fail("pfq_ssf_create_root", rc);
+	oskit_pfq_root = root;
+	oskit_pfq_reset_path = pfq_reset_path;
+
+	build(root, n, ngroups);
+
+	bench_srandom(1);
+	for (j = 0; j < BACKLOG; j++)
+		for (i = 0; i < n; i++)
+			arrive(i);
+
+	sent = 0;
+	before = get_tsc();
+	for (i = 0; i < PACKETS; i++) {
+		pfq_reset_path(root);
+		arrive(bench_random() % n);
+	}
+	cycles = get_tsc() - before;
+
+	printf("%6d %7d %10u %10u\n", n, ngroups,
+	       (unsigned) (cycles / PACKETS), sent);
+
+	/*
+	 * Drain whatever is still queued, then tear it all down.
+	 */
+	for (i = 0; i < n * BACKLOG; i++)
+		pfq_reset_path(root);
+	teardown(root, n, ngroups);
+	pfq_sched_release(root);
+	oskit_netio_release(link);
+	oskit_pfq_root = NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+	int	i;
+
+#ifndef KNIT
+	oskit_clientos_init();
+#endif
+
+	for (i = 0; i < NSIZES; i++) {
+		if ((packets[i] = oskit_bufio_create(sizes[i])) == NULL)
+			bench_fail("oskit_bufio_create", OSKIT_E_OUTOFMEMORY);
+	}
+
+	printf("%d packets per run, cycles per packet:\n", PACKETS);
+	printf("%6s %7s %10s %10s\n", "leaves", "groups", "cycles", "sent");
+	for (i = 0; i < sizeof nleaves / sizeof nleaves[0]; i++) {
+		run(nleaves[i], 0);
+		run(nleaves[i], GROUPS);
+	}
+
+	pfq_dump_stats();
+
+	for (i = 0; i < NSIZES; i++)
+		oskit_bufio_release(packets[i]);
+	return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * LMM fragmentation stress test.
+ *
+ * Runs the same random sequence of allocations and frees against an LMM
+ * with an ordinary (list) region and one with an indexed region, and
+ * reports the cycles per operation as the number of free fragments grows.
+ * The mix includes plain allocations, page allocations, and
+ * range-constrained aligned allocations, like a physical memory pool sees.
+ * Since both kinds of region use the same first-fit policy, each
+ * allocation should land at the same place in both arenas; the runs
+ * log where every one went, and the test fails at the first that
+ * differs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <oskit/lmm.h>
+#include <oskit/page.h>
+#include <oskit/clientos.h>
+#include <oskit/machine/proc_reg.h>
+
+#include "bench.h"
+
+#define SLOTS		8192		/* Blocks live at any one time */
+#define PHASES		8
+#define PHASE_OPS	50000
+#define ARENA_SIZE	(16 * 1024 * 1024)
+#define NOWHERE		((oskit_size_t) -1)	/* Logged for a failed alloc */
+
+struct bench {
+	const char	*name;
+	lmm_t		lmm;
+	lmm_region_t	region;
+	char		*arena;
+	void		*blocks[SLOTS];
+	oskit_size_t	sizes[SLOTS];
+	oskit_size_t	*log;		/* Arena offset of each alloc */
+	int		nlog;
+	unsigned long long cycles[PHASES];
+};
+
+static struct bench	list_bench, index_bench;
+
+static void
+setup(struct bench *b, const char *name, lmm_flags_t flags)
+{
+	b->name  = name;
+	b->arena = smemalign(PAGE_SIZE, ARENA_SIZE);
+	if (b->arena == NULL)
+		panic("Could not get the %s arena", b->name);
+	b->log = malloc(PHASES * PHASE_OPS * sizeof(*b->log));
+	if (b->log == NULL)
+		panic("Could not get the %s log", b->name);
+
+	lmm_init(&b->lmm);
+	lmm_add_region(&b->lmm, &b->region, b->arena, ARENA_SIZE, flags, 0);
+	lmm_add_free(&b->lmm, b->arena, ARENA_SIZE);
+}
+
+static void
+run(struct bench *b)
+{
+	unsigned long long before;
+	int		phase, n, i;
+	unsigned int	r;
+
+	bench_srandom(1);
+	for (phase = 0; phase < PHASES; phase++) {
+		before = get_tsc();
+		for (n = 0; n < PHASE_OPS; n++) {
+			i = bench_random() % SLOTS;
+			if (b->blocks[i]) {
+				lmm_free(&b->lmm, b->blocks[i], b->sizes[i]);
+				b->blocks[i] = 0;
+				continue;
+			}
+
+			r = bench_random();
+			switch (r & 7) {
+			case 0:
+				b->sizes[i]  = PAGE_SIZE;
+				b->blocks[i] = lmm_alloc_page(&b->lmm, 0);
+				break;
+			case 1:
+				/* DMA-ish: aligned, in the bottom quarter */
+				b->sizes[i]  = 32 * (1 + (r >> 3) % 64);
+				b->blocks[i] = lmm_alloc_gen(&b->lmm,
+					b->sizes[i], 0, 6, 0,
+					(oskit_addr_t)b->arena,
+					ARENA_SIZE / 4);
+				break;
+			default:
+				b->sizes[i]  = 32 * (1 + (r >> 3) % 16);
+				b->blocks[i] = lmm_alloc(&b->lmm,
+							 b->sizes[i], 0);
+				break;
+			}
+			b->log[b->nlog++] = b->blocks[i] ?
+				(char *) b->blocks[i] - b->arena : NOWHERE;
+		}
+		b->cycles[phase] = get_tsc() - before;
+	}
+}
+
+/*
+ * The two runs made the same calls, so they should have got the same
+ * answers.
+ */
+static void
+compare(struct bench *a, struct bench *b)
+{
+	int	n;
+
+	if (a->nlog != b->nlog)
+		panic("%s made %d allocations, %s made %d",
+		      a->name, a->nlog, b->name, b->nlog);
+
+	for (n = 0; n < a->nlog; n++) {
+		if (a->log[n] != b->log[n])
+			panic("Allocation %d: %s gave offset 0x%x, %s 0x%x",
+			      n, a->name, a->log[n], b->name, b->log[n]);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	int	phase;
+
+	oskit_clientos_init();
+
+	setup(&list_bench, "list", 0);
+	setup(&index_bench, "indexed", LMMF_INDEXED);
+
+	run(&list_bench);
+	run(&index_bench);
+	compare(&list_bench, &index_bench);
+
+	printf("%d ops per phase, cycles per op:\n", PHASE_OPS);
+	printf("phase %12s %12s\n", list_bench.name, index_bench.name);
+	for (phase = 0; phase < PHASES; phase++)
+		printf("%5d %12u %12u\n", phase,
+		       (unsigned) (list_bench.cycles[phase] / PHASE_OPS),
+		       (unsigned) (index_bench.cycles[phase] / PHASE_OPS));
+
+	lmm_stats(&list_bench.lmm);
+	lmm_stats(&index_bench.lmm);
+
+	return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Compare the malloc/free path through the memory object (which puts a
+ * slab layer in front of the LMM for small requests) against plain
+ * first-fit allocation from an LMM, which is what malloc used to do.
+ *
+ * The workload keeps a fixed number of objects live and randomly replaces
+ * them with objects of a different (mostly small) size, which is roughly
+ * what a long running kernel does to its heap. For each allocator the
+ * cycles per alloc/free pair are reported, along with the shape of the
+ * LMM free list at the end of the run; lots of little free nodes means
+ * a fragmented heap and slow first-fit searches.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <oskit/lmm.h>
+#include <oskit/clientos.h>
+#include <oskit/com/mem.h>
+#include <oskit/com/services.h>
+#include <oskit/machine/proc_reg.h>
+
+#include "bench.h"
+
+#define LIVE		4096		/* Objects live at any one time */
+#define ROUNDS		200000		/* Replacements per run */
+#define ARENA_SIZE	(4 * 1024 * 1024)
+
+extern lmm_t		malloc_lmm;
+
+static lmm_t		bench_lmm = LMM_INITIALIZER;
+static lmm_region_t	bench_region;
+
+static void		*objs[LIVE];
+static oskit_size_t	sizes[LIVE];
+
+/*
+ * Mostly small objects with the occasional large one.
+ */
+static oskit_size_t
+random_size(void)
+{
+	unsigned int r = bench_random();
+
+	if ((r & 63) == 0)
+		return 1024 + (r & 4095);
+	return 8 + (r % 250);
+}
+
+/*
+ * Walk the free list of an LMM and report how chopped up it is.
+ */
+static void
+lmm_shape(const char *name, lmm_t *lmm)
+{
+	oskit_addr_t	addr = 0;
+	oskit_size_t	size, largest = 0, total = 0;
+	lmm_flags_t	flags;
+	int		nodes = 0;
+
+	while (1) {
+		lmm_find_free(lmm, &addr, &size, &flags);
+		if (size == 0)
+			break;
+		nodes++;
+		total += size;
+		if (size > largest)
+			largest = size;
+		addr += size;
+	}
+	printf("%s: %d free blocks, %d bytes free, largest %d bytes\n",
+	       name, nodes, total, largest);
+}
+
+static void
+run_lmm(void)
+{
+	unsigned long long before, after;
+	void		*arena;
+	int		i, n;
+
+	arena = smemalign(4096, ARENA_SIZE);
+	if (arena == NULL)
+		panic("Could not get the arena");
+	lmm_add_region(&bench_lmm, &bench_region, arena, ARENA_SIZE, 0, 0);
+	lmm_add_free(&bench_lmm, arena, ARENA_SIZE);
+
+	bench_srandom(1);
+	for (i = 0; i < LIVE; i++) {
+		sizes[i] = random_size();
+		objs[i]  = lmm_alloc(&bench_lmm, sizes[i], 0);
+	}
+
+	before = get_tsc();
+	for (n = 0; n < ROUNDS; n++) {
+		i = bench_random() % LIVE;
+		lmm_free(&bench_lmm, objs[i], sizes[i]);
+		sizes[i] = random_size();
+		if ((objs[i] = lmm_alloc(&bench_lmm, sizes[i], 0)) == NULL)
+			panic("LMM arena exhausted after %d rounds", n);
+	}
+	after = get_tsc();
+
+	printf("lmm first-fit: %d cycles per free/alloc pair\n",
+	       (int) ((after - before) / ROUNDS));
+	lmm_shape("lmm first-fit", &bench_lmm);
+
+	for (i = 0; i < LIVE; i++)
+		lmm_free(&bench_lmm, objs[i], sizes[i]);
+}
+
+static void
+run_malloc(void)
+{
+	unsigned long long before, after;
+	int		i, n;
+
+	bench_srandom(1);
+	for (i = 0; i < LIVE; i++) {
+		sizes[i] = random_size();
+		objs[i]  = malloc(sizes[i]);
+	}
+
+	before = get_tsc();
+	for (n = 0; n < ROUNDS; n++) {
+		i = bench_random() % LIVE;
+		free(objs[i]);
+		sizes[i] = random_size();
+		if ((objs[i] = malloc(sizes[i])) == NULL)
+			panic("malloc failed after %d rounds", n);
+	}
+	after = get_tsc();
+
+	printf("malloc (slab): %d cycles per free/alloc pair\n",
+	       (int) ((after - before) / ROUNDS));
+	lmm_shape("malloc_lmm", &malloc_lmm);
+
+	for (i = 0; i < LIVE; i++)
+		free(objs[i]);
+}
+
+int
+main(int argc, char **argv)
+{
+	oskit_mem_t	*memi;
+
+	oskit_clientos_init();
+
+	printf("%d live objects, %d replacements\n", LIVE, ROUNDS);
+
+	run_lmm();
+	run_malloc();
+
+	/* Print the per size class statistics */
+	if (oskit_lookup_first(&oskit_mem_iid, (void **)&memi) == 0 && memi)
+		oskit_mem_dump(memi);
+
+	return 0;
+}
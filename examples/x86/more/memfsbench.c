@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * memfs directory and file growth benchmark.
+ *
+ * For directories of increasing size, creates N files, looks each one
+ * up, reads the directory back, and unlinks them all again, reporting
+ * cycles per operation. With the hashed directory index these should
+ * stay flat as N grows. Then appends a few megabytes to one file in
+ * small writes, which should cost the same per write however big the
+ * file has got.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <oskit/fs/memfs.h>
+#include <oskit/fs/filesystem.h>
+#include <oskit/fs/dir.h>
+#include <oskit/fs/file.h>
+#include <oskit/io/bufio.h>
+#include <oskit/clientos.h>
+#include <oskit/startup.h>
+#include <oskit/machine/proc_reg.h>
+
+#include "bench.h"
+
+#define APPEND_SIZE	(4 * 1024 * 1024)
+#define APPEND_WRITE	512
+#define APPEND_STEPS	8
+
+static int sizes[] = { 100, 1000, 10000, 30000 };
+
+/*
+ * Spread the names out a bit, so they do not all share a prefix.
+ */
+static void
+mkname(char *buf, int i)
+{
+	sprintf(buf, "%x.%d.tmp", (i * 2654435761U) >> 20, i);
+}
+
+static void
+dirbench(oskit_dir_t *root, int n)
+{
+	unsigned long long before, create, lookup, readdir, unlink;
+	struct oskit_dirents *dirents;
+	oskit_dir_t	*dir;
+	oskit_file_t	*file;
+	oskit_error_t	rc;
+	oskit_u32_t	ofs;
+	char		name[32];
+	int		i, count, total;
+
+	if ((rc = oskit_dir_mkdir(root, "spool", 0755)) != 0)
+		bench_fail("mkdir", rc);
+	if ((rc = oskit_dir_lookup(root, "spool", &file)) != 0)
+		bench_fail("lookup spool", rc);
+	dir = (oskit_dir_t *) file;
+
+	before = get_tsc();
+	for (i = 0; i < n; i++) {
+		mkname(name, i);
+		if ((rc = oskit_dir_create(dir, name, 1, 0644, &file)) != 0)
+			bench_fail("create", rc);
+		oskit_file_release(file);
+	}
+	create = get_tsc() - before;
+
+	before = get_tsc();
+	for (i = 0; i < n; i++) {
+		mkname(name, (i * 7919) % n);
+		if ((rc = oskit_dir_lookup(dir, name, &file)) != 0)
+			bench_fail("lookup", rc);
+		oskit_file_release(file);
+	}
+	lookup = get_tsc() - before;
+
+	before = get_tsc();
+	total = 0;
+	ofs = 0;
+	for (;;) {
+		if ((rc = oskit_dir_getdirentries(dir, &ofs, 1, &dirents)) != 0)
+			bench_fail("getdirentries", rc);
+		if (! dirents)
+			break;
+		oskit_dirents_getcount(dirents, &count);
+		oskit_dirents_release(dirents);
+		if (count == 0)
+			break;
+		total += count;
+	}
+	readdir = get_tsc() - before;
+	if (total != n)
+		printf("getdirentries returned %d entries, not %d\n", total, n);
+
+	before = get_tsc();
+	for (i = 0; i < n; i++) {
+		mkname(name, i);
+		if ((rc = oskit_dir_unlink(dir, name)) != 0)
+			bench_fail("unlink", rc);
+	}
+	unlink = get_tsc() - before;
+
+	oskit_dir_release(dir);
+	if ((rc = oskit_dir_rmdir(root, "spool")) != 0)
+		bench_fail("rmdir", rc);
+
+	printf("%6d %10u %10u %10u %10u\n", n,
+	       (unsigned) (create / n), (unsigned) (lookup / n),
+	       (unsigned) (readdir / n), (unsigned) (unlink / n));
+}
+
+static void
+appendbench(oskit_dir_t *root)
+{
+	static char	buf[APPEND_WRITE];
+	unsigned long long before;
+	oskit_file_t	*file;
+	oskit_bufio_t	*bio;
+	oskit_error_t	rc;
+	oskit_u32_t	actual;
+	int		off, step, stepsize;
+
+	if ((rc = oskit_dir_create(root, "log", 1, 0644, &file)) != 0)
+		bench_fail("create log", rc);
+	if ((rc = oskit_file_query(file, &oskit_bufio_iid, (void **)&bio)) != 0)
+		bench_fail("query bufio", rc);
+
+	printf("\nappending %d bytes in %d byte writes, cycles per write:\n",
+	       APPEND_SIZE, APPEND_WRITE);
+	stepsize = APPEND_SIZE / APPEND_STEPS;
+	for (off = step = 0; step < APPEND_STEPS; step++) {
+		before = get_tsc();
+		for (; off < (step + 1) * stepsize; off += APPEND_WRITE) {
+			rc = oskit_bufio_write(bio, buf, off, APPEND_WRITE,
+					       &actual);
+			if (rc || actual != APPEND_WRITE)
+				bench_fail("write", rc);
+		}
+		printf("  up to %7d bytes: %u\n", off,
+		       (unsigned) ((get_tsc() - before) /
+				   (stepsize / APPEND_WRITE)));
+	}
+
+	oskit_bufio_release(bio);
+	oskit_file_release(file);
+	if ((rc = oskit_dir_unlink(root, "log")) != 0)
+		bench_fail("unlink log", rc);
+}
+
+int
+main(int argc, char **argv)
+{
+	oskit_filesystem_t *fs;
+	oskit_dir_t	*root;
+	oskit_error_t	rc;
+	int		i;
+
+#ifndef KNIT
+	oskit_clientos_init();
+	rc = oskit_memfs_init(start_osenv(), &fs);
+#else
+	rc = oskit_memfs_init(&fs);
+#endif
+	if (rc)
+		bench_fail("oskit_memfs_init", rc);
+	if ((rc = oskit_filesystem_getroot(fs, &root)) != 0)
+		bench_fail("getroot", rc);
+
+	printf("cycles per file:\n");
+	printf("%6s %10s %10s %10s %10s\n",
+	       "files", "create", "lookup", "readdir", "unlink");
+	for (i = 0; i < sizeof sizes / sizeof sizes[0]; i++)
+		dirbench(root, sizes[i]);
+
+	appendbench(root);
+
+	oskit_dir_release(root);
+	oskit_filesystem_release(fs);
+	return 0;
+}
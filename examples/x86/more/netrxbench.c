@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Network stack receive rate test.
+ *
+ * Sets up the FreeBSD stack on a fake interface the way socket_com2
+ * does, with no device behind it: anything the stack sends is counted
+ * and dropped.  Minimum size UDP frames for a bound socket are then
+ * pushed into the stack's receive netio in batches of 1, 2, 8 and 32,
+ * and the cycles per frame from push to socket buffer are reported.
+ * A batch of one is what a driver pushing frame by frame costs.  Also
+ * builds in unix mode.
+ */
+
+#include <oskit/dev/dev.h>
+#include <oskit/dev/net.h>
+#include <oskit/dev/ethernet.h>
+#include <oskit/io/netio.h>
+#include <oskit/io/bufio.h>
+#include <oskit/net/freebsd.h>
+#include <oskit/net/socket.h>
+#include <oskit/clientos.h>
+#include <oskit/startup.h>
+#include <oskit/machine/proc_reg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bench.h"
+
+#define IPADDR		"10.0.0.1"
+#define PEERADDR	"10.0.0.2"
+#define NETMASK		"255.255.255.0"
+#define PORT		9
+
+#define FRAMELEN	60		/* Minimum Ethernet frame, less CRC */
+#define NFRAMES		(64 * 1024)
+
+static unsigned char	haddr[6] = { 0x00, 0x02, 0xb3, 0x00, 0x00, 0x01 };
+static unsigned char	peer[6]  = { 0x00, 0x02, 0xb3, 0x00, 0x00, 0x02 };
+
+static unsigned char	frame[FRAMELEN];
+static int		sent;
+
+/*
+ * The send side of the fake interface.
+ */
+static oskit_error_t
+sink(void *data, oskit_bufio_t *b, oskit_size_t size)
+{
+	sent++;
+	return 0;
+}
+
+static unsigned short
+cksum(unsigned char *p, int len)
+{
+	unsigned long	sum = 0;
+
+	for (; len > 1; p += 2, len -= 2)
+		sum += (p[0] << 8) | p[1];
+	if (len)
+		sum += p[0] << 8;
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum & 0xffff;
+}
+
+/*
+ * Build an Ethernet/IP/UDP frame from the peer to our socket.
+ * The UDP checksum is left zero, which means none.
+ */
+static void
+build_frame(void)
+{
+	unsigned char	*eh = frame, *ip = frame + 14, *udp = ip + 20;
+	unsigned long	src = ntohl(inet_addr(PEERADDR));
+	unsigned long	dst = ntohl(inet_addr(IPADDR));
+	int		iplen = FRAMELEN - 14;
+	unsigned short	sum;
+
+	memcpy(eh, haddr, 6);
+	memcpy(eh + 6, peer, 6);
+	eh[12] = 0x08;
+	eh[13] = 0x00;
+
+	ip[0] = 0x45;
+	ip[2] = iplen >> 8;
+	ip[3] = iplen;
+	ip[8] = 64;			/* TTL */
+	ip[9] = IPPROTO_UDP;
+	ip[12] = src >> 24; ip[13] = src >> 16; ip[14] = src >> 8; ip[15] = src;
+	ip[16] = dst >> 24; ip[17] = dst >> 16; ip[18] = dst >> 8; ip[19] = dst;
+	sum = cksum(ip, 20);
+	ip[10] = sum >> 8;
+	ip[11] = sum;
+
+	udp[0] = PORT >> 8;
+	udp[1] = PORT;
+	udp[2] = PORT >> 8;
+	udp[3] = PORT;
+	udp[4] = (iplen - 20) >> 8;
+	udp[5] = iplen - 20;
+}
+
+/*
+ * Read everything queued on the socket; returns the datagram count.
+ */
+static int
+drain(oskit_socket_t *so)
+{
+	char		buf[FRAMELEN];
+	oskit_size_t	got;
+	int		n = 0;
+
+	while (oskit_socket_recvfrom(so, buf, sizeof buf, OSKIT_MSG_DONTWAIT,
+				     0, 0, &got) == 0)
+		n++;
+	return n;
+}
+
+static void
+run(oskit_netio_t *recv, oskit_socket_t *so, unsigned batch)
+{
+	oskit_bufio_t		*bufs[OSKIT_NETIO_BATCH];
+	oskit_size_t		sizes[OSKIT_NETIO_BATCH];
+	unsigned long long	before, cycles = 0;
+	unsigned		i;
+	int			n, delivered = 0;
+	void			*p;
+
+	for (n = 0; n < NFRAMES; n += batch) {
+		for (i = 0; i < batch; i++) {
+			bufs[i] = oskit_bufio_create(FRAMELEN);
+			if (bufs[i] == NULL)
+				bench_fail("oskit_bufio_create", OSKIT_ENOMEM);
+			oskit_bufio_map(bufs[i], &p, 0, FRAMELEN);
+			memcpy(p, frame, FRAMELEN);
+			sizes[i] = FRAMELEN;
+		}
+
+		before = get_tsc();
+		oskit_netio_push_batch(recv, bufs, sizes, batch);
+		cycles += get_tsc() - before;
+
+		for (i = 0; i < batch; i++)
+			oskit_bufio_release(bufs[i]);
+		delivered += drain(so);
+	}
+
+	printf("batch %2u: %d frames, %d delivered, %u cycles per frame\n",
+	       batch, n, delivered, (unsigned) (cycles / n));
+}
+
+int
+main(int argc, char **argv)
+{
+	static unsigned		batches[] = { 1, 2, 8, OSKIT_NETIO_BATCH };
+	oskit_socket_factory_t	*factory;
+	oskit_freebsd_net_ether_if_t *eif;
+	oskit_socket_t		*so;
+	struct sockaddr_in	addr;
+	oskit_error_t		rc;
+	int			i;
+
+	oskit_clientos_init();
+
+	if ((rc = oskit_freebsd_net_init(start_osenv(), &factory)) != 0)
+		bench_fail("oskit_freebsd_net_init", rc);
+	if ((rc = oskit_freebsd_net_prepare_ether_if(&eif)) != 0)
+		bench_fail("oskit_freebsd_net_prepare_ether_if", rc);
+	eif->send_nio = oskit_netio_create(sink, 0);
+	memcpy(eif->haddr, haddr, sizeof haddr);
+	if ((rc = oskit_freebsd_net_ifconfig(eif, "de0", IPADDR, NETMASK)) != 0)
+		bench_fail("oskit_freebsd_net_ifconfig", rc);
+
+	if ((rc = oskit_socket_factory_create(factory, OSKIT_AF_INET,
+					      OSKIT_SOCK_DGRAM, IPPROTO_UDP,
+					      &so)) != 0)
+		bench_fail("oskit_socket_factory_create", rc);
+	memset(&addr, 0, sizeof addr);
+	addr.sin_family = OSKIT_AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(PORT);
+	if ((rc = oskit_socket_bind(so, (struct oskit_sockaddr *)&addr,
+				    sizeof addr)) != 0)
+		bench_fail("oskit_socket_bind", rc);
+
+	build_frame();
+	for (i = 0; i < sizeof batches / sizeof batches[0]; i++)
+		run(eif->recv_nio, so, batches[i]);
+	printf("%d frames sent by the stack\n", sent);
+
+	oskit_socket_release(so);
+	oskit_freebsd_net_close_ether_if(eif);
+	exit(0);
+	return 0;
+}
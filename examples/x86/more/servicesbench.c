@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * COM services registry test.
+ *
+ * Registers a few hundred objects in the global registry, two to an
+ * IID, the way a kernel with a lot of drivers and services would at
+ * startup.  Then times oskit_lookup_first for the memory object, as
+ * the C library does, and for each of the new IIDs, oskit_lookup for
+ * each of the new IIDs, and unregistering everything again.  Reports
+ * cycles per call.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <oskit/com.h>
+#include <oskit/com/services.h>
+#include <oskit/com/mem.h>
+#include <oskit/clientos.h>
+#include <oskit/machine/proc_reg.h>
+
+#include "bench.h"
+
+#define NIIDS		200
+#define NOBJS		(2 * NIIDS)
+#define NROUNDS		20
+
+static oskit_guid_t	iids[NIIDS];
+
+/*
+ * Do-nothing objects to register.
+ */
+static struct oskit_iunknown_ops obj_ops;
+static oskit_iunknown_t	objs[NOBJS];
+
+static OSKIT_COMDECL
+obj_query(oskit_iunknown_t *o, const struct oskit_guid *iid, void **out)
+{
+	*out = o;
+	return 0;
+}
+
+static OSKIT_COMDECL_U
+obj_addref(oskit_iunknown_t *o)
+{
+	return 1;
+}
+
+static OSKIT_COMDECL_U
+obj_release(oskit_iunknown_t *o)
+{
+	return 1;
+}
+
+static struct oskit_iunknown_ops obj_ops = {
+	obj_query, obj_addref, obj_release
+};
+
+static void
+report(const char *what, unsigned long long cycles, int calls)
+{
+	printf("  %-28s %6u\n", what, (unsigned) (cycles / calls));
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned long long before, cycles;
+	oskit_error_t	rc;
+	void		*intf, **arr;
+	int		i, r, n;
+
+	oskit_clientos_init();
+
+	/*
+	 * IIDs shaped like the OSKit's own: the same tail,
+	 * a different first word.
+	 */
+	for (i = 0; i < NIIDS; i++) {
+		oskit_guid_t g = OSKIT_GUID(0x4aa7e000 + i, 0x7c74, 0x11cf,
+				0xb5, 0x00, 0x08, 0x00, 0x09, 0x53, 0xad, 0xc2);
+		iids[i] = g;
+	}
+	for (i = 0; i < NOBJS; i++)
+		objs[i].ops = &obj_ops;
+
+	printf("cycles per call with %d objects under %d IIDs:\n",
+	       NOBJS, NIIDS);
+
+	before = get_tsc();
+	for (i = 0; i < NOBJS; i++)
+		if ((rc = oskit_register(&iids[i % NIIDS], &objs[i])) != 0)
+			bench_fail("oskit_register", rc);
+	report("oskit_register", get_tsc() - before, NOBJS);
+
+	before = get_tsc();
+	for (r = 0; r < NROUNDS * NIIDS; r++) {
+		oskit_lookup_first(&oskit_mem_iid, &intf);
+		if (intf == NULL)
+			bench_fail("oskit_lookup_first mem", 0);
+		oskit_mem_release((oskit_mem_t *) intf);
+	}
+	report("oskit_lookup_first(mem)", get_tsc() - before,
+	       NROUNDS * NIIDS);
+
+	cycles = 0;
+	for (r = 0; r < NROUNDS; r++) {
+		before = get_tsc();
+		for (i = 0; i < NIIDS; i++) {
+			oskit_lookup_first(&iids[i], &intf);
+			if (intf != &objs[i])
+				bench_fail("oskit_lookup_first", 0);
+		}
+		cycles += get_tsc() - before;
+	}
+	report("oskit_lookup_first", cycles, NROUNDS * NIIDS);
+
+	cycles = 0;
+	for (r = 0; r < NROUNDS; r++) {
+		before = get_tsc();
+		for (i = 0; i < NIIDS; i++) {
+			n = oskit_lookup(&iids[i], &arr);
+			if (n != 2 || arr[1] != &objs[i + NIIDS])
+				bench_fail("oskit_lookup", n);
+			free(arr);
+		}
+		cycles += get_tsc() - before;
+	}
+	report("oskit_lookup", cycles, NROUNDS * NIIDS);
+
+	before = get_tsc();
+	for (i = NOBJS - 1; i >= 0; i--)
+		if ((rc = oskit_unregister(&iids[i % NIIDS], &objs[i])) != 0)
+			bench_fail("oskit_unregister", rc);
+	report("oskit_unregister", get_tsc() - before, NOBJS);
+
+	exit(0);
+	return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Minimal C library stdio throughput test.
+ *
+ * Writes log lines with fprintf to a file in a memfs, fully buffered,
+ * line buffered and unbuffered, and then the same lines by character
+ * with fputc.  Then prints lines on the console with printf, with
+ * fprintf to the line buffered stdout, and with fprintf to the
+ * unbuffered stderr.  Reports cycles per line for each.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <oskit/fs/memfs.h>
+#include <oskit/fs/filesystem.h>
+#include <oskit/fs/dir.h>
+#include <oskit/fs/fsnamespace.h>
+#include <oskit/clientos.h>
+#include <oskit/startup.h>
+#include <oskit/machine/proc_reg.h>
+
+#include "bench.h"
+
+#define FILE_LINES	20000
+#define CONS_LINES	200
+
+#define LINE		"stdiobench: %6d this is a fairly typical log line\n"
+
+static const char *modes[] = { "full", "line", "none" };
+
+static unsigned	results[3 + 1 + 3];
+
+static unsigned
+file_lines(int mode, int bychar)
+{
+	unsigned long long before;
+	char		line[80];
+	FILE		*f;
+	int		i;
+	char		*p;
+
+	if ((f = fopen("/log", "w")) == NULL)
+		bench_fail("fopen", 0);
+	if (setvbuf(f, NULL, mode, 0) != 0)
+		bench_fail("setvbuf", 0);
+
+	before = get_tsc();
+	for (i = 0; i < FILE_LINES; i++) {
+		if (bychar) {
+			sprintf(line, LINE, i);
+			for (p = line; *p; p++)
+				fputc(*p, f);
+		}
+		else
+			fprintf(f, LINE, i);
+	}
+	fclose(f);
+	before = get_tsc() - before;
+
+	if (unlink("/log") != 0)
+		bench_fail("unlink", 0);
+	return (unsigned) (before / FILE_LINES);
+}
+
+static unsigned
+cons_lines(FILE *f)
+{
+	unsigned long long before;
+	int		i;
+
+	before = get_tsc();
+	for (i = 0; i < CONS_LINES; i++) {
+		if (f)
+			fprintf(f, LINE, i);
+		else
+			printf(LINE, i);
+	}
+	if (f)
+		fflush(f);
+	return (unsigned) ((get_tsc() - before) / CONS_LINES);
+}
+
+int
+main(int argc, char **argv)
+{
+	oskit_filesystem_t	*fs;
+	oskit_fsnamespace_t	*fsn;
+	oskit_dir_t		*root;
+	oskit_error_t		rc;
+	int			i;
+
+	oskit_clientos_init();
+	if ((rc = oskit_memfs_init(start_osenv(), &fs)) != 0)
+		bench_fail("oskit_memfs_init", rc);
+	if ((rc = oskit_filesystem_getroot(fs, &root)) != 0)
+		bench_fail("getroot", rc);
+	if ((rc = oskit_create_fsnamespace(root, root, &fsn)) != 0)
+		bench_fail("oskit_create_fsnamespace", rc);
+	oskit_clientos_setfsnamespace(fsn);
+
+	for (i = 0; i < 3; i++)
+		results[i] = file_lines(i, 0);
+	results[3] = file_lines(_IOFBF, 1);
+
+	results[4] = cons_lines(NULL);
+	results[5] = cons_lines(stdout);
+	results[6] = cons_lines(stderr);
+
+	printf("\ncycles per %d byte line:\n", (int) strlen(LINE) - 1);
+	for (i = 0; i < 3; i++)
+		printf("  memfs fprintf, %s buffered:\t%u\n",
+		       modes[i], results[i]);
+	printf("  memfs fputc, full buffered:\t%u\n", results[3]);
+	printf("  console printf:\t\t%u\n", results[4]);
+	printf("  console fprintf(stdout):\t%u\n", results[5]);
+	printf("  console fprintf(stderr):\t%u\n", results[6]);
+
+	oskit_clientos_setfsnamespace(NULL);
+	oskit_fsnamespace_release(fsn);
+	oskit_dir_release(root);
+	oskit_filesystem_release(fs);
+	exit(0);
+	return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Tickless clock test.
+ *
+ * Keeps a handful of timers going off at random intervals, first with
+ * the clock interrupting at every tick and then in tickless mode, and
+ * reports how many timer interrupts each took, how late the worst one
+ * was, and whether any timer went off on the wrong tick. Also builds
+ * in unix mode, where the one-shot timer is emulated with an itimer.
+ */
+
+#include <oskit/dev/dev.h>
+#include <oskit/time.h>
+#include <oskit/dev/clock.h>
+#include <oskit/dev/timer.h>
+#include <oskit/com/listener.h>
+#include <oskit/clientos.h>
+#include <oskit/startup.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define NTIMERS		8
+#define MAXTICKS	50		/* Half a second at 100Hz */
+#define RUNTICKS	1000		/* Ten seconds per run */
+#define NANOPERTICK	10000000
+
+static oskit_clock_t	*clock;
+static oskit_timer_t	*timers[NTIMERS];
+static unsigned int	due[NTIMERS];
+static volatile int	fired, early, late;
+
+static unsigned int
+now(void)
+{
+	oskit_timespec_t	ts;
+
+	oskit_clock_gettime(clock, &ts);
+	return ts.tv_sec * 100 + ts.tv_nsec / NANOPERTICK;
+}
+
+static void
+arm(int i)
+{
+	oskit_itimerspec_t	spec;
+	int			ticks = 1 + bench_random() % MAXTICKS;
+
+	spec.it_value.tv_sec = ticks / 100;
+	spec.it_value.tv_nsec = (ticks % 100) * NANOPERTICK;
+	spec.it_interval.tv_sec = 0;
+	spec.it_interval.tv_nsec = 0;
+	due[i] = now() + ticks;
+	oskit_timer_settime(timers[i], 0, &spec);
+}
+
+/*
+ * The timer's index is the listener's argument. Each timer re-arms
+ * itself for another random interval.
+ */
+static oskit_error_t
+expired(oskit_iunknown_t *obj, void *arg)
+{
+	int		i = (int) arg;
+	unsigned int	t = now();
+
+	fired++;
+	if (t < due[i])
+		early++;
+	else if (t > due[i])
+		late++;
+	arm(i);
+	return 0;
+}
+
+static void
+run(const char *what)
+{
+	struct osenv_timer_stats before, after;
+	oskit_itimerspec_t	spec;
+	unsigned int		end;
+	int			i;
+
+	fired = early = late = 0;
+	bench_srandom(1);
+	osenv_timer_getstats(&before);
+
+	osenv_intr_disable();
+	for (i = 0; i < NTIMERS; i++)
+		arm(i);
+	end = now() + RUNTICKS;
+	osenv_intr_enable();
+
+	while (now() < end)
+		continue;
+
+	memset(&spec, 0, sizeof spec);
+	for (i = 0; i < NTIMERS; i++)
+		oskit_timer_settime(timers[i], 0, &spec);
+	osenv_timer_getstats(&after);
+
+	printf("%-9s %10u %10u %10u %10u %6d %6d %6d\n", what,
+	       after.interrupts - before.interrupts,
+	       after.ticks - before.ticks,
+	       after.reprograms - before.reprograms,
+	       after.maxlate, fired, early, late);
+}
+
+int
+main(int argc, char **argv)
+{
+	oskit_listener_t	*l;
+	oskit_error_t		rc;
+	int			i;
+
+#ifndef KNIT
+	oskit_clientos_init();
+	/* The clock code needs an osenv */
+	start_osenv();
+#endif
+	clock = oskit_clock_init();
+
+	for (i = 0; i < NTIMERS; i++) {
+		oskit_clock_createtimer(clock, &timers[i]);
+		l = oskit_create_listener(expired, (void *) i);
+		oskit_timer_setlistener(timers[i], l);
+		oskit_listener_release(l);
+	}
+
+	printf("%d timers, 1 to %d ticks apart, for %d ticks:\n",
+	       NTIMERS, MAXTICKS, RUNTICKS);
+	printf("%-9s %10s %10s %10s %10s %6s %6s %6s\n", "mode",
+	       "interrupts", "ticks", "reprograms", "maxlate ns",
+	       "fired", "early", "late");
+
+	run("periodic");
+	if ((rc = oskit_clock_tickless(clock, 1)) != 0) {
+		printf("oskit_clock_tickless failed: 0x%x\n", rc);
+		exit(1);
+	}
+	run("tickless");
+	oskit_clock_tickless(clock, 0);
+
+	for (i = 0; i < NTIMERS; i++)
+		oskit_timer_release(timers[i]);
+	oskit_clock_release(clock);
+	exit(0);
+	return 0;
+}
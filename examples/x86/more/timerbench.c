@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * oskit_timer benchmark.
+ *
+ * Creates 100000 timers on the system clock and times arming them with
+ * random expiry times of up to five minutes, re-arming them all (as TCP
+ * does with its retransmit timers on every ack), asking each how long it
+ * has left, and cancelling them. Then arms a few thousand timers to go off
+ * over the next second and checks that each one goes off on the right tick.
+ */
+
+#include <oskit/dev/dev.h>
+#include <oskit/time.h>
+#include <oskit/dev/clock.h>
+#include <oskit/dev/timer.h>
+#include <oskit/com/listener.h>
+#include <oskit/clientos.h>
+#include <oskit/startup.h>
+#include <oskit/machine/proc_reg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define NTIMERS		100000
+#define MAXTICKS	30000		/* Five minutes at 100Hz */
+#define NFIRE		5000		/* Timers in the firing test */
+#define FIRETICKS	100		/* Spread over this many ticks */
+#define NANOPERTICK	10000000
+
+static oskit_clock_t	*clock;
+static oskit_timer_t	*timers[NTIMERS];
+static volatile int	fired, early, late;
+
+static void
+ticks2spec(int ticks, oskit_itimerspec_t *spec)
+{
+	spec->it_value.tv_sec = ticks / 100;
+	spec->it_value.tv_nsec = (ticks % 100) * NANOPERTICK;
+	spec->it_interval.tv_sec = 0;
+	spec->it_interval.tv_nsec = 0;
+}
+
+static unsigned long long
+now(void)
+{
+	oskit_timespec_t	ts;
+
+	oskit_clock_gettime(clock, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * The expected expiry time, in nanoseconds of clock time, is the
+ * listener's argument.
+ */
+static oskit_error_t
+expired(oskit_iunknown_t *obj, void *arg)
+{
+	unsigned long long	due = *(unsigned long long *) arg;
+	unsigned long long	t = now();
+
+	fired++;
+	if (t < due)
+		early++;
+	else if (t > due)
+		late++;
+	return 0;
+}
+
+static oskit_error_t
+ignore(oskit_iunknown_t *obj, void *arg)
+{
+	return 0;
+}
+
+static void
+report(const char *what, unsigned long long cycles)
+{
+	printf("  %-10s %8u cycles per timer\n", what,
+	       (unsigned) (cycles / NTIMERS));
+}
+
+int
+main(int argc, char **argv)
+{
+	static unsigned long long due[NFIRE];
+	unsigned long long	before, last = 0;
+	oskit_itimerspec_t	spec, left;
+	oskit_listener_t	*l;
+	int			i, ticks;
+
+#ifndef KNIT
+	oskit_clientos_init();
+	/* The clock code needs an osenv */
+	start_osenv();
+#endif
+	clock = oskit_clock_init();
+
+	printf("%d timers, up to %d ticks out:\n", NTIMERS, MAXTICKS);
+
+	before = get_tsc();
+	for (i = 0; i < NTIMERS; i++)
+		oskit_clock_createtimer(clock, &timers[i]);
+	report("create", get_tsc() - before);
+
+	/* some of the short ones may go off while we are at it */
+	l = oskit_create_listener(ignore, 0);
+	for (i = 0; i < NTIMERS; i++)
+		oskit_timer_setlistener(timers[i], l);
+	oskit_listener_release(l);
+
+	bench_srandom(1);
+	before = get_tsc();
+	for (i = 0; i < NTIMERS; i++) {
+		ticks2spec(1 + bench_random() * 2 % MAXTICKS, &spec);
+		oskit_timer_settime(timers[i], 0, &spec);
+	}
+	report("arm", get_tsc() - before);
+
+	before = get_tsc();
+	for (i = 0; i < NTIMERS; i++) {
+		ticks2spec(1 + bench_random() * 2 % MAXTICKS, &spec);
+		oskit_timer_settime(timers[i], 0, &spec);
+	}
+	report("re-arm", get_tsc() - before);
+
+	before = get_tsc();
+	for (i = 0; i < NTIMERS; i++)
+		oskit_timer_gettime(timers[i], &left);
+	report("gettime", get_tsc() - before);
+
+	ticks2spec(0, &spec);
+	before = get_tsc();
+	for (i = 0; i < NTIMERS; i++)
+		oskit_timer_settime(timers[i], 0, &spec);
+	report("cancel", get_tsc() - before);
+
+	/*
+	 * Now let some of them go off. Leave the others armed far out,
+	 * so that the tick handler has a full wheel to deal with.
+	 */
+	for (i = NFIRE; i < NTIMERS; i++) {
+		ticks2spec(FIRETICKS * 2 + bench_random() * 2 % MAXTICKS, &spec);
+		oskit_timer_settime(timers[i], 0, &spec);
+	}
+	for (i = 0; i < NFIRE; i++) {
+		l = oskit_create_listener(expired, &due[i]);
+		oskit_timer_setlistener(timers[i], l);
+		oskit_listener_release(l);
+	}
+	osenv_intr_disable();
+	for (i = 0; i < NFIRE; i++) {
+		ticks = 1 + bench_random() % FIRETICKS;
+		ticks2spec(ticks, &spec);
+		due[i] = now() + (unsigned long long) ticks * NANOPERTICK;
+		if (due[i] > last)
+			last = due[i];
+		oskit_timer_settime(timers[i], 0, &spec);
+	}
+	osenv_intr_enable();
+
+	while (now() < last + 10 * NANOPERTICK)
+		continue;
+	printf("%d of %d timers fired, %d early, %d late\n",
+	       fired, NFIRE, early, late);
+
+	for (i = 0; i < NTIMERS; i++)
+		oskit_timer_release(timers[i]);
+	oskit_clock_release(clock);
+	exit(0);
+	return 0;
+}
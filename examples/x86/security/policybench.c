@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Security server policy benchmark.
+ *
+ * Loads the policy from a boot module (named "policy" unless the POLICY
+ * environment variable says otherwise) and fills the SID table the way
+ * sidbench does. Then times reloading the policy, which reads it all in
+ * again and converts every SID in the table, and computing 100000 access
+ * vectors for random SID pairs and classes. compute_av is what the AVC
+ * calls on a miss, and with MLS it is mostly constraint and category set
+ * checks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <oskit/flask/security.h>
+#include <oskit/dev/dev.h>
+#include <oskit/fs/dir.h>
+#include <oskit/fs/file.h>
+#include <oskit/fs/openfile.h>
+#include <oskit/clientos.h>
+#include <oskit/startup.h>
+#include <oskit/machine/proc_reg.h>
+
+#include "bench.h"
+
+#define POLICY_NAME	"policy"
+#define NLOADS		20
+#define NCOMPUTES	100000
+#define MAXSIDS		20000
+
+static char *levels[] = {
+	"u", "c",
+	"s", "s:nocon", "s:noforn", "s:nocon,noforn",
+	"ts", "ts:nocon", "ts:noforn", "ts:nato", "ts:usuk",
+	"ts:nocon,noforn", "ts:nocon,nato", "ts:nocon,usuk",
+	"ts:noforn,nato", "ts:noforn,usuk", "ts:nato,usuk",
+	"ts:nocon,noforn,nato", "ts:nocon,noforn,usuk",
+	"ts:nocon,nato,usuk", "ts:noforn,nato,usuk",
+	"ts:nocon,noforn,nato,usuk",
+};
+#define NLEVELS		(sizeof levels / sizeof levels[0])
+
+static oskit_security_class_t classes[] = {
+	OSKIT_SECCLASS_PROCESS, OSKIT_SECCLASS_FILE, OSKIT_SECCLASS_DIR,
+	OSKIT_SECCLASS_FD, OSKIT_SECCLASS_TCP_SOCKET,
+};
+#define NCLASSES	(sizeof classes / sizeof classes[0])
+
+static oskit_security_t		*security;
+static oskit_security_id_t	sids[MAXSIDS];
+static int			nsids;
+
+static oskit_openfile_t *
+open_policy(oskit_dir_t *root, char *name)
+{
+	oskit_file_t		*file;
+	oskit_openfile_t	*ofile;
+	oskit_error_t		rc;
+
+	if ((rc = oskit_dir_lookup(root, name, &file)) != 0)
+		bench_fail("oskit_dir_lookup", rc);
+	if ((rc = oskit_file_open(file, OSKIT_O_RDONLY, &ofile)) != 0)
+		bench_fail("oskit_file_open", rc);
+	oskit_file_release(file);
+	return ofile;
+}
+
+/*
+ * Make a SID for every valid context with the user, role and type of
+ * initial SID `isid'.
+ */
+static int
+populate(oskit_security_id_t isid)
+{
+	oskit_security_context_t ctx;
+	oskit_security_id_t	sid;
+	oskit_u32_t		len;
+	char			buf[256], *p;
+	int			lo, hi, n = 0, colons = 0;
+
+	if (oskit_security_sid_to_context(security, isid, &ctx, &len))
+		return 0;
+
+	/* Keep user:role:type */
+	for (p = ctx; *p; p++)
+		if (*p == ':' && ++colons == 3)
+			break;
+	*p = 0;
+
+	for (lo = 0; lo < NLEVELS; lo++) {
+		for (hi = 0; hi < NLEVELS; hi++) {
+			if (nsids == MAXSIDS)
+				goto out;
+			sprintf(buf, "%s:%s-%s", ctx, levels[lo], levels[hi]);
+			if (oskit_security_context_to_sid(security, buf,
+							  strlen(buf) + 1,
+							  &sid) == 0) {
+				sids[nsids++] = sid;
+				n++;
+			}
+		}
+	}
+  out:
+	osenv_mem_free(ctx, OSENV_AUTO_SIZE, 0);
+	return n;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned long long	before, cycles;
+	oskit_osenv_t		*osenv;
+	oskit_dir_t		*root;
+	oskit_openfile_t	*ofile;
+	oskit_access_vector_t	allowed, decided, auditallow, auditdeny;
+	oskit_access_vector_t	notify;
+	oskit_u32_t		seqno;
+	oskit_security_id_t	sid;
+	oskit_error_t		rc;
+	char			*policyname = POLICY_NAME;
+	char			*option;
+	int			i, granted;
+
+	oskit_clientos_init();
+	osenv = start_osenv();
+	root = start_bmod();
+
+	if ((option = getenv("POLICY")) != NULL)
+		policyname = option;
+
+	ofile = open_policy(root, policyname);
+	before = get_tsc();
+	if ((rc = oskit_security_init(osenv, ofile, &security)) != 0)
+		bench_fail("oskit_security_init", rc);
+	cycles = get_tsc() - before;
+	oskit_openfile_release(ofile);
+	printf("initial load, %u cycles\n", (unsigned) cycles);
+
+	for (sid = 1; sid <= OSKIT_SECINITSID_NUM; sid++)
+		populate(sid);
+	if (nsids == 0)
+		bench_fail("populate", OSKIT_E_FAIL);
+
+	/*
+	 * Reload the policy with the table full.
+	 */
+	cycles = 0;
+	for (i = 0; i < NLOADS; i++) {
+		ofile = open_policy(root, policyname);
+		before = get_tsc();
+		rc = oskit_security_load_policy(security, ofile);
+		cycles += get_tsc() - before;
+		oskit_openfile_release(ofile);
+		if (rc)
+			bench_fail("oskit_security_load_policy", rc);
+	}
+	printf("%d SIDs, %u cycles per load_policy\n",
+	       nsids, (unsigned) (cycles / NLOADS));
+
+	/*
+	 * Compute access vectors, as the AVC does on a miss.
+	 */
+	bench_srandom(1);
+	granted = 0;
+	before = get_tsc();
+	for (i = 0; i < NCOMPUTES; i++) {
+		rc = oskit_security_compute_av(security,
+					       sids[bench_random() % nsids],
+					       sids[bench_random() % nsids],
+					       classes[bench_random() % NCLASSES],
+					       ~0, &allowed, &decided,
+					       &auditallow, &auditdeny,
+					       &notify, &seqno);
+		if (rc)
+			bench_fail("oskit_security_compute_av", rc);
+		if (allowed)
+			granted++;
+	}
+	cycles = get_tsc() - before;
+	printf("%d access vectors (%d granting), %u cycles per compute_av\n",
+	       NCOMPUTES, granted, (unsigned) (cycles / NCOMPUTES));
+
+	oskit_security_release(security);
+	oskit_dir_release(root);
+	exit(0);
+	return 0;
+}
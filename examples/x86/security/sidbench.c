@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Security server SID table benchmark.
+ *
+ * Loads the policy from a boot module (named "policy" unless the POLICY
+ * environment variable says otherwise), fills the SID table with every
+ * context it will accept that can be made by giving the initial SIDs'
+ * user, role and type each MLS range, then labels 100000 files. Labeling
+ * a file computes its SID with transition_sid and then does the round
+ * trip through the context string that the persistent SID mapping does
+ * when it reads a label back. The level names are those of the example
+ * policy in security/policydb; contexts the policy does not like are
+ * just skipped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <oskit/flask/security.h>
+#include <oskit/dev/dev.h>
+#include <oskit/fs/dir.h>
+#include <oskit/fs/file.h>
+#include <oskit/fs/openfile.h>
+#include <oskit/clientos.h>
+#include <oskit/startup.h>
+#include <oskit/machine/proc_reg.h>
+
+#include "bench.h"
+
+#define POLICY_NAME	"policy"
+#define NFILES		100000
+#define MAXSIDS		20000
+
+static char *levels[] = {
+	"u", "c",
+	"s", "s:nocon", "s:noforn", "s:nocon,noforn",
+	"ts", "ts:nocon", "ts:noforn", "ts:nato", "ts:usuk",
+	"ts:nocon,noforn", "ts:nocon,nato", "ts:nocon,usuk",
+	"ts:noforn,nato", "ts:noforn,usuk", "ts:nato,usuk",
+	"ts:nocon,noforn,nato", "ts:nocon,noforn,usuk",
+	"ts:nocon,nato,usuk", "ts:noforn,nato,usuk",
+	"ts:nocon,noforn,nato,usuk",
+};
+#define NLEVELS		(sizeof levels / sizeof levels[0])
+
+static oskit_security_t		*security;
+static oskit_security_id_t	sids[MAXSIDS];
+static int			nsids;
+
+/*
+ * Make a SID for every valid context with the user, role and type of
+ * initial SID `isid'.
+ */
+static int
+populate(oskit_security_id_t isid)
+{
+	oskit_security_context_t ctx;
+	oskit_security_id_t	sid;
+	oskit_u32_t		len;
+	char			buf[256], *p;
+	int			lo, hi, n = 0, colons = 0;
+
+	if (oskit_security_sid_to_context(security, isid, &ctx, &len))
+		return 0;
+
+	/* Keep user:role:type */
+	for (p = ctx; *p; p++)
+		if (*p == ':' && ++colons == 3)
+			break;
+	*p = 0;
+
+	for (lo = 0; lo < NLEVELS; lo++) {
+		for (hi = 0; hi < NLEVELS; hi++) {
+			if (nsids == MAXSIDS)
+				goto out;
+			sprintf(buf, "%s:%s-%s", ctx, levels[lo], levels[hi]);
+			if (oskit_security_context_to_sid(security, buf,
+							  strlen(buf) + 1,
+							  &sid) == 0) {
+				sids[nsids++] = sid;
+				n++;
+			}
+		}
+	}
+  out:
+	osenv_mem_free(ctx, OSENV_AUTO_SIZE, 0);
+	return n;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned long long	before, cycles;
+	oskit_osenv_t		*osenv;
+	oskit_dir_t		*root;
+	oskit_file_t		*file;
+	oskit_openfile_t	*ofile;
+	oskit_security_context_t ctx;
+	oskit_security_id_t	sid, newsid, again;
+	oskit_u32_t		len;
+	oskit_error_t		rc;
+	char			*policyname = POLICY_NAME;
+	char			*option;
+	int			i, tried;
+
+	oskit_clientos_init();
+	osenv = start_osenv();
+	root = start_bmod();
+
+	if ((option = getenv("POLICY")) != NULL)
+		policyname = option;
+
+	if ((rc = oskit_dir_lookup(root, policyname, &file)) != 0)
+		bench_fail("oskit_dir_lookup", rc);
+	if ((rc = oskit_file_open(file, OSKIT_O_RDONLY, &ofile)) != 0)
+		bench_fail("oskit_file_open", rc);
+	oskit_file_release(file);
+
+	if ((rc = oskit_security_init(osenv, ofile, &security)) != 0)
+		bench_fail("oskit_security_init", rc);
+	oskit_openfile_release(ofile);
+
+	/*
+	 * Fill up the SID table.
+	 */
+	tried = 0;
+	before = get_tsc();
+	for (sid = 1; sid <= OSKIT_SECINITSID_NUM; sid++) {
+		populate(sid);
+		tried += NLEVELS * NLEVELS;
+	}
+	cycles = get_tsc() - before;
+	printf("%d SIDs from %d contexts, %u cycles per context_to_sid\n",
+	       nsids, tried, (unsigned) (cycles / tried));
+	if (nsids == 0)
+		bench_fail("populate", OSKIT_E_FAIL);
+
+	/*
+	 * Label the files.
+	 */
+	bench_srandom(1);
+	before = get_tsc();
+	for (i = 0; i < NFILES; i++) {
+		sid = sids[bench_random() % nsids];
+		rc = oskit_security_transition_sid(security, sid,
+						   sids[bench_random() % nsids],
+						   OSKIT_SECCLASS_FILE,
+						   &newsid);
+		if (rc)
+			bench_fail("oskit_security_transition_sid", rc);
+
+		rc = oskit_security_sid_to_context(security, newsid,
+						   &ctx, &len);
+		if (rc)
+			bench_fail("oskit_security_sid_to_context", rc);
+		rc = oskit_security_context_to_sid(security, ctx, len, &again);
+		if (rc)
+			bench_fail("oskit_security_context_to_sid", rc);
+		osenv_mem_free(ctx, OSENV_AUTO_SIZE, 0);
+
+		if (again != newsid) {
+			printf("SID %d came back as %d\n", newsid, again);
+			exit(1);
+		}
+	}
+	cycles = get_tsc() - before;
+	printf("%d files labeled, %u cycles per file\n",
+	       NFILES, (unsigned) (cycles / NFILES));
+
+	oskit_security_release(security);
+	oskit_dir_release(root);
+	exit(0);
+	return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Bits shared by the benchmark kernels. Link with bench.o.
+ */
+#ifndef _EXAMPLES_BENCH_H_
+#define _EXAMPLES_BENCH_H_
+
+#include <oskit/error.h>
+
+/*
+ * A small and dumb random number generator, but one that gives the same
+ * sequence every time, so that runs can be compared. Returns 0 to 0x7fff.
+ */
+void		bench_srandom(unsigned int seed);
+unsigned int	bench_random(void);
+
+/*
+ * Report that WHAT failed with error RC, and exit.
+ */
+void		bench_fail(const char *what, oskit_error_t rc);
+
+#endif /* _EXAMPLES_BENCH_H_ */
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Measure the cost of pthread_create plus pthread_join, with the thread
+ * cache turned off (every create goes to the memory allocator, as it
+ * always used to) and turned on.
+ *
+ * Two patterns are timed: one thread at a time, and bursts of three
+ * threads like http_proxy starts for each connection. Each burst is
+ * followed by a short sleep, which gives the idle thread a chance to
+ * zero the cached memory before the next burst.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <oskit/startup.h>
+#include <oskit/clientos.h>
+#include <oskit/machine/proc_reg.h>
+
+#include <oskit/threads/pthread.h>
+
+#define SINGLES		5000
+#define BURSTS		500
+#define BURSTSIZE	3
+
+void *
+nothing(void *arg)
+{
+	return arg;
+}
+
+/*
+ * Cycles per create+join, one thread at a time.
+ */
+unsigned int
+singles(void)
+{
+	unsigned long long	before;
+	pthread_t		tid;
+	void			*stat;
+	int			i;
+
+	before = get_tsc();
+	for (i = 0; i < SINGLES; i++) {
+		pthread_create(&tid, 0, nothing, 0);
+		pthread_join(tid, &stat);
+	}
+	return (unsigned int) ((get_tsc() - before) / SINGLES);
+}
+
+/*
+ * Cycles per create+join, in bursts. The sleep is not counted.
+ */
+unsigned int
+bursts(void)
+{
+	unsigned long long	before, cycles = 0;
+	pthread_t		tids[BURSTSIZE];
+	void			*stat;
+	int			i, j;
+
+	for (i = 0; i < BURSTS; i++) {
+		before = get_tsc();
+		for (j = 0; j < BURSTSIZE; j++)
+			pthread_create(&tids[j], 0, nothing, 0);
+		for (j = 0; j < BURSTSIZE; j++)
+			pthread_join(tids[j], &stat);
+		cycles += get_tsc() - before;
+
+		oskit_pthread_sleep(10);
+	}
+	return (unsigned int) (cycles / (BURSTS * BURSTSIZE));
+}
+
+void
+print_stats(void)
+{
+	pthread_cache_stats_t	stats;
+
+	oskit_pthread_cache_stats(&stats);
+	printf("  cache: %d/%d threads, %d/%d stacks\n",
+	       stats.threads, stats.maxthreads, stats.stacks, stats.maxstacks);
+	printf("  thread hits %d misses %d, stack hits %d misses %d\n",
+	       stats.thread_hits, stats.thread_misses,
+	       stats.stack_hits, stats.stack_misses);
+	printf("  scrubbed %d, overflows %d\n",
+	       stats.scrubbed, stats.overflows);
+}
+
+int
+main()
+{
+	pthread_cache_stats_t	stats;
+
+#ifndef KNIT
+	oskit_clientos_init_pthreads();
+	start_clock();
+	start_pthreads();
+#endif
+	oskit_pthread_cache_stats(&stats);
+
+	oskit_pthread_cache_setsize(0, 0);
+	printf("No cache:\n");
+	printf("  single: %u cycles per create+join\n", singles());
+	printf("  bursts: %u cycles per create+join\n", bursts());
+
+	oskit_pthread_cache_setsize(stats.maxthreads, stats.maxstacks);
+	printf("Cache:\n");
+	printf("  single: %u cycles per create+join\n", singles());
+	printf("  bursts: %u cycles per create+join\n", bursts());
+	print_stats();
+
+	exit(0);
+	return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Measure the cost of switching between EDF threads, with the run
+ * queue holding more and more of them.
+ *
+ * Up to a couple of thousand periodic threads are created with the
+ * same start time and period, as sched_test does for its one realtime
+ * thread.  Each period they all come due at once and run back to back,
+ * doing nothing but yield to their next deadline, which puts them
+ * behind every other thread on the run queue.  Reports cycles from one
+ * thread yielding to the next one running, for each thread count.
+ * Needs a threads library built with PTHREAD_SCHED_EDF and
+ * THREADS_MAX_THREAD=4096 (see threads/MakeFlags).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <oskit/startup.h>
+#include <oskit/clientos.h>
+#include <oskit/machine/proc_reg.h>
+
+#include <oskit/threads/pthread.h>
+
+/*
+ * Include this file in your main.c to drag in the realtime scheduler.
+ * Do not include multiple times!
+ */
+#include <oskit/threads/sched_edf.h>
+
+#define MAXTHREADS	2048
+#define PERIOD		100		/* ms */
+#define NPERIODS	20
+#define MS2NANO(x)	((x) * 1000000)
+
+static int		counts[] = { 16, 128, 512, 1024, MAXTHREADS };
+
+pthread_t		tids[MAXTHREADS];
+int			nthreads, ran, stop;
+unsigned long long	last, cycles, switches;
+
+/*
+ * Every thread runs once a period. The first one to run in a period
+ * starts the clock, and each one after that counts the time since the
+ * one before it yielded.
+ */
+void *
+periodic_thread(void *arg)
+{
+	unsigned long long	now;
+
+	while (! stop) {
+		now = get_tsc();
+		if (ran++ % nthreads)
+			cycles += now - last, switches++;
+		last = get_tsc();
+		sched_yield();
+	}
+	return arg;
+}
+
+int
+main()
+{
+	pthread_attr_t		threadattr;
+	struct sched_param	param;
+	oskit_u32_t		start;
+	void			*stat;
+	int			i, c;
+
+#ifndef KNIT
+	oskit_clientos_init_pthreads();
+	start_clock();
+	start_pthreads();
+#endif
+	pthread_attr_init(&threadattr);
+	pthread_attr_setschedpolicy(&threadattr, SCHED_EDF);
+
+	for (c = 0; c < sizeof counts / sizeof counts[0]; c++) {
+		nthreads = counts[c];
+		ran = stop = 0;
+		cycles = switches = 0;
+
+		/*
+		 * Everyone starts a period from now, which leaves time to
+		 * create them all first.
+		 */
+		start = oskit_pthread_realtime() + PERIOD;
+		param.start.tv_sec   = start / 1000;
+		param.start.tv_nsec  = MS2NANO(start % 1000);
+		param.period.tv_sec  = 0;
+		param.period.tv_nsec = MS2NANO(PERIOD);
+		pthread_attr_setschedparam(&threadattr, &param);
+
+		for (i = 0; i < nthreads; i++) {
+			if (pthread_create(&tids[i], &threadattr,
+					   periodic_thread, 0) != 0) {
+				printf("pthread_create failed at %d threads\n",
+				       i);
+				exit(1);
+			}
+		}
+
+		oskit_pthread_sleep(PERIOD * (NPERIODS + 1));
+		stop = 1;
+		for (i = 0; i < nthreads; i++)
+			pthread_join(tids[i], &stat);
+
+		printf("%4d threads: %d periods, %u cycles per switch\n",
+		       nthreads, ran / nthreads,
+		       switches ? (unsigned int) (cycles / switches) : 0);
+	}
+
+	exit(0);
+	return 0;
+}
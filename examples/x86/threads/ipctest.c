@@ -19,6 +19,10 @@
  * A simple program demonstrating the use of the pthread IPC primitives.
  * A number of client and server threads are started up, where each client
  * sends a specific number of messages to a server. 
+ *
+ * Then the round trip latency and bandwidth of calls with big messages
+ * is measured, with the messages copied, lent, and lent from a
+ * registered ring.
  */
 
 #include <unistd.h>
@@ -39,6 +43,8 @@
 #define	SERVERS		3	/* Number of server threads */
 #define CLIENTS		10	/* Number of client threads */
 #define CLIENT_MSGS	10000	/* Number of messages each client sends */
+#define BENCH_CALLS	2000	/* Calls per message size in bench() */
+#define BENCH_MAX	(64 * 1024)
 
 /*
  * Define this to send zero length messages.
@@ -61,6 +67,7 @@ oskit_error(oskit_error_t errno, char *s)
 
 void		       *client(void *arg);
 void		       *server(void *arg);
+void			bench(void);
 pthread_mutex_t		randlock;
 int			verbose = 0;
 int			barrier;
@@ -148,6 +155,8 @@ main()
 	for (i = 0; i < SERVERS; i++)
 		pthread_join(servers[i], &status);
 
+	bench();
+
 #ifdef  CPUI
 	pthread_cancel(s1);
 	pthread_cancel(s2);
@@ -285,3 +294,128 @@ client(void *arg)
 
 	return 0;
 }
+
+/*
+ * Big message test. Server side. The server bumps the first byte and
+ * sends the message back.
+ */
+enum { BENCH_COPY, BENCH_LENT, BENCH_RING };
+
+void *
+bench_server(void *arg)
+{
+	static char		buf[BENCH_MAX];
+	oskit_ipc_lent_t	lent;
+	pthread_t		client;
+	oskit_size_t		actual;
+	oskit_error_t		rc;
+
+	while (1) {
+		if ((int) arg == BENCH_COPY) {
+			rc = oskit_ipc_wait(&client, buf, sizeof(buf),
+					    &actual, -1);
+			if (rc == 0) {
+				buf[0]++;
+				rc = oskit_ipc_reply(client, buf, actual);
+			}
+		}
+		else {
+			/*
+			 * Build the reply in place; no copies either way.
+			 */
+			rc = oskit_ipc_wait_lent(&client, &lent, -1);
+			if (rc == 0) {
+				((char *) lent.reply)[0] =
+					((char *) lent.msg)[0] + 1;
+				rc = oskit_ipc_reply(client, lent.reply,
+						     lent.msg_size);
+			}
+		}
+		if (rc) {
+			pthread_testcancel();
+			oskit_error(rc, "bench_server");
+			pthread_exit((void *) 1);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Big message test. Client side, from the main thread.
+ */
+void
+bench(void)
+{
+	static char		*names[] = { "copy", "lent", "ring" };
+	static int		sizes[] = { 4096, 16384, BENCH_MAX };
+	static char		msg[BENCH_MAX], reply[BENCH_MAX];
+	unsigned long long	before, cycles, cycles_per_ms;
+	unsigned long		ms;
+	oskit_ipc_ring_t	*ring = 0;
+	pthread_t		server;
+	oskit_size_t		actual;
+	oskit_error_t		rc;
+	void			*status;
+	char			*slot;
+	int			mode, s, i;
+
+	/*
+	 * Calibrate the cycle counter, for the bandwidth.
+	 */
+	ms = oskit_pthread_realtime();
+	before = get_tsc();
+	oskit_pthread_sleep(200);
+	cycles_per_ms = (get_tsc() - before) / (oskit_pthread_realtime() - ms);
+
+	for (mode = BENCH_COPY; mode <= BENCH_RING; mode++) {
+		pthread_create(&server, 0, bench_server, (void *) mode);
+
+		for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+			if (mode == BENCH_RING &&
+			    (rc = oskit_ipc_ring_create(server, 2,
+							sizes[s], &ring))) {
+				oskit_error(rc, "oskit_ipc_ring_create");
+				return;
+			}
+
+			before = get_tsc();
+			for (i = 0; i < BENCH_CALLS; i++) {
+				if (mode == BENCH_RING) {
+					slot = oskit_ipc_ring_next(ring);
+					slot[0] = i;
+					rc = oskit_ipc_ring_call(ring, slot,
+						sizes[s], &actual, 0);
+				}
+				else {
+					slot = reply;
+					msg[0] = i;
+					rc = oskit_ipc_call(server,
+						msg, sizes[s],
+						reply, sizes[s], &actual, 0);
+				}
+				if (rc) {
+					oskit_error(rc, "oskit_ipc_call");
+					return;
+				}
+				assert(actual == sizes[s]);
+				assert(slot[0] == (char) (i + 1));
+			}
+			cycles = get_tsc() - before;
+
+			printf("%s %6d bytes: %8u cycles per round trip, "
+			       "%u MB/s\n", names[mode], sizes[s],
+			       (unsigned) (cycles / BENCH_CALLS),
+			       (unsigned) (2ULL * sizes[s] * BENCH_CALLS *
+					   cycles_per_ms / cycles / 1000));
+
+			if (ring) {
+				oskit_ipc_ring_destroy(ring);
+				ring = 0;
+			}
+		}
+
+		pthread_cancel(server);
+		pthread_join(server, &status);
+	}
+}
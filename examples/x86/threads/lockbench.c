@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Measure the cost of pthread mutexes and condition variables.
+ *
+ * Three things are timed: a lock and unlock nobody else wants, two
+ * threads handing a mutex back and forth (each yields while holding
+ * it, so the other always has to block), and a broadcast to a crowd
+ * of threads waiting on a condition with the same mutex, up until the
+ * last of them has run. Also builds in unix mode.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <oskit/startup.h>
+#include <oskit/clientos.h>
+#include <oskit/machine/proc_reg.h>
+
+#include <oskit/threads/pthread.h>
+
+#define NLOCKS		100000
+#define NHANDOFFS	10000
+#define NWAITERS	16
+#define NROUNDS		1000
+
+pthread_mutex_t		lock;
+pthread_cond_t		go, done;
+int			generation, awake;
+
+/*
+ * Cycles per lock+unlock, uncontended.
+ */
+unsigned int
+uncontended(void)
+{
+	unsigned long long	before;
+	int			i;
+
+	before = get_tsc();
+	for (i = 0; i < NLOCKS; i++) {
+		pthread_mutex_lock(&lock);
+		pthread_mutex_unlock(&lock);
+	}
+	return (unsigned int) ((get_tsc() - before) / NLOCKS);
+}
+
+void *
+handoff_thread(void *arg)
+{
+	int	i;
+
+	for (i = 0; i < NHANDOFFS; i++) {
+		pthread_mutex_lock(&lock);
+		sched_yield();
+		pthread_mutex_unlock(&lock);
+	}
+	return arg;
+}
+
+/*
+ * Cycles per handoff between two threads.
+ */
+unsigned int
+handoff(void)
+{
+	unsigned long long	before;
+	pthread_t		tids[2];
+	void			*stat;
+	int			i;
+
+	before = get_tsc();
+	for (i = 0; i < 2; i++)
+		pthread_create(&tids[i], 0, handoff_thread, 0);
+	for (i = 0; i < 2; i++)
+		pthread_join(tids[i], &stat);
+	return (unsigned int) ((get_tsc() - before) / (2 * NHANDOFFS));
+}
+
+void *
+waiter_thread(void *arg)
+{
+	int	gen = 0;
+
+	pthread_mutex_lock(&lock);
+	while (1) {
+		while (generation == gen)
+			pthread_cond_wait(&go, &lock);
+		gen = generation;
+		if (gen > NROUNDS)
+			break;
+
+		if (++awake == NWAITERS)
+			pthread_cond_signal(&done);
+	}
+	pthread_mutex_unlock(&lock);
+	return arg;
+}
+
+/*
+ * Cycles per broadcast, up until every waiter has woken and gone
+ * through the mutex.
+ */
+unsigned int
+broadcast(void)
+{
+	unsigned long long	before, cycles = 0;
+	pthread_t		tids[NWAITERS];
+	void			*stat;
+	int			i;
+
+	for (i = 0; i < NWAITERS; i++)
+		pthread_create(&tids[i], 0, waiter_thread, 0);
+
+	pthread_mutex_lock(&lock);
+	for (i = 0; i < NROUNDS; i++) {
+		before = get_tsc();
+		awake = 0;
+		generation++;
+		pthread_cond_broadcast(&go);
+		while (awake < NWAITERS)
+			pthread_cond_wait(&done, &lock);
+		cycles += get_tsc() - before;
+	}
+	generation++;
+	pthread_cond_broadcast(&go);
+	pthread_mutex_unlock(&lock);
+
+	for (i = 0; i < NWAITERS; i++)
+		pthread_join(tids[i], &stat);
+	return (unsigned int) (cycles / NROUNDS);
+}
+
+int
+main()
+{
+	unsigned int	cycles;
+
+#ifndef KNIT
+	oskit_clientos_init_pthreads();
+	start_clock();
+	start_pthreads();
+#endif
+	pthread_mutex_init(&lock, 0);
+	pthread_cond_init(&go, 0);
+	pthread_cond_init(&done, 0);
+
+	printf("uncontended: %u cycles per lock+unlock\n", uncontended());
+	printf("handoff:     %u cycles per handoff\n", handoff());
+	cycles = broadcast();
+	printf("broadcast:   %u cycles per broadcast to %d waiters, "
+	       "%u per waiter\n", cycles, NWAITERS, cycles / NWAITERS);
+
+	exit(0);
+	return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Scheduler trace demonstration.
+ *
+ * Turns on the scheduler trace and runs a small mix of threads for half
+ * a second: a few workers that fight over a mutex, a higher priority
+ * thread that wakes up every tick, and a low priority thread that only
+ * gets the CPU when nobody else wants it. Then prints the trace on the
+ * console. Capture the console output and feed it to schedtrace_decode
+ * on the build host for latency histograms and a Chrome trace:
+ *
+ *	schedtrace_decode -j trace.json console.log
+ *
+ * Needs a threads library built with SCHED_TRACE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <oskit/startup.h>
+#include <oskit/clientos.h>
+#include <oskit/machine/proc_reg.h>
+
+#include <oskit/threads/pthread.h>
+#include <oskit/threads/trace.h>
+
+#define NRECS		8192
+#define NWORKERS	4
+#define RUNTIME		500		/* ms */
+#define HOLD		20000		/* cycles */
+
+pthread_mutex_t		lock;
+volatile int		stop;
+
+static void
+spin(unsigned int cycles)
+{
+	unsigned long long	end = get_tsc() + cycles;
+
+	while (get_tsc() < end)
+		;
+}
+
+void *
+worker_thread(void *arg)
+{
+	int	n = 0;
+
+	while (! stop) {
+		pthread_mutex_lock(&lock);
+		spin(HOLD);
+		pthread_mutex_unlock(&lock);
+		if (++n % 4 == 0)
+			sched_yield();
+	}
+	return arg;
+}
+
+void *
+ticker_thread(void *arg)
+{
+	while (! stop)
+		oskit_pthread_sleep(PTHREAD_TICK);
+	return arg;
+}
+
+void *
+background_thread(void *arg)
+{
+	while (! stop)
+		spin(HOLD);
+	return arg;
+}
+
+int
+main()
+{
+	pthread_attr_t		threadattr;
+	pthread_t		tids[NWORKERS + 2];
+	void			*stat;
+	oskit_error_t		rc;
+	int			i;
+
+#ifndef KNIT
+	oskit_clientos_init_pthreads();
+	start_clock();
+	start_pthreads();
+#endif
+	pthread_mutex_init(&lock, 0);
+
+	if ((rc = oskit_pthread_trace_enable(NRECS)) != 0) {
+		printf("oskit_pthread_trace_enable failed: 0x%x\n", rc);
+		exit(1);
+	}
+
+	pthread_attr_init(&threadattr);
+	for (i = 0; i < NWORKERS; i++)
+		pthread_create(&tids[i], &threadattr, worker_thread, 0);
+
+	oskit_pthread_attr_setprio(&threadattr, PRIORITY_NORMAL + 1);
+	pthread_create(&tids[i++], &threadattr, ticker_thread, 0);
+
+	oskit_pthread_attr_setprio(&threadattr, PRIORITY_NORMAL - 1);
+	pthread_create(&tids[i++], &threadattr, background_thread, 0);
+
+	oskit_pthread_sleep(RUNTIME);
+	stop = 1;
+	for (i = 0; i < NWORKERS + 2; i++)
+		pthread_join(tids[i], &stat);
+
+	oskit_pthread_trace_dump();
+
+	exit(0);
+	return 0;
+}
@@ -0,0 +1,605 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Build host program that decodes a pthread scheduler trace (see
+ * oskit/threads/trace.h and schedtrace.c).
+ *
+ *	schedtrace_decode [-c cycles-per-ms] [-j trace.json] [file]
+ *
+ * The input is either a console log with the output of
+ * oskit_pthread_trace_dump() somewhere in it, or a file of raw records
+ * as returned by oskit_pthread_trace_read(). The clock rate is taken
+ * from the dump; for raw records give it with -c, or times are left in
+ * cycles.
+ *
+ * Prints, for each thread, how long it ran each time it got the CPU
+ * and how long it waited on a run queue before getting it, as log2
+ * histograms, with the threads that waited longest first. Threads
+ * still waiting when the trace ends count that wait too, so starving
+ * threads show up at the top. Then, for each contended mutex, how long
+ * the waiters waited and how long the holders that handed it over had
+ * held it.
+ *
+ * With -j, also writes the trace in the Chrome trace event format, for
+ * chrome://tracing or Perfetto.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * These must match oskit/threads/trace.h.
+ */
+#define TRACE_DISPATCH	1
+#define TRACE_WAKEUP	2
+#define TRACE_PREEMPT	3
+#define TRACE_BLOCK	4
+#define TRACE_CONTEND	5
+#define TRACE_HANDOFF	6
+#define RECSIZE		16
+
+struct rec {
+	unsigned long long	stamp;
+	unsigned int		event, cpu, tid;
+	unsigned long		arg;
+};
+
+#define NBUCKETS	40
+
+struct hist {
+	unsigned long	count;
+	double		sum, max;
+	unsigned long	buckets[NBUCKETS];
+};
+
+struct thread {
+	int		seen;
+	struct hist	run, wait;
+	unsigned long	dispatches, wakeups, preempts, blocks;
+	int		running, runnable, contending;
+	double		running_since, runnable_since, contend_since;
+	unsigned long	contend_mutex;
+};
+
+struct mutex {
+	unsigned long	addr;
+	struct hist	wait, hold;
+	int		holder;
+	double		held_since;
+};
+
+#define MAXTID		65536
+#define MAXCPU		256
+
+static struct rec	*recs;
+static int		nrecs, maxrecs, lost;
+static unsigned long	clock_rate;		/* cycles per ms */
+
+static struct thread	*threads[MAXTID];
+static struct mutex	*mutexes;
+static int		nmutexes, maxmutexes;
+static int		current[MAXCPU];
+
+static FILE		*json;
+static int		json_first = 1;
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: schedtrace_decode [-c cycles-per-ms] "
+		"[-j trace.json] [file]\n");
+	exit(1);
+}
+
+static void *
+xrealloc(void *p, size_t size)
+{
+	if ((p = realloc(p, size)) == NULL) {
+		perror("realloc");
+		exit(1);
+	}
+	return p;
+}
+
+/*
+ * Records are in the byte order of the x86 the trace came from.
+ */
+static void
+add_rec(const unsigned char *b)
+{
+	struct rec	*r;
+	int		i;
+
+	if (nrecs == maxrecs) {
+		maxrecs = maxrecs ? maxrecs * 2 : 4096;
+		recs = xrealloc(recs, maxrecs * sizeof(*recs));
+	}
+	r = &recs[nrecs++];
+
+	r->stamp = 0;
+	for (i = 7; i >= 0; i--)
+		r->stamp = (r->stamp << 8) | b[i];
+	r->event = b[8];
+	r->cpu   = b[9];
+	r->tid   = b[10] | (b[11] << 8);
+	r->arg   = (unsigned long) b[12] | (b[13] << 8) |
+		   (b[14] << 16) | ((unsigned long) b[15] << 24);
+}
+
+static int
+hexval(int c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/*
+ * Console log. Everything outside the dump is ignored, as is anything
+ * in it that does not look like a record (console noise from other
+ * threads, say).
+ */
+static int
+read_log(FILE *f)
+{
+	char		line[256];
+	unsigned char	b[RECSIZE];
+	unsigned long	rate;
+	int		in = 0, found = 0, i, hi, lo, n;
+
+	while (fgets(line, sizeof line, f)) {
+		if (sscanf(line, "--- pthread trace begin, %lu cycles/ms",
+			   &rate) == 1) {
+			if (! clock_rate)
+				clock_rate = rate;
+			in = found = 1;
+			continue;
+		}
+		if (sscanf(line, "--- pthread trace end, %*d records, %d lost",
+			   &n) == 1) {
+			lost += n;
+			in = 0;
+			continue;
+		}
+		if (! in || line[0] != 'T' || line[1] != ' ')
+			continue;
+
+		for (i = 0; i < RECSIZE; i++) {
+			if ((hi = hexval(line[2 + i * 2])) < 0 ||
+			    (lo = hexval(line[3 + i * 2])) < 0)
+				break;
+			b[i] = (hi << 4) | lo;
+		}
+		if (i == RECSIZE)
+			add_rec(b);
+	}
+	return found;
+}
+
+static void
+read_raw(FILE *f)
+{
+	unsigned char	b[RECSIZE];
+
+	while (fread(b, RECSIZE, 1, f) == 1)
+		add_rec(b);
+}
+
+/*
+ * Time in microseconds if the clock rate is known, else in cycles.
+ */
+static double
+when(unsigned long long stamp)
+{
+	double	t = (double) (stamp - recs[0].stamp);
+
+	return clock_rate ? t * 1000.0 / clock_rate : t;
+}
+
+static void
+hist_add(struct hist *h, double v)
+{
+	unsigned long	x = (unsigned long) v;
+	int		i;
+
+	for (i = 0; x > 1 && i < NBUCKETS - 1; i++)
+		x >>= 1;
+	h->buckets[i]++;
+	h->count++;
+	h->sum += v;
+	if (v > h->max)
+		h->max = v;
+}
+
+static void
+hist_print(const char *title, struct hist *h)
+{
+	unsigned long	most = 0, lo, hi;
+	int		i, first = -1, last = -1, bar;
+
+	if (! h->count)
+		return;
+
+	for (i = 0; i < NBUCKETS; i++) {
+		if (! h->buckets[i])
+			continue;
+		if (first < 0)
+			first = i;
+		last = i;
+		if (h->buckets[i] > most)
+			most = h->buckets[i];
+	}
+
+	printf("    %s (%s):\n", title, clock_rate ? "us" : "cycles");
+	for (i = first; i <= last; i++) {
+		lo  = i ? 1UL << i : 0;
+		hi  = 1UL << (i + 1);
+		bar = (int) ((h->buckets[i] * 40 + most - 1) / most);
+		printf("    %10lu - %-10lu %8lu |%.*s\n", lo, hi,
+		       h->buckets[i], bar,
+		       "########################################");
+	}
+}
+
+static struct thread *
+thread(unsigned int tid)
+{
+	struct thread	*t = threads[tid];
+
+	if (! t) {
+		t = threads[tid] = xrealloc(0, sizeof(*t));
+		memset(t, 0, sizeof(*t));
+	}
+	t->seen = 1;
+	return t;
+}
+
+static struct mutex *
+mutex(unsigned long addr)
+{
+	struct mutex	*m;
+	int		i;
+
+	for (i = 0; i < nmutexes; i++)
+		if (mutexes[i].addr == addr)
+			return &mutexes[i];
+
+	if (nmutexes == maxmutexes) {
+		maxmutexes = maxmutexes ? maxmutexes * 2 : 64;
+		mutexes = xrealloc(mutexes, maxmutexes * sizeof(*mutexes));
+	}
+	m = &mutexes[nmutexes++];
+	memset(m, 0, sizeof(*m));
+	m->addr   = addr;
+	m->holder = -1;
+	return m;
+}
+
+/*
+ * Chrome trace events. Everything goes in one process, with a track
+ * per thread.
+ */
+static void
+json_event(const char *name, const char *ph, unsigned int tid,
+	   double ts, double dur, const char *args)
+{
+	if (! json)
+		return;
+
+	fprintf(json, "%s\n{\"name\":\"%s\",\"cat\":\"sched\",\"ph\":\"%s\","
+		"\"pid\":0,\"tid\":%u,\"ts\":%.3f",
+		json_first ? "" : ",", name, ph, tid, ts);
+	if (*ph == 'X')
+		fprintf(json, ",\"dur\":%.3f", dur);
+	if (*ph == 'i')
+		fprintf(json, ",\"s\":\"t\"");
+	if (args)
+		fprintf(json, ",\"args\":{%s}", args);
+	fprintf(json, "}");
+	json_first = 0;
+}
+
+static void
+end_run(struct thread *t, unsigned int tid, double now)
+{
+	if (! t->running)
+		return;
+
+	hist_add(&t->run, now - t->running_since);
+	json_event("run", "X", tid, t->running_since,
+		   now - t->running_since, 0);
+	t->running = 0;
+}
+
+static void
+decode(void)
+{
+	struct rec	*r;
+	struct thread	*t;
+	struct mutex	*m;
+	char		args[64], name[32];
+	double		now = 0;
+	int		i;
+
+	for (i = 0; i < MAXCPU; i++)
+		current[i] = -1;
+
+	for (r = recs; r < &recs[nrecs]; r++) {
+		now = when(r->stamp);
+		t   = thread(r->tid);
+
+		switch (r->event) {
+		case TRACE_DISPATCH:
+			if (t->runnable) {
+				hist_add(&t->wait, now - t->runnable_since);
+				json_event("runnable", "X", r->tid,
+					   t->runnable_since,
+					   now - t->runnable_since, 0);
+				t->runnable = 0;
+			}
+			t->running       = 1;
+			t->running_since = now;
+			t->dispatches++;
+			current[r->cpu]  = r->tid;
+			break;
+
+		case TRACE_PREEMPT:
+			end_run(t, r->tid, now);
+			t->runnable       = 1;
+			t->runnable_since = now;
+			t->preempts++;
+			break;
+
+		case TRACE_BLOCK:
+			end_run(t, r->tid, now);
+			t->runnable = 0;
+			t->blocks++;
+			break;
+
+		case TRACE_WAKEUP:
+			if (! t->runnable) {
+				t->runnable       = 1;
+				t->runnable_since = now;
+			}
+			t->wakeups++;
+			sprintf(args, "\"by\":%lu", r->arg);
+			json_event("wakeup", "i", r->tid, now, 0, args);
+			break;
+
+		case TRACE_CONTEND:
+			t->contending    = 1;
+			t->contend_since = now;
+			t->contend_mutex = r->arg;
+			mutex(r->arg);
+			break;
+
+		case TRACE_HANDOFF:
+			m = mutex(r->arg);
+			if (m->holder >= 0 && m->holder == current[r->cpu])
+				hist_add(&m->hold, now - m->held_since);
+			if (t->contending && t->contend_mutex == r->arg) {
+				hist_add(&m->wait, now - t->contend_since);
+				sprintf(name, "mutex 0x%08lx", r->arg);
+				json_event(name, "X", r->tid, t->contend_since,
+					   now - t->contend_since, 0);
+				t->contending = 0;
+			}
+			m->holder     = r->tid;
+			m->held_since = now;
+			break;
+
+		default:
+			fprintf(stderr, "record %d: unknown event %u\n",
+				(int) (r - recs), r->event);
+			break;
+		}
+	}
+
+	/*
+	 * Threads still waiting for the CPU at the end. This is what a
+	 * thread that never gets to run looks like.
+	 */
+	for (i = 0; i < MAXTID; i++) {
+		if ((t = threads[i]) && t->runnable) {
+			hist_add(&t->wait, now - t->runnable_since);
+			json_event("runnable", "X", i, t->runnable_since,
+				   now - t->runnable_since, 0);
+		}
+	}
+}
+
+static int
+by_wait(const void *a, const void *b)
+{
+	const struct thread	*x = threads[*(const int *) a];
+	const struct thread	*y = threads[*(const int *) b];
+
+	if (x->wait.max != y->wait.max)
+		return x->wait.max < y->wait.max ? 1 : -1;
+	return *(const int *) a - *(const int *) b;
+}
+
+static double
+avg(struct hist *h)
+{
+	return h->count ? h->sum / h->count : 0;
+}
+
+/*
+ * A table column for an average or maximum, or n/a with no samples.
+ */
+static void
+column(struct hist *h, double v)
+{
+	if (h->count)
+		printf(" %12.1f", v);
+	else
+		printf(" %12s", "n/a");
+}
+
+/*
+ * Average and maximum, or n/a with no samples.
+ */
+static void
+avgmax(const char *label, struct hist *h)
+{
+	if (h->count)
+		printf("%s avg %.1f max %.1f", label, avg(h), h->max);
+	else
+		printf("%s n/a", label);
+}
+
+static void
+report(void)
+{
+	struct thread	*t;
+	struct mutex	*m;
+	int		*order, n = 0, i;
+	const char	*unit = clock_rate ? "us" : "cycles";
+
+	printf("%d records, %d lost", nrecs, lost);
+	if (clock_rate)
+		printf(", %lu cycles/ms, %.3f ms",
+		       clock_rate, when(recs[nrecs - 1].stamp) / 1000);
+	printf("\n");
+	if (! clock_rate)
+		printf("No clock rate, so times are in cycles.\n");
+	if (lost)
+		printf("Records were lost; the first times for each thread "
+		       "may be missing.\n");
+
+	order = xrealloc(0, MAXTID * sizeof(*order));
+	for (i = 0; i < MAXTID; i++)
+		if (threads[i])
+			order[n++] = i;
+	qsort(order, n, sizeof(*order), by_wait);
+
+	printf("\nThreads, longest wait for the CPU first (%s):\n", unit);
+	printf("  %5s %8s %8s %8s %12s %12s %12s %12s\n", "tid",
+	       "runs", "blocks", "preempts",
+	       "run avg", "run max", "wait avg", "wait max");
+	for (i = 0; i < n; i++) {
+		t = threads[order[i]];
+		printf("  %5d %8lu %8lu %8lu",
+		       order[i], t->dispatches, t->blocks, t->preempts);
+		column(&t->run, avg(&t->run));
+		column(&t->run, t->run.max);
+		column(&t->wait, avg(&t->wait));
+		column(&t->wait, t->wait.max);
+		printf("%s\n", t->runnable ? "  (still waiting)" : "");
+	}
+
+	for (i = 0; i < n; i++) {
+		t = threads[order[i]];
+		printf("\nThread %d:\n", order[i]);
+		hist_print("run", &t->run);
+		hist_print("wait", &t->wait);
+	}
+
+	for (i = 0; i < nmutexes; i++) {
+		m = &mutexes[i];
+		printf("\nMutex 0x%08lx: %lu contended waits, ",
+		       m->addr, m->wait.count);
+		avgmax("wait", &m->wait);
+		printf(", ");
+		avgmax("hold before handoff", &m->hold);
+		printf(" (%s)\n", unit);
+		hist_print("wait", &m->wait);
+		hist_print("hold", &m->hold);
+	}
+	free(order);
+}
+
+int
+main(int argc, char **argv)
+{
+	FILE	*f = stdin;
+	char	*jsonfile = 0;
+	int	c, i;
+
+	while ((c = getopt(argc, argv, "c:j:")) != -1) {
+		switch (c) {
+		case 'c':
+			clock_rate = strtoul(optarg, 0, 0);
+			break;
+		case 'j':
+			jsonfile = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (argc - optind > 1)
+		usage();
+	if (argc - optind == 1 && (f = fopen(argv[optind], "rb")) == NULL) {
+		perror(argv[optind]);
+		exit(1);
+	}
+
+	/*
+	 * Look for a dump first, and if there is none, take the file
+	 * as raw records.
+	 */
+	if (! read_log(f)) {
+		if (f == stdin) {
+			fprintf(stderr, "no trace dump found on stdin\n");
+			exit(1);
+		}
+		rewind(f);
+		read_raw(f);
+	}
+	if (nrecs == 0) {
+		fprintf(stderr, "no trace records\n");
+		exit(1);
+	}
+
+	if (jsonfile) {
+		if ((json = fopen(jsonfile, "w")) == NULL) {
+			perror(jsonfile);
+			exit(1);
+		}
+		fprintf(json, "{\"traceEvents\":[");
+		fprintf(json, "\n{\"name\":\"process_name\",\"ph\":\"M\","
+			"\"pid\":0,\"args\":{\"name\":\"oskit\"}}");
+		json_first = 0;
+		for (i = 0; i < nrecs; i++) {
+			if (threads[recs[i].tid])
+				continue;
+			thread(recs[i].tid);
+			fprintf(json, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+				"\"pid\":0,\"tid\":%u,"
+				"\"args\":{\"name\":\"thread %u\"}}",
+				recs[i].tid, recs[i].tid);
+		}
+	}
+
+	decode();
+	report();
+
+	if (json) {
+		fprintf(json, "\n],\"displayTimeUnit\":\"ns\"}\n");
+		fclose(json);
+	}
+	exit(0);
+}
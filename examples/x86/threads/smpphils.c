@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Dining Philosophers, scaled up to measure SMP throughput.
+ *
+ * Same monitor solution as dphils.c, but with several independent tables
+ * so that there is real parallelism to be had, and without the sleeps, so
+ * that the philosophers are busy all the time. Each table has its own
+ * monitor, so the only thing shared between tables is the scheduler.
+ * At the end we print how many meals were eaten per million cycles and
+ * how the meals were spread over the CPUs.
+ *
+ * To see anything interesting, build the threads library with -DSMP (see
+ * threads/MakeFlags) and link with liboskit_smp. On a uniprocessor this
+ * is just a scheduler stress test.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <oskit/startup.h>
+#include <oskit/clientos.h>
+#include <oskit/machine/proc_reg.h>
+
+#include <oskit/threads/pthread.h>
+
+#define TABLES		8
+#define PHILOSOPHERS	5
+#define MEALS		2000
+#define MAXCPUS		8
+
+enum {THINKING,HUNGRY,EATING};
+
+struct table {
+	pthread_mutex_t	monitor;
+	pthread_cond_t	self[PHILOSOPHERS];
+	int		state[PHILOSOPHERS];
+};
+
+struct table	tables[TABLES];
+
+/*
+ * Meals eaten on each CPU. Each philosopher counts privately and adds
+ * its counts in at the end, so this does not turn into a hot spot.
+ */
+pthread_mutex_t	count_lock;
+int		meals_by_cpu[MAXCPUS];
+
+#define LEFT(k)		(((k) + (PHILOSOPHERS - 1)) % PHILOSOPHERS)
+#define RIGHT(k)	(((k) + 1) % PHILOSOPHERS)
+
+void test(struct table *t, int k)
+{
+    if (t->state[LEFT(k)] != EATING &&
+	t->state[k] == HUNGRY &&
+	t->state[RIGHT(k)] != EATING) {
+	t->state[k] = EATING;
+	pthread_cond_signal(&t->self[k]);
+    }
+}
+
+void pickup(struct table *t, int i)
+{
+    pthread_mutex_lock(&t->monitor);
+    t->state[i] = HUNGRY;
+    test(t, i);
+    while (t->state[i] != EATING)
+	pthread_cond_wait(&t->self[i], &t->monitor);
+    pthread_mutex_unlock(&t->monitor);
+}
+
+void putdown(struct table *t, int i)
+{
+    pthread_mutex_lock(&t->monitor);
+    t->state[i] = THINKING;
+    test(t, LEFT(i));
+    test(t, RIGHT(i));
+    pthread_mutex_unlock(&t->monitor);
+}
+
+void validate_state(struct table *t, int i)
+{
+    pthread_mutex_lock(&t->monitor);
+    if (t->state[i] != EATING ||
+	t->state[LEFT(i)] == EATING ||
+	t->state[RIGHT(i)] == EATING) {
+	printf("Invalid state at table %d, philosopher %d\n",
+	       (int) (t - tables), i);
+	abort();
+    }
+    pthread_mutex_unlock(&t->monitor);
+}
+
+void cycle_soaker(void) {}
+
+/*
+ * Burn some CPU. Each philosopher has its own random number generator;
+ * a shared one would need a lock, and that would be all we measured.
+ */
+void random_spin(unsigned int *seed, int max)
+{
+    int spin_time, i;
+
+    *seed = *seed * 1103515245 + 12345;
+    spin_time = ((*seed >> 16) & 0x7fff) % (max * 100);
+
+    for (i = 0; i < spin_time; i++)
+	cycle_soaker();
+}
+
+void *
+philosopher(void *arg)
+{
+    int			id = (int) arg;
+    struct table	*t = &tables[id / PHILOSOPHERS];
+    int			i = id % PHILOSOPHERS;
+    int			mymeals[MAXCPUS];
+    unsigned int	seed = id + 1;
+    int			j;
+
+    for (j = 0; j < MAXCPUS; j++)
+	mymeals[j] = 0;
+
+    for (j = 0; j < MEALS; j++) {
+	pickup(t, i);
+	validate_state(t, i);
+	mymeals[oskit_pthread_whichcpu() % MAXCPUS]++;
+	random_spin(&seed, 100);
+	putdown(t, i);
+	random_spin(&seed, 50);
+    }
+
+    pthread_mutex_lock(&count_lock);
+    for (j = 0; j < MAXCPUS; j++)
+	meals_by_cpu[j] += mymeals[j];
+    pthread_mutex_unlock(&count_lock);
+
+    return 0;
+}
+
+int
+main()
+{
+    pthread_t		threads[TABLES * PHILOSOPHERS];
+    unsigned long long	before, cycles;
+    void		*stat;
+    int			i, k, total;
+
+#ifndef KNIT
+    oskit_clientos_init_pthreads();
+    start_clock();
+    start_pthreads();
+#endif
+
+    pthread_mutex_init(&count_lock, 0);
+    for (k = 0; k < TABLES; k++) {
+	pthread_mutex_init(&tables[k].monitor, 0);
+	for (i = 0; i < PHILOSOPHERS; i++) {
+	    tables[k].state[i] = THINKING;
+	    pthread_cond_init(&tables[k].self[i], 0);
+	}
+    }
+
+    printf("%d tables of %d philosophers, %d meals each\n",
+	   TABLES, PHILOSOPHERS, MEALS);
+
+    before = get_tsc();
+    for (i = 0; i < TABLES * PHILOSOPHERS; i++)
+	pthread_create(&threads[i], 0, philosopher, (void *) i);
+
+    for (i = 0; i < TABLES * PHILOSOPHERS; i++)
+	pthread_join(threads[i], &stat);
+    cycles = get_tsc() - before;
+
+    total = 0;
+    for (i = 0; i < MAXCPUS; i++) {
+	if (meals_by_cpu[i]) {
+	    printf("  CPU %d: %d meals\n", i, meals_by_cpu[i]);
+	    total += meals_by_cpu[i];
+	}
+    }
+    printf("%d meals in %u Mcycles, %u meals per Mcycle\n", total,
+	   (unsigned) (cycles / 1000000),
+	   (unsigned) (total / ((cycles / 1000000) ? cycles / 1000000 : 1)));
+
+    exit(0);
+    return 0;
+}
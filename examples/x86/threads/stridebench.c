@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Measure the cost of waking up stride scheduled threads, with the
+ * run queue holding more and more of them.
+ *
+ * Up to a couple of thousand threads, each with a different number of
+ * tickets as in stride_test, wait on a condition.  Each round signals
+ * every one of them, which puts them all on the run queue at spread
+ * out pass values, and then waits until the last has run.  Reports
+ * cycles per wakeup for each thread count.  Needs a threads library
+ * built with PTHREAD_SCHED_STRIDE and THREADS_MAX_THREAD=4096 (see
+ * threads/MakeFlags).  Also builds in unix mode.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <oskit/startup.h>
+#include <oskit/clientos.h>
+#include <oskit/machine/proc_reg.h>
+
+#include <oskit/threads/pthread.h>
+
+/*
+ * Include this file in your main.c to drag in the stride scheduler.
+ * Do not include multiple times!
+ */
+#include <oskit/threads/sched_stride.h>
+
+#define MAXTHREADS	2048
+#define NROUNDS		20
+
+static int		counts[] = { 16, 128, 512, 1024, MAXTHREADS };
+
+pthread_mutex_t		lock;
+pthread_cond_t		go, done;
+int			generation, nthreads, waiting;
+pthread_t		tids[MAXTHREADS];
+
+void *
+waiter_thread(void *arg)
+{
+	int	gen = 0;
+
+	pthread_mutex_lock(&lock);
+	while (1) {
+		if (++waiting == nthreads)
+			pthread_cond_signal(&done);
+		while (generation == gen)
+			pthread_cond_wait(&go, &lock);
+		gen = generation;
+		if (gen < 0)
+			break;
+	}
+	pthread_mutex_unlock(&lock);
+	return arg;
+}
+
+/*
+ * Cycles per wakeup with all the threads so far, up until each has
+ * run and gone back to waiting.
+ */
+unsigned int
+wakeups(void)
+{
+	unsigned long long	before, cycles = 0;
+	int			i, r;
+
+	pthread_mutex_lock(&lock);
+	while (waiting < nthreads)
+		pthread_cond_wait(&done, &lock);
+
+	for (r = 0; r < NROUNDS; r++) {
+		before = get_tsc();
+		waiting = 0;
+		generation++;
+		for (i = 0; i < nthreads; i++)
+			pthread_cond_signal(&go);
+		while (waiting < nthreads)
+			pthread_cond_wait(&done, &lock);
+		cycles += get_tsc() - before;
+	}
+	pthread_mutex_unlock(&lock);
+
+	return (unsigned int) (cycles / (NROUNDS * nthreads));
+}
+
+int
+main()
+{
+	pthread_attr_t		threadattr;
+	struct sched_param	param;
+	void			*stat;
+	int			i, c;
+
+#ifndef KNIT
+	oskit_clientos_init_pthreads();
+	start_clock();
+	start_pthreads();
+#endif
+	pthread_mutex_init(&lock, 0);
+	pthread_cond_init(&go, 0);
+	pthread_cond_init(&done, 0);
+
+	/*
+	 * Change ourself to the STRIDE scheduler so that we get enough
+	 * CPU time to run.
+	 */
+	param.tickets = 1000;
+	pthread_setschedparam(pthread_self(), SCHED_STRIDE, &param);
+
+	pthread_attr_init(&threadattr);
+	pthread_attr_setschedpolicy(&threadattr, SCHED_STRIDE);
+
+	for (c = 0; c < sizeof counts / sizeof counts[0]; c++) {
+		/*
+		 * Add threads up to the next count. They start out
+		 * waiting, so the new ones do not disturb the others.
+		 */
+		pthread_mutex_lock(&lock);
+		for (i = nthreads; i < counts[c]; i++) {
+			param.tickets = 10 * (1 + i % 100);
+			pthread_attr_setschedparam(&threadattr, &param);
+			if (pthread_create(&tids[i], &threadattr,
+					   waiter_thread, 0) != 0) {
+				printf("pthread_create failed at %d threads\n",
+				       i);
+				exit(1);
+			}
+		}
+		nthreads = counts[c];
+		pthread_mutex_unlock(&lock);
+
+		printf("%4d threads: %u cycles per wakeup\n",
+		       nthreads, wakeups());
+	}
+
+	pthread_mutex_lock(&lock);
+	generation = -1;
+	pthread_cond_broadcast(&go);
+	pthread_mutex_unlock(&lock);
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(tids[i], &stat);
+
+	exit(0);
+	return 0;
+}
@@ -32,6 +32,8 @@ struct oskit_socket;
 /* call back function used to receive packets */
 oskit_error_t bsdnet_net_receive(void *data, struct oskit_bufio *b, 
 	oskit_size_t pkt_size);
+oskit_error_t bsdnet_net_receive_batch(void *data, struct oskit_bufio **bufs,
+	oskit_size_t *sizes, unsigned count);
 
 /* generic driver ioctl function */
 int bsdnet_driver_ioctl(struct ifnet *, int, char *);
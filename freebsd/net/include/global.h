@@ -122,6 +122,7 @@
 #define bsdnet_getpeername OSKIT_FREEBSD_NET_bsdnet_getpeername
 #define bsdnet_getsockname OSKIT_FREEBSD_NET_bsdnet_getsockname
 #define bsdnet_net_receive OSKIT_FREEBSD_NET_bsdnet_net_receive
+#define bsdnet_net_receive_batch OSKIT_FREEBSD_NET_bsdnet_net_receive_batch
 #define bsdnet_read OSKIT_FREEBSD_NET_bsdnet_read
 #define bsdnet_recvfrom OSKIT_FREEBSD_NET_bsdnet_recvfrom
 #define bsdnet_sendto OSKIT_FREEBSD_NET_bsdnet_sendto
@@ -357,6 +358,7 @@
 #define mbinit OSKIT_FREEBSD_NET_mbinit
 #define mbstat OSKIT_FREEBSD_NET_mbstat
 #define mbuf_bufio_create_instance OSKIT_FREEBSD_NET_mbuf_bufio_create_instance
+#define mbuf_bufio_mbufs OSKIT_FREEBSD_NET_mbuf_bufio_mbufs
 #if 0
 #define memcmp OSKIT_FREEBSD_NET_memcmp
 #endif
@@ -173,18 +173,15 @@ bufio_read(oskit_bufio_t *io, void *dest, oskit_off_t offset,
 		"(%p,%p,%d,%d) called\n", io, dest, offset, count);
 #endif
 
-	/* XXX - we don't even consider the case 
-	 * that our mbuf might run out of bytes 
-	 */
-	*actual = count;
+	*actual = 0;
 
 	/* find the mbuf to start with */
-	while (offset > mpos + m0->m_len) {
+	while (m0 && offset >= mpos + m0->m_len) {
 		mpos += m0->m_len;
 		m0 = m0->m_next;
 	}
 		
-	while (count > 0) {
+	while (m0 && count > 0) {
 		/* copyout */
 		int start = offset - mpos;
 		int avail = m0->m_len - start;
@@ -197,14 +194,11 @@ bufio_read(oskit_bufio_t *io, void *dest, oskit_off_t offset,
 		dest += bytes;
 		offset += bytes;
 		count -= bytes;
+		*actual += bytes;
 
-		/* if there are bytes left to copy, advance to next mbuf */
-		if (count > 0) {
-			mpos += m0->m_len;
-			m0 = m0->m_next;
-			if (!m0)
-				break;
-		}
+		/* advance to next mbuf */
+		mpos += m0->m_len;
+		m0 = m0->m_next;
 	}
 	return 0;
 }
@@ -257,8 +251,10 @@ bufio_setsize(oskit_bufio_t *io, oskit_off_t new_size)
 /*
  * we support it as best as we can...
  *
- * if it fails, the driver will 
- * call copyin when it needs the data from the mbufs
+ * A range that lies within one mbuf is mapped in place, however long
+ * the chain is; empty mbufs in front of it don't matter.  If it fails,
+ * the driver will use the bufiovec interface or copyin when it needs
+ * the data from the mbufs.
  */
 static OSKIT_COMDECL
 bufio_map(oskit_bufio_t *io, void **dest, 
@@ -267,18 +263,6 @@ bufio_map(oskit_bufio_t *io, void **dest,
 	struct mbuf *m = ((mbuf_bufio_t *)io)->m;
 	int 	m_off = 0;
 
-#ifndef NO_FAST_REJECT
-	/* 
-	 * this is what currently happens: it only makes sense to check
-	 * if the mbuf chain has only one mbuf in it - since the device
-	 * driver will want to map the whole thing in.
-	 *
-	 * even in the future it would be safe to leave that so as map
-	 * is ``voluntary'' anyway.
-	 */
-	if (m->m_next)
-		return OSKIT_E_NOTIMPL;
-#endif
 	/*
 	 * go through the list of mbufs, trying to find one 
 	 * that contains the requested range 
@@ -294,23 +278,25 @@ bufio_map(oskit_bufio_t *io, void **dest,
 }
 
 /*
- * convert this mbuf chain in a series of iovec's, provided by the caller
+ * convert this mbuf chain in a series of iovec's, provided by the caller.
+ * Empty mbufs are skipped.  Returns the number of iovecs the whole
+ * chain needs, which is more than veclen if vec was too short.
  */
 static OSKIT_COMDECL_U
 bufiovec_map(oskit_bufiovec_t *io, oskit_iovec_t *vec, oskit_u32_t veclen)
 {
 	struct mbuf *m = ((mbuf_bufio_t *)(io - 1))->m;
-
-	int	n = 0;
-	while (vec && m && n <= veclen) {
-	    vec->iov_base = m->m_data;
-	    vec->iov_len = m->m_len;
-	    m = m->m_next;
-	    vec++;
-	    n++;
+	oskit_u32_t n = 0;
+
+	for (; m; m = m->m_next) {
+		if (m->m_len == 0)
+			continue;
+		if (n < veclen) {
+			vec[n].iov_base = m->m_data;
+			vec[n].iov_len = m->m_len;
+		}
+		n++;
 	}
-	if (m)
-	    return OSKIT_ENOBUFS;	/* XXX: No buffer space available */
 	return n;
 }
 
@@ -409,3 +395,19 @@ mbuf_bufio_create_instance(struct mbuf *m, oskit_size_t *mlen)
 	    *mlen = b->mlen;
 	return &b->ioi;
 }
+
+/*
+ * if this bufio is one of ours, return the mbuf chain behind it and its
+ * length in *mlen, otherwise NULL.  The chain still belongs to the bufio.
+ */
+struct mbuf *
+mbuf_bufio_mbufs(oskit_bufio_t *io, oskit_size_t *mlen)
+{
+	mbuf_bufio_t *b = (mbuf_bufio_t *)io;
+
+	if (io->ops != &mbuf_bio_ops)
+		return NULL;
+	if (mlen)
+		*mlen = b->mlen;
+	return b->m;
+}
@@ -24,6 +24,7 @@
 #include <oskit/io/bufio.h>
 struct mbuf;
 oskit_bufio_t * mbuf_bufio_create_instance(struct mbuf *m, oskit_size_t *mlen);
+struct mbuf * mbuf_bufio_mbufs(oskit_bufio_t *io, oskit_size_t *mlen);
 
 #endif /* _MBUF_BUF_IO_H */
 
@@ -24,7 +24,9 @@
  *
  * ether_input() will queue the packet on the interface, and might
  * post a software irq for the processing. If it does, we immediately
- * execute the software irq.
+ * execute the software irq.  bsdnet_net_receive_batch is the callback
+ * for batched pushes; it does the same for a vector of packets under a
+ * single spl section.
  *
  * Note the use of the spl*() and save_cpl/restore_cpl here.
  * We must simulate what the code in /usr/src/sys/i386/isa/vector.s and
@@ -85,6 +87,7 @@ extern volatile unsigned oskit_freebsd_ipending;
 extern unsigned oskit_freebsd_idelayed;
 volatile unsigned int    netisr;
 char * ethtoa(unsigned char p[6]);
+void bsdnet_net_softnet(void);
 
 /*
  * We don't see the 64bit preamble or 32bit CRC so our
@@ -92,31 +95,33 @@ char * ethtoa(unsigned char p[6]);
  */
 #define ETHERMAX        (1526-8-4)
 
-oskit_error_t
-bsdnet_net_receive(void *data, oskit_bufio_t *b, oskit_size_t pkt_size)
+/*
+ * Check a received frame and map it in.  Returns 0 and sets *framep if
+ * the frame should go up, nonzero if it should be dropped; *errp is the
+ * error to return to the driver in that case.
+ */
+static int
+receive_check(oskit_freebsd_net_ether_if_t *eif, oskit_bufio_t *b,
+	      oskit_size_t pkt_size, unsigned char **framep, oskit_error_t *errp)
 {
-        struct mbuf     	*m;
 	struct ether_header     *eh;
 	unsigned char   	*frame;
-	int 			rval = 0, err = 0, length, payload;
-        caddr_t         	rb;
-	oskit_freebsd_net_ether_if_t *eif = data;
-	struct ifnet 		*ifp = eif->ifp;
-	unsigned		cpl;
-	int			s;
+	int			err;
 
+	*errp = 0;
 	if (pkt_size > ETHERMAX) {
 		osenv_log(OSENV_LOG_WARNING, 
 			"%s: Hey Wally, I caught a big one! -- %d bytes\n",
 			       eif->info.name, pkt_size);
-		return OSKIT_E_DEV_BADPARAM;
+		*errp = OSKIT_E_DEV_BADPARAM;
+		return 1;
 	}
 
 	/* we are not associated with an interface yet 
 	 * so we can't do anything
 	 */
-	if (!ifp)
-		return 0;
+	if (!eif->ifp)
+		return 1;
 
 	/* map data in */
 	/* buf, dest, offset, count */
@@ -132,7 +137,7 @@ bsdnet_net_receive(void *data, oskit_bufio_t *b, oskit_size_t pkt_size)
 
 		/* ignore IEEE 802.3 packets */
 		if (type < ETHERMTU)
-			return 0;
+			return 1;
 
 #if VERBOSITY > 0
 		osenv_log(OSENV_LOG_INFO, 
@@ -142,17 +147,21 @@ bsdnet_net_receive(void *data, oskit_bufio_t *b, oskit_size_t pkt_size)
 #endif
 	}
 
-	/* keep a reference around! */
-	oskit_bufio_addref(b);
-
-	/* NOW we're getting BSDish... */
-
-	/* save cpl */
-	save_cpl(&cpl);
+	*framep = frame;
+	return 0;
+}
 
-	/* we set the cpl to what it would be if BSD processed that interrupt */
-	osenv_assert(osenv_intr_enabled() != 0);
-	s = splimp();
+/*
+ * Wrap a mapped frame in a packet header mbuf faking a cluster.
+ * Must be called at splimp.  Takes a reference on the bufio if it
+ * succeeds.
+ */
+static struct mbuf *
+receive_mbuf(struct ifnet *ifp, oskit_bufio_t *b, unsigned char *frame,
+	     oskit_size_t pkt_size)
+{
+        struct mbuf     	*m;
+	int 			length, payload;
 
 	/* 
  	 * this code is modeled from /usr/src/sys/....../if_ix.c 
@@ -161,7 +170,7 @@ bsdnet_net_receive(void *data, oskit_bufio_t *b, oskit_size_t pkt_size)
         if (m == 0) {
                 osenv_log(OSENV_LOG_INFO, "MGETHDR:"); 
 			/* ZZZ need to add drop counters */
-                goto done;
+                return 0;
         }
         length = pkt_size;
         payload = length - sizeof(struct ether_header);
@@ -172,24 +181,55 @@ bsdnet_net_receive(void *data, oskit_bufio_t *b, oskit_size_t pkt_size)
 	/*
 	 * here we go, faking an mbuf cluster
 	 */
-	m->m_ext.ext_buf = frame;
+	m->m_ext.ext_buf = (caddr_t)frame;
 	m->m_ext.ext_size = length;
-	m->m_data = rb = frame + sizeof(struct ether_header);
+	m->m_data = (caddr_t)frame + sizeof(struct ether_header);
         m->m_len = payload;
 
 	/*
 	 * mark this mbuf as referring to an oskit bufio 
 	 */
+	oskit_bufio_addref(b);
 	m->m_ext.ext_bufio = b;
 	m->m_flags |= M_EXT;
 
+	return m;
+}
+
+oskit_error_t
+bsdnet_net_receive(void *data, oskit_bufio_t *b, oskit_size_t pkt_size)
+{
+        struct mbuf     	*m;
+	unsigned char   	*frame;
+	oskit_error_t		rval;
+	oskit_freebsd_net_ether_if_t *eif = data;
+	struct ifnet 		*ifp = eif->ifp;
+	unsigned		cpl;
+	int			s;
+
+	if (receive_check(eif, b, pkt_size, &frame, &rval))
+		return rval;
+
+	/* NOW we're getting BSDish... */
+
+	/* save cpl */
+	save_cpl(&cpl);
+
+	/* we set the cpl to what it would be if BSD processed that interrupt */
+	osenv_assert(osenv_intr_enabled() != 0);
+	s = splimp();
+
+	m = receive_mbuf(ifp, b, frame, pkt_size);
+	if (m == 0)
+		goto done;
+
 	/* we set the cpl to what it would be if BSD processed that interrupt */
 	splnet();
 
 	/* 
 	 * hand packet up as if it came fresh from a device driver 
 	 */
-	ether_input(ifp, eh, m);
+	ether_input(ifp, (struct ether_header *)frame, m);
 	ifp->if_ipackets++;
 
 done:
@@ -199,6 +239,91 @@ done:
 	/* now restore the cpl */
 	restore_cpl(cpl);
 
+	return 0;
+}
+
+/*
+ * Receive a batch of frames.  The mbufs for the whole batch are built
+ * and handed to ether_input inside one spl section, and if we were
+ * called from base level the protocol input that ether_input posted is
+ * run once for the batch, rather than waiting for the software
+ * interrupt.  Returns the first error, like sequential pushes would.
+ */
+oskit_error_t
+bsdnet_net_receive_batch(void *data, oskit_bufio_t **bufs,
+			 oskit_size_t *sizes, unsigned count)
+{
+	struct mbuf		*m, *head, **tail;
+	unsigned char		*frames[OSKIT_NETIO_BATCH];
+	oskit_error_t		err, rval = 0;
+	oskit_freebsd_net_ether_if_t *eif = data;
+	struct ifnet 		*ifp = eif->ifp;
+	unsigned		cpl, i;
+	int			s;
+
+	while (count > OSKIT_NETIO_BATCH) {
+		err = bsdnet_net_receive_batch(data, bufs, sizes,
+					       OSKIT_NETIO_BATCH);
+		if (err && !rval)
+			rval = err;
+		bufs += OSKIT_NETIO_BATCH;
+		sizes += OSKIT_NETIO_BATCH;
+		count -= OSKIT_NETIO_BATCH;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (receive_check(eif, bufs[i], sizes[i], &frames[i], &err)) {
+			frames[i] = 0;
+			if (err && !rval)
+				rval = err;
+		}
+	}
+
+	save_cpl(&cpl);
+
+	osenv_assert(osenv_intr_enabled() != 0);
+	s = splimp();
+
+	head = 0;
+	tail = &head;
+	for (i = 0; i < count; i++) {
+		if (frames[i] == 0)
+			continue;
+		m = receive_mbuf(ifp, bufs[i], frames[i], sizes[i]);
+		if (m == 0)
+			break;
+		*tail = m;
+		tail = &m->m_nextpkt;
+	}
+
+	splnet();
+
+	for (i = 0; head; i++) {
+		if (frames[i] == 0)
+			continue;
+		m = head;
+		head = m->m_nextpkt;
+		m->m_nextpkt = 0;
+		ether_input(ifp, (struct ether_header *)frames[i], m);
+		ifp->if_ipackets++;
+	}
+
+	osenv_assert(osenv_intr_enabled() == 0);
+
+	splx(s);
+	restore_cpl(cpl);
+
+	/*
+	 * At base level nothing else can be holding the stack, so run
+	 * the queued input now instead of at the next interrupt.
+	 */
+	if (cpl == 0) {
+		s = splnet();
+		if (oskit_freebsd_ipending & SWI_NET_PENDING)
+			bsdnet_net_softnet();
+		splx(s);
+	}
+
 	return rval;
 }
 
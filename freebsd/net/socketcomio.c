@@ -964,6 +964,13 @@ asyncio_readable(oskit_asyncio_t *f)
 /*
  * methods of bufio_streams
  */
+/*
+ * Read whatever is queued, up to what the receive buffer can hold.
+ * The mbufs are taken off the socket buffer rather than copied, so the
+ * bufio returned is backed by the receive clusters and by the frames
+ * the driver passed up (see net_receive.c).  It is usually a chain;
+ * use the bufiovec interface or oskit_bufio_read to get at it.
+ */
 static OSKIT_COMDECL
 bufio_stream_read(oskit_bufio_stream_t *f,
 	struct oskit_bufio **buf, oskit_size_t *bytes)
@@ -971,7 +978,7 @@ bufio_stream_read(oskit_bufio_stream_t *f,
 	oskit_sockimpl_t *si = (oskit_sockimpl_t *)(f-3);
 	oskit_error_t	rc;
 	struct socket *so = si->so;
-	int	mlen = 1440;	/* ???: 1526 - 12 - 74 */
+	int	mlen = so->so_rcv.sb_hiwat;
 	struct proc  p;
 	struct mbuf *m;
 	struct uio auio;
@@ -984,9 +991,14 @@ bufio_stream_read(oskit_bufio_stream_t *f,
 			(struct mbuf **)0, (int *)0);
 
 	*bytes = mlen - auio.uio_resid;
-	if (*bytes > 0)
+	if (*bytes > 0) {
 		*buf = mbuf_bufio_create_instance(m, 0);
-	else
+		if (*buf == 0) {
+			m_freem(m);
+			*bytes = 0;
+			rc = ENOMEM;
+		}
+	} else
 		/* XXX violates COM rules.
 		   should return an error code instead ??? */
 		*buf = 0;
@@ -995,6 +1007,13 @@ bufio_stream_read(oskit_bufio_stream_t *f,
 	return xlaterc(rc);
 }
 
+/*
+ * Lend a bufio to the socket; it is referenced until the data has
+ * been acknowledged.  A bufio we handed out from bufio_stream_read on
+ * some socket is passed on by sharing its mbufs, which is what lets a
+ * relay move data between two sockets without copying it.  Anything
+ * else must be mappable.
+ */
 static OSKIT_COMDECL
 bufio_stream_write(oskit_bufio_stream_t *f,
 	struct oskit_bufio *buf, oskit_size_t offset)
@@ -1003,7 +1022,7 @@ bufio_stream_write(oskit_bufio_stream_t *f,
 	oskit_error_t	rc;
 	struct socket *so = si->so;
 	struct proc  p;
-	struct mbuf *m;
+	struct mbuf *m, *chain;
 	oskit_off_t   size;
 	oskit_size_t  payload;
 	void	      *data;
@@ -1017,45 +1036,51 @@ bufio_stream_write(oskit_bufio_stream_t *f,
 		return oskit_freebsd_xlate_errno(rc);
 #endif
 
-	OSKIT_FREEBSD_CREATE_CURPROC(p);
-
 	rc = oskit_bufio_getsize(buf, &size);
 	if (rc)
-		goto bailout;
-
-	/* Don't bother if I can't map */
-	rc = oskit_bufio_map(buf, &data, 0, (oskit_size_t)size);
-	if (rc)
-		goto bailout;
-
+		return rc;
+	if (offset >= size)
+		return OSKIT_EINVAL;
 	payload = size - offset;
-	MGETHDR(m, M_DONTWAIT, MT_DATA);
-	if (m == 0) {
-		rc = OSKIT_ENOMEM;
-		goto bailout;
-	}
 
-	/* let's fake an external mbuf, see net_receive.c */
+	MGETHDR(m, M_DONTWAIT, MT_DATA);
+	if (m == 0)
+		return OSKIT_ENOMEM;
         m->m_pkthdr.rcvif = (struct ifnet *)0;
-        m->m_pkthdr.len = 0;
-
-        /*
-         * here we go, manually assembling our new external mbuf
-         */
-        m->m_ext.ext_buf = data;
-        m->m_ext.ext_size = size;
-        m->m_data = data + offset;
-        m->m_len = payload;
+        m->m_pkthdr.len = payload;
 
-	oskit_bufio_addref(buf);
-        m->m_ext.ext_bufio = buf;
-        m->m_flags |= M_EXT;
+	if ((chain = mbuf_bufio_mbufs(buf, 0)) != NULL) {
+		/*
+		 * share the clusters; the small mbufs get copied
+		 */
+		m->m_len = 0;
+		m->m_next = m_copym(chain, offset, M_COPYALL, M_DONTWAIT);
+		if (m->m_next == 0) {
+			m_freem(m);
+			return OSKIT_ENOMEM;
+		}
+	} else {
+		/* Don't bother if I can't map */
+		rc = oskit_bufio_map(buf, &data, 0, (oskit_size_t)size);
+		if (rc) {
+			m_freem(m);
+			return rc;
+		}
+
+		/* let's fake an external mbuf, see net_receive.c */
+		m->m_ext.ext_buf = data;
+		m->m_ext.ext_size = size;
+		m->m_data = data + offset;
+		m->m_len = payload;
+
+		oskit_bufio_addref(buf);
+		m->m_ext.ext_bufio = buf;
+		m->m_flags |= M_EXT;
+	}
 
+	OSKIT_FREEBSD_CREATE_CURPROC(p);
 	rc = so->so_proto->pr_usrreqs->pru_sosend(so, (struct sockaddr *)0, (struct uio *)0,
 			m, (struct mbuf *)0, 0, &p);
-
-	/* unmap ??? */
-bailout:
 	OSKIT_FREEBSD_DESTROY_CURPROC(p);
 	return xlaterc(rc);
 }
@@ -43,10 +43,11 @@ oskit_freebsd_net_open_ether_if(oskit_etherdev_t *dev,
         memset(eif, 0, sizeof *eif);
 
         eif->dev = dev;
-        eif->recv_nio = oskit_netio_create(bsdnet_net_receive, eif);
+        eif->recv_nio = oskit_netio_create_batch(bsdnet_net_receive,
+						 bsdnet_net_receive_batch, eif, NULL);
         if (eif->recv_nio == NULL) {
                 osenv_log(OSENV_LOG_ERR, 
-			"oskit_netio_create failed in %s", __FUNCTION__);
+			"oskit_netio_create_batch failed in %s", __FUNCTION__);
 		return OSKIT_ENOMEM;
 	}
 
@@ -105,10 +106,11 @@ oskit_freebsd_net_prepare_ether_if(oskit_freebsd_net_ether_if_t **out_eif)
         eif = (oskit_freebsd_net_ether_if_t *)osenv_mem_alloc(sizeof *eif, 0, 0);
         memset(eif, 0, sizeof *eif);
 
-	eif->recv_nio = oskit_netio_create(bsdnet_net_receive, eif);
+	eif->recv_nio = oskit_netio_create_batch(bsdnet_net_receive,
+						 bsdnet_net_receive_batch, eif, NULL);
         if (eif->recv_nio == NULL) {
                 osenv_log(OSENV_LOG_ERR, 
-			"oskit_netio_create failed in %s", __FUNCTION__);
+			"oskit_netio_create_batch failed in %s", __FUNCTION__);
 		return OSKIT_ENOMEM;
 	}
 	*out_eif = eif;
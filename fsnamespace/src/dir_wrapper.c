@@ -375,6 +375,8 @@ dir_create(oskit_dir_t *d,
 
 	err = NOWRAPPERCALL(dir, diri, dir,
 			    create, name, excl, mode, out_file);
+	if (!err)
+		fsn_cache_invalidate(dir->fsnimpl, dir->w_diri, name);
 
 	return err;
 }
@@ -391,6 +393,8 @@ dir_link(oskit_dir_t *d, const char *name, oskit_file_t *file)
 	assert(file);
 
 	err = NOWRAPPERCALL(dir, diri, dir, link, name, file);
+	if (!err)
+		fsn_cache_invalidate(dir->fsnimpl, dir->w_diri, name);
 
 	return err;
 }
@@ -457,6 +461,8 @@ dir_mkdir(oskit_dir_t *d, const char *name, oskit_mode_t mode)
 		return OSKIT_E_INVALIDARG;
 
 	err = NOWRAPPERCALL(dir, diri, dir, mkdir, name, mode);
+	if (!err)
+		fsn_cache_invalidate(dir->fsnimpl, dir->w_diri, name);
 
 	return err;
 }
@@ -508,6 +514,8 @@ dir_mknod(oskit_dir_t *d, const char *name, oskit_mode_t mode, oskit_dev_t dev)
 		return OSKIT_E_INVALIDARG;
 
 	err = NOWRAPPERCALL(dir, diri, dir, mknod, name, mode, dev);
+	if (!err)
+		fsn_cache_invalidate(dir->fsnimpl, dir->w_diri, name);
 
 	return err;
 }
@@ -522,6 +530,8 @@ dir_symlink(oskit_dir_t *d, const char *link_name, const char *dest_name)
 		return OSKIT_E_INVALIDARG;
 
 	err = NOWRAPPERCALL(dir, diri, dir, symlink, link_name, dest_name);
+	if (!err)
+		fsn_cache_invalidate(dir->fsnimpl, dir->w_diri, link_name);
 
 	return err;
 }
@@ -36,27 +36,22 @@
 #define DPRINTF(fmt, args... )
 #endif
 
-/* Maximum number of cache entries. Seems like a reasonable number ... */
-#define MAX_ENTRIES	768
-
-/* Maximum name component allowed in the cache. */
-#define	MAX_CNAMELEN	30
-
 /*
- * This is a cache entry
+ * This is a cache entry. The name is allocated along with it, so any
+ * length of name can be cached.
  */
 typedef struct namecache {
 	queue_chain_t	hashchain;	/* Queuing element */
 	queue_chain_t	lruchain;	/* Queuing element */
 	oskit_dir_t    *dir;		/* Directory this entry contained in */
-	oskit_file_t   *file;		/* Actual entry. Either file or dir */
-	unsigned int	hash;		/* XXX Hash value. */
-	char		flags;		/* Info Flags */
-	unsigned char	len;			/* Name len */
-	char		name[MAX_CNAMELEN];	/* Sized for word alignment */
-#ifdef VERBOSE
-	int		nulls;		/* Leave room for terminating NULL */
-#endif
+	oskit_file_t   *file;		/* Actual entry, or null if negative */
+	unsigned int	hash;		/* Hash value. */
+	unsigned int	generation;	/* Cache generation it was made in */
+	oskit_size_t	size;		/* Bytes allocated for the entry */
+	short		flags;		/* Info Flags */
+	short		active;		/* On the active list */
+	int		len;		/* Name len */
+	char		name[0];	/* Name, null terminated */
 } namecache_t;
 
 /*
@@ -82,17 +77,40 @@ typedef struct namecache {
  *     that.
  *  *  Rename (and thus rmdir) require that we purge the entire cache to avoid
  *     name aliasing problems. Well, I think this is the case. 
+ *  *  A negative entry records that a name was looked up and did not
+ *     exist. Creating anything under that name (through the directory
+ *     wrapper) must throw the negative entry away; see dir_wrapper.c.
+ *     Names created behind the namespace's back, through a directory
+ *     object that did not come from the namespace, are not noticed.
  */
 
+/*
+ * The hash value munges the component name with the address of
+ * the containing directory.
+ */
+static inline unsigned int
+cache_hash(oskit_dir_t *dir, const char *name, int len)
+{
+	unsigned int	hash = 2166136261U;
+
+	while (len--)
+		hash = (hash ^ (unsigned char) *name++) * 16777619U;
+	return hash ^ ((unsigned int) dir >> 4) ^ (unsigned int) dir;
+}
+
 void
 fsn_cache_init(struct fsnimpl *fsnimpl)
 {
 	struct fs_cache	*fsc = &(fsnimpl->fs_cache);
-	int		 i;
 	
-	queue_init(&(fsc->lru));
-	for (i = 0; i < NHEADERS; i++)
-		queue_init(&(fsc->hash[i]));
+	queue_init(&(fsc->active));
+	queue_init(&(fsc->inactive));
+	fsc->hash     = 0;
+	fsc->nheaders = 0;
+	fsc->count    = 0;
+	fsc->nactive  = 0;
+	fsc->bytes    = 0;
+	fsc->budget   = FSCACHE_DEFAULT_BUDGET;
 
 #ifdef THREAD_SAFE
 	pthread_mutex_init(&(fsc->mutex), &pthread_mutexattr_default);
@@ -100,48 +118,213 @@ fsn_cache_init(struct fsnimpl *fsnimpl)
 }
 
 /*
- * On exit, release all of the entries in the cache.
+ * Take an entry out of the cache and free it.
  */
-void
-fsn_cache_cleanup(struct fsnimpl *fsnimpl)
+static void
+cache_free(struct fs_cache *fsc, namecache_t *ncp)
+{
+	DPRINTF("Free: %p %p %s\n", ncp, ncp->dir, ncp->name);
+
+	queue_remove(&fsc->hash[ncp->hash & (fsc->nheaders - 1)],
+		     ncp, namecache_t *, hashchain);
+	if (ncp->active) {
+		queue_remove(&fsc->active, ncp, namecache_t *, lruchain);
+		fsc->nactive--;
+	}
+	else {
+		queue_remove(&fsc->inactive, ncp, namecache_t *, lruchain);
+	}
+
+	oskit_dir_release(ncp->dir);
+	if (ncp->file)
+		oskit_file_release(ncp->file);
+
+	fsc->count--;
+	fsc->bytes -= ncp->size;
+	sfree(ncp, ncp->size);
+}
+
+/*
+ * Throw out the least recently used entry, preferring one that has
+ * not been hit since it went in.
+ */
+static void
+cache_evict(struct fs_cache *fsc)
 {
-	struct fs_cache	*fsc = &(fsnimpl->fs_cache);
 	namecache_t	*ncp;
 
-	FSCACHE_LOCK(fsnimpl);
-	DPRINTF("\n");
+	if (!queue_empty(&fsc->inactive))
+		ncp = (namecache_t *) queue_first(&fsc->inactive);
+	else
+		ncp = (namecache_t *) queue_first(&fsc->active);
 
 	/*
-	 * Iterate through the LRU list (which contains every entry).
+	 * An entry is considered evicted only when its a capacity miss
+	 * (not purged).
 	 */
-	while (!queue_empty(&fsc->lru)) {
-		queue_remove_first(&fsc->lru, ncp, namecache_t *, lruchain);
+	if (ncp->generation == fsc->generation)
+		FSSTAT(fsc->stats.evictions++);
+	cache_free(fsc, ncp);
+}
+
+/*
+ * Double the hash table. If we cannot get the memory, the chains just
+ * get longer.
+ */
+static void
+cache_grow(struct fs_cache *fsc)
+{
+	queue_head_t	*hash;
+	namecache_t	*ncp;
+	int		i, n;
+
+	n = fsc->nheaders ? fsc->nheaders * 2 : NHEADERS;
+	if ((hash = (queue_head_t *) smalloc(n * sizeof(*hash))) == NULL)
+		return;
+	for (i = 0; i < n; i++)
+		queue_init(&hash[i]);
+
+	queue_iterate(&fsc->active, ncp, namecache_t *, lruchain)
+		queue_enter(&hash[ncp->hash & (n - 1)],
+			    ncp, namecache_t *, hashchain);
+	queue_iterate(&fsc->inactive, ncp, namecache_t *, lruchain)
+		queue_enter(&hash[ncp->hash & (n - 1)],
+			    ncp, namecache_t *, hashchain);
+
+	if (fsc->hash)
+		sfree(fsc->hash, fsc->nheaders * sizeof(*hash));
+	fsc->hash     = hash;
+	fsc->nheaders = n;
+}
+
+/*
+ * Find an entry. Stale entries left behind by a purge are freed as
+ * they are come across.
+ */
+static namecache_t *
+cache_find(struct fs_cache *fsc,
+	   oskit_dir_t *dir, const char *name, int len, unsigned int hash)
+{
+	queue_head_t	*head;
+	namecache_t	*ncp, *next;
 
-		if (ncp->dir) {
-			queue_remove(&fsc->hash[ncp->hash & (NHEADERS-1)],
-				     ncp, namecache_t *, hashchain);
+	if (!fsc->hash)
+		return 0;
 
-			oskit_dir_release(ncp->dir);
-			oskit_file_release(ncp->file);
+	head = &fsc->hash[hash & (fsc->nheaders - 1)];
+	for (ncp = (namecache_t *) queue_first(head);
+	     !queue_end(head, (queue_entry_t) ncp); ncp = next) {
+		next = (namecache_t *) queue_next(&ncp->hashchain);
 
-			DPRINTF("Cleaned: %p %p %s\n",
-				ncp, ncp->dir, ncp->name);
+		if (ncp->generation != fsc->generation) {
+			cache_free(fsc, ncp);
+			continue;
 		}
-		else
-			DPRINTF("Cleaned: %p\n", ncp);
-			
-		sfree(ncp, sizeof(*ncp));
+		if (ncp->hash == hash && ncp->dir == dir && ncp->len == len &&
+		    memcmp(ncp->name, name, len) == 0)
+			return ncp;
+	}
+	return 0;
+}
+
+/*
+ * Make a new entry and link it in. Returns null if it will not fit.
+ */
+static namecache_t *
+cache_insert(struct fs_cache *fsc, oskit_dir_t *dir,
+	     oskit_file_t *file, const char *name, int len, oskit_u32_t flags)
+{
+	namecache_t	*ncp;
+	oskit_size_t	size;
+	unsigned int	hash;
+
+	size = (sizeof(namecache_t) + len + 1 + 7) & ~7;
+	if (size > fsc->budget)
+		return 0;
+
+	hash = cache_hash(dir, name, len);
+
+	/*
+	 * If the name is already there (a negative entry that was not
+	 * invalidated, say), replace it.
+	 */
+	if ((ncp = cache_find(fsc, dir, name, len, hash)) != NULL)
+		cache_free(fsc, ncp);
+
+	/*
+	 * Make room, then grab an entry.
+	 */
+	while (fsc->count && fsc->bytes + size > fsc->budget)
+		cache_evict(fsc);
+
+	if (fsc->count >= fsc->nheaders * 2)
+		cache_grow(fsc);
+	if (!fsc->hash)
+		return 0;
+
+	if ((ncp = (namecache_t *) smalloc(size)) == NULL)
+		return 0;
+
+	/*
+	 * Initialize entry and place it in its bucket. Note that we must add
+	 * a references to the dir object. The caller took care of the file.
+	 */
+	ncp->hash       = hash;
+	ncp->generation = fsc->generation;
+	ncp->size       = size;
+	ncp->dir        = dir;
+	ncp->file       = file;
+	ncp->len        = len;
+	ncp->flags      = flags;
+	ncp->active     = 0;
+	memcpy(ncp->name, name, len);
+	ncp->name[len]  = '\0';
+	oskit_dir_addref(dir);
+
+	queue_enter(&fsc->hash[hash & (fsc->nheaders - 1)],
+		    ncp, namecache_t *, hashchain);
+
+	/*
+	 * New entries go on the inactive list.
+	 */
+	queue_enter(&fsc->inactive, ncp, namecache_t *, lruchain);
+
+	fsc->count++;
+	fsc->bytes += size;
+	return ncp;
+}
+
+/*
+ * On exit, release all of the entries in the cache.
+ */
+void
+fsn_cache_cleanup(struct fsnimpl *fsnimpl)
+{
+	struct fs_cache	*fsc = &(fsnimpl->fs_cache);
+
+	FSCACHE_LOCK(fsnimpl);
+	DPRINTF("\n");
+
+	while (fsc->count)
+		cache_free(fsc, queue_empty(&fsc->inactive) ?
+			   (namecache_t *) queue_first(&fsc->active) :
+			   (namecache_t *) queue_first(&fsc->inactive));
+	if (fsc->hash) {
+		sfree(fsc->hash, fsc->nheaders * sizeof(queue_head_t));
+		fsc->hash     = 0;
+		fsc->nheaders = 0;
 	}
 #if	defined(FSCACHE_STATS)
 	printf("fscache stats:\n");
 	printf("    lookups:    %d\n", fsc->stats.lookups);
+	printf("    hits:       %d\n", fsc->stats.hits);
+	printf("    neghits:    %d\n", fsc->stats.neghits);
 	printf("    misses:     %d\n", fsc->stats.misses);
-	printf("    toolong:    %d\n", fsc->stats.toolong);
 	printf("    entered:    %d\n", fsc->stats.entered);
-	printf("    tossed:     %d\n", fsc->stats.tossed);
+	printf("    negentered: %d\n", fsc->stats.negentered);
+	printf("    evictions:  %d\n", fsc->stats.evictions);
 	printf("    removed:    %d\n", fsc->stats.removed);
 	printf("    purges:     %d\n", fsc->stats.purges);
-	printf("    purged:     %d\n", fsc->stats.purged);
 	printf("    renames:    %d\n", fsc->stats.renames);
 	printf("    renamed:    %d\n", fsc->stats.renamed_files);
 #endif
@@ -159,10 +342,6 @@ fsn_cache_enter(struct fsnimpl *fsnimpl, oskit_dir_t *dir,
 		oskit_file_t *file, char *name, int len, nameinfo_t *nameip)
 {
 	struct fs_cache	        *fsc = &(fsnimpl->fs_cache);
-	namecache_t		*ncp;
-	unsigned int		hash = 0;
-	char			*cp;
-	int			i;
 	oskit_dir_t		*isdir;
 	oskit_u32_t		flags = 0;
 	oskit_error_t		rc;
@@ -216,98 +395,39 @@ fsn_cache_enter(struct fsnimpl *fsnimpl, oskit_dir_t *dir,
 	 */
 	nameip->flags = flags;
 	nameip->file  = file;		/* To be consistent with lookup */
-	
-	/*
-	 * Forget about names that are too long. Waste of space.
-	 */
-	if (len > MAX_CNAMELEN) {
-		FSSTAT(fsc->stats.toolong++);
+
+	if (!cache_insert(fsc, dir, file, name, len, flags)) {
 		/*
 		 * Release extra reference from above.
 		 */
 		oskit_file_release(file);
-		DPRINTF("Name too long (max=%d, is %d):  %s\n",
-			MAX_CNAMELEN, len, name);
 		return;
 	}
 
-	/*
-	 * The hash value munges the component name with the address of
-	 * the containing directory.
-	 */
-	for (cp = name, i = 0; i < len; i++, cp++)
-		hash += (unsigned char) *cp;
-	hash = hash ^ (unsigned int) dir;
-
-	/*
-	 * Grab an entry. If passed the maximum, grab the lru entry and
-	 * use that (after releasing its stuff).
-	 */
-	if (fsc->count > MAX_ENTRIES) {
-		queue_remove_first(&fsc->lru, ncp, namecache_t *, lruchain);
-
-		DPRINTF("Toss: %p %p %s\n", ncp, ncp->dir, ncp->name);
-
-		if (ncp->dir) {
-			queue_remove(&fsc->hash[ncp->hash & (NHEADERS - 1)],
-				     ncp, namecache_t *, hashchain);
-
-			oskit_dir_release(ncp->dir);
-			oskit_file_release(ncp->file);
-
-			/*
-			 * A entry is considered tossed only when its a 
-			 * capacity miss (not purged or removed).
-			 */
-			if (ncp->len != (unsigned char) -1)
-				FSSTAT(fsc->stats.tossed++);
-		}
-	}
-	else {
-		if ((ncp = (namecache_t *) smalloc(sizeof(namecache_t)))
-		    == NULL) {
-			/*
-			 * Release extra reference from above. 
-			 */
-			oskit_file_release(file);
-			return;
-		}
-		memset((void *) ncp, 0, sizeof(namecache_t));
-		fsc->count++;
-	}
-
-	/*
-	 * Initialize entry and place it in its bucket. Note that we must add
-	 * a references to the dir object. The file object had a reference
-	 * added above.
-	 */
-	ncp->hash   = hash;
-	ncp->dir    = dir;
-	ncp->file   = file;
-	ncp->len    = len;
-	ncp->flags  = flags;
-	memcpy(ncp->name, name, len);
-#ifdef  VERBOSE
-	ncp->name[len] = '\0';
-#endif
-	oskit_dir_addref(dir);
-
-	/*
-	 * Link into the hash chain.
-	 */
-	queue_enter(&fsc->hash[hash & (NHEADERS - 1)],
-		    ncp, namecache_t *, hashchain);
+	FSSTAT(fsc->stats.entered++);
+	DPRINTF("New:  %p %p %s\n", dir, file, name);
+}
 
-	/*
-	 * New entries go on the LRU chain
-	 */
-	queue_enter(&fsc->lru, ncp, namecache_t *, lruchain);
+/*
+ * Remember that a name does not exist in a directory.
+ *
+ * NOTE: The caller is responsible for locking!
+ */
+void
+fsn_cache_enter_negative(struct fsnimpl *fsnimpl, oskit_dir_t *dir,
+			 char *name, int len)
+{
+	struct fs_cache	*fsc = &(fsnimpl->fs_cache);
 
-	FSSTAT(fsc->stats.entered++);
-	DPRINTF("New:  %p %p %p %s\n", ncp, dir, file, ncp->name);
+	if (cache_insert(fsc, dir, 0, name, len, NAMEINFO_NEGATIVE))
+		FSSTAT(fsc->stats.negentered++);
 }
 
 /*
+ * Returns 1 if the name was found in the cache, with the results in
+ * *nameip. For a negative entry, the file is null and the flags say
+ * NAMEINFO_NEGATIVE.
+ *
  * NOTE: The caller is responsible for locking!
  */
 oskit_error_t
@@ -315,45 +435,16 @@ fsn_cache_lookup(struct fsnimpl *fsnimpl,
 		 oskit_dir_t *dir, char *name, int len, nameinfo_t *nameip)
 {
 	struct fs_cache *fsc = &(fsnimpl->fs_cache);
-	namecache_t	*ncp;
-	unsigned int	hash = 0;
-	char		*cp;
-	int		i;
+	namecache_t	*ncp, *old;
 
 	FSSTAT(fsc->stats.lookups++);
 
-	/*
-	 * Forget about names that are too long. Waste of space.
-	 */
-	if (len > MAX_CNAMELEN) {
-		FSSTAT(fsc->stats.toolong++);
-		nameip->flags = NULL;
-		nameip->file  = NULL;
+	ncp = cache_find(fsc, dir, name, len, cache_hash(dir, name, len));
+	if (!ncp) {
+		FSSTAT(fsc->stats.misses++);
 		return 0;
 	}
 
-	/*
-	 * The hash value munges the component name with the address of
-	 * the containing directory.
-	 */
-	for (cp = name, i = 0; i < len; i++, cp++)
-		hash += (unsigned char) *cp;
-	hash = hash ^ (unsigned int) dir;
-
-	/*
-	 * Iterate through the hash chain. Compare both the name and
-	 * the dir object.
-	 */
-	queue_iterate(&fsc->hash[hash & (NHEADERS - 1)],
-		      ncp, namecache_t *, hashchain) {
-		if (ncp->dir == dir && ncp->len == len &&
-		    memcmp(ncp->name, name, len) == 0)
-			goto found;
-	}
-	FSSTAT(fsc->stats.misses++);
-	return 0;
-
- found:
 	DPRINTF("%p %p %s\n", ncp, dir, ncp->name);
 
 	/*
@@ -361,20 +452,41 @@ fsn_cache_lookup(struct fsnimpl *fsnimpl,
 	 */
 	nameip->flags = ncp->flags;
 	nameip->file  = ncp->file;
-	oskit_file_addref(ncp->file);
+	if (ncp->file) {
+		oskit_file_addref(ncp->file);
+		FSSTAT(fsc->stats.hits++);
+	}
+	else
+		FSSTAT(fsc->stats.neghits++);
 		
 	/*
-	 * Move to head of LRU chain.
+	 * Move to the end of the active list. If that makes the active
+	 * list too long, the oldest active entry goes back to the
+	 * inactive list.
 	 */
-	queue_remove(&fsc->lru, ncp, namecache_t *, lruchain);
-	queue_enter(&fsc->lru, ncp, namecache_t *, lruchain);
+	if (ncp->active) {
+		queue_remove(&fsc->active, ncp, namecache_t *, lruchain);
+	}
+	else {
+		queue_remove(&fsc->inactive, ncp, namecache_t *, lruchain);
+		ncp->active = 1;
+		fsc->nactive++;
+	}
+	queue_enter(&fsc->active, ncp, namecache_t *, lruchain);
+
+	if (fsc->nactive > fsc->count / 2) {
+		queue_remove_first(&fsc->active, old, namecache_t *, lruchain);
+		old->active = 0;
+		fsc->nactive--;
+		queue_enter(&fsc->inactive, old, namecache_t *, lruchain);
+	}
 
 	return 1;
 }
 
 /*
  * Find and remove a particular entry from the cache. Used when a file is
- * unlinked.
+ * unlinked, and when a name is created (to get rid of a negative entry).
  *
  * NOTE: The caller is responsible for locking!
  */
@@ -384,66 +496,24 @@ fsn_cache_remove(struct fsnimpl *fsnimpl,
 {
 	struct fs_cache *fsc = &(fsnimpl->fs_cache);
 	namecache_t	*ncp;
-	int		len;
-	unsigned int	hash = 0;
-	char		*cp;
-
-	len  = strlen(name);
+	int		len = strlen(name);
 
-	/*
-	 * Forget about names that are too long. Waste of space.
-	 */
-	if (len > MAX_CNAMELEN) {
-		FSSTAT(fsc->stats.toolong++);
+	ncp = cache_find(fsc, dir, name, len, cache_hash(dir, name, len));
+	if (!ncp)
 		return;
-	}
-
-	/*
-	 * The hash value munges the component name with the address of
-	 * the containing directory.
-	 */
-	for (cp = (char *) name; *cp != 0; cp++)
-		hash += (unsigned char) *cp;
-	hash = hash ^ (unsigned int) dir;
 
-	/*
-	 * Iterate through the hash chain. Compare both the name and
-	 * the dir object.
-	 */
-	queue_iterate(&fsc->hash[hash & (NHEADERS - 1)],
-		      ncp, namecache_t *, hashchain) {
-		if (ncp->dir == dir && ncp->len == len &&
-		    strcmp(ncp->name, name) == 0)
-			goto found;
-	}
-	return;
-
- found:
 	DPRINTF("%p %p %s\n", ncp, dir, name);
 	FSSTAT(fsc->stats.removed++);
-
-	oskit_file_release(ncp->file);
-	oskit_dir_release(ncp->dir);
-
-	/*
-	 * Leave the entry on the LRU list. It will eventually fall to the
-	 * bottom and get reused. Clear the dir/file entries to indicate
-	 * that they have been released already, and that the entry is no
-	 * longer on the hash chain.
-	 */
-	ncp->dir    = 0;
-	ncp->file   = 0;
-	
-	queue_remove(&fsc->hash[hash & (NHEADERS - 1)],
-		     ncp, namecache_t *, hashchain);
+	cache_free(fsc, ncp);
 }
 
 /*
  * Purge the cache of all entries when a directory is either renamed or
  * removed.  We do not release the entries (like remove above) since that
  * would penalize the caller (for the time to flush the entire cache).
- * Rather, force subsequent matches to fail, which spreads the cost of
- * releasing every entry among all the callers.
+ * Rather, bump the generation number so that subsequent matches fail.
+ * Stale entries are freed as lookups run across them, or as they fall
+ * off the LRU lists, which spreads the cost among all the callers.
  *
  * NOTE: The caller is responsible for locking!
  */
@@ -451,23 +521,11 @@ void
 fsn_cache_purge(struct fsnimpl *fsnimpl)
 {
 	struct fs_cache	*fsc = &(fsnimpl->fs_cache);
-	namecache_t	*ncp;
 
 	DPRINTF("\n");
 	FSSTAT(fsc->stats.purges++);
 
-	/*
-	 * Iterate through the LRU list (which contains every entry).
-	 */
-	queue_iterate(&fsc->lru, ncp, namecache_t *, lruchain) {
-		/*
-		 * Force match to fail.
-		 */
-		if (ncp->len != (unsigned char) -1) {
-			ncp->len = -1;
-			FSSTAT(fsc->stats.purged++);
-		}
-	}
+	fsc->generation++;
 }
 
 void
@@ -478,9 +536,7 @@ fsn_cache_rename(struct fsnimpl *fsnimpl,
 	oskit_error_t	rc;
 	oskit_file_t	*file;
 	oskit_dir_t	*isdir;
-#ifdef FSCACHE_STATS
 	struct fs_cache *fsc = &(fsnimpl->fs_cache);
-#endif
 
 	DPRINTF("%p %s, %p %s\n", olddir, oldname, newdir, newname);
 	FSSTAT(fsc->stats.renames++);
@@ -522,19 +578,59 @@ void
 fsn_cache_delete(struct fsnimpl *fsnimpl,
 		 oskit_dir_t *dir, const char *name, int len)
 {
-	char		namecopy[MAX_CNAMELEN + 1];
+	struct fs_cache *fsc = &(fsnimpl->fs_cache);
+	namecache_t	*ncp;
 
-	/*
-	 * Forget about names that are too long. Waste of space.
-	 */
-	if (len > MAX_CNAMELEN)
-		return;
+	FSCACHE_LOCK(fsnimpl);
+	ncp = cache_find(fsc, dir, name, len, cache_hash(dir, name, len));
+	if (ncp) {
+		FSSTAT(fsc->stats.removed++);
+		cache_free(fsc, ncp);
+	}
+	FSCACHE_UNLOCK(fsnimpl);
+}
+
+/*
+ * Called by the directory wrapper when a name is created, to get rid
+ * of any negative entry for it.
+ *
+ * NOTE: The caller is *NOT* responsible for locking!
+ */
+void
+fsn_cache_invalidate(struct fsnimpl *fsnimpl,
+		     oskit_dir_t *dir, const char *name)
+{
+	FSCACHE_LOCK(fsnimpl);
+	fsn_cache_remove(fsnimpl, dir, name);
+	FSCACHE_UNLOCK(fsnimpl);
+}
+
+/*
+ * Change the memory budget, throwing out entries to get under it.
+ */
+void
+fsn_cache_setsize(struct fsnimpl *fsnimpl, oskit_size_t bytes)
+{
+	struct fs_cache *fsc = &(fsnimpl->fs_cache);
+
+	FSCACHE_LOCK(fsnimpl);
+	fsc->budget = bytes;
+	while (fsc->count && fsc->bytes > fsc->budget)
+		cache_evict(fsc);
+	FSCACHE_UNLOCK(fsnimpl);
+}
+
+void
+fsn_cache_getstats(struct fsnimpl *fsnimpl,
+		   struct oskit_fsnamespace_cache_stats *stats)
+{
+	struct fs_cache *fsc = &(fsnimpl->fs_cache);
 
-	memcpy(namecopy, name, len);
-	namecopy[len] = NULL;
-	
 	FSCACHE_LOCK(fsnimpl);
-	fsn_cache_remove(fsnimpl, dir, (const char *) namecopy);
+	*stats = fsc->stats;
+	stats->entries = fsc->count;
+	stats->bytes   = fsc->bytes;
+	stats->budget  = fsc->budget;
 	FSCACHE_UNLOCK(fsnimpl);
 }
 #endif /* FSCACHE */
@@ -21,6 +21,7 @@
 #include <oskit/fs/file.h>
 #include <oskit/fs/dir.h>
 #include <oskit/queue.h>
+#include <oskit/fs/fsnamespace.h>
 
 /*
  * This turns on the FS cache.
@@ -28,15 +29,22 @@
 #define FSCACHE
 
 /*
- * Turn this on if you want some stats.
+ * Turn this on if you want the stats printed when the cache is cleaned up.
+ * They are always kept; see oskit_fsnamespace_cache_stats.
  */
 #undef FSCACHE_STATS
 
 /*
- * Number of hash chain headers.
+ * Initial number of hash chain headers. The table doubles as the cache
+ * fills up.
  */
 #define NHEADERS		128	/* Must be a power of two! */
 
+/*
+ * Default memory budget for cache entries, in bytes.
+ */
+#define FSCACHE_DEFAULT_BUDGET	(128 * 1024)
+
 /*
  * This structure is returned from fs_cache_lookup and enter.
  */
@@ -47,6 +55,7 @@ typedef struct {
 #define NAMEINFO_DIRECTORY	0x01
 #define NAMEINFO_MOUNTPOINT	0x02
 #define NAMEINFO_SYMLINK	0x04
+#define NAMEINFO_NEGATIVE	0x08	/* Name does not exist; file is null */
 
 #ifdef THREAD_SAFE
 #include <oskit/threads/pthread.h>
@@ -64,37 +73,31 @@ typedef struct {
 #define FSCACHE_UNLOCK(f)
 #endif
 
-#ifdef  FSCACHE_STATS
-struct fscache_stats {
-	oskit_u32_t	lookups;
-	oskit_u32_t	misses;
-	oskit_u32_t	toolong;
-	oskit_u32_t	entered;
-	oskit_u32_t	tossed;
-	oskit_u32_t	removed;
-	oskit_u32_t	purges;
-	oskit_u32_t	purged;
-	oskit_u32_t	renames;
-	oskit_u32_t	renamed_files;
-};
 #define FSSTAT(x) (x)
-#else
-#define FSSTAT(x)
-#endif
 
 /*
- * Okay, this is the structure that goes into the fsimpl
+ * Okay, this is the structure that goes into the fsimpl.
+ *
+ * Entries live on one of two LRU lists. New entries go on the inactive
+ * list, and move to the active list if they are hit again. Entries are
+ * reclaimed from the inactive list first, and the active list is kept
+ * to no more than half the entries, so a one-time scan of a big tree
+ * cannot flush the names that are used all the time.
  */
 struct fs_cache {
-	queue_head_t		hash[NHEADERS]; /* Hash chain headers */
-	queue_head_t		lru;		/* LRU list for replacement */
+	queue_head_t	       *hash;		/* Hash chain headers */
+	int			nheaders;	/* Number of them */
+	queue_head_t		active;		/* Entries hit more than once */
+	queue_head_t		inactive;	/* Everything else */
 	int			count;		/* Number of entries */
+	int			nactive;	/* Entries on the active list */
+	oskit_size_t		bytes;		/* Memory used by entries */
+	oskit_size_t		budget;		/* Limit on the above */
+	unsigned int		generation;	/* Bumped by a purge */
 #ifdef  THREAD_SAFE
 	pthread_mutex_t		mutex;
 #endif
-#ifdef  FSCACHE_STATS
-	struct fscache_stats    stats;
-#endif
+	struct oskit_fsnamespace_cache_stats stats;
 };
 
 struct fsnimpl;
@@ -110,6 +113,13 @@ void		fsn_cache_remove(struct fsnimpl *,
 void		fsn_cache_delete(struct fsnimpl *,
 				oskit_dir_t *dir, const char *name, int len);
 void		fsn_cache_purge(struct fsnimpl *);
+void		fsn_cache_enter_negative(struct fsnimpl *, oskit_dir_t *,
+				char *, int);
+void		fsn_cache_invalidate(struct fsnimpl *,
+				oskit_dir_t *dir, const char *name);
+void		fsn_cache_setsize(struct fsnimpl *, oskit_size_t);
+void		fsn_cache_getstats(struct fsnimpl *,
+				struct oskit_fsnamespace_cache_stats *);
 void		fsn_cache_rename(struct fsnimpl *,
 				oskit_dir_t *, const char *,
 				oskit_dir_t *, const char *);
@@ -161,8 +161,17 @@ fsn_lookup(struct fsobj *fs,
 #endif
 #ifdef  FSCACHE
 		FSCACHE_LOCK(fsnimpl);
-		if (!(cached =
-		      fsn_cache_lookup(fsnimpl, dir, comp, s-comp, &nameinfo)))
+		if ((cached =
+		     fsn_cache_lookup(fsnimpl, dir, comp, s-comp, &nameinfo)) &&
+		    (nameinfo.flags & NAMEINFO_NEGATIVE)) {
+			oskit_dir_release(dir);
+			FSCACHE_UNLOCK(fsnimpl);
+#if VERBOSITY > 2
+			printf(__FUNCTION__" = nope: cached ENOENT.\n");
+#endif
+			return OSKIT_ENOENT;
+		}
+		if (!cached)
 #endif
 		{
 			savechar = *s;
@@ -170,6 +179,16 @@ fsn_lookup(struct fsobj *fs,
 			rc = oskit_dir_lookup(dir, comp, &file);
 			*s = savechar;
 			if (rc) {
+#ifdef  FSCACHE
+				/*
+				 * Remember that it is not there, unless
+				 * the caller is about to create it.
+				 */
+				if (rc == OSKIT_ENOENT &&
+				    (*s || !(flags & FSLOOKUP_NOCACHE)))
+					fsn_cache_enter_negative(fsnimpl, dir,
+							comp, s - comp);
+#endif
 				oskit_dir_release(dir);
 				FSCACHE_UNLOCK(fsnimpl);
 #if VERBOSITY > 2
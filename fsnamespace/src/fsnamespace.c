@@ -385,3 +385,37 @@ oskit_create_fsnamespace(struct oskit_dir *rootdir,
 	return 0;
 }
 
+/*
+ * Name cache controls. These are not part of the COM interface, since
+ * they only make sense for this implementation of it.
+ */
+oskit_error_t
+oskit_fsnamespace_cache_setsize(oskit_fsnamespace_t *f, oskit_size_t bytes)
+{
+	struct fsobj	*fs = (struct fsobj *) f;
+
+	if (!fs || fs->fsni.ops != &fsnamespace_ops)
+		return OSKIT_E_INVALIDARG;
+#ifdef  FSCACHE
+	fsn_cache_setsize(fs->fsnimpl, bytes);
+	return 0;
+#else
+	return OSKIT_E_NOTIMPL;
+#endif
+}
+
+oskit_error_t
+oskit_fsnamespace_cache_stats(oskit_fsnamespace_t *f,
+			      struct oskit_fsnamespace_cache_stats *out_stats)
+{
+	struct fsobj	*fs = (struct fsobj *) f;
+
+	if (!fs || fs->fsni.ops != &fsnamespace_ops || !out_stats)
+		return OSKIT_E_INVALIDARG;
+#ifdef  FSCACHE
+	fsn_cache_getstats(fs->fsnimpl, out_stats);
+	return 0;
+#else
+	return OSKIT_E_NOTIMPL;
+#endif
+}
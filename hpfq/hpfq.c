@@ -78,7 +78,8 @@ sched_release(pfq_sched_t *_)
 		return p->p_count;
 
 	oskit_pqueue_release(p->p_virtq);
-	oskit_netio_release(p->p_link);
+	if (p->p_link)				/* only the root has one */
+		oskit_netio_release(p->p_link);
 	free(p);
 
 	return 0;
@@ -127,6 +127,24 @@ netio_push(oskit_netio_t *_, oskit_bufio_t *b, oskit_size_t size)
 	return 0;
 }
 
+/*
+ * Queue a batch of packets, one at a time.
+ */
+static OSKIT_COMDECL
+netio_push_batch(oskit_netio_t *io, oskit_bufio_t **bufs, oskit_size_t *sizes,
+		 unsigned count)
+{
+	oskit_error_t rc, err = 0;
+	unsigned i;
+
+	for (i = 0; i < count; i++) {
+		rc = netio_push(io, bufs[i], sizes[i]);
+		if (rc && !err)
+			err = rc;
+	}
+	return err;
+}
+
 /*
  * Unimplemented bufio allocator
  */
@@ -142,7 +160,8 @@ static struct oskit_netio_ops leaf_netio = {
 	netio_addref,
 	netio_release,
 	netio_push,
-	netio_alloc_bufio
+	netio_alloc_bufio,
+	netio_push_batch
 };
 
 
@@ -18,15 +18,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include "local.h"
 
 int fclose(FILE *stream)
 {
-	close(fileno(stream));
-	if ((stream != stdin) &&
-	    (stream != stdout) &&
-	    (stream != stderr))
-		free(stream);
+	int rc;
 
-	return 0;
-}
+	flockfile(stream);
+	rc = __sflush(stream);
+	if (close(fileno(stream)) < 0)
+		rc = EOF;
+	if (stream->_flags & __SMBF)
+		free(stream->_bf._base);
+	stream->_bf._base = stream->_p = NULL;
+	stream->_bf._size = 0;
+	stream->_flags = 0;		/* release the FILE */
+	funlockfile(stream);
 
+	return rc;
+}
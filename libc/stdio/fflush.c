@@ -15,26 +15,55 @@
  * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
  */
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #include <errno.h>
 #include <fd.h>
+#include "local.h"
 
 /*
  * fflush
  *
- * Since the oskit stdio doesn't buffer at all, we just return 
- * success.  We do try and check for bogus stream pointers though.
+ * Write out whatever the stream has buffered; a NULL stream means
+ * all of them.  We do try and check for bogus stream pointers though.
  */
 int
 fflush(FILE *stream) 
 {
-	/* NULL isn't really an error, since it means that we're 
-	 * supposed to flush all streams.  So just return success.
-	 */
+	int rc;
+
 	if (stream == NULL)
-		return 0;
+		return _fwalk(__sflush);
 
 	if (fd_check_stream(fileno(stream)))
 		return EOF;
 
+	flockfile(stream);
+	rc = __sflush(stream);
+	funlockfile(stream);
+	return rc;
+}
+
+/*
+ * Write the buffer out.  On an error, whatever did not get written
+ * stays at the front of the buffer.
+ */
+int
+__sflush(FILE *fp)
+{
+	unsigned char *p = fp->_bf._base;
+	int n = fp->_p - p, rc;
+
+	while (n > 0) {
+		if ((rc = write(fp->_file, p, n)) <= 0) {
+			memmove(fp->_bf._base, p, n);
+			fp->_p = fp->_bf._base + n;
+			fp->_flags |= __SERR;
+			return EOF;
+		}
+		p += rc;
+		n -= rc;
+	}
+	fp->_p = fp->_bf._base;
 	return 0;
 }
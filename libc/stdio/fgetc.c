@@ -17,11 +17,17 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include "local.h"
 
 int fgetc(FILE *stream)
 {
 	unsigned char c;
-	int rc = read(fileno(stream), &c, 1);
+	int rc;
+
+	if (__sbuffered(stream))
+		fflush(stream);
+
+	rc = read(fileno(stream), &c, 1);
 
 	switch (rc) {
 	case 1:
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include "local.h"
 
 char *
 fgets(char *str, int size, FILE *stream)
@@ -33,7 +34,12 @@ fgets(char *str, int size, FILE *stream)
 	 * discipline stuff for us.
 	 */
 	if (stream == stdin) {
-		int rc = read(fileno(stream), str, size);
+		int rc;
+
+		/* Let a prompt written to stdout show first. */
+		if (__sbuffered(stdout))
+			fflush(stdout);
+		rc = read(fileno(stream), str, size);
 		if (rc > 0)
 			return str;
 		if (rc < 0)
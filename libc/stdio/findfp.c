@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ * 
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ * 
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Find a free FILE for fopen, and walk the open ones for fflush(NULL)
+ * and exit.  A FILE is free when its flags are zero.  The three
+ * standard streams and a few more are static; after that FILEs are
+ * malloc'd in blocks, which are never given back.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "local.h"
+
+#define	NSTATIC		10		/* FILEs before we need malloc */
+#define	NDYNAMIC	10		/* FILEs per malloc'd block */
+
+struct glue {
+	struct glue	*next;
+	int		niobs;
+	FILE		*iobs;
+};
+
+static FILE		usual[NSTATIC];
+static struct glue	uglue = { 0, NSTATIC, usual };
+static struct glue	sglue = { &uglue, 3, __sF };
+
+static struct glue *
+moreglue(int n)
+{
+	struct glue	*g;
+
+	if ((g = malloc(sizeof(*g) + n * sizeof(FILE))) == NULL)
+		return NULL;
+	g->next = NULL;
+	g->niobs = n;
+	g->iobs = (FILE *) (g + 1);
+	memset(g->iobs, 0, n * sizeof(FILE));
+	return g;
+}
+
+/*
+ * Returns a cleared FILE with its descriptor set to -1,
+ * or NULL if there is no memory for another one.
+ */
+FILE *
+__sfp(void)
+{
+	struct glue	*g;
+	FILE		*fp;
+	int		n;
+
+	for (g = &sglue; ; g = g->next) {
+		for (fp = g->iobs, n = g->niobs; n > 0; fp++, n--)
+			if (fp->_flags == 0)
+				goto found;
+		if (g->next == NULL && (g->next = moreglue(NDYNAMIC)) == NULL)
+			return NULL;
+	}
+ found:
+	memset(fp, 0, sizeof(*fp));
+	fp->_flags = 1;		/* reserve this slot; caller sets real flags */
+	fp->_file = -1;
+	return fp;
+}
+
+/*
+ * Call function on every open stream, locked, and OR together
+ * the results.
+ */
+int
+_fwalk(int (*function)(FILE *))
+{
+	struct glue	*g;
+	FILE		*fp;
+	int		n, ret = 0;
+
+	for (g = &sglue; g != NULL; g = g->next)
+		for (fp = g->iobs, n = g->niobs; n > 0; fp++, n--)
+			if (fp->_flags != 0) {
+				flockfile(fp);
+				ret |= (*function)(fp);
+				funlockfile(fp);
+			}
+	return ret;
+}
+
+/*
+ * Write out everything that is buffered.  exit calls this.
+ */
+void
+_cleanup(void)
+{
+	_fwalk(__sflush);
+}
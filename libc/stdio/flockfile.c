@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ * 
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ * 
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Stream locking for the Minimal C library.  This is not a threaded
+ * library (see mem_lock.c), so by default these do nothing.  An
+ * environment that shares streams between threads, or writes to them
+ * from interrupt handlers, can supply its own versions; since these are
+ * in a file of their own, the ones it links in are used instead. All
+ * the stdio routines hold the lock while they touch a stream's buffer,
+ * so that is all it takes to make them thread safe.
+ */
+
+#include <stdio.h>
+
+void
+flockfile(FILE *fp)
+{
+}
+
+void
+funlockfile(FILE *fp)
+{
+}
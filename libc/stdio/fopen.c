@@ -20,11 +20,12 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include "local.h"
 
 FILE *
 fopen(const char *name, const char *mode)
 {
-	int base_mode = O_RDONLY, flags = 0;
+	int base_mode = O_RDONLY, flags = 0, sflags = __SRD;
 	FILE *stream;
 
 	/* Find the appropriate Unix mode flags.  */
@@ -33,20 +34,24 @@ fopen(const char *name, const char *mode)
 		case 'w':
 			base_mode = O_WRONLY;
 			flags |= O_CREAT | O_TRUNC;
+			sflags = __SWR;
 			break;
 		case 'a':
 			base_mode = O_WRONLY;
 			flags |= O_CREAT | O_APPEND;
+			sflags = __SWR;
 			break;
 	}
 	while (*mode)
 	{
-		if (*mode == '+')
+		if (*mode == '+') {
 			base_mode = O_RDWR;
+			sflags = __SRW;
+		}
 		mode++;
 	}
 
-	if (!(stream = malloc(sizeof(*stream))))
+	if (!(stream = __sfp()))
 	{
 		errno = ENOMEM;
 		return 0;
@@ -54,11 +59,10 @@ fopen(const char *name, const char *mode)
 
 	if ((stream->_file = open(name, base_mode | flags)) < 0)
 	{
-		free(stream);
+		stream->_flags = 0;
 		return 0;
 	}
 
-	stream->_flags &= ~(__SEOF|__SERR);
+	stream->_flags = sflags;
 	return stream;
 }
-
@@ -16,16 +16,25 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
+#include "local.h"
 
 int fputc(int c, FILE *stream)
 {
-	char ch = c;
+	unsigned char ch = c;
+	int rc = 0;
 
-	int rc = write(fileno(stream), &ch, 1);
+	flockfile(stream);
+	/*
+	 * Fast path: room in the buffer with some to spare,
+	 * and no newline to flush on.
+	 */
+	if (stream->_bf._base != NULL &&
+	    stream->_p < stream->_bf._base + stream->_bf._size - 1 &&
+	    !(ch == '\n' && (stream->_flags & __SLBF)))
+		*stream->_p++ = ch;
+	else
+		rc = __swrite(stream, (const char *) &ch, 1);
+	funlockfile(stream);
 
-	if (rc < 0)
-		stream->_flags |= __SERR;
-	return rc;
+	return (rc == 0 ? ch : EOF);
 }
-
@@ -16,19 +16,17 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
 #include <string.h>
+#include "local.h"
 
 int
 fputs(const char *str, FILE *stream)
 {
-        int rc = write(fileno(stream), str, strlen(str));
+	int len = strlen(str), rc;
 
-	if (rc < 0) {
-		stream->_flags |= __SERR;
-		return EOF;
-	}
+	flockfile(stream);
+	rc = __swrite(stream, str, len);
+	funlockfile(stream);
 
-	return rc;
+	return (rc == 0 ? len : EOF);
 }
-
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include "local.h"
 
 int fread(void *buf, int size, int count, FILE *stream)
 {
@@ -25,6 +26,9 @@ int fread(void *buf, int size, int count, FILE *stream)
 	if ((total = size * count) == 0)
 		return 0;
 
+	if (__sbuffered(stream))
+		fflush(stream);
+
 	total = read(fileno(stream), buf, total);
 
 	if (total == 0)
@@ -17,10 +17,16 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include "local.h"
 
 int fseek(FILE *stream, long offset, int whence)
 {
-	oskit_off_t off = lseek(fileno(stream), offset, whence);
+	oskit_off_t off;
+
+	if (__sbuffered(stream))
+		fflush(stream);
+
+	off = lseek(fileno(stream), offset, whence);
 	
 	if (off < 0)
 		stream->_flags |= __SERR;
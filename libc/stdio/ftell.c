@@ -17,9 +17,13 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include "local.h"
 
 long ftell(FILE *stream)
 {
+	if (__sbuffered(stream))
+		fflush(stream);
+
 	return lseek(fileno(stream), 0, SEEK_CUR);
 }
 
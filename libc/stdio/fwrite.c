@@ -16,20 +16,62 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include "local.h"
 
 int fwrite(void *buf, int size, int count, FILE *stream)
 {
-	int total;
+	int total, rc;
 
 	if ((total = size * count) == 0)
 		return 0;
 
-	total = write(fileno(stream), buf, total);
+	flockfile(stream);
+	rc = __swrite(stream, buf, total);
+	funlockfile(stream);
 
-	if (total < 0)
-		stream->_flags |= __SERR;
-
-	return (total > 0 ? total/size : 0);
+	return (rc == 0 ? count : 0);
 }
 
+/*
+ * Buffered write of len bytes.  Returns 0, or EOF on an error.
+ */
+int
+__swrite(FILE *fp, const char *buf, int len)
+{
+	const char *p = buf;
+	int resid = len, space, n;
+
+	if (fp->_bf._base == NULL && !(fp->_flags & __SNBF))
+		__smakebuf(fp);
+
+	while (resid > 0) {
+		space = fp->_bf._size - (fp->_p - fp->_bf._base);
+
+		if ((fp->_flags & __SNBF) ||
+		    (space == fp->_bf._size && resid >= space)) {
+			/*
+			 * Unbuffered, or at least a buffer's worth with
+			 * nothing buffered: no point copying it.
+			 */
+			if ((n = write(fp->_file, p, resid)) <= 0) {
+				fp->_flags |= __SERR;
+				return EOF;
+			}
+		}
+		else {
+			n = resid < space ? resid : space;
+			memcpy(fp->_p, p, n);
+			fp->_p += n;
+			if (n == space && __sflush(fp))
+				return EOF;
+		}
+		p += n;
+		resid -= n;
+	}
+
+	if ((fp->_flags & __SLBF) && memchr(buf, '\n', len))
+		return __sflush(fp);
+	return 0;
+}
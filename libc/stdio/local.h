@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ * 
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ * 
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Internals shared by the buffered stdio routines.  The functions
+ * beginning with __s expect the caller to hold the stream lock.
+ */
+#ifndef __STDIO_LOCAL_H_INCLUDED__
+#define __STDIO_LOCAL_H_INCLUDED__
+
+FILE	*__sfp(void);
+int	_fwalk(int (*function)(FILE *));
+void	_cleanup(void);
+void	__smakebuf(FILE *fp);
+int	__sflush(FILE *fp);
+int	__swrite(FILE *fp, const char *buf, int len);
+
+/* Called by exit; set once any stream has a buffer. */
+extern void (*__cleanup)(void);
+
+/*
+ * True if there is output sitting in the buffer.
+ */
+#define __sbuffered(fp)	((fp)->_p > (fp)->_bf._base)
+
+#endif /* __STDIO_LOCAL_H_INCLUDED__ */
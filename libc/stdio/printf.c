@@ -46,7 +46,12 @@
 #include <oskit/console.h>
 #include "doprnt.h"
 
-/* This version of printf is implemented in terms of putchar and puts.  */
+/*
+ * This version of printf goes straight to the console, not through
+ * stdout, so it works before there are any file descriptors and from
+ * anywhere in the kernel.  Output is collected a line at a time and
+ * handed to console_putbytes in one go.
+ */
 
 #define	PRINTF_BUFMAX	128
 
@@ -58,10 +63,6 @@ struct printf_state {
 static void
 flush(struct printf_state *state)
 {
-	/*
-	 * It would be nice to call write(1,) here, but if fd_set_console
-	 * has not been called, it will break.
-	 */
 	console_putbytes((const char *) state->buf, state->index);
 
 	state->index = 0;
@@ -74,22 +75,9 @@ printf_char(arg, c)
 {
 	struct printf_state *state = (struct printf_state *) arg;
 
-	if (c == '\n')
-	{
-		state->buf[state->index] = 0;
-		puts(state->buf);
-		state->index = 0;
-	}
-	else if ((c == 0) || (state->index >= PRINTF_BUFMAX))
-	{
+	state->buf[state->index++] = c;
+	if (c == '\n' || state->index >= PRINTF_BUFMAX)
 		flush(state);
-		putchar(c);
-	}
-	else
-	{
-		state->buf[state->index] = c;
-		state->index++;
-	}
 }
 
 /*
@@ -16,20 +16,13 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <oskit/console.h>
 
-/* Simple puts() implementation that just uses putchar().
-   Note that our printf() is implemented
-   in terms of only puts() and putchar(), so that's all we need.
-   The only reason the caller might want to replace this function
-   is if putchar() has extremely high overhead for some reason.  */
+/* Like printf, puts goes straight to the console, not through stdout.  */
 int puts(const char *s)
 {
-	while (*s)
-	{
-		putchar(*s);
-		s++;
-	}
-	putchar('\n');
+	console_putbytes(s, strlen(s));
+	console_putchar('\n');
 	return 0;
 }
-
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ * 
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ * 
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "local.h"
+
+/*
+ * Change the buffering of a stream.  Anything already buffered is
+ * written out first.  If buf is NULL a buffer of the given size, or
+ * BUFSIZ, is allocated here.
+ */
+int
+setvbuf(FILE *fp, char *buf, int mode, int size)
+{
+	int	ret = 0;
+
+	if (mode != _IONBF && mode != _IOLBF && mode != _IOFBF)
+		return EOF;
+
+	flockfile(fp);
+	__sflush(fp);
+	if (fp->_flags & __SMBF)
+		free(fp->_bf._base);
+	fp->_flags &= ~(__SLBF|__SNBF|__SMBF);
+	fp->_bf._base = fp->_p = NULL;
+	fp->_bf._size = 0;
+
+	if (mode == _IONBF)
+		fp->_flags |= __SNBF;
+	else {
+		if (size <= 0)
+			size = BUFSIZ;
+		if (buf == NULL) {
+			if ((buf = malloc(size)) == NULL) {
+				fp->_flags |= __SNBF;
+				ret = EOF;
+				goto out;
+			}
+			fp->_flags |= __SMBF;
+		}
+		fp->_bf._base = fp->_p = (unsigned char *) buf;
+		fp->_bf._size = size;
+		if (mode == _IOLBF)
+			fp->_flags |= __SLBF;
+		__cleanup = _cleanup;
+	}
+ out:
+	funlockfile(fp);
+	return ret;
+}
+
+void
+setbuf(FILE *fp, char *buf)
+{
+	setvbuf(fp, buf, buf ? _IOFBF : _IONBF, BUFSIZ);
+}
+
+int
+setlinebuf(FILE *fp)
+{
+	return setvbuf(fp, NULL, _IOLBF, 0);
+}
@@ -36,7 +36,8 @@
 
 /*
  * This file defines stdin, stdout, and stderr in a manner similar
- * to the FreeBSD C library. 
+ * to the FreeBSD C library.  stdout is line buffered and stderr is
+ * unbuffered; both get to the console through file descriptors.
  */
 
 #include <unistd.h>
@@ -47,7 +48,7 @@
 /*	 p r w flags file _bf z  cookie close read seek  write */
 
 FILE __sF[3] = {
-	std(0, STDIN_FILENO),	/* stdin */
-	std(0, STDOUT_FILENO),	/* stdout */
-	std(0, STDERR_FILENO)	/* stderr */
+	std(__SRD, STDIN_FILENO),		/* stdin */
+	std(__SWR|__SLBF, STDOUT_FILENO),	/* stdout */
+	std(__SWR|__SNBF, STDERR_FILENO)	/* stderr */
 };
@@ -16,9 +16,9 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
 #include <stdarg.h>
 #include "doprnt.h"
+#include "local.h"
 
 #define	PRINTF_BUFMAX	128
 
@@ -26,6 +26,7 @@ struct printf_state {
 	FILE *stream;
 	char buf[PRINTF_BUFMAX];
 	unsigned int index;
+	int error;
 };
 
 
@@ -34,7 +35,10 @@ flush(struct printf_state *state)
 {
 	if (state->index > 0)
 	{
-		write(fileno(state->stream), state->buf, state->index);
+		flockfile(state->stream);
+		if (__swrite(state->stream, state->buf, state->index))
+			state->error = 1;
+		funlockfile(state->stream);
 		state->index = 0;
 	}
 }
@@ -60,10 +64,11 @@ int vfprintf(FILE *stream, const char *fmt, va_list args)
 
 	state.stream = stream;
 	state.index = 0;
+	state.error = 0;
 	_doprnt(fmt, args, 0, (void (*)())dochar, (char *) &state);
 
 	flush(&state);
 
-	return 0;
+	return (state.error ? EOF : 0);
 }
 
@@ -28,8 +28,13 @@
 
 void _run_atexits(void);
 
+/* Set by stdio once it has buffers to flush. */
+void (*__cleanup)(void);
+
 void exit(int code)
 {
     _run_atexits();
+    if (__cleanup)
+	(*__cleanup)();
     _exit(code);
 }
@@ -66,11 +66,16 @@ static OSKIT_COMDECL linux_net_alloc_bufio(oskit_netio_t *ioi,
 					   oskit_size_t size,
 					   oskit_bufio_t **out_bufio);
 
+static OSKIT_COMDECL linux_net_push_batch(oskit_netio_t *ioi,
+					  oskit_bufio_t **bufs,
+					  oskit_size_t *sizes,
+					  unsigned count);
+
 /*** Network send I/O interface ***/
 
 static struct oskit_netio_ops net_io_ops = {
 	linux_net_query, linux_net_addref, linux_net_release,
-	linux_net_push, linux_net_alloc_bufio
+	linux_net_push, linux_net_alloc_bufio, linux_net_push_batch
 };
 
 
@@ -306,6 +311,24 @@ linux_net_alloc_bufio(oskit_netio_t *io, oskit_size_t size,
 	return 0;
 }
 
+/*
+ * Send a batch of packets, one at a time.
+ */
+static OSKIT_COMDECL
+linux_net_push_batch(oskit_netio_t *ioi, oskit_bufio_t **bufs,
+		     oskit_size_t *sizes, unsigned count)
+{
+	oskit_error_t rc, err = 0;
+	unsigned i;
+
+	for (i = 0; i < count; i++) {
+		rc = linux_net_push(ioi, bufs[i], sizes[i]);
+		if (rc && !err)
+			err = rc;
+	}
+	return err;
+}
+
 
 /*** Network device node interface methods ***/
 /*
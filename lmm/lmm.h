@@ -28,6 +28,33 @@ struct lmm_node
 #define ALIGN_SIZE	sizeof(struct lmm_node)
 #define ALIGN_MASK	(ALIGN_SIZE - 1)
 
+/*
+ * Free block header used in indexed regions (see lmm_index.c).
+ * The free blocks are kept in a treap ordered by address,
+ * with each node also recording the largest free block in its subtree.
+ */
+struct lmm_inode
+{
+	struct lmm_inode *left, *right;
+	oskit_size_t size;
+	oskit_size_t max;
+};
+
+#define IALIGN_SIZE	sizeof(struct lmm_inode)
+#define IALIGN_MASK	(IALIGN_SIZE - 1)
+
+#define INDEXED(reg)	((reg)->flags & LMMF_INDEXED)
+#define ROOT(reg)	(*(struct lmm_inode **)&(reg)->nodes)
+
+void *lmm_index_alloc(struct lmm_region *reg, oskit_size_t size,
+		      int align_bits, oskit_addr_t align_ofs,
+		      oskit_addr_t in_min, oskit_addr_t in_max);
+void lmm_index_free(struct lmm_region *reg, void *block, oskit_size_t size);
+int lmm_index_find_free(struct lmm_region *reg, oskit_addr_t start_addr,
+			oskit_addr_t *out_addr, oskit_size_t *out_size);
+void lmm_index_walk(struct lmm_region *reg,
+		    void (*func)(struct lmm_inode *node, void *arg), void *arg);
+
 #define CHECKREGPTR(p)	{ \
 	assert((reg->nodes == 0 && reg->free == 0) \
 	       || (oskit_addr_t)reg->nodes >= reg->min); \
@@ -57,6 +57,16 @@ void lmm_add_free(lmm_t *lmm, void *block, oskit_size_t size)
 				new_max = reg->max;
 			assert(new_max > new_min);
 
+			/* Indexed regions have a coarser granularity.  */
+			if (INDEXED(reg))
+			{
+				new_min = (new_min + IALIGN_MASK)
+					  & ~IALIGN_MASK;
+				new_max &= ~IALIGN_MASK;
+				if (new_max <= new_min)
+					continue;
+			}
+
 			/* Add the block.  */
 			lmm_free(lmm, (void*)new_min, new_max - new_min);
 		}
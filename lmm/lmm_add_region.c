@@ -26,8 +26,16 @@ void lmm_add_region(lmm_t *lmm, lmm_region_t *reg,
 	struct lmm_region **rp, *r;
 
 	/* Align the start and end addresses appropriately.  */
-	min = (min + ALIGN_MASK) & ~ALIGN_MASK;
-	max &= ~ALIGN_MASK;
+	if (flags & LMMF_INDEXED)
+	{
+		min = (min + IALIGN_MASK) & ~IALIGN_MASK;
+		max &= ~IALIGN_MASK;
+	}
+	else
+	{
+		min = (min + ALIGN_MASK) & ~ALIGN_MASK;
+		max &= ~ALIGN_MASK;
+	}
 
 	/* If there's not enough memory to do anything with,
 	   then just drop the region on the floor.
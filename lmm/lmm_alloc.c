@@ -35,6 +35,16 @@ void *lmm_alloc(lmm_t *lmm, oskit_size_t size, lmm_flags_t flags)
 		if (flags & ~reg->flags)
 			continue;
 
+		if (INDEXED(reg))
+		{
+			void *block = lmm_index_alloc(reg, size, 0, 0,
+						      (oskit_addr_t)0,
+						      (oskit_addr_t)-1);
+			if (block)
+				return block;
+			continue;
+		}
+
 		for (nodep = &reg->nodes;
 		     (node = *nodep) != 0;
 		     nodep = &node->next)
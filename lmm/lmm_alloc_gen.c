@@ -44,6 +44,16 @@ void *lmm_alloc_gen(lmm_t *lmm, oskit_size_t size, lmm_flags_t flags,
 		    || (reg->max <= in_min))
 			continue;
 
+		if (INDEXED(reg))
+		{
+			void *block = lmm_index_alloc(reg, size,
+						      align_bits, align_ofs,
+						      in_min, in_max);
+			if (block)
+				return block;
+			continue;
+		}
+
 		for (nodep = &reg->nodes;
 		     (node = *nodep) != 0;
 		     nodep = &node->next)
@@ -27,6 +27,33 @@
 
 #include "lmm.h"
 
+struct dump_state
+{
+	struct lmm_region *reg;
+	struct lmm_inode *prev;
+	oskit_size_t free_check;
+};
+
+static void dump_inode(struct lmm_inode *node, void *arg)
+{
+	struct dump_state *ds = arg;
+
+	printf("  node %p-%08x size=%08x max=%08x\n",
+		node, (oskit_addr_t)node + node->size, node->size, node->max);
+
+	assert(((oskit_addr_t)node & IALIGN_MASK) == 0);
+	assert((node->size & IALIGN_MASK) == 0);
+	assert(node->size >= sizeof(*node));
+	assert(node->max >= node->size);
+	assert((ds->prev == 0) ||
+	       ((oskit_addr_t)ds->prev + ds->prev->size
+		< (oskit_addr_t)node));
+	assert((oskit_addr_t)node < ds->reg->max);
+
+	ds->prev = node;
+	ds->free_check += node->size;
+}
+
 void lmm_dump(lmm_t *lmm)
 {
 	struct lmm_region *reg;
@@ -44,6 +71,16 @@ void lmm_dump(lmm_t *lmm)
 
 		CHECKREGPTR(reg);
 
+		if (INDEXED(reg))
+		{
+			struct dump_state ds = { reg, 0, 0 };
+
+			lmm_index_walk(reg, dump_inode, &ds);
+			printf(" free_check=%08x\n", ds.free_check);
+			assert(reg->free == ds.free_check);
+			continue;
+		}
+
 		free_check = 0;
 		for (node = reg->nodes; node; node = node->next)
 		{
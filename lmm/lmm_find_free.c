@@ -35,6 +35,21 @@ void lmm_find_free(lmm_t *lmm, oskit_addr_t *inout_addr,
 		    || (reg->min > lowest_addr))
 			continue;
 
+		if (INDEXED(reg))
+		{
+			oskit_addr_t addr;
+			oskit_size_t size;
+
+			if (lmm_index_find_free(reg, start_addr, &addr, &size)
+			    && addr < lowest_addr)
+			{
+				lowest_addr = addr;
+				lowest_size = size;
+				lowest_flags = reg->flags;
+			}
+			continue;
+		}
+
 		for (node = reg->nodes; node; node = node->next)
 		{
 			assert((oskit_addr_t)node >= reg->min);
@@ -28,9 +28,6 @@ void lmm_free(lmm_t *lmm, void *block, oskit_size_t size)
 	assert(block != 0);
 	assert(size > 0);
 
-	size = (((oskit_addr_t)block & ALIGN_MASK) + size + ALIGN_MASK)
-		& ~ALIGN_MASK;
-
 	/* First find the region to add this block to.  */
 	for (reg = lmm->regions; ; reg = reg->next)
 	{
@@ -42,6 +39,15 @@ void lmm_free(lmm_t *lmm, void *block, oskit_size_t size)
 			break;
 	}
 
+	if (INDEXED(reg))
+	{
+		lmm_index_free(reg, block, size);
+		return;
+	}
+
+	size = (((oskit_addr_t)block & ALIGN_MASK) + size + ALIGN_MASK)
+		& ~ALIGN_MASK;
+
 	/* Record the newly freed space in the region's free space counter.  */
 	reg->free += size;
 	assert(reg->free <= reg->max - reg->min);
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Free block management for indexed (LMMF_INDEXED) regions.
+ *
+ * The free blocks of the region are kept in a treap ordered by address.
+ * Node priorities are a hash of the node address, so no extra space is
+ * needed to store them. Every node also records the size of the largest
+ * free block in its subtree, which lets an allocation skip whole subtrees
+ * that can't possibly satisfy it. The search still returns the lowest
+ * addressed block that fits, so allocation behaves exactly as it does
+ * in a list-based region; it just gets there in O(log n) steps in the
+ * common case. Freeing finds the neighbors to coalesce with in O(log n).
+ */
+
+#include "lmm.h"
+
+/*
+ * Knuth's multiplicative hash; good enough to keep the treap balanced
+ * even though free block addresses are anything but random.
+ */
+#define PRIO(n)	((oskit_u32_t)((oskit_addr_t)(n) / IALIGN_SIZE) * 2654435761U)
+
+static inline void
+fixup(struct lmm_inode *n)
+{
+	n->max = n->size;
+	if (n->left && n->left->max > n->max)
+		n->max = n->left->max;
+	if (n->right && n->right->max > n->max)
+		n->max = n->right->max;
+}
+
+/*
+ * Split a tree into the nodes below addr and those at or above it.
+ */
+static void
+split(struct lmm_inode *t, oskit_addr_t addr,
+      struct lmm_inode **lp, struct lmm_inode **rp)
+{
+	if (t == 0) {
+		*lp = *rp = 0;
+		return;
+	}
+	if ((oskit_addr_t)t < addr) {
+		split(t->right, addr, &t->right, rp);
+		*lp = t;
+	}
+	else {
+		split(t->left, addr, lp, &t->left);
+		*rp = t;
+	}
+	fixup(t);
+}
+
+/*
+ * Join two trees, where every node in l is below every node in r.
+ */
+static struct lmm_inode *
+merge(struct lmm_inode *l, struct lmm_inode *r)
+{
+	if (l == 0)
+		return r;
+	if (r == 0)
+		return l;
+
+	if (PRIO(l) > PRIO(r)) {
+		l->right = merge(l->right, r);
+		fixup(l);
+		return l;
+	}
+	else {
+		r->left = merge(l, r->left);
+		fixup(r);
+		return r;
+	}
+}
+
+static void
+insert(struct lmm_region *reg, struct lmm_inode *node, oskit_size_t size)
+{
+	struct lmm_inode *l, *r;
+
+	assert(((oskit_addr_t)node & IALIGN_MASK) == 0);
+	assert((size & IALIGN_MASK) == 0);
+	assert(size > 0);
+
+	node->left = node->right = 0;
+	node->size = size;
+	fixup(node);
+
+	split(ROOT(reg), (oskit_addr_t)node, &l, &r);
+	ROOT(reg) = merge(merge(l, node), r);
+}
+
+static void
+delete(struct lmm_region *reg, struct lmm_inode *node)
+{
+	struct lmm_inode *l, *m, *r;
+
+	split(ROOT(reg), (oskit_addr_t)node, &l, &r);
+	split(r, (oskit_addr_t)node + IALIGN_SIZE, &m, &r);
+	assert(m == node);
+	ROOT(reg) = merge(l, r);
+}
+
+/*
+ * Find the lowest addressed free block in the subtree
+ * that can hold the requested allocation.
+ * Returns the address to allocate at in *out_addr.
+ * Sets *stop if the range constraint was exceeded,
+ * in which case no higher addressed block will do either.
+ */
+static struct lmm_inode *
+find(struct lmm_inode *t, oskit_size_t size,
+     int align_bits, oskit_addr_t align_ofs,
+     oskit_addr_t in_min, oskit_addr_t in_max,
+     oskit_addr_t *out_addr, int *stop)
+{
+	struct lmm_inode *node;
+	oskit_addr_t addr;
+	int i;
+
+	if (t == 0 || t->max < size)
+		return 0;
+
+	/* Blocks in the left subtree all end at or below this one's start,
+	   so they are of no use if this node doesn't start above in_min.  */
+	if ((oskit_addr_t)t > in_min) {
+		node = find(t->left, size, align_bits, align_ofs,
+			    in_min, in_max, out_addr, stop);
+		if (node || *stop)
+			return node;
+	}
+
+	if (t->size >= size) {
+		addr = (oskit_addr_t)t;
+		if (addr < in_min)
+			addr = in_min;
+		for (i = 0; i < align_bits; i++) {
+			oskit_addr_t bit = (oskit_addr_t)1 << i;
+			if ((addr ^ align_ofs) & bit)
+				addr += bit;
+		}
+
+		if ((addr - (oskit_addr_t)t + size) <= t->size) {
+			if (addr + size > in_max) {
+				*stop = 1;
+				return 0;
+			}
+			*out_addr = addr;
+			return t;
+		}
+	}
+
+	return find(t->right, size, align_bits, align_ofs,
+		    in_min, in_max, out_addr, stop);
+}
+
+void *lmm_index_alloc(struct lmm_region *reg, oskit_size_t size,
+		      int align_bits, oskit_addr_t align_ofs,
+		      oskit_addr_t in_min, oskit_addr_t in_max)
+{
+	struct lmm_inode *node, *anode;
+	oskit_addr_t addr, end;
+	oskit_size_t nsize;
+	int stop = 0;
+
+	node = find(ROOT(reg), size, align_bits, align_ofs,
+		    in_min, in_max, &addr, &stop);
+	if (node == 0)
+		return 0;
+
+	/* Carve the (aligned-out) allocation out of the node,
+	   and put back whatever is left on either side of it.  */
+	anode = (struct lmm_inode *)(addr & ~IALIGN_MASK);
+	end = (addr + size + IALIGN_MASK) & ~IALIGN_MASK;
+	nsize = node->size;
+	assert(anode >= node);
+	assert(end <= (oskit_addr_t)node + nsize);
+
+	delete(reg, node);
+	if (anode > node)
+		insert(reg, node, (oskit_addr_t)anode - (oskit_addr_t)node);
+	if (end < (oskit_addr_t)node + nsize)
+		insert(reg, (struct lmm_inode *)end,
+		       (oskit_addr_t)node + nsize - end);
+
+	assert(reg->free >= end - (oskit_addr_t)anode);
+	reg->free -= end - (oskit_addr_t)anode;
+
+	return (void *)addr;
+}
+
+void lmm_index_free(struct lmm_region *reg, void *block, oskit_size_t size)
+{
+	struct lmm_inode *node = (struct lmm_inode *)
+				 ((oskit_addr_t)block & ~IALIGN_MASK);
+	struct lmm_inode *t, *prevnode = 0, *nextnode = 0;
+
+	size = (((oskit_addr_t)block & IALIGN_MASK) + size + IALIGN_MASK)
+		& ~IALIGN_MASK;
+
+	reg->free += size;
+	assert(reg->free <= reg->max - reg->min);
+
+	/* Find the free blocks on either side of the new one.  */
+	for (t = ROOT(reg); t; ) {
+		assert(t != node);
+		if (t < node) {
+			prevnode = t;
+			t = t->right;
+		}
+		else {
+			nextnode = t;
+			t = t->left;
+		}
+	}
+
+	/* Coalesce with them if they are adjacent.  */
+	if (prevnode &&
+	    (oskit_addr_t)prevnode + prevnode->size >= (oskit_addr_t)node) {
+		assert((oskit_addr_t)prevnode + prevnode->size
+		       == (oskit_addr_t)node);
+		delete(reg, prevnode);
+		size += prevnode->size;
+		node = prevnode;
+	}
+	if (nextnode &&
+	    (oskit_addr_t)node + size >= (oskit_addr_t)nextnode) {
+		assert((oskit_addr_t)node + size == (oskit_addr_t)nextnode);
+		delete(reg, nextnode);
+		size += nextnode->size;
+	}
+
+	insert(reg, node, size);
+}
+
+int lmm_index_find_free(struct lmm_region *reg, oskit_addr_t start_addr,
+			oskit_addr_t *out_addr, oskit_size_t *out_size)
+{
+	struct lmm_inode *t, *found = 0;
+
+	/* Find the lowest block that ends above start_addr.  */
+	for (t = ROOT(reg); t; ) {
+		if ((oskit_addr_t)t + t->size > start_addr) {
+			found = t;
+			t = t->left;
+		}
+		else
+			t = t->right;
+	}
+	if (found == 0)
+		return 0;
+
+	if ((oskit_addr_t)found > start_addr) {
+		*out_addr = (oskit_addr_t)found;
+		*out_size = found->size;
+	}
+	else {
+		*out_addr = start_addr;
+		*out_size = found->size - (start_addr - (oskit_addr_t)found);
+	}
+	return 1;
+}
+
+static void
+walk(struct lmm_inode *t, void (*func)(struct lmm_inode *node, void *arg),
+     void *arg)
+{
+	if (t == 0)
+		return;
+	walk(t->left, func, arg);
+	func(t, arg);
+	walk(t->right, func, arg);
+}
+
+void lmm_index_walk(struct lmm_region *reg,
+		    void (*func)(struct lmm_inode *node, void *arg), void *arg)
+{
+	walk(ROOT(reg), func, arg);
+}
@@ -27,6 +27,11 @@
 
 #include "lmm.h"
 
+static void count_inode(struct lmm_inode *node, void *arg)
+{
+	(*(unsigned int *)arg)++;
+}
+
 void lmm_stats(lmm_t *lmm)
 {
 	struct lmm_region *reg;
@@ -42,6 +47,13 @@ void lmm_stats(lmm_t *lmm)
 
 		regions++;
 
+		if (INDEXED(reg))
+		{
+			lmm_index_walk(reg, count_inode, &nodes);
+			memfree += reg->free;
+			continue;
+		}
+
 		free_check = 0;
 		for (node = reg->nodes; node; node = node->next)
 		{
@@ -91,19 +91,31 @@ struct memfs {
 	char *name;		/* name of this file */
 	oskit_size_t namelen;	/* bytes in name, not including terminator */
         struct memfs *next, **prevp; /* siblings in directory */
+	struct memfs *hnext;	/* next in directory's hash chain */
+	oskit_u32_t hash;	/* hash of name */
+	oskit_u32_t cookie;	/* getdirentries offset in directory */
 
 	union {
 		struct {
 			oskit_bufio_t bufioi;
 			oskit_size_t size;	/* file size */
-			void *data;		/* file data */
+			void **pages;		/* page table, null for holes */
+			oskit_size_t npages;	/* slots in page table */
+			void *data;		/* contiguous data, if any */
 			oskit_size_t allocsize;	/* bytes smalloc'd */
 			oskit_bool_t can_sfree;	/* data is smalloc'd */
 			oskit_bool_t inhibit_resize; /* disallow resizing */
 		} file;
 		struct {
 			oskit_dir_t *parent; /* .. directory, null for self */
-			struct memfs *contents; /* files in this directory */
+			struct memfs *contents; /* files, oldest first */
+			struct memfs **tailp;	/* end of contents list */
+			oskit_u32_t count;	/* files in contents */
+			oskit_u32_t nextcookie;	/* cookie for next file */
+			struct memfs **hash;	/* name index, if big enough */
+			oskit_u32_t hashsize;	/* buckets in hash */
+			struct memfs *cursor;	/* first file at cursor_ofs */
+			oskit_u32_t cursor_ofs;	/* 0 if cursor is not valid */
 		} dir;
 	} data;
 };
@@ -144,6 +156,8 @@ static struct oskit_bufio_ops memfs_bufio_ops;
 
 static OSKIT_COMDECL_U memfsfilesystem_release(oskit_filesystem_t *b0);
 static void            memfs_file_release_internal(struct memfs *b);
+static void            memfs_free_data(struct memfs *b);
+static void            memfs_free_index(struct memfs *dir);
 
 static OSKIT_COMDECL
 memfs_dir_query(oskit_dir_t *b0, const oskit_iid_t *iid, void **out_ihandle)
@@ -215,12 +229,9 @@ memfs_file_free(struct memfs *b)
 	if ((void *)b->filei.ops == &memfs_dir_ops) {
 		if (b->data.dir.parent)
 			memfs_file_release_internal((struct memfs*)b->data.dir.parent);
-
-	} else {
-		if (b->data.file.can_sfree)
-			osenv_mem_free(b->fsys, b->data.file.data, OSENV_NONBLOCKING,
-				       b->data.file.allocsize);
-	}
+		memfs_free_index(b);
+	} else
+		memfs_free_data(b);
 	osenv_mem_free(fsys, b, OSENV_NONBLOCKING, sizeof *b);
 }
 
@@ -293,9 +304,19 @@ memfs_file_allocate(struct memfs_fsys *fs,
 			} else
 				new->data.dir.parent = NULL;
 			new->data.dir.contents = NULL;
+			new->data.dir.tailp = &new->data.dir.contents;
+			new->data.dir.count = 0;
+			new->data.dir.nextcookie = 1;
+			new->data.dir.hash = NULL;
+			new->data.dir.hashsize = 0;
+			new->data.dir.cursor = NULL;
+			new->data.dir.cursor_ofs = 0;
 		} else {
 			new->data.file.bufioi.ops = &memfs_bufio_ops;
 			new->data.file.size = 0;
+			new->data.file.pages = NULL;
+			new->data.file.npages = 0;
+			new->data.file.data = NULL;
 			new->data.file.allocsize = 0;
 			new->data.file.can_sfree = 0;
 			new->data.file.inhibit_resize = 0;
@@ -333,54 +354,296 @@ memfsdir_stat(oskit_dir_t *f, struct oskit_stat *st)
 	return 0;
 }
 
+/*
+ * File data.
+ *
+ * A file's data is normally kept in a table of pages, indexed by page
+ * number. Pages that have never been written are left out of the table
+ * (null), and read as zeros, so files can have holes and growing a file
+ * costs nothing until the new part is written. The page table doubles
+ * when it fills up, so appending is cheap no matter how big the file
+ * gets. Any part of the last page beyond the end of the file is kept
+ * zeroed, so that a later extension reads zeros there too.
+ *
+ * A file can instead be given a contiguous buffer by
+ * oskit_memfs_file_set_contents (this is how boot modules are loaded
+ * without copying them). Such a file stays contiguous until it grows
+ * beyond the buffer, at which point its contents are copied into pages.
+ */
+#define PAGENO(ofs)	((oskit_size_t)(ofs) / PAGE_SIZE)
+#define PAGEOFS(ofs)	((oskit_size_t)(ofs) & (PAGE_SIZE - 1))
+#define MIN_PAGETABLE	16
+
+/*
+ * Make the page table big enough to hold page number pgno.
+ */
+static oskit_error_t
+memfs_pagetable_grow(struct memfs *b, oskit_size_t pgno)
+{
+	oskit_size_t npages = b->data.file.npages;
+	void **pages;
+
+	if (pgno < npages)
+		return 0;
+
+	npages = npages ? npages * 2 : MIN_PAGETABLE;
+	if (npages <= pgno)
+		npages = pgno + 1;
+
+	pages = osenv_mem_alloc(b->fsys, npages * sizeof(void *),
+				OSENV_NONBLOCKING, 0);
+	if (!pages)
+		return OSKIT_ENOSPC;
+
+	memset(pages, 0, npages * sizeof(void *));
+	if (b->data.file.pages) {
+		memcpy(pages, b->data.file.pages,
+		       b->data.file.npages * sizeof(void *));
+		osenv_mem_free(b->fsys, b->data.file.pages, OSENV_NONBLOCKING,
+			       b->data.file.npages * sizeof(void *));
+	}
+	b->data.file.pages = pages;
+	b->data.file.npages = npages;
+	return 0;
+}
+
+/*
+ * Return the page holding page number pgno, or null if it is a hole.
+ * If alloc is set, fill in the hole with a zeroed page.
+ */
+static char *
+memfs_page(struct memfs *b, oskit_size_t pgno, oskit_bool_t alloc)
+{
+	char *page;
+
+	if (pgno < b->data.file.npages && b->data.file.pages[pgno])
+		return b->data.file.pages[pgno];
+	if (!alloc)
+		return NULL;
+
+	if (memfs_pagetable_grow(b, pgno))
+		return NULL;
+	page = osenv_mem_alloc(b->fsys, PAGE_SIZE, OSENV_NONBLOCKING, PAGE_SIZE);
+	if (!page)
+		return NULL;
+	memset(page, 0, PAGE_SIZE);
+	b->data.file.pages[pgno] = page;
+	return page;
+}
+
+/*
+ * Free all pages from page number pgno on. The table itself goes
+ * too if it ends up empty.
+ */
+static void
+memfs_free_pages(struct memfs *b, oskit_size_t pgno)
+{
+	oskit_size_t i;
+
+	for (i = pgno; i < b->data.file.npages; i++) {
+		if (b->data.file.pages[i]) {
+			osenv_mem_free(b->fsys, b->data.file.pages[i],
+				       OSENV_NONBLOCKING, PAGE_SIZE);
+			b->data.file.pages[i] = NULL;
+		}
+	}
+	if (pgno == 0 && b->data.file.pages) {
+		osenv_mem_free(b->fsys, b->data.file.pages, OSENV_NONBLOCKING,
+			       b->data.file.npages * sizeof(void *));
+		b->data.file.pages = NULL;
+		b->data.file.npages = 0;
+	}
+}
+
+/*
+ * Free everything a file holds.
+ */
+static void
+memfs_free_data(struct memfs *b)
+{
+	if (b->data.file.data) {
+		if (b->data.file.can_sfree)
+			osenv_mem_free(b->fsys, b->data.file.data,
+				       OSENV_NONBLOCKING,
+				       b->data.file.allocsize);
+		b->data.file.data = NULL;
+		b->data.file.allocsize = 0;
+		b->data.file.can_sfree = 0;
+	}
+	memfs_free_pages(b, 0);
+}
+
+/*
+ * Move the contents of a contiguous file into pages.
+ */
+static oskit_error_t
+memfs_make_paged(struct memfs *b)
+{
+	oskit_size_t ofs, count;
+	char *page;
+
+	for (ofs = 0; ofs < b->data.file.size; ofs += PAGE_SIZE) {
+		count = b->data.file.size - ofs;
+		if (count > PAGE_SIZE)
+			count = PAGE_SIZE;
+		if ((page = memfs_page(b, PAGENO(ofs), 1)) == NULL) {
+			memfs_free_pages(b, 0);
+			return OSKIT_ENOSPC;
+		}
+		memcpy(page, (char *)b->data.file.data + ofs, count);
+	}
+
+	if (b->data.file.can_sfree)
+		osenv_mem_free(b->fsys, b->data.file.data, OSENV_NONBLOCKING,
+			       b->data.file.allocsize);
+	b->data.file.data = NULL;
+	b->data.file.allocsize = 0;
+	b->data.file.can_sfree = 0;
+	return 0;
+}
+
 static oskit_error_t
 memfs_resize(struct memfs *b, oskit_size_t size, oskit_bool_t override_inhibit)
 {
+	oskit_error_t rc;
+	char *page;
+
 	if (size < 0)
 		return OSKIT_EINVAL;
 	else if (size == b->data.file.size)
 		return 0;
 	else if (!override_inhibit && b->data.file.inhibit_resize)
 		return OSKIT_EPERM;
-	else if (size < b->data.file.allocsize) {
-		if (size > b->data.file.size)
+
+	if (size == 0) {
+		memfs_free_data(b);
+		b->data.file.size = 0;
+		return 0;
+	}
+
+	if (b->data.file.data) {
+		if (size <= b->data.file.allocsize) {
+			if (size > b->data.file.size)
 				/*
 				 * Zero-fill the new space.
 				 */
-			memset((char *)b->data.file.data +
-			       b->data.file.size, 0,
-			       size - b->data.file.size);
-		else if (size == 0 && b->data.file.can_sfree) {
-			osenv_mem_free(b->fsys, b->data.file.data, OSENV_NONBLOCKING,
-				       b->data.file.allocsize);
-			b->data.file.allocsize = 0;
-			b->data.file.can_sfree = 0;
+				memset((char *)b->data.file.data +
+				       b->data.file.size, 0,
+				       size - b->data.file.size);
+			b->data.file.size = size;
+			return 0;
 		}
-		b->data.file.size = size;
-	} else {
+		if ((rc = memfs_make_paged(b)) != 0)
+			return rc;
+	}
+
+	if (size < b->data.file.size) {
 		/*
-		 * Must grow the file.
+		 * Drop the pages past the new end, and clear the
+		 * rest of the new last page.
 		 */
-		char *new;
-		oskit_size_t newsize = round_page(size);
-		new = osenv_mem_alloc(b->fsys, newsize, OSENV_NONBLOCKING, PAGE_SIZE);
-		if (!new)
-			return OSKIT_ENOSPC;
-		else {
-			memcpy(new, b->data.file.data,
-			       b->data.file.size);
-			memset(new + b->data.file.size, 0,
-			       size - b->data.file.size);
-			if (b->data.file.can_sfree)
-				osenv_mem_free(b->fsys, b->data.file.data,
-					       OSENV_NONBLOCKING,
-					       b->data.file.allocsize);
-			b->data.file.allocsize = newsize;
-			b->data.file.can_sfree = 1;
-			b->data.file.size = size;
-			b->data.file.data = new;
-		}
+		memfs_free_pages(b, PAGENO(size + PAGE_SIZE - 1));
+		if (PAGEOFS(size) &&
+		    (page = memfs_page(b, PAGENO(size), 0)) != NULL)
+			memset(page + PAGEOFS(size), 0,
+			       PAGE_SIZE - PAGEOFS(size));
 	}
+
+	/*
+	 * Growing is free; the new part is a hole until written.
+	 */
+	b->data.file.size = size;
+	return 0;
+}
+
+/*
+ * Copy data out of a file. The range must be within the file.
+ */
+static void
+memfs_read_data(struct memfs *b, void *buf, oskit_size_t offset,
+		oskit_size_t amount)
+{
+	oskit_size_t count;
+	char *page;
+
+	if (b->data.file.data) {
+		memcpy(buf, (char *)b->data.file.data + offset, amount);
+		return;
+	}
+
+	while (amount) {
+		count = PAGE_SIZE - PAGEOFS(offset);
+		if (count > amount)
+			count = amount;
+		if ((page = memfs_page(b, PAGENO(offset), 0)) != NULL)
+			memcpy(buf, page + PAGEOFS(offset), count);
+		else
+			memset(buf, 0, count);
+		buf = (char *)buf + count;
+		offset += count;
+		amount -= count;
+	}
+}
+
+/*
+ * Copy data into a file. The file must already be big enough.
+ * Returns the number of bytes copied, which is less than asked
+ * for only if we ran out of memory.
+ */
+static oskit_size_t
+memfs_write_data(struct memfs *b, const void *buf, oskit_size_t offset,
+		 oskit_size_t amount)
+{
+	oskit_size_t count, done = 0;
+	char *page;
+
+	if (b->data.file.data) {
+		memcpy((char *)b->data.file.data + offset, buf, amount);
+		return amount;
+	}
+
+	while (done < amount) {
+		count = PAGE_SIZE - PAGEOFS(offset);
+		if (count > amount - done)
+			count = amount - done;
+		if ((page = memfs_page(b, PAGENO(offset), 1)) == NULL)
+			break;
+		memcpy(page + PAGEOFS(offset), buf, count);
+		buf = (const char *)buf + count;
+		offset += count;
+		done += count;
+	}
+	return done;
+}
+
+/*
+ * Move the contents of a paged file into one contiguous buffer, for
+ * callers that need to see the whole file at one address. The buffer
+ * is rounded up to a page so that the file can still grow into the
+ * last page without going back to pages.
+ */
+static oskit_error_t
+memfs_make_contiguous(struct memfs *b)
+{
+	oskit_size_t allocsize;
+	char *data;
+
+	if (b->data.file.data)
+		return 0;
+
+	allocsize = (b->data.file.size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	data = osenv_mem_alloc(b->fsys, allocsize, OSENV_NONBLOCKING,
+			       PAGE_SIZE);
+	if (!data)
+		return OSKIT_ENOSPC;
+
+	memfs_read_data(b, data, 0, b->data.file.size);
+	memset(data + b->data.file.size, 0, allocsize - b->data.file.size);
+	memfs_free_pages(b, 0);
+
+	b->data.file.data = data;
+	b->data.file.allocsize = allocsize;
+	b->data.file.can_sfree = 1;
 	return 0;
 }
 
@@ -463,17 +726,96 @@ memfsdir_open(oskit_dir_t *d, oskit_oflags_t flags,
 }
 
 
+/*
+ * Directories.
+ *
+ * The files in a directory are kept on a list, oldest first. Each one is
+ * given a cookie when it is linked in, in increasing order; that is what
+ * getdirentries uses as its offset, so a directory can be read a bit at a
+ * time while files come and go without anything being skipped or seen
+ * twice. The directory remembers where the last getdirentries left off,
+ * so reading it from start to end is linear.
+ *
+ * Once a directory has more than MEMFS_HASH_MIN files, it also gets a
+ * hash table on the names, which doubles whenever the number of files
+ * outgrows it. It is not shrunk again; big directories tend to stay big.
+ */
+#define MEMFS_HASH_MIN		32
+#define MEMFS_DIRENTS_MIN	64	/* entries per getdirentries call */
+
+static inline oskit_u32_t
+memfs_namehash(const char *name, oskit_size_t len)
+{
+	oskit_u32_t h = 2166136261U;
+
+	while (len--)
+		h = (h ^ (unsigned char)*name++) * 16777619U;
+	return h;
+}
+
+/*
+ * Build or grow the hash table to hold the directory's files,
+ * including any just linked onto the contents chain. If there is no
+ * memory for it, nothing changes and the caller has to keep using the
+ * table that is there (if any).
+ */
+static oskit_error_t
+memfs_grow_index(struct memfs *dir)
+{
+	oskit_u32_t i, size = dir->data.dir.hashsize;
+	struct memfs **hash, *b;
+
+	size = size ? size * 2 : MEMFS_HASH_MIN * 2;
+	hash = osenv_mem_alloc(dir->fsys, size * sizeof(*hash),
+			       OSENV_NONBLOCKING, 0);
+	if (!hash)
+		return OSKIT_ENOMEM;
+	for (i = 0; i < size; i++)
+		hash[i] = NULL;
+
+	for (b = dir->data.dir.contents; b; b = b->next) {
+		b->hnext = hash[b->hash & (size - 1)];
+		hash[b->hash & (size - 1)] = b;
+	}
+
+	memfs_free_index(dir);
+	dir->data.dir.hash = hash;
+	dir->data.dir.hashsize = size;
+	return 0;
+}
+
+static void
+memfs_free_index(struct memfs *dir)
+{
+	if (dir->data.dir.hash)
+		osenv_mem_free(dir->fsys, dir->data.dir.hash, OSENV_NONBLOCKING,
+			       dir->data.dir.hashsize * sizeof(struct memfs *));
+	dir->data.dir.hash = NULL;
+	dir->data.dir.hashsize = 0;
+}
+
 static oskit_file_t *
 memfs_lookup(struct memfs *dir, const char *name)
 {
 	struct memfs *b;
 	oskit_size_t len = strlen(name);
+	oskit_u32_t h;
 
 	if (len == 0 || (len == 1 && name[0] == '.'))
 		return &dir->filei;
 	if (len == 2 && name[0] == '.' && name[1] == '.')
 		return (oskit_file_t *)dir->data.dir.parent ?: &dir->filei;
 
+	if (dir->data.dir.hash) {
+		h = memfs_namehash(name, len);
+		for (b = dir->data.dir.hash[h & (dir->data.dir.hashsize - 1)];
+		     b; b = b->hnext)
+			if (b->hash == h && b->namelen == len &&
+			    memcmp(name, b->name, len) == 0)
+				return &b->filei;
+		return NULL;
+	}
+
 	for (b = dir->data.dir.contents; b; b = b->next)
 		if (b->namelen == len && memcmp(name, b->name, len) == 0)
 			return &b->filei;
@@ -507,16 +849,49 @@ memfsdir_lookup(oskit_dir_t *d, const char *name, oskit_file_t **out_file)
 }
 
 /*
- * Link B into DIR's contents chain.
+ * Link B onto the end of DIR's contents chain.
  */
-static inline void
+static void
 dir_contents_link(struct memfs *dir, struct memfs *b)
 {
-	b->next = dir->data.dir.contents;
-	b->prevp = &dir->data.dir.contents;
-	if (dir->data.dir.contents)
-		dir->data.dir.contents->prevp = &b->next;
-	dir->data.dir.contents = b;
+	oskit_u32_t h;
+
+	if (dir->data.dir.nextcookie == 0) {
+		/*
+		 * Cookies wrapped. Renumber; anyone in the middle of
+		 * reading the directory will start over.
+		 */
+		struct memfs *x;
+
+		dir->data.dir.nextcookie = 1;
+		for (x = dir->data.dir.contents; x; x = x->next)
+			x->cookie = dir->data.dir.nextcookie++;
+		dir->data.dir.cursor = NULL;
+		dir->data.dir.cursor_ofs = 0;
+	}
+	b->cookie = dir->data.dir.nextcookie++;
+
+	b->next = NULL;
+	b->prevp = dir->data.dir.tailp;
+	*dir->data.dir.tailp = b;
+	dir->data.dir.tailp = &b->next;
+	if (dir->data.dir.cursor_ofs && !dir->data.dir.cursor)
+		dir->data.dir.cursor = b;
+
+	b->hash = memfs_namehash(b->name, b->namelen);
+	if (++dir->data.dir.count > dir->data.dir.hashsize &&
+	    dir->data.dir.count > MEMFS_HASH_MIN &&
+	    memfs_grow_index(dir) == 0)
+		return;
+	if (dir->data.dir.hash) {
+		/*
+		 * The table is big enough, or could not be grown and
+		 * just gets longer chains.
+		 */
+		h = b->hash & (dir->data.dir.hashsize - 1);
+		b->hnext = dir->data.dir.hash[h];
+		dir->data.dir.hash[h] = b;
+	}
 }
 
 static OSKIT_COMDECL
@@ -574,11 +949,25 @@ memfsdir_link(oskit_dir_t *d, char *name, oskit_file_t *file)
 /*
  * Remove B from its containing directory's contents chain.
  */
-static inline void
-dir_contents_unlink(struct memfs *b)
+static void
+dir_contents_unlink(struct memfs *dir, struct memfs *b)
 {
+	struct memfs **hp;
+
+	if (dir->data.dir.hash) {
+		hp = &dir->data.dir.hash[b->hash & (dir->data.dir.hashsize - 1)];
+		while (*hp != b)
+			hp = &(*hp)->hnext;
+		*hp = b->hnext;
+	}
+	dir->data.dir.count--;
+
+	if (dir->data.dir.cursor == b)
+		dir->data.dir.cursor = b->next;
 	if (b->next)
 		b->next->prevp = b->prevp;
+	else
+		dir->data.dir.tailp = b->prevp;
 	*b->prevp = b->next;
 }
 
@@ -591,7 +980,7 @@ memfsdir_unlink(oskit_dir_t *d, const char *name)
 
 	b = (struct memfs *)memfs_lookup(dir, name);
 	if (b && b->filei.ops != (void *)&memfs_dir_ops) {
-		dir_contents_unlink(b);
+		dir_contents_unlink(dir, b);
 	}
 
 	if (!b)
@@ -669,7 +1058,7 @@ memfsdir_rmdir(oskit_dir_t *d, const char *name)
 	else if (b->data.dir.contents)
 		rc = OSKIT_ENOTEMPTY;
 	else {
-		dir_contents_unlink(b);
+		dir_contents_unlink(dir, b);
 		rc = 0;
 	}
 
@@ -695,8 +1084,8 @@ memfsdir_rmdir(oskit_dir_t *d, const char *name)
  * using the task allocator when they are no longer needed.
  */
 /*
- * Since nentries doesn't mean much, we'll just return everything
- * we have.
+ * The offset is the cookie of the next file to return. We return at
+ * least MEMFS_DIRENTS_MIN entries at a time, since readdir asks for one.
  */
 static OSKIT_COMDECL
 memfsdir_getdirentries(oskit_dir_t *d, oskit_u32_t *inout_ofs,
@@ -704,24 +1093,35 @@ memfsdir_getdirentries(oskit_dir_t *d, oskit_u32_t *inout_ofs,
 		      struct oskit_dirents **out_dirents)
 {
 	struct memfs *dir = (void *)d;
-	struct memfs *b;
+	struct memfs *b, *start;
 	struct internal_dirent *dirents;
 	int count = 0;
 	oskit_error_t rc;
 
+	if (nentries < MEMFS_DIRENTS_MIN)
+		nentries = MEMFS_DIRENTS_MIN;
+
 	/*
-	 * if inout_ofs is non-zero, we assume the caller wants more entries
-	 * but we've given all we have during the first call
+	 * Find where to start. Usually this is where the last call
+	 * left off, which we remember.
 	 */
-	if (*inout_ofs != 0) {
-		*out_dirents = NULL;
-		return 0;
-	}
+	if (*inout_ofs != 0 && *inout_ofs == dir->data.dir.cursor_ofs)
+		start = dir->data.dir.cursor;
+	else
+		for (start = dir->data.dir.contents;
+		     start && start->cookie < *inout_ofs; start = start->next)
+			;
 
-	/* count files */
-	for (b = dir->data.dir.contents; b; b = b->next)
+	for (b = start; b && count < nentries; b = b->next)
 		count++;
 
+	/*
+	 * Nothing left; tell the caller we are done.
+	 */
+	if (count == 0 && *inout_ofs != 0) {
+		*out_dirents = NULL;
+		return 0;
+	}
 
 	dirents = osenv_mem_alloc(dir->fsys, sizeof dirents[0] * count,
 				  OSENV_AUTO_SIZE | OSENV_NONBLOCKING,0);
@@ -740,8 +1140,8 @@ memfsdir_getdirentries(oskit_dir_t *d, oskit_u32_t *inout_ofs,
 		return rc;
 	}
 
-	for (b = dir->data.dir.contents; b; dirents++, b = b->next) {
-		oskit_size_t len = strlen(b->name) + 1;
+	for (b = start; count--; dirents++, b = b->next) {
+		oskit_size_t len = b->namelen + 1;
 #if VERBOSITY > 4
 		osenv_local_log(dir->fsys, OSENV_LOG_INFO, __FUNCTION__": content memfs `%s'\n", b->name);
 #endif
@@ -755,8 +1155,13 @@ memfsdir_getdirentries(oskit_dir_t *d, oskit_u32_t *inout_ofs,
 
 		dirents->ino = (oskit_ino_t) b;
 		dirents->namelen = len - 1;
+		*inout_ofs = b->cookie + 1;
 	}
-	*inout_ofs = 1;
+	if (*inout_ofs == 0)
+		*inout_ofs = dir->data.dir.nextcookie ?: 1;
+
+	dir->data.dir.cursor = b;
+	dir->data.dir.cursor_ofs = *inout_ofs;
 	return 0;
 }
 
@@ -792,10 +1197,11 @@ memfsdir_symlink(oskit_dir_t *d, char *link_name, char *dest_name)
 		else {
 			size_t len = strlen(dest_name);
 			rc = memfs_resize(b, len, 0);
+			if (!rc && memfs_write_data(b, dest_name, 0, len) != len)
+				rc = OSKIT_ENOSPC;
 			if (rc)
 				memfs_file_release_internal(b);
 			else {
-				memcpy(b->data.file.data, dest_name, len);
 				dir_contents_link(dir, b);
 #if VERBOSITY > 2
 				osenv_local_log(dir->fsys, OSENV_LOG_INFO,
@@ -900,13 +1306,9 @@ memfssym_readlink(oskit_file_t *f, void *buf, oskit_u32_t len,
 #endif
 	if (len > b->data.file.size)
 		len = b->data.file.size;
-	memcpy(buf, b->data.file.data, len);
+	memfs_read_data(b, buf, 0, len);
 
 	*out_actual = len;
-#if VERBOSITY > 2
-	osenv_local_log(b->fsys, OSENV_LOG_INFO,
-		  __FUNCTION__": readlink returns `%s'\n", b->data.file.data);
-#endif
 	return 0;
 }
 
@@ -989,12 +1391,9 @@ memfs_tree_free(struct memfs_fsys *fsys, struct memfs *b)
 			contents = contents->next;
 			memfs_tree_free(fsys,x);
 		}
-	} else {
-		if (b->data.file.can_sfree) {
-			osenv_mem_free(fsys, b->data.file.data, OSENV_NONBLOCKING,
-				       b->data.file.allocsize);
-		}
-	}
+		memfs_free_index(b);
+	} else
+		memfs_free_data(b);
 	osenv_mem_free(fsys, b, OSENV_NONBLOCKING, sizeof *b);
 }
 
@@ -1203,11 +1602,10 @@ afile_read(oskit_bufio_t *io, void *buf,
 			amount = file->data.file.size - offset;
 		DMARK(file->fsys);
 #if VERBOSITY > 20
-		osenv_local_log(file->fsys, OSENV_LOG_INFO, __FUNCTION__": copying %d from %p+%x to %p\n",
-		       amount, (char *)file->data.file.data, (int)offset,
-		       buf);
+		osenv_local_log(file->fsys, OSENV_LOG_INFO, __FUNCTION__": copying %d from %x to %p\n",
+		       amount, (int)offset, buf);
 #endif
-		memcpy(buf, (char *)file->data.file.data + offset, amount);
+		memfs_read_data(file, buf, offset, amount);
 		DMARK(file->fsys);
 		*out_actual = amount;
 		rc = 0;
@@ -1224,6 +1622,7 @@ afile_write(oskit_bufio_t *io, const void *buf,
 {
 	oskit_error_t rc;
 	struct memfs *file;
+	oskit_size_t oldsize;
 
 	if (!io || io->ops != &memfs_bufio_ops)
 		return OSKIT_E_INVALIDARG;
@@ -1233,18 +1632,29 @@ afile_write(oskit_bufio_t *io, const void *buf,
 	if (offset < 0)
 		return OSKIT_EINVAL;
 
-	if ((offset+amount) > file->data.file.size)
+	oldsize = file->data.file.size;
+	if ((offset+amount) > oldsize)
 		rc = memfs_resize(file, offset + amount, 0);
 	else
 		rc = 0;
 
 	if (!rc) {
 #if VERBOSITY > 20
-		osenv_local_log(file->fsys, OSENV_LOG_INFO, __FUNCTION__": copying %d from %p to %p+%x\n",
-		       amount, buf, (char *)file->data.file.data, (int)offset);
+		osenv_local_log(file->fsys, OSENV_LOG_INFO, __FUNCTION__": copying %d from %p to %x\n",
+		       amount, buf, (int)offset);
 #endif
-		memcpy((char *)file->data.file.data + offset, buf, amount);
-		*out_actual = amount;
+		*out_actual = memfs_write_data(file, buf, offset, amount);
+		if (*out_actual < amount) {
+			/*
+			 * Ran out of memory part way. Don't leave the
+			 * file bigger than what was actually written.
+			 */
+			if (oldsize < offset + *out_actual)
+				oldsize = offset + *out_actual;
+			memfs_resize(file, oldsize, 1);
+		}
+		if (*out_actual == 0 && amount)
+			rc = OSKIT_ENOSPC;
 	}
 
 	return rc;
@@ -1288,6 +1698,7 @@ afile_map(oskit_bufio_t *io, void **out_addr,
        oskit_off_t offset, oskit_size_t count)
 {
 	struct memfs *file;
+	char *page;
 
 	if (!io || io->ops != &memfs_bufio_ops || offset < 0)
 		return OSKIT_E_INVALIDARG;
@@ -1299,7 +1710,25 @@ afile_map(oskit_bufio_t *io, void **out_addr,
 	if (offset + count > file->data.file.size)
 		return OSKIT_E_INVALIDARG;
 
-	*out_addr = file->data.file.data + offset;
+	if (file->data.file.data) {
+		*out_addr = file->data.file.data + offset;
+		return 0;
+	}
+
+	/*
+	 * A range within one page can be mapped where it is. Anything
+	 * bigger needs the file in one piece.
+	 */
+	if (count > 0 && PAGENO(offset) != PAGENO(offset + count - 1)) {
+		if (memfs_make_contiguous(file))
+			return OSKIT_ENOSPC;
+		*out_addr = file->data.file.data + offset;
+		return 0;
+	}
+	if ((page = memfs_page(file, PAGENO(offset), 1)) == NULL)
+		return OSKIT_ENOSPC;
+
+	*out_addr = page + PAGEOFS(offset);
 	return 0;
 }
 
@@ -1450,14 +1879,11 @@ oskit_memfs_file_set_contents(oskit_file_t *file,
 			     oskit_bool_t inhibit_resize)
 {
 	struct memfs *b = (void *)file;
-	oskit_error_t rc;
 
 	if (file->ops != &memfs_file_ops || size > allocsize)
 		return OSKIT_EINVAL;
 
-	rc = memfs_resize(b, 0, 1);
-	if (rc)
-		return rc;
+	memfs_free_data(b);
 
 	b->data.file.data = data;
 	b->data.file.size = size;
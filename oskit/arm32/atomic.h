@@ -111,4 +111,26 @@ atomic_dec_and_test(volatile atomic_t *v)
 	return result;
 }
 
+/*
+ * If the value is old, make it new.  Return true if it was swapped.
+ */
+OSKIT_INLINE int
+atomic_cmpxchg(volatile atomic_t *v, oskit_s32_t old, oskit_s32_t new)
+{
+	int	result;
+	int	enabled = interrupts_enabled();
+
+	if (enabled)
+		disable_interrupts();
+
+	result = (v->counter == old);
+	if (result)
+		v->counter = new;
+
+	if (enabled)
+		enable_interrupts();
+
+	return result;
+}
+
 #endif /* _OSKIT_ARM32_ATOMIC_H_ */
@@ -20,9 +20,12 @@
 #include <oskit/types.h>
 #include <oskit/compiler.h>
 
-/* This is a very naive standard I/O implementation
-   which simply chains to the low-level I/O routines
-   without doing any buffering or anything.  */
+/* This is a small standard I/O implementation.  FILE output is
+   buffered in the FreeBSD buffer fields below, fully or by line, or not
+   at all, as set by setvbuf; input goes straight to the low-level I/O
+   routines.  printf, putchar and puts do not use stdout at all: they go
+   directly to the console, a line at a time, so they work anywhere in
+   the kernel.  */
 
 #ifndef NULL
 #define NULL 0
@@ -78,8 +81,18 @@ typedef	struct __sFILE {
 
 extern FILE __sF[];
 
+#define	__SLBF		0x0001		/* line buffered */
+#define	__SNBF		0x0002		/* unbuffered */
+#define	__SRD		0x0004		/* OK to read */
+#define	__SWR		0x0008		/* OK to write */
+#define	__SRW		0x0010		/* open for reading & writing */
 #define	__SEOF		0x0020		/* found EOF */
 #define	__SERR		0x0040		/* found error */
+#define	__SMBF		0x0080		/* _bf._base is from malloc */
+
+#define	_IOFBF		0		/* setvbuf should set fully buffered */
+#define	_IOLBF		1		/* setvbuf should set line buffered */
+#define	_IONBF		2		/* setvbuf should set unbuffered */
 
 #define	stdin		(&__sF[0])
 #define	stdout		(&__sF[1])
@@ -124,6 +137,11 @@ char *fgets(char *__str, int __size, FILE *__stream);
 FILE *fopen(const char *__path, const char *__mode);
 FILE *fdopen(int fd, const char *__mode);
 int fflush(FILE *stream);
+int setvbuf(FILE *__stream, char *__buf, int __mode, int __size);
+void setbuf(FILE *__stream, char *__buf);
+int setlinebuf(FILE *__stream);
+void flockfile(FILE *__stream);
+void funlockfile(FILE *__stream);
 int fclose(FILE *__stream);
 int fread(void *__buf, int __size, int __count, FILE *__stream);
 int fwrite(void *__buf, int __size, int __count, FILE *__stream);
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ * 
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ * 
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+/*
+ * Persistent readiness notification, with the interface and semantics
+ * of Linux epoll.  Works on any descriptor whose object exports
+ * oskit_asyncio.  Unlike Linux, closing a descriptor does not take it
+ * out of the interest sets it is in; use EPOLL_CTL_DEL first.
+ */
+#ifndef _OSKIT_C_SYS_EPOLL_H_
+#define	_OSKIT_C_SYS_EPOLL_H_
+
+#include <oskit/compiler.h>
+#include <oskit/types.h>
+
+#define EPOLLIN		0x001		/* readable */
+#define EPOLLPRI	0x002		/* exceptional condition */
+#define EPOLLOUT	0x004		/* writable */
+#define EPOLLERR	0x008		/* error polling the descriptor */
+#define EPOLLHUP	0x010		/* never set; for compatibility */
+#define EPOLLONESHOT	(1U << 30)	/* disable after one event */
+#define EPOLLET		(1U << 31)	/* edge triggered */
+
+#define EPOLL_CTL_ADD	1
+#define EPOLL_CTL_DEL	2
+#define EPOLL_CTL_MOD	3
+
+typedef union epoll_data {
+	void		*ptr;
+	int		fd;
+	oskit_u32_t	u32;
+	oskit_u64_t	u64;
+} epoll_data_t;
+
+struct epoll_event {
+	oskit_u32_t	events;
+	epoll_data_t	data;
+};
+
+OSKIT_BEGIN_DECLS
+
+int	epoll_create(int size);
+int	epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int	epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+		   int timeout);
+
+OSKIT_END_DECLS
+
+#endif /* !_OSKIT_C_SYS_EPOLL_H_ */
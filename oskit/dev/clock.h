@@ -195,4 +195,11 @@ extern const struct oskit_guid oskit_clock_iid;
 /* This is how the default implementation gives you one. */
 struct oskit_clock *oskit_clock_init(void);
 
+/*
+ * Have the default clock's timer interrupt only when one of its timers
+ * is due, rather than at every tick. Returns OSKIT_E_NOTIMPL if the
+ * osenv timer cannot do that.
+ */
+oskit_error_t oskit_clock_tickless(struct oskit_clock *clock, int enable);
+
 #endif /* _OSKIT_DEV_CLOCK_H_ */
@@ -126,6 +126,27 @@ long osenv_timer_spin_resolution(void);
 void osenv_timer_register(void (*func)(void), int freq);
 void osenv_timer_unregister(void (*func)(void), int freq);
 
+/*
+ * Tickless mode. Instead of interrupting at a fixed rate, the timer is
+ * programmed to go off when NEXT says something is next due, in ticks
+ * after the last tick delivered. Handlers are then called once for each
+ * tick that has gone by. Pass a null NEXT to go back to a fixed rate.
+ * osenv_timer_reprogram asks NEXT again, after something has been added
+ * that is due sooner; osenv_timer_lag returns the number of ticks that
+ * have gone by but not been delivered yet.
+ */
+int osenv_timer_tickless(int (*next)(void));
+void osenv_timer_reprogram(void);
+int osenv_timer_lag(void);
+
+struct osenv_timer_stats {
+	unsigned	interrupts;	/* timer interrupts taken */
+	unsigned	ticks;		/* ticks delivered to handlers */
+	unsigned	reprograms;	/* one-shots cut short by reprogram */
+	unsigned	maxlate;	/* worst interrupt latency, in ns */
+};
+void osenv_timer_getstats(struct osenv_timer_stats *out_stats);
+
 /*
  * Declarations for the osenv_timer_pit layer upon which the osenv_timer
  * functions are implemented.
@@ -135,6 +156,10 @@ void osenv_timer_unregister(void (*func)(void), int freq);
 int osenv_timer_pit_init(int freq, void (*timer_intr)(void));
 void osenv_timer_pit_shutdown(void);
 int osenv_timer_pit_read(void);
+int osenv_timer_pit_oneshot_max(void);
+void osenv_timer_pit_oneshot(int counts);
+int osenv_timer_pit_elapsed(void);
+void osenv_timer_pit_periodic(int freq);
 
 /*
  * Flags to *_block_open routines.
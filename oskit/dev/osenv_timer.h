@@ -46,6 +46,10 @@ struct oskit_osenv_timer_ops {
 				void (*func)(void), int freq);
 	OSKIT_COMDECL_V (*unregister)(oskit_osenv_timer_t *o,
 				void (*func)(void), int freq);
+	OSKIT_COMDECL	(*tickless)(oskit_osenv_timer_t *o,
+				int (*next)(void));
+	OSKIT_COMDECL_V (*reprogram)(oskit_osenv_timer_t *o);
+	OSKIT_COMDECL_U (*lag)(oskit_osenv_timer_t *o);
 };
 
 /* GUID for oskit_osenv_timer interface */
@@ -70,6 +74,12 @@ extern const struct oskit_guid oskit_osenv_timer_iid;
 	((o)->ops->Register((oskit_osenv_timer_t *)(o), (handler), (freq)))
 #define oskit_osenv_timer_unregister(o, handler, freq) \
 	((o)->ops->unregister((oskit_osenv_timer_t *)(o), (handler), (freq)))
+#define oskit_osenv_timer_tickless(o, next) \
+	((o)->ops->tickless((oskit_osenv_timer_t *)(o), (next)))
+#define oskit_osenv_timer_reprogram(o) \
+	((o)->ops->reprogram((oskit_osenv_timer_t *)(o)))
+#define oskit_osenv_timer_lag(o) \
+	((o)->ops->lag((oskit_osenv_timer_t *)(o)))
 
 /*
  * Return a reference to an osenv timer interface object.
@@ -50,10 +50,45 @@ typedef struct oskit_avc_entry_ref {
 	oskit_avc_entry_t *ae;	
 } oskit_avc_entry_ref_t;
 
+/*
+ * Cache statistics for one (ssid,tsid,tclass) triple, as returned by
+ * lookup_stats and get_stats. Misses are decisions that had to be fetched
+ * from the security server; reclaims are the times an entry for the
+ * triple was thrown out to make room for another.
+ */
+typedef struct oskit_avc_stats {
+	oskit_security_id_t   ssid;
+	oskit_security_id_t   tsid;
+	oskit_security_class_t tclass;
+	oskit_u32_t	      hits;
+	oskit_u32_t	      misses;
+	oskit_u32_t	      reclaims;
+} oskit_avc_stats_t;
+
 #define OSKIT_AVC_ENTRY_REF_NULL { 0 }
 #define OSKIT_AVC_ENTRY_REF_INIT(h) { (h)->ae = 0; }
 #define OSKIT_AVC_ENTRY_REF_CPY(dst,src) (dst)->ae = (src)->ae
 
+/*
+ * One of the permission checks made by has_perm_batch. If aeref is not
+ * NULL it is used and updated as by oskit_avc_has_perm_ref.
+ */
+typedef struct oskit_avc_check {
+	oskit_security_id_t   ssid;
+	oskit_security_id_t   tsid;
+	oskit_security_class_t tclass;
+	oskit_access_vector_t requested;
+	oskit_avc_entry_ref_t *aeref;
+} oskit_avc_check_t;
+
+#define OSKIT_AVC_CHECK_INIT(c,s,t,cl,req,ref) do { \
+	oskit_avc_check_t *__c = (c); \
+	__c->ssid = (s); __c->tsid = (t); __c->tclass = (cl); \
+	__c->requested = (req); __c->aeref = (ref); \
+} while (0)
+
+#define OSKIT_AVC_BATCH_MAX	8
+
 #define OSKIT_AVC_AUDITALLOW 0
 #define OSKIT_AVC_AUDITDENY  1
 
@@ -132,6 +167,39 @@ struct oskit_avc_ops {
 	OSKIT_COMDECL_V	(*log_contents)(oskit_avc_t *a, int priority, char *tag);
 
 	OSKIT_COMDECL_V	(*log_stats)(oskit_avc_t *a, int priority, char *tag);
+
+	/*
+	 * Set the number of entries the cache may grow to. Entries already
+	 * allocated are kept even if there are more than the new limit.
+	 */
+	OSKIT_COMDECL	(*set_size)(oskit_avc_t *a, oskit_u32_t maxnodes);
+
+	/*
+	 * Per-triple statistics: lookup_stats returns those for one triple,
+	 * or OSKIT_ENOENT if the cache has never seen it. get_stats copies
+	 * out up to `count' records and returns the number it has.
+	 */
+	OSKIT_COMDECL	(*lookup_stats)(oskit_avc_t *a,
+					oskit_security_id_t ssid,
+					oskit_security_id_t tsid,
+					oskit_security_class_t tclass,
+					oskit_avc_stats_t *out_stats);
+
+	OSKIT_COMDECL	(*get_stats)(oskit_avc_t *a,
+				     oskit_avc_stats_t *out_stats,
+				     oskit_u32_t count,
+				     oskit_u32_t *out_count);
+
+	/*
+	 * Make up to OSKIT_AVC_BATCH_MAX permission checks in one go. The
+	 * checks are decided in order; the first one that fails stops the
+	 * rest, its error is returned and its index stored in
+	 * *out_failed (which is set to nchecks if all are granted).
+	 */
+	OSKIT_COMDECL	(*has_perm_batch)(oskit_avc_t *a,
+					  oskit_avc_check_t *checks,
+					  oskit_u32_t nchecks,
+					  oskit_u32_t *out_failed);
 };
 
 
@@ -145,6 +213,10 @@ struct oskit_avc_ops {
 #define oskit_avc_remove_callback(a,c) ((a)->ops->add_callback((a),(c)))
 #define oskit_avc_log_contents(a,pri,tag) ((a)->ops->log_contents((a),(pri),(tag)))
 #define oskit_avc_log_stats(a,pri,tag) ((a)->ops->log_stats((a),(pri),(tag)))
+#define oskit_avc_set_size(a,maxnodes) ((a)->ops->set_size((a),(maxnodes)))
+#define oskit_avc_lookup_stats(a,ssid,tsid,tclass,st) ((a)->ops->lookup_stats((a),(ssid),(tsid),(tclass),(st)))
+#define oskit_avc_get_stats(a,st,count,out_count) ((a)->ops->get_stats((a),(st),(count),(out_count)))
+#define oskit_avc_has_perm_batch(a,checks,n,out_failed) ((a)->ops->has_perm_batch((a),(checks),(n),(out_failed)))
 
 
 extern inline OSKIT_COMDECL oskit_avc_get_ref(
@@ -135,4 +135,37 @@ oskit_error_t	oskit_create_fsnamespace(struct oskit_dir *rootdir,
 				struct oskit_dir *cwd,
 				oskit_fsnamespace_t **out_fsnamespace);
 
+/*
+ * Name cache statistics, returned by oskit_fsnamespace_cache_stats.
+ */
+struct oskit_fsnamespace_cache_stats {
+	oskit_u32_t	lookups;	/* Cache lookups */
+	oskit_u32_t	hits;		/* Found the file */
+	oskit_u32_t	neghits;	/* Found that the name does not exist */
+	oskit_u32_t	misses;		/* Had to ask the filesystem */
+	oskit_u32_t	entered;	/* Entries added */
+	oskit_u32_t	negentered;	/* Negative entries added */
+	oskit_u32_t	evictions;	/* Entries thrown out for space */
+	oskit_u32_t	removed;	/* Entries removed by unlink and such */
+	oskit_u32_t	purges;		/* Whole cache invalidations */
+	oskit_u32_t	renames;
+	oskit_u32_t	renamed_files;
+	oskit_u32_t	entries;	/* Entries in the cache now */
+	oskit_u32_t	bytes;		/* Memory they take up */
+	oskit_u32_t	budget;		/* Limit on that memory */
+};
+
+/*
+ * Set the memory budget for the name cache shared by a namespace and
+ * its clones. Zero turns the cache off.
+ */
+oskit_error_t	oskit_fsnamespace_cache_setsize(oskit_fsnamespace_t *f,
+				oskit_size_t bytes);
+
+/*
+ * Get the name cache statistics.
+ */
+oskit_error_t	oskit_fsnamespace_cache_stats(oskit_fsnamespace_t *f,
+				struct oskit_fsnamespace_cache_stats *out_stats);
+
 #endif /* _OSKIT_COM_FSNAMESPACE_H_ */
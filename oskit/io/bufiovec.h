@@ -48,6 +48,9 @@ struct oskit_bufiovec_ops {
 	/*
 	 * Return an array of iovecs that represents a scatter/gather buffer
 	 * Otherwise, all the comments on bufio::map apply.
+	 * At most veclen entries of vec are filled in; the return value
+	 * is the number of iovecs the whole buffer needs, so a caller
+	 * whose array was too short can tell and try again or copy.
 	 */
 	OSKIT_COMDECL_U	(*map)(oskit_bufiovec_t *io, 
 			       oskit_iovec_t *vec, oskit_u32_t veclen);
@@ -75,6 +75,20 @@ struct oskit_netio_ops {
 	OSKIT_COMDECL 	(*alloc_bufio)(oskit_netio_t *io,
 				oskit_size_t size,
 				oskit_bufio_t **out_bufio);
+
+	/*
+	 * Push `count' packets at once; packet i is bufs[i], sizes[i]
+	 * bytes long.  Means the same as pushing them one at a time,
+	 * in order, and the bufio references work the same way, but
+	 * lets the consumer do its per-call work once for the lot.
+	 * All of the packets are offered even if some fail; the
+	 * return value is the error from the first that did, or 0.
+	 * Consumers that have nothing to gain just loop over push.
+	 */
+	OSKIT_COMDECL	(*push_batch)(oskit_netio_t *io,
+				oskit_bufio_t **bufs,
+				oskit_size_t *sizes,
+				unsigned count);
 };
 
 extern const struct oskit_guid oskit_netio_iid;
@@ -92,6 +106,14 @@ extern const struct oskit_guid oskit_netio_iid;
 	((io)->ops->push((oskit_netio_t *)(io), (b), (size)))
 #define oskit_netio_alloc_bufio(io, size, out_bufio) \
 	((io)->ops->alloc_bufio((oskit_netio_t *)(io), (size), (out_bufio)))
+#define oskit_netio_push_batch(io, bufs, sizes, count) \
+	((io)->ops->push_batch((oskit_netio_t *)(io), (bufs), (sizes), (count)))
+
+/*
+ * A reasonable number of packets for a producer to gather before
+ * calling push_batch; consumers must take any count.
+ */
+#define OSKIT_NETIO_BATCH	32
 
 /*
  * This function provides a default netio object implementation,
@@ -114,4 +136,17 @@ oskit_netio_t * oskit_netio_create_cleanup(oskit_error_t (*func)(void *data,
                                    		oskit_size_t pkt_size),
               		void *data, void (*destructor)(void *data));
 
+/*
+ * Like oskit_netio_create_cleanup, but push_batch calls `batchfunc'
+ * with the whole batch instead of calling `func' for each packet.
+ */
+oskit_netio_t * oskit_netio_create_batch(oskit_error_t (*func)(void *data,
+						oskit_bufio_t *b,
+                                   		oskit_size_t pkt_size),
+			oskit_error_t (*batchfunc)(void *data,
+						oskit_bufio_t **bufs,
+						oskit_size_t *sizes,
+						unsigned count),
+              		void *data, void (*destructor)(void *data));
+
 #endif /* _OSKIT_IO_NETIO_H_ */
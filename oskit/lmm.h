@@ -31,7 +31,8 @@ typedef struct lmm_region
 {
 	struct lmm_region *next;
 
-	/* List of free memory blocks in this region.  */
+	/* List of free memory blocks in this region
+	   (or the root of the free block tree, for indexed regions).  */
 	struct lmm_node *nodes;
 
 	/* Virtual addresses of the start and end of the memory region.  */
@@ -55,6 +56,15 @@ typedef struct lmm
 
 #define LMM_INITIALIZER { 0 }
 
+/*
+ * Region flag: keep the region's free blocks in an address-ordered tree
+ * indexed by block size, rather than in a simple list.  Allocation and
+ * free become O(log n) in the number of free blocks instead of O(n),
+ * at the cost of a slightly larger minimum block size.  This is not a
+ * memory attribute, and should not be passed to the allocation routines.
+ */
+#define LMMF_INDEXED	0x80000000
+
 OSKIT_BEGIN_DECLS
 
 void lmm_init(lmm_t *lmm);
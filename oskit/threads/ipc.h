@@ -43,6 +43,46 @@ oskit_error_t	oskit_ipc_call(pthread_t dst, void *sendmsg,
 oskit_error_t	oskit_ipc_reply(pthread_t src, void *msg,
 			oskit_size_t msg_size);
 
+/*
+ * Lent messages. A receiver that asks for them is handed pointers to
+ * the sender's buffers instead of a copy, and may use them until it
+ * replies; the sender stays blocked until then, even for a plain send.
+ * The reply can be built in place in the caller's reply buffer, and
+ * replying from that buffer copies nothing. A plain sender is released
+ * with a zero length reply.
+ */
+typedef struct oskit_ipc_lent {
+	void		*msg;		/* The sender's message */
+	oskit_size_t	msg_size;
+	void		*reply;		/* Caller's reply buffer, or null */
+	oskit_size_t	reply_size;
+} oskit_ipc_lent_t;
+
+oskit_error_t	oskit_ipc_recv_lent(pthread_t src, oskit_ipc_lent_t *lent,
+			oskit_s32_t timeout);
+
+oskit_error_t	oskit_ipc_wait_lent(pthread_t *src, oskit_ipc_lent_t *lent,
+			oskit_s32_t timeout);
+
+/*
+ * A ring of page aligned buffers registered for repeated calls to one
+ * thread. Each call sends a slot and takes the reply back in the same
+ * slot, so a server using lent receives works on it in place. A ring
+ * belongs to one client thread.
+ */
+typedef struct oskit_ipc_ring oskit_ipc_ring_t;
+
+oskit_error_t	oskit_ipc_ring_create(pthread_t dst, int nslots,
+			oskit_size_t slot_size, oskit_ipc_ring_t **out);
+
+void		oskit_ipc_ring_destroy(oskit_ipc_ring_t *ring);
+
+void	       *oskit_ipc_ring_next(oskit_ipc_ring_t *ring);
+
+oskit_error_t	oskit_ipc_ring_call(oskit_ipc_ring_t *ring, void *slot,
+			oskit_size_t msg_size, oskit_size_t *actual,
+			oskit_s32_t timeout);
+
 #endif
 
 
@@ -339,6 +339,27 @@ typedef void (*oskit_pthread_csw_hook_t)(void);
 oskit_pthread_csw_hook_t
 	oskit_pthread_aftercsw_hook_set(oskit_pthread_csw_hook_t hook);
 
+/*
+ * Cache of thread structures and stacks, reused across thread create
+ * and destroy. The limits are in number of cached items.
+ */
+struct pthread_cache_stats {
+	int		maxthreads;	/* Limit on cached thread structs */
+	int		maxstacks;	/* Limit on cached stacks */
+	int		threads;	/* Thread structs in the cache */
+	int		stacks;		/* Stacks in the cache */
+	oskit_u32_t	thread_hits;	/* Creates that found a thread struct */
+	oskit_u32_t	thread_misses;
+	oskit_u32_t	stack_hits;	/* Creates that found a stack */
+	oskit_u32_t	stack_misses;
+	oskit_u32_t	scrubbed;	/* Items zeroed by the idle thread */
+	oskit_u32_t	overflows;	/* Frees that did not fit */
+};
+typedef struct pthread_cache_stats pthread_cache_stats_t;
+
+int		oskit_pthread_cache_setsize(int maxthreads, int maxstacks);
+int		oskit_pthread_cache_stats(pthread_cache_stats_t *stats);
+
 /*
  * Timer. The resolution is 10ms.
  */
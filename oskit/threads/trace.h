@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Scheduler trace. When the threads library is built with SCHED_TRACE,
+ * the scheduler and the mutex code write a record into a ring for each
+ * of the events below while tracing is turned on. Otherwise the calls
+ * here just fail with OSKIT_ENOSYS.
+ *
+ * Records are read back in the order they were written. The ring keeps
+ * the most recent ones; older records that were overwritten before
+ * being read are counted as lost. The records are 16 bytes, in the
+ * byte order of the machine, and are what the decoder on the build
+ * host (examples/x86/threads/schedtrace_decode.c) reads.
+ */
+#ifndef	_OSKIT_THREADS_TRACE_H_
+#define _OSKIT_THREADS_TRACE_H_
+
+#include <oskit/types.h>
+#include <oskit/error.h>
+
+typedef struct oskit_pthread_trace {
+	oskit_u64_t	stamp;		/* Cycle counter */
+	oskit_u8_t	event;		/* One of the below */
+	oskit_u8_t	cpu;		/* CPU it happened on */
+	oskit_u16_t	tid;		/* Thread it happened to */
+	oskit_u32_t	arg;		/* Depends on the event */
+} oskit_pthread_trace_t;
+
+/*
+ * Events, and what arg is for each.
+ */
+#define OSKIT_PTHREAD_TRACE_DISPATCH	1	/* Runs. Thread switched from */
+#define OSKIT_PTHREAD_TRACE_WAKEUP	2	/* Made runnable. Thread running */
+#define OSKIT_PTHREAD_TRACE_PREEMPT	3	/* Switched out, still runnable.
+						   Reschedule reason */
+#define OSKIT_PTHREAD_TRACE_BLOCK	4	/* Switched out to wait.
+						   Reschedule reason */
+#define OSKIT_PTHREAD_TRACE_CONTEND	5	/* Waits for a mutex. Mutex */
+#define OSKIT_PTHREAD_TRACE_HANDOFF	6	/* Handed a mutex. Mutex */
+
+/*
+ * Start tracing into a ring of at least nrecs records, which is
+ * allocated the first time. Anything still in the ring is kept.
+ */
+oskit_error_t	oskit_pthread_trace_enable(int nrecs);
+
+/*
+ * Stop tracing. The ring can still be read.
+ */
+void		oskit_pthread_trace_disable(void);
+
+/*
+ * Copy out up to max of the oldest unread records and return how many.
+ * If lost is non-null, the number of records overwritten before they
+ * could be read since the last call is stored there.
+ */
+int		oskit_pthread_trace_read(oskit_pthread_trace_t *buf, int max,
+			int *lost);
+
+/*
+ * Cycles per millisecond, as measured against the clock since tracing
+ * was first enabled. Zero if not enough time has gone by to tell.
+ */
+oskit_u32_t	oskit_pthread_trace_clock(void);
+
+/*
+ * Stop tracing, then read everything left and print it on the console
+ * in hex, one record to a line, between marker lines the decoder looks
+ * for.
+ */
+void		oskit_pthread_trace_dump(void);
+
+#endif /* _OSKIT_THREADS_TRACE_H_ */
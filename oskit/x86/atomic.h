@@ -84,4 +84,23 @@ atomic_dec_and_test(volatile atomic_t *v)
 	return c != 0;
 }
 
+/*
+ * If the value is old, make it new.  Return true if it was swapped.
+ * Always locked, since the pthread mutexes depend on it to be atomic
+ * against the other processors too.
+ */
+OSKIT_INLINE int
+atomic_cmpxchg(volatile atomic_t *v, oskit_s32_t old, oskit_s32_t new)
+{
+	oskit_s32_t prev;
+
+	__asm__ __volatile__(
+		"lock; cmpxchgl %2,%1"
+		: "=a" (prev), "+m" (v->counter)
+		: "r" (new), "0" (old)
+		: "memory");
+
+	return prev == old;
+}
+
 #endif /* _OSKIT_X86_ATOMIC_H_ */
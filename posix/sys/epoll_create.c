@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ * 
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ * 
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "epollimpl.h"
+
+static struct oskit_iunknown_ops epoll_ops;
+
+static OSKIT_COMDECL
+epoll_query(oskit_iunknown_t *io, const struct oskit_guid *iid,
+	    void **out_ihandle)
+{
+	struct epoll *ep = (struct epoll *)io;
+
+	if (memcmp(iid, &oskit_iunknown_iid, sizeof(*iid)) == 0) {
+		*out_ihandle = &ep->iu;
+		ep->count++;
+		return 0;
+	}
+
+	*out_ihandle = 0;
+	return OSKIT_E_NOINTERFACE;
+}
+
+static OSKIT_COMDECL_U
+epoll_addref(oskit_iunknown_t *io)
+{
+	struct epoll *ep = (struct epoll *)io;
+
+	return ++ep->count;
+}
+
+static OSKIT_COMDECL_U
+epoll_iunknown_release(oskit_iunknown_t *io)
+{
+	struct epoll *ep = (struct epoll *)io;
+	unsigned newcount;
+	int fd;
+
+	if ((newcount = --ep->count) != 0)
+		return newcount;
+
+	for (fd = 0; fd < ep->nitems; fd++)
+		if (ep->items[fd])
+			epoll_item_destroy(ep, ep->items[fd]);
+#ifdef THREAD_SAFE
+	pthread_mutex_destroy(&ep->mutex);
+#endif
+	free(ep->items);
+	free(ep);
+	return 0;
+}
+
+static struct oskit_iunknown_ops epoll_ops = {
+	epoll_query,
+	epoll_addref,
+	epoll_iunknown_release,
+};
+
+/*
+ * The size is only a hint in Linux, and we don't use it either;
+ * the interest set grows as needed.
+ */
+int
+epoll_create(int size)
+{
+	struct epoll *ep;
+	int fd;
+
+	if (size <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if ((ep = malloc(sizeof *ep)) == 0) {
+		errno = ENOMEM;
+		return -1;
+	}
+	memset(ep, 0, sizeof *ep);
+	ep->iu.ops = &epoll_ops;
+	ep->count = 1;
+	queue_init(&ep->readyq);
+#ifdef THREAD_SAFE
+	pthread_mutex_init(&ep->mutex, 0);
+#endif
+
+	fd = fd_alloc(&ep->iu, 0);
+	epoll_release(ep);
+	return fd;
+}
+
+struct epoll *
+epoll_lookup(int epfd)
+{
+	struct epoll *ep;
+
+	if (fd_check(epfd))
+		return 0;
+
+	ep = (struct epoll *)fd_array[epfd].obj;
+	if (ep->iu.ops != &epoll_ops) {
+		fd_unlock(epfd);
+		errno = EINVAL;
+		return 0;
+	}
+	epoll_addref(&ep->iu);
+	fd_unlock(epfd);
+	return ep;
+}
+
+void
+epoll_release(struct epoll *ep)
+{
+	epoll_iunknown_release(&ep->iu);
+}
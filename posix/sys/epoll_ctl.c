@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ * 
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ * 
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <oskit/c/environment.h>
+#include "epollimpl.h"
+
+#ifdef KNIT
+#include <knit/c/sleep.h>
+
+#undef oskit_libcenv_wakeup
+#define oskit_libcenv_wakeup(s, sr)         oskit_wakeup((sr))
+#endif
+
+/*
+ * Called by the descriptor's asyncio when one of the conditions we
+ * registered for may have come true.  Just queue the item; epoll_wait
+ * polls it.
+ */
+static oskit_error_t
+epoll_callback(oskit_iunknown_t *ioobj, void *arg)
+{
+	struct epitem	*epi = arg;
+	struct epoll	*ep  = epi->ep;
+	int		enabled;
+
+	enabled = epoll_lock();
+	if (EPOLL_ASYNCIO_MASK(epi->event.events)) {
+		epoll_queue(ep, epi);
+		if (ep->waiter) {
+			oskit_libcenv_wakeup(libc_environment, ep->waiter);
+			ep->waiter = 0;
+		}
+	}
+	epoll_unlock(enabled);
+	return 0;
+}
+
+/*
+ * Register the listener for the item's events, and queue the item if
+ * one of them is already true so that it isn't missed.
+ */
+static void
+epoll_arm(struct epoll *ep, struct epitem *epi)
+{
+	oskit_s32_t	mask = EPOLL_ASYNCIO_MASK(epi->event.events);
+	oskit_s32_t	cond;
+	int		enabled;
+
+	if (mask == 0)
+		return;
+
+	cond = oskit_asyncio_add_listener(epi->asyncio, epi->listener, mask);
+	if (cond < 0 || (cond & mask)) {
+		enabled = epoll_lock();
+		epoll_queue(ep, epi);
+		epoll_unlock(enabled);
+	}
+}
+
+static void
+epoll_disarm(struct epoll *ep, struct epitem *epi)
+{
+	int		enabled;
+
+	oskit_asyncio_remove_listener(epi->asyncio, epi->listener);
+	enabled = epoll_lock();
+	epoll_dequeue(ep, epi);
+	epoll_unlock(enabled);
+}
+
+void
+epoll_item_destroy(struct epoll *ep, struct epitem *epi)
+{
+	epoll_disarm(ep, epi);
+	ep->items[epi->fd] = 0;
+	oskit_listener_release(epi->listener);
+	oskit_asyncio_release(epi->asyncio);
+	free(epi);
+}
+
+/*
+ * Make room in the interest set for descriptor fd.
+ */
+static int
+epoll_grow(struct epoll *ep, int fd)
+{
+	struct epitem	**items;
+	int		n = ep->nitems ? ep->nitems : 16;
+
+	while (n <= fd)
+		n *= 2;
+	if ((items = realloc(ep->items, n * sizeof *items)) == 0)
+		return ENOMEM;
+	memset(items + ep->nitems, 0, (n - ep->nitems) * sizeof *items);
+	ep->items = items;
+	ep->nitems = n;
+	return 0;
+}
+
+static int
+epoll_add(struct epoll *ep, int fd, struct epoll_event *event)
+{
+	struct epitem	*epi;
+	oskit_asyncio_t	*asyncio;
+	int		err;
+
+	if (fd_check(fd))
+		return errno;
+	if (!FD_HAS_INTERFACE(fd, asyncio)) {
+		fd_unlock(fd);
+		return EPERM;
+	}
+	asyncio = fd_array[fd].asyncio;
+	oskit_asyncio_addref(asyncio);
+	fd_unlock(fd);
+
+	if (fd >= ep->nitems && (err = epoll_grow(ep, fd)) != 0)
+		goto bad;
+
+	if ((epi = malloc(sizeof *epi)) == 0) {
+		err = ENOMEM;
+		goto bad;
+	}
+	memset(epi, 0, sizeof *epi);
+	epi->fd = fd;
+	epi->event = *event;
+	epi->ep = ep;
+	epi->asyncio = asyncio;
+	epi->listener = oskit_create_listener(epoll_callback, epi);
+	if (epi->listener == 0) {
+		free(epi);
+		err = ENOMEM;
+		goto bad;
+	}
+
+	ep->items[fd] = epi;
+	epoll_arm(ep, epi);
+	return 0;
+
+ bad:
+	oskit_asyncio_release(asyncio);
+	return err;
+}
+
+int
+epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+	struct epoll	*ep;
+	struct epitem	*epi;
+	int		err = 0;
+
+	if ((ep = epoll_lookup(epfd)) == 0)
+		return -1;
+
+	if (fd == epfd || (op != EPOLL_CTL_DEL && event == 0)) {
+		epoll_release(ep);
+		errno = EINVAL;
+		return -1;
+	}
+
+	epoll_mutex_lock(ep);
+	epi = (fd >= 0 && fd < ep->nitems) ? ep->items[fd] : 0;
+
+	switch (op) {
+	case EPOLL_CTL_ADD:
+		if (epi)
+			err = EEXIST;
+		else
+			err = epoll_add(ep, fd, event);
+		break;
+
+	case EPOLL_CTL_MOD:
+		if (!epi) {
+			err = ENOENT;
+			break;
+		}
+		epoll_disarm(ep, epi);
+		epi->event = *event;
+		epoll_arm(ep, epi);
+		break;
+
+	case EPOLL_CTL_DEL:
+		if (!epi) {
+			err = ENOENT;
+			break;
+		}
+		epoll_item_destroy(ep, epi);
+		break;
+
+	default:
+		err = EINVAL;
+	}
+
+	epoll_mutex_unlock(ep);
+	epoll_release(ep);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
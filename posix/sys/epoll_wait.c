@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ * 
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ * 
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <oskit/time.h>
+#include <oskit/dev/clock.h>
+#include <oskit/c/environment.h>
+#include "epollimpl.h"
+
+extern oskit_clock_t	*sys_clock;
+
+#ifdef KNIT
+#include <knit/c/sleep.h>
+
+#undef oskit_libcenv_sleep_init
+#undef oskit_libcenv_sleep
+#define oskit_libcenv_sleep_init(s, sr)     oskit_sleep_init((sr))
+#define oskit_libcenv_sleep(s, sr, timeout) oskit_sleep((sr),(timeout))
+#endif
+
+/*
+ * Move everything on queue `from' to the end of queue `to'.
+ */
+static void
+epoll_splice(queue_head_t *from, queue_head_t *to)
+{
+	struct epitem	*epi;
+
+	while (!queue_empty(from)) {
+		queue_remove_first(from, epi, struct epitem *, chain);
+		queue_enter(to, epi, struct epitem *, chain);
+	}
+}
+
+/*
+ * How long until the deadline. Returns zero if it has passed.
+ */
+static int
+epoll_remaining(const oskit_timespec_t *deadline, oskit_timespec_t *left)
+{
+	oskit_timespec_t	now;
+
+	oskit_clock_gettime(sys_clock, &now);
+	left->tv_sec = deadline->tv_sec - now.tv_sec;
+	left->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+	if (left->tv_nsec < 0) {
+		left->tv_sec--;
+		left->tv_nsec += 1000000000;
+	}
+	return left->tv_sec > 0 || (left->tv_sec == 0 && left->tv_nsec > 0);
+}
+
+/*
+ * Poll the items on the ready queue, and report the ones that have
+ * something.  Level triggered items that reported go back on the
+ * queue for next time; the rest come off and wait for their listener
+ * to put them back.  Only the items that were queued on entry are
+ * looked at, so nothing is reported twice in one call.
+ */
+static int
+epoll_scan(struct epoll *ep, struct epoll_event *events, int maxevents)
+{
+	queue_head_t	todo, again;
+	struct epitem	*epi;
+	oskit_s32_t	cond;
+	oskit_u32_t	revents;
+	int		enabled, n = 0;
+
+	queue_init(&todo);
+	queue_init(&again);
+
+	enabled = epoll_lock();
+	epoll_splice(&ep->readyq, &todo);
+
+	while (n < maxevents && !queue_empty(&todo)) {
+		queue_remove_first(&todo, epi, struct epitem *, chain);
+		epi->queued = 0;
+		epoll_unlock(enabled);
+
+		cond = oskit_asyncio_poll(epi->asyncio);
+		if (cond < 0)
+			revents = EPOLLERR;
+		else
+			revents = ASYNCIO_EPOLL_MASK(cond) & epi->event.events;
+
+		enabled = epoll_lock();
+		if (!revents)
+			continue;
+
+		events[n].events = revents;
+		events[n].data = epi->event.data;
+		n++;
+
+		if (epi->event.events & EPOLLONESHOT)
+			epi->event.events &= EPOLLET | EPOLLONESHOT;
+		else if (!(epi->event.events & EPOLLET) && !epi->queued) {
+			queue_enter(&again, epi, struct epitem *, chain);
+			epi->queued = 1;
+		}
+	}
+
+	/*
+	 * Put back what we didn't get to and the level triggered items,
+	 * behind anything queued meanwhile.
+	 */
+	epoll_splice(&todo, &ep->readyq);
+	epoll_splice(&again, &ep->readyq);
+	epoll_unlock(enabled);
+
+	return n;
+}
+
+int
+epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+	struct epoll	*ep;
+	osenv_sleeprec_t sleeprec;
+	oskit_timespec_t ts = { 0, 0 }, deadline;
+	int		enabled, n, rc, timed = 0;
+
+#ifdef THREAD_SAFE
+	pthread_testcancel();
+#endif
+	if ((ep = epoll_lookup(epfd)) == 0)
+		return -1;
+	if (maxevents <= 0) {
+		epoll_release(ep);
+		errno = EINVAL;
+		return -1;
+	}
+
+	/*
+	 * A zero timespec means forever. Wakeups that find nothing
+	 * ready go back to sleep for what is left until the deadline;
+	 * without a clock to measure that, each sleep is the whole
+	 * timeout again.
+	 */
+	if (timeout > 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000;
+		if (sys_clock || posixlib_clock_init()) {
+			oskit_clock_gettime(sys_clock, &deadline);
+			deadline.tv_sec += ts.tv_sec;
+			deadline.tv_nsec += ts.tv_nsec;
+			if (deadline.tv_nsec >= 1000000000) {
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000;
+			}
+			timed = 1;
+		}
+	}
+
+	for (;;) {
+		epoll_mutex_lock(ep);
+		n = epoll_scan(ep, events, maxevents);
+		epoll_mutex_unlock(ep);
+		if (n || timeout == 0)
+			break;
+		if (timed && !epoll_remaining(&deadline, &ts))
+			break;
+
+		/*
+		 * Nothing ready.  Sleep until a listener queues something,
+		 * unless one did while we were scanning.
+		 */
+		oskit_libcenv_sleep_init(libc_environment, &sleeprec);
+		enabled = epoll_lock();
+		if (!queue_empty(&ep->readyq)) {
+			epoll_unlock(enabled);
+			continue;
+		}
+		ep->waiter = &sleeprec;
+		epoll_unlock(enabled);
+
+		rc = oskit_libcenv_sleep(libc_environment, &sleeprec, &ts);
+
+		enabled = epoll_lock();
+		if (ep->waiter == &sleeprec)
+			ep->waiter = 0;
+		epoll_unlock(enabled);
+		if (rc == ETIMEDOUT)
+			break;
+	}
+
+	epoll_release(ep);
+	return n;
+}
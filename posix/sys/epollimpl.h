@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ * 
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ * 
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+/*
+ * Internal definitions for the epoll implementation.
+ *
+ * An epoll descriptor is a COM object holding the interest set, indexed
+ * by descriptor number, and a queue of the items that may be ready.
+ * Each item has a listener registered on the descriptor's asyncio for
+ * as long as it is in the set; the listener only queues the item and
+ * wakes a waiter, since it can be called at interrupt level.
+ * epoll_wait polls the queued items to find out what actually happened.
+ */
+#ifndef _POSIX_SYS_EPOLLIMPL_H_
+#define _POSIX_SYS_EPOLLIMPL_H_
+
+#include <oskit/com.h>
+#include <oskit/com/listener.h>
+#include <oskit/io/asyncio.h>
+#include <oskit/dev/dev.h>
+#include <oskit/queue.h>
+#include <sys/epoll.h>
+#include "posix.h"
+#include "fd.h"
+
+struct epitem {
+	queue_chain_t		chain;		/* on the ready queue */
+	int			queued;
+	int			fd;
+	struct epoll_event	event;
+	struct epoll		*ep;
+	oskit_asyncio_t		*asyncio;
+	oskit_listener_t	*listener;
+};
+
+struct epoll {
+	oskit_iunknown_t	iu;
+	unsigned		count;
+	struct epitem		**items;	/* indexed by fd */
+	int			nitems;
+	queue_head_t		readyq;
+	osenv_sleeprec_t	*waiter;	/* set while in epoll_wait */
+#ifdef THREAD_SAFE
+	pthread_mutex_t		mutex;		/* the interest set */
+#endif
+};
+
+#ifdef THREAD_SAFE
+#define epoll_mutex_lock(ep)	pthread_mutex_lock(&(ep)->mutex)
+#define epoll_mutex_unlock(ep)	pthread_mutex_unlock(&(ep)->mutex)
+#else
+#define epoll_mutex_lock(ep)
+#define epoll_mutex_unlock(ep)
+#endif
+
+/*
+ * Look up an epoll descriptor and take a reference to it.
+ */
+struct epoll	*epoll_lookup(int epfd);
+void		epoll_release(struct epoll *ep);
+
+/*
+ * Take an item out of the interest set and free it.
+ */
+void		epoll_item_destroy(struct epoll *ep, struct epitem *epi);
+
+/*
+ * Translate epoll events to asyncio conditions and back.
+ */
+#define EPOLL_ASYNCIO_MASK(ev)						\
+	((((ev) & EPOLLIN) ? OSKIT_ASYNCIO_READABLE : 0) |		\
+	 (((ev) & EPOLLOUT) ? OSKIT_ASYNCIO_WRITABLE : 0) |		\
+	 (((ev) & EPOLLPRI) ? OSKIT_ASYNCIO_EXCEPTION : 0))
+#define ASYNCIO_EPOLL_MASK(c)						\
+	((((c) & OSKIT_ASYNCIO_READABLE) ? EPOLLIN : 0) |		\
+	 (((c) & OSKIT_ASYNCIO_WRITABLE) ? EPOLLOUT : 0) |		\
+	 (((c) & OSKIT_ASYNCIO_EXCEPTION) ? EPOLLPRI : 0))
+
+/*
+ * The ready queue is shared with listener callbacks, which may run at
+ * interrupt level.
+ */
+static inline int
+epoll_lock(void)
+{
+#ifdef KNIT
+	return osenv_intr_save_disable();
+#else
+	if (!posixlib_osenv_intr_iface)
+		posixlib_osenv_intr_init_iface();
+	if (posixlib_osenv_intr_iface)
+		return oskit_osenv_intr_save_disable(posixlib_osenv_intr_iface);
+	return 0;
+#endif
+}
+
+static inline void
+epoll_unlock(int enabled)
+{
+	if (!enabled)
+		return;
+#ifdef KNIT
+	osenv_intr_enable();
+#else
+	oskit_osenv_intr_enable(posixlib_osenv_intr_iface);
+#endif
+}
+
+/*
+ * Put an item on the ready queue if it isn't already; called locked.
+ */
+static inline void
+epoll_queue(struct epoll *ep, struct epitem *epi)
+{
+	if (epi->queued)
+		return;
+	queue_enter(&ep->readyq, epi, struct epitem *, chain);
+	epi->queued = 1;
+}
+
+static inline void
+epoll_dequeue(struct epoll *ep, struct epitem *epi)
+{
+	if (!epi->queued)
+		return;
+	queue_remove(&ep->readyq, epi, struct epitem *, chain);
+	epi->queued = 0;
+}
+
+#endif /* _POSIX_SYS_EPOLLIMPL_H_ */
@@ -27,41 +27,110 @@
 #include "avtab.h"
 #include "policydb.h"
 
-#define AVTAB_HASH(keyp) \
-((keyp->target_type + (keyp->source_type << 4) + \
-(keyp->target_class << 8)) % AVTAB_SIZE)
+static inline __u32 avtab_hash(avtab_t * h, avtab_key_t * keyp)
+{
+	__u32 hash;
+
+	hash = keyp->source_type;
+	hash = hash * 31 + keyp->target_type;
+	hash = hash * 31 + keyp->target_class;
+	hash *= 2654435761U;
+	return (hash ^ (hash >> 16)) & (h->nslot - 1);
+}
 
 #define AVTAB_EQ(key,keyp) \
 ((key.source_type == keyp->source_type) && \
  (key.target_class == keyp->target_class) && \
  (key.target_type == keyp->target_type))
 
+#define AVTAB_EMPTY(node) ((node)->key.target_class == 0)
+
+
+/*
+ * Find the slot for `key':  the one holding it, or
+ * the empty one where it would go.
+ */
+static avtab_ptr_t avtab_slot(avtab_t * h, avtab_key_t * key)
+{
+	__u32 i;
+	avtab_ptr_t cur;
+
+
+	i = avtab_hash(h, key);
+	for (;;) {
+		cur = &h->htable[i];
+		if (AVTAB_EMPTY(cur) || AVTAB_EQ(cur->key, key))
+			return cur;
+		i = (i + 1) & (h->nslot - 1);
+	}
+}
+
+
+/*
+ * Make the table `nslot' slots, moving over any entries.
+ */
+static int avtab_resize(avtab_t * h, __u32 nslot)
+{
+	avtab_ptr_t htable, cur;
+	__u32 i, oldsize;
+
+
+	htable = (avtab_ptr_t) malloc(nslot * sizeof(struct avtab_node));
+	if (htable == NULL)
+		return -ENOMEM;
+	memset(htable, 0, nslot * sizeof(struct avtab_node));
+
+	cur = h->htable;
+	oldsize = h->nslot;
+	h->htable = htable;
+	h->nslot = nslot;
+	for (i = 0; i < oldsize; i++)
+		if (!AVTAB_EMPTY(&cur[i]))
+			*avtab_slot(h, &cur[i].key) = cur[i];
+
+	if (cur)
+		free(cur);
+	return 0;
+}
+
+
+/*
+ * The number of slots for `nel' entries.
+ */
+static __u32 avtab_slots_for(__u32 nel)
+{
+	__u32 nslot;
+
+
+	nslot = AVTAB_MIN_SLOTS;
+	while (nslot < AVTAB_MAX_SLOTS && nel > nslot / 4 * 3)
+		nslot *= 2;
+	return nslot;
+}
+
 
 int avtab_insert(avtab_t * h, avtab_key_t * key, avtab_datum_t * datum)
 {
-	int hvalue;
-	avtab_ptr_t cur, newnode;
+	avtab_ptr_t cur;
 
 
 	if (!h)
 		return -ENOMEM;
+	if (!key->target_class)
+		return -EINVAL;
 
-	hvalue = AVTAB_HASH(key);
-	cur = h->htable[hvalue];
-	while (cur != NULL && !AVTAB_EQ(cur->key, key))
-		cur = cur->next;
+	if ((h->nel + 1) * 4 > h->nslot * 3) {
+		if (h->nslot >= AVTAB_MAX_SLOTS ||
+		    avtab_resize(h, h->nslot ? h->nslot * 2 : AVTAB_MIN_SLOTS))
+			return -ENOMEM;
+	}
 
-	if (cur != NULL)
+	cur = avtab_slot(h, key);
+	if (!AVTAB_EMPTY(cur))
 		return -EEXIST;
 
-	newnode = (avtab_ptr_t) malloc(sizeof(struct avtab_node));
-	if (newnode == NULL)
-		return -ENOMEM;
-	memset(newnode, 0, sizeof(struct avtab_node));
-	newnode->key = *key;
-	newnode->datum = *datum;
-	newnode->next = h->htable[hvalue];
-	h->htable[hvalue] = newnode;
+	cur->key = *key;
+	cur->datum = *datum;
 
 	h->nel++;
 	return 0;
@@ -71,19 +140,14 @@ int avtab_insert(avtab_t * h, avtab_key_t * key, avtab_datum_t * datum)
 avtab_datum_t *
  avtab_search(avtab_t * h, avtab_key_t * key)
 {
-	int hvalue;
 	avtab_ptr_t cur;
 
 
-	if (!h)
+	if (!h || !h->nel)
 		return NULL;
 
-	hvalue = AVTAB_HASH(key);
-	cur = h->htable[hvalue];
-	while (cur != NULL && !AVTAB_EQ(cur->key, key))
-		cur = cur->next;
-
-	if (cur == NULL)
+	cur = avtab_slot(h, key);
+	if (AVTAB_EMPTY(cur))
 		return NULL;
 
 	return &cur->datum;
@@ -92,22 +156,14 @@ avtab_datum_t *
 
 void avtab_destroy(avtab_t * h)
 {
-	int i;
-	avtab_ptr_t cur, temp;
-
-
 	if (!h)
 		return;
 
-	for (i = 0; i < AVTAB_SIZE; i++) {
-		cur = h->htable[i];
-		while (cur != NULL) {
-			temp = cur;
-			cur = cur->next;
-			free(temp);
-		}
-		h->htable[i] = NULL;
-	}
+	if (h->htable)
+		free(h->htable);
+	h->htable = NULL;
+	h->nslot = 0;
+	h->nel = 0;
 }
 
 
@@ -117,21 +173,21 @@ int avtab_map(avtab_t * h,
 			    void *args),
 	      void *args)
 {
-	int i, ret;
+	int ret;
+	__u32 i;
 	avtab_ptr_t cur;
 
 
 	if (!h)
 		return 0;
 
-	for (i = 0; i < AVTAB_SIZE; i++) {
-		cur = h->htable[i];
-		while (cur != NULL) {
-			ret = apply(&cur->key, &cur->datum, args);
-			if (ret)
-				return ret;
-			cur = cur->next;
-		}
+	for (i = 0; i < h->nslot; i++) {
+		cur = &h->htable[i];
+		if (AVTAB_EMPTY(cur))
+			continue;
+		ret = apply(&cur->key, &cur->datum, args);
+		if (ret)
+			return ret;
 	}
 	return 0;
 }
@@ -139,11 +195,8 @@ int avtab_map(avtab_t * h,
 
 int avtab_init(avtab_t * h)
 {
-	int i;
-
-
-	for (i = 0; i < AVTAB_SIZE; i++)
-		h->htable[i] = (avtab_ptr_t) NULL;
+	h->htable = NULL;
+	h->nslot = 0;
 	h->nel = 0;
 	return 0;
 }
@@ -151,33 +204,116 @@ int avtab_init(avtab_t * h)
 
 void avtab_hash_eval(avtab_t * h, char *progname, char *table)
 {
-	int i, chain_len, slots_used, max_chain_len;
+	__u32 i, probe, max_probe;
+
+
+	max_probe = 0;
+	for (i = 0; i < h->nslot; i++) {
+		if (AVTAB_EMPTY(&h->htable[i]))
+			continue;
+		probe = (i - avtab_hash(h, &h->htable[i].key)) & (h->nslot - 1);
+		if (probe > max_probe)
+			max_probe = probe;
+	}
+
+	printf("%s:  %s:  %d entries in %d slots, longest probe %d\n",
+	       progname, table, h->nel, h->nslot, max_probe + 1);
+}
+
+
+/*
+ * Read a table written as a slot array image.
+ */
+static int avtab_read_image(avtab_t * a, FILE * fp)
+{
+	__u32 buf[AVTAB_IMAGE_WORDS], nel, nslot, i, j, count;
 	avtab_ptr_t cur;
+	size_t items;
 
 
-	slots_used = 0;
-	max_chain_len = 0;
-	for (i = 0; i < AVTAB_SIZE; i++) {
-		cur = h->htable[i];
-		if (cur) {
-			slots_used++;
-			chain_len = 0;
-			while (cur) {
-				chain_len++;
-				cur = cur->next;
+	items = fread(buf, sizeof(__u32), 2, fp);
+	if (items != 2) {
+		printf("security: avtab: truncated table\n");
+		return -1;
+	}
+	nel = le32_to_cpu(buf[0]);
+	nslot = le32_to_cpu(buf[1]);
+	if (nslot < AVTAB_MIN_SLOTS || nslot > AVTAB_MAX_SLOTS ||
+	    (nslot & (nslot - 1)) || nel >= nslot) {
+		printf("security: avtab: bad table size (%d entries, %d slots)\n", nel, nslot);
+		return -1;
+	}
+	if (avtab_resize(a, nslot)) {
+		printf("security: avtab: out of memory\n");
+		return -1;
+	}
+
+	if (sizeof(struct avtab_node) == sizeof buf) {
+		/* Same layout, read the slots in place */
+		items = fread(a->htable, sizeof buf, nslot, fp);
+		if (items != nslot) {
+			printf("security: avtab: truncated table\n");
+			goto bad;
+		}
+		for (i = 0; i < nslot * AVTAB_IMAGE_WORDS; i++)
+			((__u32 *) a->htable)[i] =
+				le32_to_cpu(((__u32 *) a->htable)[i]);
+	} else {
+		for (i = 0; i < nslot; i++) {
+			items = fread(buf, sizeof(__u32), AVTAB_IMAGE_WORDS, fp);
+			if (items != AVTAB_IMAGE_WORDS) {
+				printf("security: avtab: truncated table\n");
+				goto bad;
 			}
+			for (j = 0; j < AVTAB_IMAGE_WORDS; j++)
+				buf[j] = le32_to_cpu(buf[j]);
+			cur = &a->htable[i];
+			cur->key.source_type = buf[0];
+			cur->key.target_type = buf[1];
+			cur->key.target_class = buf[2];
+			cur->datum.specified = buf[3];
+			cur->datum.allowed = buf[4];
+			cur->datum.trans_type = buf[5];
+#ifdef CONFIG_FLASK_AUDIT
+			cur->datum.auditallow = buf[6];
+			cur->datum.auditdeny = buf[7];
+#endif
+#ifdef CONFIG_FLASK_NOTIFY
+			cur->datum.notify = buf[8];
+#endif
+		}
+	}
 
-			if (chain_len > max_chain_len)
-				max_chain_len = chain_len;
+	/*
+	 * Every entry has to be where a search for it will look,
+	 * and only once.  Count first, so that there is known to
+	 * be an empty slot to end the searches.
+	 */
+	count = 0;
+	for (i = 0; i < nslot; i++)
+		if (!AVTAB_EMPTY(&a->htable[i]))
+			count++;
+	if (count != nel) {
+		printf("security: avtab: table has %d entries, expected %d\n", count, nel);
+		goto bad;
+	}
+	for (i = 0; i < nslot; i++) {
+		cur = &a->htable[i];
+		if (!AVTAB_EMPTY(cur) && avtab_slot(a, &cur->key) != cur) {
+			printf("security: avtab: misplaced or duplicate entry\n");
+			goto bad;
 		}
 	}
+	a->nel = nel;
+	return 0;
 
-	printf("%s:  %s:  %d nodes and %d slots used, longest chain length %d\n",
-	       progname, table, h->nel, slots_used, max_chain_len);
+      bad:
+	avtab_destroy(a);
+	return -1;
 }
 
 
-int avtab_read(avtab_t * a, FILE * fp, __u32 config)
+int avtab_read(avtab_t * a, FILE * fp, __u32 config, __u32 version)
 {
 	int i, rc;
 	avtab_key_t avkey;
@@ -191,6 +327,9 @@ int avtab_read(avtab_t * a, FILE * fp, __u32 config)
 		printf("security: avtab: out of memory\n");
 		return -1;
 	}
+	if (version != POLICYDB_VERSION_AVTAB_LIST)
+		return avtab_read_image(a, fp);
+
 	items = fread(&nel, sizeof(__u32), 1, fp);
 	if (items != 1) {
 		printf("security: avtab: truncated table\n");
@@ -201,6 +340,10 @@ int avtab_read(avtab_t * a, FILE * fp, __u32 config)
 		printf("security: avtab: table is empty\n");
 		goto bad;
 	}
+	if (avtab_resize(a, avtab_slots_for(nel))) {
+		printf("security: avtab: out of memory\n");
+		goto bad;
+	}
 	for (i = 0; i < nel; i++) {
 		memset(&avkey, 0, sizeof(avtab_key_t));
 		memset(&avdatum, 0, sizeof(avtab_datum_t));
@@ -279,45 +422,40 @@ int avtab_read(avtab_t * a, FILE * fp, __u32 config)
 #ifndef __KERNEL__
 int avtab_write(avtab_t * a, FILE * fp)
 {
-	int i;
+	__u32 i;
 	avtab_ptr_t cur;
-	__u32 buf[32];
-	__u32 nel;
-	size_t items, items2;
+	__u32 buf[AVTAB_IMAGE_WORDS];
+	size_t items;
+
 
+	if (!a->nslot && avtab_resize(a, AVTAB_MIN_SLOTS))
+		return -1;
 
-	nel = cpu_to_le32(a->nel);
-	items = fwrite(&nel, sizeof(__u32), 1, fp);
-	if (items != 1)
+	buf[0] = cpu_to_le32(a->nel);
+	buf[1] = cpu_to_le32(a->nslot);
+	items = fwrite(buf, sizeof(__u32), 2, fp);
+	if (items != 2)
 		return -1;
 
-	for (i = 0; i < AVTAB_SIZE; i++) {
-		for (cur = a->htable[i]; cur; cur = cur->next) {
-			items = 1;	/* item 0 is used for the item count */
-			buf[items++] = cpu_to_le32(cur->key.source_type);
-			buf[items++] = cpu_to_le32(cur->key.target_type);
-			buf[items++] = cpu_to_le32(cur->key.target_class);
-			buf[items++] = cpu_to_le32(cur->datum.specified);
-			if (cur->datum.specified & AVTAB_ALLOWED)
-				buf[items++] = cpu_to_le32(cur->datum.allowed);
-			if (cur->datum.specified & AVTAB_TRANSITION)
-				buf[items++] = cpu_to_le32(cur->datum.trans_type);
+	for (i = 0; i < a->nslot; i++) {
+		cur = &a->htable[i];
+		memset(buf, 0, sizeof buf);
+		buf[0] = cpu_to_le32(cur->key.source_type);
+		buf[1] = cpu_to_le32(cur->key.target_type);
+		buf[2] = cpu_to_le32(cur->key.target_class);
+		buf[3] = cpu_to_le32(cur->datum.specified);
+		buf[4] = cpu_to_le32(cur->datum.allowed);
+		buf[5] = cpu_to_le32(cur->datum.trans_type);
 #ifdef CONFIG_FLASK_AUDIT
-			if (cur->datum.specified & AVTAB_AUDITALLOW)
-				buf[items++] = cpu_to_le32(cur->datum.auditallow);
-			if (cur->datum.specified & AVTAB_AUDITDENY)
-				buf[items++] = cpu_to_le32(cur->datum.auditdeny);
+		buf[6] = cpu_to_le32(cur->datum.auditallow);
+		buf[7] = cpu_to_le32(cur->datum.auditdeny);
 #endif
 #ifdef CONFIG_FLASK_NOTIFY
-			if (cur->datum.specified & AVTAB_NOTIFY)
-				buf[items++] = cpu_to_le32(cur->datum.notify);
+		buf[8] = cpu_to_le32(cur->datum.notify);
 #endif
-			buf[0] = cpu_to_le32(items - 1);
-
-			items2 = fwrite(buf, sizeof(__u32), items, fp);
-			if (items != items2)
-				return -1;
-		}
+		items = fwrite(buf, sizeof(__u32), AVTAB_IMAGE_WORDS, fp);
+		if (items != AVTAB_IMAGE_WORDS)
+			return -1;
 	}
 
 	return 0;
@@ -26,6 +26,13 @@
  * by a type pair and a class.  An access vector
  * table is used to represent the type enforcement
  * tables.
+ *
+ * The table is open addressed with linear probing,
+ * and doubles in size to keep it no more than 3/4
+ * full.  A slot is empty if its target class is
+ * zero, since class values start at one.  Nothing
+ * is ever removed, and a pointer returned by
+ * avtab_search is only good until the next insert.
  */
 
 #ifndef _AVTAB_H_
@@ -63,16 +70,28 @@ typedef struct avtab_node *avtab_ptr_t;
 struct avtab_node {
 	avtab_key_t key;
 	avtab_datum_t datum;
-	avtab_ptr_t next;
 };
 
-#define AVTAB_SIZE 1013
+#define AVTAB_MIN_SLOTS 16
+#define AVTAB_MAX_SLOTS (1 << 24)
 
 typedef struct avtab {
-	avtab_ptr_t htable[AVTAB_SIZE];
+	avtab_ptr_t htable;	/* the slots */
+	__u32 nslot;	/* number of slots, a power of two */
 	__u32 nel;	/* number of elements */
 } avtab_t;
 
+/*
+ * Binary policies from POLICYDB_VERSION 2 on hold the
+ * table as an image of the slot array:  nel and nslot,
+ * then every slot as AVTAB_IMAGE_WORDS words, in the
+ * order of struct avtab_node with all of the optional
+ * fields present.  Reading one back needs no hashing
+ * or allocation per rule, and when struct avtab_node
+ * has that same layout the slots are read in place.
+ */
+#define AVTAB_IMAGE_WORDS 9
+
 int avtab_init(avtab_t *);
 
 int avtab_insert(avtab_t * h, avtab_key_t * k, avtab_datum_t * d);
@@ -89,7 +108,7 @@ int avtab_map(avtab_t * h,
 
 void avtab_hash_eval(avtab_t * h, char *progname, char *table);
 
-int avtab_read(avtab_t * a, FILE * fp, __u32 config);
+int avtab_read(avtab_t * a, FILE * fp, __u32 config, __u32 version);
 
 #ifndef __KERNEL__
 int avtab_write(avtab_t * a, FILE * fp);
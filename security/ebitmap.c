@@ -26,43 +26,197 @@
 
 #include "ebitmap.h"
 
+/*
+ * The index of the lowest set bit in a nonzero map word.  Done in
+ * halves so that 32-bit targets get two bsfs rather than a libgcc call.
+ */
+static inline int ebitmap_ctz(MAPTYPE map)
+{
+#if __GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 4)
+	if ((__u32) map)
+		return __builtin_ctz((__u32) map);
+	return 32 + __builtin_ctz((__u32) (map >> 32));
+#else
+	int i = 0;
+
+	while (!(map & MAPBIT)) {
+		map >>= 1;
+		i++;
+	}
+	return i;
+#endif
+}
+
+/*
+ * A cursor over the nonzero words of a bitmap, dense or not.
+ */
+typedef struct ebitmap_walk {
+	ebitmap_t *e;
+	ebitmap_node_t *n;	/* next node, if sparse */
+	__u32 startbit;		/* next word, if dense */
+} ebitmap_walk_t;
+
+static inline void ebitmap_walk_start(ebitmap_walk_t * w, ebitmap_t * e)
+{
+	w->e = e;
+	w->n = ebitmap_is_dense(e) ? 0 : e->u.node;
+	w->startbit = 0;
+}
+
+static inline int ebitmap_walk_next(ebitmap_walk_t * w,
+				    __u32 * startbit, MAPTYPE * map)
+{
+	MAPTYPE m;
+
+	if (!ebitmap_is_dense(w->e)) {
+		if (!w->n)
+			return FALSE;
+		*startbit = w->n->startbit;
+		*map = w->n->map;
+		w->n = w->n->next;
+		return TRUE;
+	}
+
+	while (w->startbit < w->e->highbit) {
+		m = w->e->u.map[w->startbit / MAPSIZE];
+		*startbit = w->startbit;
+		w->startbit += MAPSIZE;
+		if (m) {
+			*map = m;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
+/*
+ * Set the highbit of a dense bitmap from its words.
+ */
+static void ebitmap_dense_highbit(ebitmap_t * e)
+{
+	int i;
+
+	for (i = EBITMAP_DENSE_WORDS; i > 0; i--)
+		if (e->u.map[i - 1])
+			break;
+	e->highbit = i * MAPSIZE;
+}
+
+
+/*
+ * Move the words of a dense bitmap out into a node list, leaving
+ * the highbit alone.  On failure the bitmap is unchanged.
+ */
+static int ebitmap_to_sparse(ebitmap_t * e)
+{
+	ebitmap_node_t *head, *new, *prev, *n;
+	int i;
+
+	head = prev = 0;
+	for (i = 0; i < EBITMAP_DENSE_WORDS; i++) {
+		if (!e->u.map[i])
+			continue;
+		new = (ebitmap_node_t *) malloc(sizeof(ebitmap_node_t));
+		if (!new) {
+			while (head) {
+				n = head;
+				head = head->next;
+				free(n);
+			}
+			return FALSE;
+		}
+		new->startbit = i * MAPSIZE;
+		new->map = e->u.map[i];
+		new->next = 0;
+		if (prev)
+			prev->next = new;
+		else
+			head = new;
+		prev = new;
+	}
+
+	e->u.node = head;
+	return TRUE;
+}
+
+
+/*
+ * Pull a node list whose highbit has dropped to EBITMAP_DENSE_BITS
+ * or below back into the ebitmap.
+ */
+static void ebitmap_to_dense(ebitmap_t * e)
+{
+	MAPTYPE map[EBITMAP_DENSE_WORDS];
+	ebitmap_node_t *n, *temp;
+
+	memset(map, 0, sizeof map);
+	n = e->u.node;
+	while (n) {
+		map[n->startbit / MAPSIZE] = n->map;
+		temp = n;
+		n = n->next;
+		free(temp);
+	}
+	memcpy(e->u.map, map, sizeof map);
+}
+
+
 int ebitmap_or(ebitmap_t * dst, ebitmap_t * e1, ebitmap_t * e2)
 {
-	ebitmap_node_t *n1, *n2, *new, *prev;
+	ebitmap_node_t *new, *prev;
+	ebitmap_walk_t w1, w2;
+	__u32 s1 = 0, s2 = 0;
+	MAPTYPE m1 = 0, m2 = 0;
+	int more1, more2, i;
+
+
+	if (ebitmap_is_dense(e1) && ebitmap_is_dense(e2)) {
+		ebitmap_t result;
 
+		for (i = 0; i < EBITMAP_DENSE_WORDS; i++)
+			result.u.map[i] = e1->u.map[i] | e2->u.map[i];
+		result.highbit = (e1->highbit > e2->highbit) ?
+			e1->highbit : e2->highbit;
+		*dst = result;
+		return TRUE;
+	}
 
 	ebitmap_init(dst);
 
-	n1 = e1->node;
-	n2 = e2->node;
+	ebitmap_walk_start(&w1, e1);
+	ebitmap_walk_start(&w2, e2);
+	more1 = ebitmap_walk_next(&w1, &s1, &m1);
+	more2 = ebitmap_walk_next(&w2, &s2, &m2);
 	prev = 0;
-	while (n1 || n2) {
+	while (more1 || more2) {
 		new = (ebitmap_node_t *) malloc(sizeof(ebitmap_node_t));
 		if (!new) {
+			dst->highbit = EBITMAP_DENSE_BITS + MAPSIZE;
 			ebitmap_destroy(dst);
 			return FALSE;
 		}
 		memset(new, 0, sizeof(ebitmap_node_t));
-		if (n1 && n2 && n1->startbit == n2->startbit) {
-			new->startbit = n1->startbit;
-			new->map = n1->map | n2->map;
-			n1 = n1->next;
-			n2 = n2->next;
-		} else if (!n2 || (n1 && n1->startbit < n2->startbit)) {
-			new->startbit = n1->startbit;
-			new->map = n1->map;
-			n1 = n1->next;
+		if (more1 && more2 && s1 == s2) {
+			new->startbit = s1;
+			new->map = m1 | m2;
+			more1 = ebitmap_walk_next(&w1, &s1, &m1);
+			more2 = ebitmap_walk_next(&w2, &s2, &m2);
+		} else if (!more2 || (more1 && s1 < s2)) {
+			new->startbit = s1;
+			new->map = m1;
+			more1 = ebitmap_walk_next(&w1, &s1, &m1);
 		} else {
-			new->startbit = n2->startbit;
-			new->map = n2->map;
-			n2 = n2->next;
+			new->startbit = s2;
+			new->map = m2;
+			more2 = ebitmap_walk_next(&w2, &s2, &m2);
 		}
 
 		new->next = 0;
 		if (prev)
 			prev->next = new;
 		else
-			dst->node = new;
+			dst->u.node = new;
 		prev = new;
 	}
 
@@ -74,13 +228,21 @@ int ebitmap_or(ebitmap_t * dst, ebitmap_t * e1, ebitmap_t * e2)
 int ebitmap_cmp(ebitmap_t * e1, ebitmap_t * e2)
 {
 	ebitmap_node_t *n1, *n2;
+	int i;
 
 
 	if (e1->highbit != e2->highbit)
 		return FALSE;
 
-	n1 = e1->node;
-	n2 = e2->node;
+	if (ebitmap_is_dense(e1)) {
+		for (i = 0; i < EBITMAP_DENSE_WORDS; i++)
+			if (e1->u.map[i] != e2->u.map[i])
+				return FALSE;
+		return TRUE;
+	}
+
+	n1 = e1->u.node;
+	n2 = e2->u.node;
 	while (n1 && n2 &&
 	       (n1->startbit == n2->startbit) &&
 	       (n1->map == n2->map)) {
@@ -100,12 +262,18 @@ int ebitmap_cpy(ebitmap_t * dst, ebitmap_t * src)
 	ebitmap_node_t *n, *new, *prev;
 
 
+	if (ebitmap_is_dense(src)) {
+		*dst = *src;
+		return TRUE;
+	}
+
 	ebitmap_init(dst);
-	n = src->node;
+	n = src->u.node;
 	prev = 0;
 	while (n) {
 		new = (ebitmap_node_t *) malloc(sizeof(ebitmap_node_t));
 		if (!new) {
+			dst->highbit = src->highbit;
 			ebitmap_destroy(dst);
 			return FALSE;
 		}
@@ -116,7 +284,7 @@ int ebitmap_cpy(ebitmap_t * dst, ebitmap_t * src)
 		if (prev)
 			prev->next = new;
 		else
-			dst->node = new;
+			dst->u.node = new;
 		prev = new;
 		n = n->next;
 	}
@@ -128,27 +296,40 @@ int ebitmap_cpy(ebitmap_t * dst, ebitmap_t * src)
 
 int ebitmap_contains(ebitmap_t * e1, ebitmap_t * e2)
 {
-	ebitmap_node_t *n1, *n2;
+	ebitmap_walk_t w1, w2;
+	__u32 s1 = 0, s2 = 0;
+	MAPTYPE m1 = 0, m2 = 0;
+	int more1, more2, i;
 
 
 	if (e1->highbit < e2->highbit)
 		return FALSE;
 
-	n1 = e1->node;
-	n2 = e2->node;
-	while (n1 && n2 && (n1->startbit <= n2->startbit)) {
-		if (n1->startbit < n2->startbit) {
-			n1 = n1->next;
+	if (ebitmap_is_dense(e1)) {
+		/* and so is e2 */
+		for (i = 0; i < EBITMAP_DENSE_WORDS; i++)
+			if ((e1->u.map[i] & e2->u.map[i]) != e2->u.map[i])
+				return FALSE;
+		return TRUE;
+	}
+
+	ebitmap_walk_start(&w1, e1);
+	ebitmap_walk_start(&w2, e2);
+	more1 = ebitmap_walk_next(&w1, &s1, &m1);
+	more2 = ebitmap_walk_next(&w2, &s2, &m2);
+	while (more1 && more2 && (s1 <= s2)) {
+		if (s1 < s2) {
+			more1 = ebitmap_walk_next(&w1, &s1, &m1);
 			continue;
 		}
-		if ((n1->map & n2->map) != n2->map)
+		if ((m1 & m2) != m2)
 			return FALSE;
 
-		n1 = n1->next;
-		n2 = n2->next;
+		more1 = ebitmap_walk_next(&w1, &s1, &m1);
+		more2 = ebitmap_walk_next(&w2, &s2, &m2);
 	}
 
-	if (n2)
+	if (more2)
 		return FALSE;
 
 	return TRUE;
@@ -160,10 +341,13 @@ int ebitmap_get_bit(ebitmap_t * e, unsigned long bit)
 	ebitmap_node_t *n;
 
 
-	if (e->highbit < bit)
+	if (e->highbit <= bit)
 		return FALSE;
 
-	n = e->node;
+	if (ebitmap_is_dense(e))
+		return (e->u.map[bit / MAPSIZE] >> (bit % MAPSIZE)) & MAPBIT;
+
+	n = e->u.node;
 	while (n && (n->startbit <= bit)) {
 		if ((n->startbit + MAPSIZE) > bit) {
 			if (n->map & (MAPBIT << (bit - n->startbit)))
@@ -178,13 +362,38 @@ int ebitmap_get_bit(ebitmap_t * e, unsigned long bit)
 }
 
 
-int ebitmap_set_bit(ebitmap_t * e, unsigned long bit, int value)
+/*
+ * Return the lowest set bit at or above `bit',
+ * or ebitmap_length(e) if there is none.
+ */
+unsigned int ebitmap_next_bit(ebitmap_t * e, unsigned int bit)
+{
+	ebitmap_walk_t w;
+	__u32 startbit;
+	MAPTYPE map;
+
+
+	ebitmap_walk_start(&w, e);
+	while (ebitmap_walk_next(&w, &startbit, &map)) {
+		if (startbit + MAPSIZE <= bit)
+			continue;
+		if (bit > startbit)
+			map &= ~(MAPTYPE) 0 << (bit - startbit);
+		if (map)
+			return startbit + ebitmap_ctz(map);
+	}
+
+	return e->highbit;
+}
+
+
+static int ebitmap_sparse_set_bit(ebitmap_t * e, unsigned long bit, int value)
 {
 	ebitmap_node_t *n, *prev, *new;
 
 
 	prev = 0;
-	n = e->node;
+	n = e->u.node;
 	while (n && n->startbit <= bit) {
 		if ((n->startbit + MAPSIZE) > bit) {
 			if (value) {
@@ -207,7 +416,7 @@ int ebitmap_set_bit(ebitmap_t * e, unsigned long bit, int value)
 					if (prev)
 						prev->next = n->next;
 					else
-						e->node = n->next;
+						e->u.node = n->next;
 
 					free(n);
 				}
@@ -237,10 +446,42 @@ int ebitmap_set_bit(ebitmap_t * e, unsigned long bit, int value)
 		new->next = prev->next;
 		prev->next = new;
 	} else {
-		new->next = e->node;
-		e->node = new;
+		new->next = e->u.node;
+		e->u.node = new;
+	}
+
+	return TRUE;
+}
+
+
+int ebitmap_set_bit(ebitmap_t * e, unsigned long bit, int value)
+{
+	if (ebitmap_is_dense(e)) {
+		if (bit < EBITMAP_DENSE_BITS) {
+			if (value)
+				e->u.map[bit / MAPSIZE] |= MAPBIT << (bit % MAPSIZE);
+			else
+				e->u.map[bit / MAPSIZE] &= ~(MAPBIT << (bit % MAPSIZE));
+			ebitmap_dense_highbit(e);
+			return TRUE;
+		}
+		if (!value)
+			return TRUE;
+
+		/* outgrowing the ebitmap */
+		if (!ebitmap_to_sparse(e))
+			return FALSE;
+		if (!ebitmap_sparse_set_bit(e, bit, value)) {
+			ebitmap_to_dense(e);
+			return FALSE;
+		}
+		return TRUE;
 	}
 
+	if (!ebitmap_sparse_set_bit(e, bit, value))
+		return FALSE;
+	if (ebitmap_is_dense(e))
+		ebitmap_to_dense(e);
 	return TRUE;
 }
 
@@ -253,15 +494,16 @@ void ebitmap_destroy(ebitmap_t * e)
 	if (!e)
 		return;
 
-	n = e->node;
-	while (n) {
-		temp = n;
-		n = n->next;
-		free(temp);
+	if (!ebitmap_is_dense(e)) {
+		n = e->u.node;
+		while (n) {
+			temp = n;
+			n = n->next;
+			free(temp);
+		}
 	}
 
-	e->highbit = 0;
-	e->node = 0;
+	ebitmap_init(e);
 	return;
 }
 
@@ -269,7 +511,7 @@ void ebitmap_destroy(ebitmap_t * e)
 int ebitmap_read(ebitmap_t * e, FILE * fp)
 {
 	ebitmap_node_t *n, *l;
-	__u32 buf[32], mapsize, count, i;
+	__u32 buf[32], mapsize, count, i, startbit, lastbit;
 	__u64 map;
 	size_t items;
 
@@ -287,65 +529,70 @@ int ebitmap_read(ebitmap_t * e, FILE * fp)
 		printf("security: ebitmap: map size %d does not match my size %d (high bit was %d)\n", mapsize, MAPSIZE, e->highbit);
 		return FALSE;
 	}
-	if (!e->highbit) {
-		e->node = NULL;
+	if (!e->highbit)
 		return TRUE;
-	}
 	if (e->highbit & (MAPSIZE - 1)) {
 		printf("security: ebitmap: high bit (%d) is not a multiple of the map size (%d)\n", e->highbit, MAPSIZE);
 		goto bad;
 	}
 	l = NULL;
+	lastbit = 0;
 	for (i = 0; i < count; i++) {
 		items = fread(buf, sizeof(__u32), 1, fp);
 		if (items != 1) {
 			printf("security: ebitmap: truncated map\n");
 			goto bad;
 		}
-		n = (ebitmap_node_t *) malloc(sizeof(ebitmap_node_t));
-		if (!n) {
-			printf("security: ebitmap: out of memory\n");
-			goto bad;
-		}
-		memset(n, 0, sizeof(ebitmap_node_t));
+		startbit = le32_to_cpu(buf[0]);
 
-		n->startbit = le32_to_cpu(buf[0]);
-
-		if (n->startbit & (MAPSIZE - 1)) {
-			printf("security: ebitmap start bit (%d) is not a multiple of the map size (%d)\n", n->startbit, MAPSIZE);
-			goto bad_free;
+		if (startbit & (MAPSIZE - 1)) {
+			printf("security: ebitmap start bit (%d) is not a multiple of the map size (%d)\n", startbit, MAPSIZE);
+			goto bad;
 		}
-		if (n->startbit > (e->highbit - MAPSIZE)) {
-			printf("security: ebitmap start bit (%d) is beyond the end of the bitmap (%d)\n", n->startbit, (e->highbit - MAPSIZE));
-			goto bad_free;
+		if (startbit > (e->highbit - MAPSIZE)) {
+			printf("security: ebitmap start bit (%d) is beyond the end of the bitmap (%d)\n", startbit, (e->highbit - MAPSIZE));
+			goto bad;
 		}
 		items = fread(&map, sizeof(__u64), 1, fp);
 		if (items != 1) {
 			printf("security: ebitmap: truncated map\n");
-			goto bad_free;
+			goto bad;
 		}
-		n->map = le64_to_cpu(map);
+		map = le64_to_cpu(map);
 
-		if (!n->map) {
-			printf("security: ebitmap: null map in ebitmap (startbit %d)\n", n->startbit);
-			goto bad_free;
+		if (!map) {
+			printf("security: ebitmap: null map in ebitmap (startbit %d)\n", startbit);
+			goto bad;
 		}
-		if (l) {
-			if (n->startbit <= l->startbit) {
-				printf("security: ebitmap: start bit %d comes after start bit %d\n", n->startbit, l->startbit);
-				goto bad_free;
-			}
+		if (i && startbit <= lastbit) {
+			printf("security: ebitmap: start bit %d comes after start bit %d\n", startbit, lastbit);
+			goto bad;
+		}
+		lastbit = startbit;
+
+		if (ebitmap_is_dense(e)) {
+			e->u.map[startbit / MAPSIZE] = map;
+			continue;
+		}
+
+		n = (ebitmap_node_t *) malloc(sizeof(ebitmap_node_t));
+		if (!n) {
+			printf("security: ebitmap: out of memory\n");
+			goto bad;
+		}
+		memset(n, 0, sizeof(ebitmap_node_t));
+		n->startbit = startbit;
+		n->map = map;
+		if (l)
 			l->next = n;
-		} else
-			e->node = n;
+		else
+			e->u.node = n;
 
 		l = n;
 	}
 
 	return TRUE;
 
-      bad_free:
-	free(n);
       bad:
 	ebitmap_destroy(e);
 	return FALSE;
@@ -355,8 +602,8 @@ int ebitmap_read(ebitmap_t * e, FILE * fp)
 #ifndef __KERNEL__
 int ebitmap_write(ebitmap_t * e, FILE * fp)
 {
-	ebitmap_node_t *n;
-	__u32 buf[32], bit, count;
+	ebitmap_walk_t w;
+	__u32 buf[32], bit, count, startbit;
 	__u64 map;
 	size_t items;
 
@@ -364,7 +611,8 @@ int ebitmap_write(ebitmap_t * e, FILE * fp)
 	buf[1] = cpu_to_le32(e->highbit);
 
 	count = 0;
-	for (n = e->node; n; n = n->next)
+	ebitmap_walk_start(&w, e);
+	while (ebitmap_walk_next(&w, &startbit, &map))
 		count++;
 	buf[2] = cpu_to_le32(count);
 
@@ -372,12 +620,13 @@ int ebitmap_write(ebitmap_t * e, FILE * fp)
 	if (items != 3)
 		return FALSE;
 
-	for (n = e->node; n; n = n->next) {
-		bit = cpu_to_le32(n->startbit);
+	ebitmap_walk_start(&w, e);
+	while (ebitmap_walk_next(&w, &startbit, &map)) {
+		bit = cpu_to_le32(startbit);
 		items = fwrite(&bit, sizeof(__u32), 1, fp);
 		if (items != 1)
 			return FALSE;
-		map = cpu_to_le64(n->map);
+		map = cpu_to_le64(map);
 		items = fwrite(&map, sizeof(__u64), 1, fp);
 		if (items != 1)
 			return FALSE;
@@ -29,7 +29,12 @@
  * Each extensible bitmap is implemented as a linked
  * list of bitmap nodes, where each bitmap node has
  * an explicitly specified starting bit position within
- * the total bitmap.
+ * the total bitmap.  Small bitmaps, which is nearly
+ * all of them, keep their bits in the ebitmap itself
+ * instead:  a bitmap is dense if its highbit is no more
+ * than EBITMAP_DENSE_BITS, and then the bits are in
+ * u.map, with the words past highbit zero.  Otherwise
+ * u.node is the first node of the list.
  */
 
 #ifndef _EBITMAP_H_
@@ -45,14 +50,30 @@ typedef struct ebitmap_node {
 	struct ebitmap_node *next;
 } ebitmap_node_t;
 
+#define EBITMAP_DENSE_WORDS 2
+#define EBITMAP_DENSE_BITS (EBITMAP_DENSE_WORDS * MAPSIZE)
+
 typedef struct ebitmap {
-	ebitmap_node_t *node;	/* first node in the bitmap */
+	union {
+		ebitmap_node_t *node;	/* first node in the bitmap */
+		MAPTYPE map[EBITMAP_DENSE_WORDS]; /* the bitmap, if dense */
+	} u;
 	__u32 highbit;	/* highest position in the total bitmap */
 } ebitmap_t;
 
 
 #define ebitmap_length(e) ((e)->highbit)
 
+#define ebitmap_is_dense(e) ((e)->highbit <= EBITMAP_DENSE_BITS)
+
+/*
+ * Visit the set bits of `e' in increasing order.
+ */
+#define ebitmap_for_each_bit(e, bit) \
+	for ((bit) = ebitmap_next_bit((e), 0); \
+	     (bit) < ebitmap_length(e); \
+	     (bit) = ebitmap_next_bit((e), (bit) + 1))
+
 #define ebitmap_init(e) memset(e, 0, sizeof(ebitmap_t))
 
 /*
@@ -71,6 +92,7 @@ int ebitmap_cpy(ebitmap_t * dst, ebitmap_t * src);
 int ebitmap_contains(ebitmap_t * e1, ebitmap_t * e2);
 int ebitmap_get_bit(ebitmap_t * e, unsigned long bit);
 int ebitmap_set_bit(ebitmap_t * e, unsigned long bit, int value);
+unsigned int ebitmap_next_bit(ebitmap_t * e, unsigned int bit);
 void ebitmap_destroy(ebitmap_t * e);
 int ebitmap_read(ebitmap_t * e, FILE * fp);
 #ifndef __KERNEL__
@@ -168,6 +168,7 @@ e %s oskit_security_%s\n", $3, $3);}' | sort
 #define ebitmap_cpy oskit_security_ebitmap_cpy
 #define ebitmap_destroy oskit_security_ebitmap_destroy
 #define ebitmap_get_bit oskit_security_ebitmap_get_bit
+#define ebitmap_next_bit oskit_security_ebitmap_next_bit
 #define ebitmap_or oskit_security_ebitmap_or
 #define ebitmap_read oskit_security_ebitmap_read
 #define ebitmap_set_bit oskit_security_ebitmap_set_bit
@@ -211,6 +212,7 @@ e %s oskit_security_%s\n", $3, $3);}' | sort
 #define security_transition_sid oskit_security_security_transition_sid
 #define sidtab oskit_security_sidtab
 #define sidtab_context_to_sid oskit_security_sidtab_context_to_sid
+#define sidtab_destroy oskit_security_sidtab_destroy
 #define sidtab_insert oskit_security_sidtab_insert
 #define sidtab_map oskit_security_sidtab_map
 #define sidtab_map_remove_on_error oskit_security_sidtab_map_remove_on_error
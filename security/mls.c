@@ -83,9 +83,8 @@ int mls_compute_context_len(context_struct_t * context)
 	for (l = 0; l < 2; l++) {
 		len += strlen(policydb.p_sens_val_to_name[context->range.level[l].sens - 1]) + 1;
 
-		for (i = 1; i <= ebitmap_length(&context->range.level[l].cat); i++)
-			if (ebitmap_get_bit(&context->range.level[l].cat, i - 1))
-				len += strlen(policydb.p_cat_val_to_name[i - 1]) + 1;
+		ebitmap_for_each_bit(&context->range.level[l].cat, i)
+			len += strlen(policydb.p_cat_val_to_name[i]) + 1;
 
 		if (mls_level_relation(context->range.level[0], context->range.level[1]) == MLS_RELATION_EQ)
 			break;
@@ -115,13 +114,12 @@ int mls_sid_to_context(context_struct_t * context,
 		scontextp += strlen(policydb.p_sens_val_to_name[context->range.level[l].sens - 1]);
 		*scontextp = ':';
 		scontextp++;
-		for (i = 1; i <= ebitmap_length(&context->range.level[l].cat); i++)
-			if (ebitmap_get_bit(&context->range.level[l].cat, i - 1)) {
-				strcpy(scontextp, policydb.p_cat_val_to_name[i - 1]);
-				scontextp += strlen(policydb.p_cat_val_to_name[i - 1]);
-				*scontextp = ',';
-				scontextp++;
-			}
+		ebitmap_for_each_bit(&context->range.level[l].cat, i) {
+			strcpy(scontextp, policydb.p_cat_val_to_name[i]);
+			scontextp += strlen(policydb.p_cat_val_to_name[i]);
+			*scontextp = ',';
+			scontextp++;
+		}
 		if (mls_level_relation(context->range.level[0], context->range.level[1]) != MLS_RELATION_EQ) {
 			scontextp--;
 			sprintf(scontextp, "-");
@@ -171,17 +169,15 @@ int mls_context_isvalid(policydb_t *p, context_struct_t * c)
 		if (!levdatum)
 			return FALSE;
 
-		for (i = 1; i <= ebitmap_length(&c->range.level[l].cat); i++) {
-			if (ebitmap_get_bit(&c->range.level[l].cat, i - 1)) {
-				if (i > p->p_cats.nprim)
-					return FALSE;
-				if (!ebitmap_get_bit(&levdatum->level->cat, i - 1))
-					/*
-					 * Category may not be associated with
-					 * sensitivity in low level.
-					 */
-					return FALSE;
-			}
+		ebitmap_for_each_bit(&c->range.level[l].cat, i) {
+			if (i >= p->p_cats.nprim)
+				return FALSE;
+			if (!ebitmap_get_bit(&levdatum->level->cat, i))
+				/*
+				 * Category may not be associated with
+				 * sensitivity in low level.
+				 */
+				return FALSE;
 		}
 	}
 
@@ -329,15 +325,13 @@ int mls_convert_context(policydb_t * oldp,
 		c->range.level[l].sens = levdatum->level->sens;
 
 		ebitmap_init(&bitmap);
-		for (i = 1; i <= ebitmap_length(&c->range.level[l].cat); i++) {
-			if (ebitmap_get_bit(&c->range.level[l].cat, i - 1)) {
-				catdatum = (cat_datum_t *) hashtab_search(newp->p_cats.table,
-					 oldp->p_cat_val_to_name[i - 1]);
-				if (!catdatum)
-					return -EINVAL;
-				if (!ebitmap_set_bit(&bitmap, catdatum->value - 1, TRUE))
-					return -ENOMEM;
-			}
+		ebitmap_for_each_bit(&c->range.level[l].cat, i) {
+			catdatum = (cat_datum_t *) hashtab_search(newp->p_cats.table,
+						 oldp->p_cat_val_to_name[i]);
+			if (!catdatum)
+				return -EINVAL;
+			if (!ebitmap_set_bit(&bitmap, catdatum->value - 1, TRUE))
+				return -ENOMEM;
 		}
 		ebitmap_destroy(&c->range.level[l].cat);
 		c->range.level[l].cat = bitmap;
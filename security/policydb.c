@@ -1085,7 +1085,7 @@ int policydb_read(policydb_t * p, FILE * fp)
 {
 	ocontext_t *c, *l;
 	int i, j;
-	__u32 buf[32], len, config, nprim, nel;
+	__u32 buf[32], len, config, version, nprim, nel;
 	size_t items;
 
 	config = 0;
@@ -1106,7 +1106,9 @@ int policydb_read(policydb_t * p, FILE * fp)
 	for (i = 0; i < 5; i++)
 		buf[i] = le32_to_cpu(buf[i]);
 
-	if (buf[0] != POLICYDB_VERSION) {
+	version = buf[0];
+	if (version != POLICYDB_VERSION &&
+	    version != POLICYDB_VERSION_AVTAB_LIST) {
 		printf("security:  policydb version %d does not match my version %d\n", buf[0], POLICYDB_VERSION);
 		return -1;
 	}
@@ -1168,7 +1170,7 @@ int policydb_read(policydb_t * p, FILE * fp)
 		}
 	}
 
-	if (avtab_read(&p->te_avtab, fp, config))
+	if (avtab_read(&p->te_avtab, fp, config, version))
 		goto bad;
 
 	if (policydb_index_classes(p))
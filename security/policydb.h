@@ -249,7 +249,8 @@ extern int policydb_read(policydb_t * p, FILE * fp);
 int policydb_write(policydb_t * p, FILE * fp);
 #endif
 
-#define POLICYDB_VERSION 1
+#define POLICYDB_VERSION 2
+#define POLICYDB_VERSION_AVTAB_LIST 1	/* avtab as a list of rules */
 #define POLICYDB_CONFIG_MLS    1
 #define POLICYDB_CONFIG_AUDIT  2
 #define POLICYDB_CONFIG_NOTIFY 4
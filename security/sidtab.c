@@ -27,20 +27,110 @@
 #include "sidtab.h"
 #include "services.h"
 
-#define SIDTAB_HASH(sid) \
-(sid % SIDTAB_SIZE)
+#define SIDTAB_HASH(s, sid) \
+((sid) & ((s)->size - 1))
+
+#define SIDTAB_CHASH(s, hash) \
+((hash) & ((s)->size - 1))
+
+
+/*
+ * Hash a context. Equal contexts (by context_cmp) hash equal.
+ */
+static __u32 context_hash(context_struct_t * c)
+{
+	__u32 hash;
+#ifdef CONFIG_FLASK_MLS
+	unsigned int bit;
+	int l;
+#endif
+
+	hash = c->user;
+	hash = hash * 31 + c->role;
+	hash = hash * 31 + c->type;
+#ifdef CONFIG_FLASK_MLS
+	for (l = 0; l < 2; l++) {
+		hash = hash * 31 + c->range.level[l].sens;
+		ebitmap_for_each_bit(&c->range.level[l].cat, bit)
+			hash = hash * 31 + bit;
+	}
+#endif
+	return hash * 2654435761U;
+}
+
+
+/*
+ * Make both tables `size' slots, moving over any entries.
+ */
+static int sidtab_resize(sidtab_t * s, unsigned int size)
+{
+	sidtab_node_t **htable, **ctable, *cur, *next;
+	unsigned int i, oldsize;
+
+	htable = (sidtab_node_t **) malloc(size * sizeof(*htable));
+	if (htable == NULL)
+		return -ENOMEM;
+	ctable = (sidtab_node_t **) malloc(size * sizeof(*ctable));
+	if (ctable == NULL) {
+		free(htable);
+		return -ENOMEM;
+	}
+	memset(htable, 0, size * sizeof(*htable));
+	memset(ctable, 0, size * sizeof(*ctable));
+
+	oldsize = s->size;
+	s->size = size;
+	for (i = 0; i < oldsize; i++) {
+		for (cur = s->htable[i]; cur != NULL; cur = next) {
+			next = cur->next;
+			cur->next = htable[SIDTAB_HASH(s, cur->sid)];
+			htable[SIDTAB_HASH(s, cur->sid)] = cur;
+			cur->cnext = ctable[SIDTAB_CHASH(s, cur->chash)];
+			ctable[SIDTAB_CHASH(s, cur->chash)] = cur;
+		}
+	}
+
+	if (oldsize) {
+		free(s->htable);
+		free(s->ctable);
+	}
+	s->htable = htable;
+	s->ctable = ctable;
+	return 0;
+}
+
+
+/*
+ * Take a node off its context chain.
+ */
+static void sidtab_cunlink(sidtab_t * s, sidtab_node_t * node)
+{
+	sidtab_node_t **prev;
+
+	prev = &s->ctable[SIDTAB_CHASH(s, node->chash)];
+	while (*prev != node)
+		prev = &(*prev)->cnext;
+	*prev = node->cnext;
+}
 
 
 int sidtab_insert(sidtab_t * s, security_id_t sid, context_struct_t * context)
 {
-	int hvalue;
+	int hvalue, ret;
 	sidtab_node_t *cur, *newnode;
 
 
 	if (!s)
 		return -ENOMEM;
 
-	hvalue = SIDTAB_HASH(sid);
+	/* if the table cannot grow, just let the chains get longer */
+	if (s->nel >= s->size) {
+		ret = sidtab_resize(s, s->size ? s->size * 2 : SIDTAB_MINSIZE);
+		if (ret && s->size == 0)
+			return ret;
+	}
+
+	hvalue = SIDTAB_HASH(s, sid);
 	cur = s->htable[hvalue];
 	while (cur != NULL && cur->sid != sid)
 		cur = cur->next;
@@ -56,10 +146,15 @@ int sidtab_insert(sidtab_t * s, security_id_t sid, context_struct_t * context)
 		free(newnode);
 		return -ENOMEM;
 	}
+	newnode->chash = context_hash(context);
 	newnode->next = s->htable[hvalue];
 	s->htable[hvalue] = newnode;
+	newnode->cnext = s->ctable[SIDTAB_CHASH(s, newnode->chash)];
+	s->ctable[SIDTAB_CHASH(s, newnode->chash)] = newnode;
 
 	s->nel++;
+	if (sid >= s->next_sid)
+		s->next_sid = sid + 1;
 	return 0;
 }
 
@@ -70,10 +165,10 @@ int sidtab_remove(sidtab_t * s, security_id_t sid)
 	sidtab_node_t *cur, *last;
 
 
-	if (!s)
+	if (!s || !s->size)
 		return -ENOENT;
 
-	hvalue = SIDTAB_HASH(sid);
+	hvalue = SIDTAB_HASH(s, sid);
 	last = NULL;
 	cur = s->htable[hvalue];
 	while (cur != NULL && cur->sid != sid) {
@@ -88,10 +183,12 @@ int sidtab_remove(sidtab_t * s, security_id_t sid)
 		s->htable[hvalue] = cur->next;
 	else
 		last->next = cur->next;
+	sidtab_cunlink(s, cur);
 
 	context_destroy(&cur->context);
 
 	free(cur);
+	s->nel--;
 	return 0;
 }
 
@@ -103,10 +200,10 @@ context_struct_t *
 	sidtab_node_t *cur;
 
 
-	if (!s)
+	if (!s || !s->size)
 		return NULL;
 
-	hvalue = SIDTAB_HASH(sid);
+	hvalue = SIDTAB_HASH(s, sid);
 	cur = s->htable[hvalue];
 	while (cur != NULL && cur->sid != sid)
 		cur = cur->next;
@@ -131,7 +228,7 @@ int sidtab_map(sidtab_t * s,
 	if (!s)
 		return 0;
 
-	for (i = 0; i < SIDTAB_SIZE; i++) {
+	for (i = 0; i < s->size; i++) {
 		cur = s->htable[i];
 		while (cur != NULL) {
 			ret = apply(cur->sid, &cur->context, args);
@@ -144,6 +241,10 @@ int sidtab_map(sidtab_t * s,
 }
 
 
+/*
+ * `apply' may change the contexts, so they are all
+ * hashed again afterwards.
+ */
 void sidtab_map_remove_on_error(sidtab_t * s,
 				int (*apply) (security_id_t sid,
 					      context_struct_t * context,
@@ -157,7 +258,7 @@ void sidtab_map_remove_on_error(sidtab_t * s,
 	if (!s)
 		return;
 
-	for (i = 0; i < SIDTAB_SIZE; i++) {
+	for (i = 0; i < s->size; i++) {
 		last = NULL;
 		cur = s->htable[i];
 		while (cur != NULL) {
@@ -171,8 +272,10 @@ void sidtab_map_remove_on_error(sidtab_t * s,
 
 				temp = cur;
 				cur = cur->next;
+				sidtab_cunlink(s, temp);
 				context_destroy(&temp->context);
 				free(temp);
+				s->nel--;
 			} else {
 				last = cur;
 				cur = cur->next;
@@ -180,6 +283,15 @@ void sidtab_map_remove_on_error(sidtab_t * s,
 		}
 	}
 
+	memset(s->ctable, 0, s->size * sizeof(*s->ctable));
+	for (i = 0; i < s->size; i++) {
+		for (cur = s->htable[i]; cur != NULL; cur = cur->next) {
+			cur->chash = context_hash(&cur->context);
+			cur->cnext = s->ctable[SIDTAB_CHASH(s, cur->chash)];
+			s->ctable[SIDTAB_CHASH(s, cur->chash)] = cur;
+		}
+	}
+
 	return;
 }
 
@@ -190,28 +302,28 @@ int sidtab_context_to_sid(sidtab_t * s,
 {
 	security_id_t sid;
 	sidtab_node_t *cur;
-	int i, ret;
+	__u32 hash;
+	int ret;
 
 
 	*out_sid = SECSID_NULL;
 
 	/* check to see if there is already a sid for this context */
-	for (i = 0; i < SIDTAB_SIZE; i++) {
-		cur = s->htable[i];
+	hash = context_hash(context);
+	if (s->size) {
+		cur = s->ctable[SIDTAB_CHASH(s, hash)];
 		while (cur != NULL) {
-			if (context_cmp(&cur->context, context)) {
+			if (cur->chash == hash &&
+			    context_cmp(&cur->context, context)) {
 				*out_sid = cur->sid;
 				return 0;
 			}
-			cur = cur->next;
+			cur = cur->cnext;
 		}
 	}
 
 	/* no sid exists; need to create a new entry in the sid table */
-	sid = s->nel + 1;
-	if (sid == 0) {	
-		return -1;
-	}
+	sid = s->next_sid ? s->next_sid : 1;
 	ret = sidtab_insert(s, sid, context);
 	if (ret) {
 		return -1;
@@ -220,4 +332,33 @@ int sidtab_context_to_sid(sidtab_t * s,
 	return 0;
 }
 
+
+/*
+ * Free everything in the table, leaving it empty.
+ */
+void sidtab_destroy(sidtab_t * s)
+{
+	int i;
+	sidtab_node_t *cur, *temp;
+
+
+	if (!s)
+		return;
+
+	for (i = 0; i < s->size; i++) {
+		cur = s->htable[i];
+		while (cur != NULL) {
+			temp = cur;
+			cur = cur->next;
+			context_destroy(&temp->context);
+			free(temp);
+		}
+	}
+	if (s->size) {
+		free(s->htable);
+		free(s->ctable);
+	}
+	memset(s, 0, sizeof(*s));
+}
+
 /* FLASK */
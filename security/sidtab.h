@@ -23,6 +23,9 @@
 /*
  * A security identifier table (sidtab) is a hash table
  * of security context structures indexed by SID value.
+ * Each context is also hashed into a second table, so
+ * that the SID for a context can be found without
+ * looking at every entry.
  */
 
 #ifndef _SIDTAB_H_
@@ -33,19 +36,31 @@
 typedef struct sidtab_node {
 	security_id_t sid;		/* security identifier */
 	context_struct_t context;	/* security context structure */
-	struct sidtab_node *next;
+	__u32 chash;			/* hash of the context */
+	struct sidtab_node *next;	/* next in SID chain */
+	struct sidtab_node *cnext;	/* next in context chain */
 } sidtab_node_t;
 
-#define SIDTAB_SIZE 23
+/*
+ * Both tables start out with SIDTAB_MINSIZE slots and double
+ * whenever there are more entries than slots. An all-zero
+ * sidtab is a valid empty one.
+ */
+#define SIDTAB_MINSIZE 64
 
 typedef struct {
-	sidtab_node_t *htable[SIDTAB_SIZE];
+	sidtab_node_t **htable;	/* by SID */
+	sidtab_node_t **ctable;	/* by context */
+	unsigned int size;	/* slots in each table, a power of two */
 	unsigned int nel;	/* number of elements */
+	security_id_t next_sid;	/* next SID to hand out */
 } sidtab_t;
 
 
 int sidtab_insert(sidtab_t * s, security_id_t sid, context_struct_t * context);
 
+int sidtab_remove(sidtab_t * s, security_id_t sid);
+
 context_struct_t *sidtab_search(sidtab_t * s, security_id_t sid);
 
 int sidtab_map(sidtab_t * s,
@@ -64,6 +79,8 @@ int sidtab_context_to_sid(sidtab_t * s,		/* IN */
 			  context_struct_t * context,	/* IN */
 			  security_id_t * sid);		/* OUT */
 
+void sidtab_destroy(sidtab_t * s);
+
 #endif	/* _SIDTAB_H_ */
 
 /* FLASK */
@@ -158,6 +158,42 @@ netio_push(oskit_netio_t *io, oskit_bufio_t *b, oskit_size_t size)
 	return 0;
 }
 
+/*
+ * Queue a batch of packets under one lock, and wake the thread once.
+ */
+static OSKIT_COMDECL
+netio_push_batch(oskit_netio_t *io, oskit_bufio_t **bufs, oskit_size_t *sizes,
+		 unsigned count)
+{
+        pthread_netio_impl_t *nio = (pthread_netio_impl_t *)io;
+	oskit_error_t	     err = 0;
+	int		     next;
+	unsigned	     i;
+
+	fast_mutex_spinlock(&nio->mutex);
+	for (i = 0; i < count; i++) {
+		next = NEXTI(nio->qtail);
+		if (next == nio->qhead) {
+#ifdef NETIOSTATS
+			nio->qdrops += count - i;
+#endif
+			err = ENOMEM;
+			break;
+		}
+		oskit_bufio_addref(bufs[i]);
+		nio->packets[nio->qtail] = bufs[i];
+		nio->qtail = next;
+#ifdef NETIOSTATS
+		nio->qpushes++;
+#endif
+	}
+	fast_mutex_unlock(&nio->mutex);
+	if (i)
+		pthread_cond_signal(&nio->cond);
+
+	return err;
+}
+
 static OSKIT_COMDECL
 netio_alloc_bufio(oskit_netio_t *io, oskit_size_t size,
 		  oskit_bufio_t **out_bufio)
@@ -170,7 +206,8 @@ static struct oskit_netio_ops oskit_pthread_netio_ops = {
 	netio_addref,
 	netio_release,
 	netio_push,
-	netio_alloc_bufio
+	netio_alloc_bufio,
+	netio_push_batch
 };
 
 static void
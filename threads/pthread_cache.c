@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * A small cache of thread structures and stacks, so that programs that
+ * create and destroy lots of short lived threads do not spend all their
+ * time in the memory allocator.
+ *
+ * When a thread is destroyed, its thread structure and stack are put in
+ * the cache (if there is room) instead of being handed back to the
+ * deallocator. The idle thread zeroes cached memory while it has nothing
+ * better to do, so that pthread_create usually gets memory that is ready
+ * to go. The clock timers hanging off a thread structure are kept with
+ * it, which saves creating them again.
+ *
+ * The cache links through a small header written at the start of each
+ * cached piece of memory. That header is cleared when the memory is
+ * handed out again.
+ */
+
+#include <threads/pthread_internal.h>
+#include <string.h>
+
+struct cache_entry {
+	struct cache_entry	*next;
+	size_t			size;		/* Size of the memory */
+	int			clean;		/* Already zeroed */
+};
+
+struct cache {
+	struct cache_entry	*entries;
+	int			count;
+	int			max;
+};
+
+#define DEFAULT_CACHE_THREADS	16
+#define DEFAULT_CACHE_STACKS	16
+
+static struct cache	thread_cache = { 0, 0, DEFAULT_CACHE_THREADS };
+static struct cache	stack_cache  = { 0, 0, DEFAULT_CACHE_STACKS };
+static int		dirty_entries;
+static pthread_cache_stats_t cache_stats;
+
+/*
+ * Taken with interrupts disabled. Never held across a call to the
+ * allocator or while zeroing memory.
+ */
+static pthread_lock_t	cache_lock = PTHREAD_LOCK_INITIALIZER;
+
+/*
+ * Take an entry of the right size out of a cache, preferring one that
+ * has already been zeroed. Cache is locked.
+ */
+static struct cache_entry *
+cache_get(struct cache *cache, size_t size)
+{
+	struct cache_entry	**pp, **found = 0, *entry;
+
+	for (pp = &cache->entries; *pp; pp = &(*pp)->next) {
+		if ((*pp)->size != size)
+			continue;
+		found = pp;
+		if ((*pp)->clean)
+			break;
+	}
+	if (! found)
+		return 0;
+
+	entry  = *found;
+	*found = entry->next;
+	cache->count--;
+	if (! entry->clean)
+		dirty_entries--;
+
+	return entry;
+}
+
+/*
+ * Put memory in a cache if there is room for it. Cache is locked.
+ */
+static int
+cache_put(struct cache *cache, void *mem, size_t size, int clean)
+{
+	struct cache_entry	*entry = mem;
+
+	if (cache->count >= cache->max) {
+		cache_stats.overflows++;
+		return 0;
+	}
+
+	entry->size  = size;
+	entry->clean = clean;
+	entry->next  = cache->entries;
+	cache->entries = entry;
+	cache->count++;
+	if (! clean)
+		dirty_entries++;
+
+	return 1;
+}
+
+/*
+ * Zero a thread structure, except for the timers.
+ */
+static void
+zero_thread(pthread_thread_t *pthread)
+{
+	struct oskit_timer	*condtimer  = pthread->condtimer;
+	struct oskit_timer	*sleeptimer = pthread->sleeptimer;
+
+	memset((void *) pthread, 0, PAGE_SIZE);
+
+	pthread->condtimer  = condtimer;
+	pthread->sleeptimer = sleeptimer;
+}
+
+/*
+ * Get zeroed memory for a thread structure. If it came from the cache,
+ * its timers are still attached.
+ */
+pthread_thread_t *
+pthread_cache_alloc_thread(void)
+{
+	struct cache_entry	*entry;
+	pthread_thread_t	*pthread;
+	int			enabled;
+
+	enabled = save_disable_interrupts();
+	pthread_lock(&cache_lock);
+	entry = cache_get(&thread_cache, PAGE_SIZE);
+	if (entry)
+		cache_stats.thread_hits++;
+	else
+		cache_stats.thread_misses++;
+	pthread_unlock(&cache_lock);
+	restore_interrupt_enable(enabled);
+
+	if (! entry) {
+		if ((pthread = threads_allocator(PAGE_SIZE)) == NULL)
+			return NULL_THREADPTR;
+		memset((void *) pthread, 0, PAGE_SIZE);
+		return pthread;
+	}
+
+	pthread = (pthread_thread_t *) entry;
+	if (entry->clean)
+		memset((void *) entry, 0, sizeof(*entry));
+	else
+		zero_thread(pthread);
+
+	return pthread;
+}
+
+/*
+ * Cache a dead thread structure. Returns zero if the cache is full,
+ * in which case the caller must dispose of it. Preemption is disabled.
+ */
+int
+pthread_cache_free_thread(pthread_thread_t *pthread)
+{
+	oskit_itimerspec_t	ts;
+	int			enabled, rc;
+
+	/*
+	 * Make sure the timers cannot go off on the next owner.
+	 */
+	memset(&ts, 0, sizeof(ts));
+	oskit_timer_settime(pthread->condtimer, 0, &ts);
+	oskit_timer_settime(pthread->sleeptimer, 0, &ts);
+
+	enabled = save_disable_interrupts();
+	pthread_lock(&cache_lock);
+	rc = cache_put(&thread_cache, pthread, PAGE_SIZE, 0);
+	pthread_unlock(&cache_lock);
+	restore_interrupt_enable(enabled);
+
+	return rc;
+}
+
+/*
+ * Get a zeroed stack of the given size.
+ */
+void *
+pthread_cache_alloc_stack(size_t size)
+{
+	struct cache_entry	*entry;
+	void			*pstk;
+	int			enabled;
+
+	enabled = save_disable_interrupts();
+	pthread_lock(&cache_lock);
+	entry = cache_get(&stack_cache, size);
+	if (entry)
+		cache_stats.stack_hits++;
+	else
+		cache_stats.stack_misses++;
+	pthread_unlock(&cache_lock);
+	restore_interrupt_enable(enabled);
+
+	if (! entry) {
+		if ((pstk = threads_allocator(size)) == NULL)
+			return NULL;
+		memset(pstk, 0, size);
+		return pstk;
+	}
+
+	if (entry->clean)
+		memset((void *) entry, 0, sizeof(*entry));
+	else
+		memset((void *) entry, 0, size);
+
+	return (void *) entry;
+}
+
+/*
+ * Cache a stack. Returns zero if the cache is full.
+ */
+int
+pthread_cache_free_stack(void *pstk, size_t size)
+{
+	int	enabled, rc;
+
+	enabled = save_disable_interrupts();
+	pthread_lock(&cache_lock);
+	rc = cache_put(&stack_cache, pstk, size, 0);
+	pthread_unlock(&cache_lock);
+	restore_interrupt_enable(enabled);
+
+	return rc;
+}
+
+/*
+ * Find a dirty entry and take it out of its cache. Cache is locked.
+ */
+static struct cache_entry *
+cache_get_dirty(struct cache *cache)
+{
+	struct cache_entry	**pp, *entry;
+
+	for (pp = &cache->entries; *pp; pp = &(*pp)->next) {
+		if (! (*pp)->clean) {
+			entry = *pp;
+			*pp   = entry->next;
+			cache->count--;
+			dirty_entries--;
+			return entry;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Called from the idle loop. Zero everything in the cache that has not
+ * been zeroed yet. The entry being zeroed is out of the cache while the
+ * lock is dropped, so nobody else can grab it half done.
+ */
+void
+pthread_cache_scrub(void)
+{
+	struct cache_entry	*entry;
+	size_t			size;
+	int			isthread, enabled;
+
+	while (dirty_entries) {
+		enabled = save_disable_interrupts();
+		pthread_lock(&cache_lock);
+		isthread = 1;
+		if ((entry = cache_get_dirty(&thread_cache)) == 0) {
+			isthread = 0;
+			entry = cache_get_dirty(&stack_cache);
+		}
+		pthread_unlock(&cache_lock);
+		restore_interrupt_enable(enabled);
+
+		if (! entry)
+			break;
+
+		size = entry->size;
+		if (isthread)
+			zero_thread((pthread_thread_t *) entry);
+		else
+			memset((void *) entry, 0, size);
+
+		enabled = save_disable_interrupts();
+		pthread_lock(&cache_lock);
+		cache_stats.scrubbed++;
+		if (! cache_put(isthread ? &thread_cache : &stack_cache,
+				entry, size, 1)) {
+			/*
+			 * Cache was shrunk in the meantime.
+			 */
+			pthread_unlock(&cache_lock);
+			restore_interrupt_enable(enabled);
+			if (isthread) {
+				oskit_timer_release(
+				    ((pthread_thread_t *) entry)->condtimer);
+				oskit_timer_release(
+				    ((pthread_thread_t *) entry)->sleeptimer);
+			}
+			threads_deallocator((void *) entry);
+			continue;
+		}
+		pthread_unlock(&cache_lock);
+		restore_interrupt_enable(enabled);
+	}
+}
+
+/*
+ * Change the cache limits. Anything over the new limits is freed.
+ */
+int
+oskit_pthread_cache_setsize(int maxthreads, int maxstacks)
+{
+	struct cache_entry	*threads = 0, *stacks = 0, *entry;
+	int			enabled;
+
+	if (maxthreads < 0 || maxstacks < 0)
+		return EINVAL;
+
+	enabled = save_disable_interrupts();
+	pthread_lock(&cache_lock);
+	thread_cache.max = maxthreads;
+	stack_cache.max  = maxstacks;
+
+	while (thread_cache.count > thread_cache.max) {
+		entry = thread_cache.entries;
+		thread_cache.entries = entry->next;
+		thread_cache.count--;
+		if (! entry->clean)
+			dirty_entries--;
+		entry->next = threads;
+		threads = entry;
+	}
+	while (stack_cache.count > stack_cache.max) {
+		entry = stack_cache.entries;
+		stack_cache.entries = entry->next;
+		stack_cache.count--;
+		if (! entry->clean)
+			dirty_entries--;
+		entry->next = stacks;
+		stacks = entry;
+	}
+	pthread_unlock(&cache_lock);
+	restore_interrupt_enable(enabled);
+
+	/*
+	 * Now free them without the lock held.
+	 */
+	while ((entry = threads) != 0) {
+		threads = entry->next;
+		oskit_timer_release(((pthread_thread_t *) entry)->condtimer);
+		oskit_timer_release(((pthread_thread_t *) entry)->sleeptimer);
+		threads_deallocator((void *) entry);
+	}
+	while ((entry = stacks) != 0) {
+		stacks = entry->next;
+		threads_deallocator((void *) entry);
+	}
+
+	return 0;
+}
+
+/*
+ * Return a snapshot of the cache statistics.
+ */
+int
+oskit_pthread_cache_stats(pthread_cache_stats_t *stats)
+{
+	int	enabled;
+
+	if (! stats)
+		return EINVAL;
+
+	enabled = save_disable_interrupts();
+	pthread_lock(&cache_lock);
+	*stats = cache_stats;
+	stats->maxthreads = thread_cache.max;
+	stats->maxstacks  = stack_cache.max;
+	stats->threads    = thread_cache.count;
+	stats->stacks     = stack_cache.count;
+	pthread_unlock(&cache_lock);
+	restore_interrupt_enable(enabled);
+
+	return 0;
+}
@@ -18,6 +18,7 @@
 #include <malloc.h>
 #include <threads/pthread_internal.h>
 #include "pthread_cond.h"
+#include "pthread_mutex.h"
 
 /*
  * Create and initialize a new condition variable
@@ -39,6 +40,7 @@ pthread_cond_init(pthread_cond_t *c, const pthread_condattr_t *attr)
 
         queue_init(&(pimpl->waiters));
 	pthread_lock_init(&(pimpl->lock));
+	pimpl->mutex = 0;
 	c->impl = pimpl;
 
         return 0;
@@ -75,6 +77,36 @@ pthread_cond_destroy(pthread_cond_t *c)
         return 0;
 }
 
+/*
+ * Remember which mutex the waiters use, so that pthread_cond_broadcast
+ * can move them over to it. Waiters using different mutexes (which
+ * POSIX does not allow anyway) are just woken up. Called with the
+ * condition locked, before going on the queue.
+ */
+OSKIT_INLINE void
+cond_setmutex(struct pthread_cond_impl *pimpl, pthread_mutex_t *m)
+{
+	if (queue_empty(&(pimpl->waiters)))
+		pimpl->mutex = m;
+	else if (pimpl->mutex != m)
+		pimpl->mutex = 0;
+}
+
+/*
+ * Get the mutex back after a wait. A waiter that pthread_cond_broadcast
+ * moved onto the mutex queue has been handed it already.
+ */
+OSKIT_INLINE void
+cond_relock(pthread_mutex_t *m)
+{
+	pthread_thread_t	*pthread = CURPTHREAD();
+
+	if (pthread->mutex_handoff)
+		pthread->mutex_handoff = 0;
+	else
+		pthread_mutex_lock(m);
+}
+
 /*
  * Wait on a condition. The timedwait version is below. Because of the
  * timer, conditions have to be manipulated at splhigh to avoid deadlock
@@ -107,6 +139,7 @@ pthread_cond_wait(pthread_cond_t *c, pthread_mutex_t *m)
 
         /* place ourself on the queue */
 	queue_check(&(pimpl->waiters), pthread);
+	cond_setmutex(pimpl, m);
 	queue_enter(&(pimpl->waiters), pthread, pthread_thread_t *, chain);
 	
         /* unlock mutex */
@@ -125,8 +158,8 @@ pthread_cond_wait(pthread_cond_t *c, pthread_mutex_t *m)
 	enable_interrupts();
 	restore_preemption_enable(enabled);
 
-        /* grab mutex before returning */
-        pthread_mutex_lock(m);
+        /* grab mutex before returning, unless broadcast handed it over */
+	cond_relock(m);
 
 	/* Look for a cancelation point */
 	pthread_testcancel();
@@ -158,6 +191,7 @@ pthread_cond_wait_safe(pthread_cond_t *c, pthread_mutex_t *m)
 
         /* place ourself on the queue */
 	queue_check(&(pimpl->waiters), pthread);
+	cond_setmutex(pimpl, m);
 	queue_enter(&(pimpl->waiters), pthread, pthread_thread_t *, chain);
 	
         /* unlock mutex */
@@ -185,8 +219,8 @@ pthread_cond_wait_safe(pthread_cond_t *c, pthread_mutex_t *m)
 	restore_interrupt_enable(enabled);
 	restore_preemption_enable(preemptable);
 
-        /* grab mutex before returning */
-        pthread_mutex_lock(m);
+        /* grab mutex before returning, unless broadcast handed it over */
+	cond_relock(m);
 
         return 0;
 }
@@ -240,6 +274,7 @@ pthread_cond_timedwait(pthread_cond_t *c, pthread_mutex_t *m,
 
         /* place ourself on the queue */
 	queue_check(&(pimpl->waiters), pthread);
+	cond_setmutex(pimpl, m);
 	queue_enter(&(pimpl->waiters), pthread, pthread_thread_t *, chain);
 
         /* unlock mutex */
@@ -293,8 +328,8 @@ pthread_cond_timedwait(pthread_cond_t *c, pthread_mutex_t *m,
 	enable_interrupts();
 	restore_preemption_enable(enabled);
 	
-        /* grab mutex before returning */
-        pthread_mutex_lock(m);
+        /* grab mutex before returning, unless broadcast handed it over */
+	cond_relock(m);
 
 	/* Look for a cancelation point */
 	pthread_testcancel();
@@ -360,6 +395,7 @@ pthread_cond_donate_wait(pthread_cond_t *c, pthread_mutex_t *m,
 
         /* place ourself on the queue */
 	queue_check(&(pimpl->waiters), pthread);
+	cond_setmutex(pimpl, m);
 	queue_enter(&(pimpl->waiters), pthread, pthread_thread_t *, chain);
 
         /* unlock mutex */
@@ -418,8 +454,8 @@ pthread_cond_donate_wait(pthread_cond_t *c, pthread_mutex_t *m,
 	enable_interrupts();
 	restore_preemption_enable(enabled);
 	
-        /* grab mutex before returning */
-        pthread_mutex_lock(m);
+        /* grab mutex before returning, unless broadcast handed it over */
+	cond_relock(m);
 
 	/* Look for a cancelation point */
 	pthread_testcancel();
@@ -576,9 +612,20 @@ pthread_cond_broadcast(pthread_cond_t *c)
 		pnext->waitflags &= ~THREAD_WS_CONDWAIT;
 		pnext->waitcond   = 0;
 		pthread_unlock(&pnext->waitlock);
-		pthread_sched_setrunnable(pnext);
 	}
-	queue_init(&(pimpl->waiters));
+
+	/*
+	 * Rather than wake them all up to fight over the mutex, move them
+	 * onto the mutex queue to be handed the mutex one at a time.
+	 */
+	if (! pimpl->mutex ||
+	    ! pthread_mutex_requeue(pimpl->mutex, &(pimpl->waiters))) {
+		while (! queue_empty(&(pimpl->waiters))) {
+			queue_remove_first(&(pimpl->waiters),
+					   pnext, pthread_thread_t *, chain);
+			pthread_sched_setrunnable(pnext);
+		}
+	}
 	pthread_unlock(&(pimpl->lock));
 
 	restore_interrupt_enable(enabled);
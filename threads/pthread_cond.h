@@ -21,4 +21,5 @@
 struct pthread_cond_impl {
 	spin_lock_t	lock;		/* Lock for this data structure */
         queue_head_t	waiters;        /* queue for cond var */
+	pthread_mutex_t	*mutex;		/* Mutex the waiters use, if one */
 };
@@ -156,12 +156,12 @@ pthread_create_internal(void *(*function)(void *), void *argument,
 	if (! attr)
 		attr = &pthread_attr_default;
 
-	if ((pthread =
-	     (pthread_thread_t *) threads_allocator(PAGE_SIZE)) == NULL)
+	/*
+	 * Comes back zeroed, possibly from the cache of dead threads.
+	 */
+	if ((pthread = pthread_cache_alloc_thread()) == NULL_THREADPTR)
 		panic("pthread_create_internal: Not enough memory");
 
-	memset((void *) pthread, 0, PAGE_SIZE);
-
 	if ((pthread->ssize = attr->stacksize) < PTHREAD_STACK_MIN)
 		return NULL_THREADPTR;
 
@@ -172,6 +172,7 @@ pthread_create_internal(void *(*function)(void *), void *argument,
 	if (attr->stackaddr) {
 		pthread->pstk  = attr->stackaddr;
 		pthread->flags = THREAD_USERSTACK;
+		memset(pthread->pstk, 0, pthread->ssize);
 	}
 	else {
 		if (attr->guardsize) {
@@ -179,10 +180,10 @@ pthread_create_internal(void *(*function)(void *), void *argument,
 			pthread->ssize    += pthread->guardsize;
 		}
 
-		if ((pthread->pstk = threads_allocator(pthread->ssize)) == NULL)
+		if ((pthread->pstk =
+		     pthread_cache_alloc_stack(pthread->ssize)) == NULL)
 			panic("pthread_create_internal: Not enough memory");
 	}
-	memset(pthread->pstk, 0, pthread->ssize);
 
 	/*
 	 * Set up the thread.
@@ -206,7 +207,8 @@ pthread_create_internal(void *(*function)(void *), void *argument,
 	pthread_lock_init(&pthread->siglock);
 	pthread_mutex_init(&pthread->mutex, NULL);
 	pthread_cond_init(&pthread->cond, NULL);
-	pthread_prepare_timer(pthread);
+	if (! pthread->condtimer)
+		pthread_prepare_timer(pthread);
 
 #ifdef	THREAD_STATS
 	pthread->stats.rmin = pthread->stats.qmin = 100000000; /* XXX */
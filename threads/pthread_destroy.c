@@ -55,9 +55,11 @@ pthread_destroy_internal(pthread_thread_t *pthread)
 	thread_destroy(pthread);
 	
 	/*
-	 * Callout for memory deallocator. 
+	 * Keep the stack for the next thread if there is room, otherwise
+	 * callout for memory deallocator.
 	 */
-	if (pthread->pstk && (! (pthread->flags & THREAD_USERSTACK)))
+	if (pthread->pstk && (! (pthread->flags & THREAD_USERSTACK)) &&
+	    ! pthread_cache_free_stack(pthread->pstk, pthread->ssize))
 		threads_deallocator(pthread->pstk);
 
 #ifdef	CPU_INHERIT
@@ -69,9 +71,6 @@ pthread_destroy_internal(pthread_thread_t *pthread)
 		pthread_sched_message_send(pthread->scheduler, &msg);
 	}
 #endif
-	oskit_timer_release(pthread->condtimer);
-	oskit_timer_release(pthread->sleeptimer);
-	
 	rc = pthread_cond_destroy(&pthread->cond);
 	assert(rc == 0);
 	rc = pthread_mutex_destroy(&pthread->mutex);
@@ -84,12 +83,19 @@ pthread_destroy_internal(pthread_thread_t *pthread)
 	}
 #endif
 
-	threads_deallocator(pthread);
-	
 	/*
-	 * Release the TID.
+	 * Release the TID before the structure can be handed out again.
 	 */
 	threads_tidtothread[(int) tid] = 0;
+
+	/*
+	 * The thread structure (and its timers) can be cached too.
+	 */
+	if (! pthread_cache_free_thread(pthread)) {
+		oskit_timer_release(pthread->condtimer);
+		oskit_timer_release(pthread->sleeptimer);
+		threads_deallocator(pthread);
+	}
 }
 
 /*
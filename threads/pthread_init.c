@@ -36,6 +36,8 @@ int			threads_alive                    = 1; /* Main */
 
 #ifdef SMP
 pthread_lock_t		threads_smpboot_lock = PTHREAD_LOCK_INITIALIZER;
+volatile int		threads_ipi_tick[MAXCPUS]        = { 0 };
+volatile int		threads_ipi_resched[MAXCPUS]     = { 0 };
 #endif
 
 int		        threads_initialized  = 0;
@@ -290,14 +292,11 @@ pthread_init_internal(int preemptible, pthread_thread_t *mainthread)
 }
 
 /*
- * Preemption interrupt.
+ * Charge a clock tick to the thread running on this processor.
  */
-void
-pthread_interrupt_handler(void)
+static void
+pthread_tick_account(void)
 {
-	if (! threads_preempt_ready)
-		return;
-	
 	if (CURPTHREAD()) {
 		CURPTHREAD()->cputime++;
 		CURPTHREAD()->cpticks++;
@@ -315,6 +314,19 @@ pthread_interrupt_handler(void)
 		}
 #endif
 	}
+}
+
+/*
+ * Preemption interrupt. Only the base processor gets these; it passes
+ * each tick on to the others with an IPI.
+ */
+void
+pthread_interrupt_handler(void)
+{
+	if (! threads_preempt_ready)
+		return;
+
+	pthread_tick_account();
 	threads_realticks++;
 
 	/*
@@ -372,21 +384,18 @@ pthread_interrupt_handler(void)
 
 #ifndef CPU_INHERIT
 #ifdef SMP
-	if (THISCPU == threads_base_processor) {
+	{
 		int	curr = -1;
 		int	i;
 
 		for (i = 0; i < threads_num_processors; i++) {
 			curr = smp_find_cpu(curr);			
-			if (curr != threads_base_processor)
+			if (curr != threads_base_processor) {
+				threads_ipi_tick[curr] = 1;
 				smp_message_pass(curr);
+			}
 		}
 	}
-	else {
-		if (PREEMPT_ENABLE && CURPTHREAD() != IDLETHREAD) 
-			pthread_preempt();
-		return;
-	}
 #endif
 #ifdef LATENCY_THREAD
 	if (hiprio) {
@@ -463,13 +472,53 @@ pthread_smp_booted(void *ignored)
 	exit(1);
 }
 
+/*
+ * The IPI is used both to pass on clock ticks from the base processor,
+ * and by the scheduler to get another CPU to reschedule when a thread
+ * it should be running was put on its RunQ. Each sets its own flag
+ * before sending, since two of them can arrive as one interrupt.
+ *
+ * A tick here is only charged to the running thread; the clock and the
+ * CPU percentages are kept by the base processor.
+ */
 void
 pthread_ipi_handler(void *ignored)
 {
+	int	tick = 0, resched = 0;
+
 	/* ack the interrupt */
 	smp_apic_ack();
 
-	pthread_interrupt();
+	if (threads_ipi_tick[THISCPU]) {
+		threads_ipi_tick[THISCPU] = 0;
+		tick = threads_preempt_ready;
+	}
+	if (threads_ipi_resched[THISCPU]) {
+		threads_ipi_resched[THISCPU] = 0;
+		resched = 1;
+	}
+
+	if (tick)
+		pthread_tick_account();
+
+	/*
+	 * If the CPU is idle, it will find the new thread when the idle
+	 * loop wakes up from the interrupt.
+	 */
+	if ((tick || resched) && PREEMPT_ENABLE && CURPTHREAD() != IDLETHREAD)
+		pthread_preempt();
+}
+
+/*
+ * Tell another CPU to reschedule. If preemption is disabled over there,
+ * the needed flag makes it happen when preemption is turned back on.
+ */
+void
+pthread_smp_resched(int cpu)
+{
+	threads_preempt_needed[cpu] = 1;
+	threads_ipi_resched[cpu]    = 1;
+	smp_message_pass(cpu);
 }
 #endif
 
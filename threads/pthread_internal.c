@@ -74,6 +74,7 @@ pthread_idle_function(void *arg)
 		assert_preemption_disabled();
 
 		pthread_reap_threads();
+		pthread_cache_scrub();
 
 		/*
 		 * If nothing to schedule call the delay function
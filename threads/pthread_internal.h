@@ -68,10 +68,12 @@
 #include <oskit/smp.h>
 #endif
 
-#if defined(RTSCHED_STATS) || defined(SCHED_STATS) || defined(IPC_STATS) || defined(THREAD_STATS)
+#if defined(RTSCHED_STATS) || defined(SCHED_STATS) || defined(IPC_STATS) || \
+    defined(THREAD_STATS) || defined(SCHED_TRACE)
 #include "pthread_stats.h"
 #else
 #define PCOUNT(x)
+#define TRACE_EVENT(event, pthread, arg)
 #endif
 
 /*
@@ -80,6 +82,7 @@
  */
 typedef struct pthread_thread {
 	queue_chain_t		runq;		/* Runq/free link */
+	int			runq_slot;	/* Slot in a heap runq */
 	pcb_t			*ppcb;		/* Pointer to PCB */
 	void			*pstk;		/* Pointer to stack alloc */
 	void			*(*func)(void *);/* Start function */
@@ -123,6 +126,8 @@ typedef struct pthread_thread {
 	pthread_lock_t		waitlock;	/* Lock */
 	oskit_u32_t		waitflags;	/* Wait state flags */
 	pthread_cond_t		*waitcond;	/* Condition variable */
+	int			mutex_handoff;	/* Broadcast moved us to the
+						   mutex queue */
 	struct osenv_sleeprec	*sleeprec;	/* pthread in an osenv_sleep */
 
 	/*
@@ -136,6 +141,7 @@ typedef struct pthread_thread {
 		oskit_size_t		reply_size;
 		queue_head_t		senders;
 		queue_chain_t		senders_chain;
+		struct oskit_ipc_lent	*lent;		/* Lent receive */
 	} ipc_state;
 
 	/*
@@ -185,6 +191,7 @@ typedef struct pthread_thread {
 	int			priority;	/* Current Priority */
 	int			base_priority;  /* Original priority */
 	int			ticks;		/* Scheduling ticks left */
+	int			cpu;		/* RunQ (CPU) it belongs to */
 #ifdef  PTHREAD_SCHED_STRIDE
 	int			tickets;
 	int			stride;
@@ -379,9 +386,13 @@ void		pthread_sched_priority_transfer_and_wait(pthread_thread_t *p,
 				pthread_lock_t *plock);
 
 /*
- * The maximum number of allowed threads.
+ * The maximum number of allowed threads. Several things are sized by
+ * this or scan all of it, so it is kept small unless asked for; see
+ * MakeFlags.
  */
+#ifndef THREADS_MAX_THREAD
 #define THREADS_MAX_THREAD	512
+#endif
 
 /*
  * The array of thread structure pointers, indexed by TID.
@@ -458,6 +469,9 @@ pthread_thread_t *pthread_current(void);
 int		  pthread_setprio_internal(pthread_thread_t *pthread, int pri);
 void		  pthread_preempt(void);
 void		  pthread_yield(void);
+#ifdef SMP
+void		  pthread_smp_resched(int cpu);
+#endif
 int		  threads_stack_back_trace(int tid, int max_st_levels);
 void		  thread_getstate(pthread_thread_t *pth, pthread_state_t *pst);
 void		  pthread_call_key_destructors(void);
@@ -472,6 +486,12 @@ int		  pthread_cond_wait_safe(pthread_cond_t *c,
 void		  pthread_exit_locked(void *status) OSKIT_NORETURN;
 void		  pthread_reap_threads(void);
 
+pthread_thread_t *pthread_cache_alloc_thread(void);
+int		  pthread_cache_free_thread(pthread_thread_t *pthread);
+void		 *pthread_cache_alloc_stack(size_t size);
+int		  pthread_cache_free_stack(void *pstk, size_t size);
+void		  pthread_cache_scrub(void);
+
 int		  pthread_init_comlock(void);
 void		  pthread_init_attributes(void);
 void		  pthread_init_guard(void);
@@ -495,6 +515,8 @@ int		  sigqueue_internal(pid_t pid, int signo,
 /*
  * Internal mutex prototypes.
  */
+int		  pthread_mutex_requeue(pthread_mutex_t *m,
+			queue_head_t *q);
 void		  pthread_mutex_panic(pthread_mutex_t *m,
 			char *t, char *msg);
 
@@ -22,6 +22,7 @@
 #include <threads/pthread_ipc.h>
 #include <stdlib.h>
 #include <string.h>
+#include <malloc.h>
 
 #define MIN(x, y)		((x) <= (y) ? (x) : (y))
 #define ANYTID			((pthread_t) -1)
@@ -40,6 +41,19 @@ pthread_init_ipc(void)
 #endif
 }
 
+/*
+ * Lend a sender's buffers to a receiver, instead of copying. The sender
+ * has its message and reply buffers (none for a plain send) filled in.
+ */
+static void
+ipc_lend(oskit_ipc_lent_t *lent, pthread_thread_t *sender)
+{
+	lent->msg        = sender->ipc_state.msg;
+	lent->msg_size   = sender->ipc_state.msg_size;
+	lent->reply      = sender->ipc_state.reply;
+	lent->reply_size = sender->ipc_state.reply_size;
+}
+
 /*
  * Send a message. Synchronous. Caller blocks until receiver picks
  * up the message, or until the timeout expires.
@@ -50,6 +64,7 @@ oskit_ipc_send(pthread_t dst,
 {
 	pthread_thread_t	*pthread = CURPTHREAD();
 	pthread_thread_t	*target;
+	oskit_ipc_lent_t	*lent;
 	int			err = 0;
 #ifdef  IPC_STATS
 	stat_stamp_t		before;
@@ -76,7 +91,15 @@ oskit_ipc_send(pthread_t dst,
 	if (target->waitflags & THREAD_WS_IPCRECV_WAIT &&
 	    (target->ipc_state.tid == pthread->tid ||
 	     target->ipc_state.tid == ANYTID)) {
-		if (msg_size) {
+		lent = target->ipc_state.lent;
+		if (lent) {
+			pthread->ipc_state.msg        = msg;
+			pthread->ipc_state.msg_size   = msg_size;
+			pthread->ipc_state.reply      = 0;
+			pthread->ipc_state.reply_size = 0;
+			ipc_lend(lent, pthread);
+		}
+		else if (msg_size) {
 			memcpy(target->ipc_state.msg,
 			       msg, MIN(msg_size, target->ipc_state.msg_size));
 
@@ -100,6 +123,16 @@ oskit_ipc_send(pthread_t dst,
 		stats.sends++;
 		stats.send_cycles += STAT_STAMPDIFF(before);
 #endif
+		/*
+		 * A lent message belongs to the receiver until it replies,
+		 * so wait for the reply.
+		 */
+		if (lent) {
+			pthread->ipc_state.tid = dst;
+			pthread_sched_handoff(THREAD_WS_IPCREPL_WAIT, target);
+			goto sent;
+		}
+
 		/*
 		 * And handoff to the receiver. No waitstate is provided,
 		 * so the sender yields to the receiver (sender does not
@@ -119,10 +152,12 @@ oskit_ipc_send(pthread_t dst,
 	queue_enter(&target->ipc_state.senders,
 		    pthread, pthread_thread_t *, ipc_state.senders_chain)
 
-	pthread->ipc_state.msg      = msg;
-	pthread->ipc_state.msg_size = msg_size;
-	pthread->ipc_state.tid      = dst;
-	pthread->waitflags         |= THREAD_WS_IPCSEND_WAIT;
+	pthread->ipc_state.msg        = msg;
+	pthread->ipc_state.msg_size   = msg_size;
+	pthread->ipc_state.reply      = 0;
+	pthread->ipc_state.reply_size = 0;
+	pthread->ipc_state.tid        = dst;
+	pthread->waitflags           |= THREAD_WS_IPCSEND_WAIT;
 	pthread_unlock(&target->waitlock);
 #ifdef  IPC_STATS
 	stats.sblocks++;
@@ -133,6 +168,7 @@ oskit_ipc_send(pthread_t dst,
 	/*
 	 * Back from send. The receiver woke us up, or we got canceled.
 	 */
+  sent:
 	pthread_lock(&pthread->lock);
 	if (pthread->flags & THREAD_CANCELED) {
 		pthread_unlock(&pthread->lock);
@@ -153,12 +189,12 @@ oskit_ipc_send(pthread_t dst,
 
 /*
  * Blocking receive. The receiver waits for a message from the specified
- * source thread.
+ * source thread. The message is copied, or lent if lent is non-null.
  */
-oskit_error_t
-oskit_ipc_recv(pthread_t src,
-	       void *msg, oskit_size_t msg_size, oskit_size_t *actual,
-	       oskit_s32_t timeout)
+static oskit_error_t
+ipc_recv(pthread_t src,
+	 void *msg, oskit_size_t msg_size, oskit_size_t *actual,
+	 oskit_ipc_lent_t *lent, oskit_s32_t timeout)
 {
 	pthread_thread_t	*pthread = CURPTHREAD();
 	pthread_thread_t	*source;
@@ -189,13 +225,19 @@ oskit_ipc_recv(pthread_t src,
 	pthread_lock(&source->waitlock);
 	if (source->waitflags & THREAD_WS_IPCSEND_WAIT &&
 	    source->ipc_state.tid == pthread->tid) {
-		*actual = MIN(msg_size, source->ipc_state.msg_size);
+		if (lent) {
+			ipc_lend(lent, source);
+			source->waitflags |= THREAD_WS_IPCREPL_WAIT;
+		}
+		else {
+			*actual = MIN(msg_size, source->ipc_state.msg_size);
 
-		if (*actual) {
-			memcpy(msg, source->ipc_state.msg, *actual);
+			if (*actual) {
+				memcpy(msg, source->ipc_state.msg, *actual);
 
-			if (source->ipc_state.msg_size > msg_size)
-				err = OSKIT_ERANGE;
+				if (source->ipc_state.msg_size > msg_size)
+					err = OSKIT_ERANGE;
+			}
 		}
 
 		/*
@@ -238,6 +280,7 @@ oskit_ipc_recv(pthread_t src,
 	 */
 	pthread->ipc_state.msg      = msg;
 	pthread->ipc_state.msg_size = msg_size;
+	pthread->ipc_state.lent     = lent;
 	pthread->ipc_state.tid      = src;
 	pthread->waitflags         |= THREAD_WS_IPCRECV_WAIT;
 #ifdef  IPC_STATS
@@ -261,21 +304,39 @@ oskit_ipc_recv(pthread_t src,
 	 * Message was transfered. Check for short message.
 	 */
 	*actual = pthread->ipc_state.msg_size;
-	if (pthread->ipc_state.msg_size > msg_size)
+	if (! lent && pthread->ipc_state.msg_size > msg_size)
 		err = OSKIT_ERANGE;
 
 	enable_interrupts();
 	return err;
 }
 
-/*
- * Blocking wait. The receiver waits for a message from any source thread.
- * The id of the source is returned.
- */
 oskit_error_t
-oskit_ipc_wait(pthread_t *src,
+oskit_ipc_recv(pthread_t src,
 	       void *msg, oskit_size_t msg_size, oskit_size_t *actual,
 	       oskit_s32_t timeout)
+{
+	return ipc_recv(src, msg, msg_size, actual, 0, timeout);
+}
+
+/*
+ * Receive a lent message from the specified source thread.
+ */
+oskit_error_t
+oskit_ipc_recv_lent(pthread_t src, oskit_ipc_lent_t *lent, oskit_s32_t timeout)
+{
+	return ipc_recv(src, 0, 0, &lent->msg_size, lent, timeout);
+}
+
+/*
+ * Blocking wait. The receiver waits for a message from any source thread.
+ * The id of the source is returned. The message is copied, or lent if
+ * lent is non-null.
+ */
+static oskit_error_t
+ipc_wait(pthread_t *src,
+	 void *msg, oskit_size_t msg_size, oskit_size_t *actual,
+	 oskit_ipc_lent_t *lent, oskit_s32_t timeout)
 {
 	pthread_thread_t	*pthread = CURPTHREAD();
 	pthread_thread_t	*source;
@@ -315,15 +376,22 @@ oskit_ipc_wait(pthread_t *src,
 
 	/*
 	 * The message can be transfered from the sender, and then the
-	 * sender is woken up.
+	 * sender is woken up. A lent message keeps the sender waiting
+	 * until the reply.
 	 */
-	*actual = MIN(msg_size, source->ipc_state.msg_size);
+	if (lent) {
+		ipc_lend(lent, source);
+		source->waitflags |= THREAD_WS_IPCREPL_WAIT;
+	}
+	else {
+		*actual = MIN(msg_size, source->ipc_state.msg_size);
 
-	if (*actual) {
-		memcpy(msg, source->ipc_state.msg, *actual);
+		if (*actual) {
+			memcpy(msg, source->ipc_state.msg, *actual);
 
-		if (source->ipc_state.msg_size > msg_size)
-			err = OSKIT_ERANGE;
+			if (source->ipc_state.msg_size > msg_size)
+				err = OSKIT_ERANGE;
+		}
 	}
 
 	/*
@@ -375,6 +443,7 @@ oskit_ipc_wait(pthread_t *src,
 	 */
 	pthread->ipc_state.msg      = msg;
 	pthread->ipc_state.msg_size = msg_size;
+	pthread->ipc_state.lent     = lent;
 	pthread->ipc_state.tid      = ANYTID;
 	pthread->waitflags         |= THREAD_WS_IPCRECV_WAIT;
 #ifdef  IPC_STATS
@@ -399,13 +468,31 @@ oskit_ipc_wait(pthread_t *src,
 	 */
 	*src    = pthread->ipc_state.tid;
 	*actual = pthread->ipc_state.msg_size;
-	if (pthread->ipc_state.msg_size > msg_size)
+	if (! lent && pthread->ipc_state.msg_size > msg_size)
 		err = OSKIT_ERANGE;
 
 	enable_interrupts();
 	return err;
 }
 
+oskit_error_t
+oskit_ipc_wait(pthread_t *src,
+	       void *msg, oskit_size_t msg_size, oskit_size_t *actual,
+	       oskit_s32_t timeout)
+{
+	return ipc_wait(src, msg, msg_size, actual, 0, timeout);
+}
+
+/*
+ * Wait for a lent message from any source thread.
+ */
+oskit_error_t
+oskit_ipc_wait_lent(pthread_t *src, oskit_ipc_lent_t *lent,
+		    oskit_s32_t timeout)
+{
+	return ipc_wait(src, 0, 0, &lent->msg_size, lent, timeout);
+}
+
 /*
  * Send a message. Synchronous. Caller blocks until receiver picks
  * up the message, or until the timeout expires.
@@ -439,7 +526,19 @@ oskit_ipc_call(pthread_t dst,
 	if (target->waitflags & THREAD_WS_IPCRECV_WAIT &&
 	    (target->ipc_state.tid == pthread->tid ||
 	     target->ipc_state.tid == ANYTID)) {
-		if (sendmsg_size) {
+		/*
+		 * Setup sender to recv the reply.
+		 */
+		pthread->ipc_state.reply      = recvmsg;
+		pthread->ipc_state.reply_size = recvmsg_size;
+		pthread->ipc_state.tid        = dst;
+
+		if (target->ipc_state.lent) {
+			pthread->ipc_state.msg      = sendmsg;
+			pthread->ipc_state.msg_size = sendmsg_size;
+			ipc_lend(target->ipc_state.lent, pthread);
+		}
+		else if (sendmsg_size) {
 			memcpy(target->ipc_state.msg, sendmsg,
 			       MIN(sendmsg_size, target->ipc_state.msg_size));
 
@@ -454,13 +553,6 @@ oskit_ipc_call(pthread_t dst,
 		target->ipc_state.msg_size = sendmsg_size;
 		target->ipc_state.tid      = pthread->tid;
 
-		/*
-		 * Setup sender to recv the reply.
-		 */
-		pthread->ipc_state.reply      = recvmsg;
-		pthread->ipc_state.reply_size = recvmsg_size;
-		pthread->ipc_state.tid        = dst;
-
 		/*
 		 * Clear the recv wait.
 		 */
@@ -519,7 +611,7 @@ oskit_ipc_call(pthread_t dst,
 
 /*
  * Reply to an RPC. The target thread must be in the RPC client side
- * wait, or the call fails.
+ * wait (or a send whose message was lent), or the call fails.
  */
 oskit_error_t
 oskit_ipc_reply(pthread_t src, void *msg, oskit_size_t msg_size)
@@ -553,9 +645,10 @@ oskit_ipc_reply(pthread_t src, void *msg, oskit_size_t msg_size)
 	}
 
 	/*
-	 * Copy back the reply and look for a short message.
+	 * Copy back the reply and look for a short message. A reply built
+	 * in a lent reply buffer is already there.
 	 */
-	if (msg_size) {
+	if (msg_size && msg != source->ipc_state.reply) {
 		memcpy(source->ipc_state.reply,
 		       msg, MIN(msg_size, source->ipc_state.reply_size));
 
@@ -584,6 +677,84 @@ oskit_ipc_reply(pthread_t src, void *msg, oskit_size_t msg_size)
 	return err;
 }
 
+/*
+ * Registered buffer rings. The slots are page aligned, and a multiple
+ * of the page size long.
+ */
+struct oskit_ipc_ring {
+	pthread_t	dst;		/* Where the calls go */
+	char		*slots;		/* nslots * slot_size bytes */
+	oskit_size_t	slot_size;
+	int		nslots;
+	int		next;		/* Next slot to hand out */
+};
+
+oskit_error_t
+oskit_ipc_ring_create(pthread_t dst, int nslots, oskit_size_t slot_size,
+		      oskit_ipc_ring_t **out)
+{
+	oskit_ipc_ring_t	*ring;
+
+	if (nslots <= 0 || slot_size == 0)
+		return OSKIT_EINVAL;
+
+	if ((ring = malloc(sizeof(*ring))) == NULL)
+		return OSKIT_ENOMEM;
+
+	slot_size = (slot_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	if ((ring->slots = memalign(PAGE_SIZE, nslots * slot_size)) == NULL) {
+		free(ring);
+		return OSKIT_ENOMEM;
+	}
+	ring->dst       = dst;
+	ring->slot_size = slot_size;
+	ring->nslots    = nslots;
+	ring->next      = 0;
+
+	*out = ring;
+	return 0;
+}
+
+void
+oskit_ipc_ring_destroy(oskit_ipc_ring_t *ring)
+{
+	free(ring->slots);
+	free(ring);
+}
+
+/*
+ * Hand out the slots in turn, so the last nslots - 1 replies are
+ * still around while the next request is filled in.
+ */
+void *
+oskit_ipc_ring_next(oskit_ipc_ring_t *ring)
+{
+	void	*slot = ring->slots + ring->next * ring->slot_size;
+
+	if (++ring->next == ring->nslots)
+		ring->next = 0;
+	return slot;
+}
+
+/*
+ * Call with a slot as both the message and the reply buffer.
+ */
+oskit_error_t
+oskit_ipc_ring_call(oskit_ipc_ring_t *ring, void *slot,
+		    oskit_size_t msg_size, oskit_size_t *actual,
+		    oskit_s32_t timeout)
+{
+	oskit_size_t	offset = (char *) slot - ring->slots;
+
+	if ((char *) slot < ring->slots ||
+	    offset >= ring->nslots * ring->slot_size ||
+	    offset % ring->slot_size || msg_size > ring->slot_size)
+		return OSKIT_EINVAL;
+
+	return oskit_ipc_call(ring->dst, slot, msg_size,
+			      slot, ring->slot_size, actual, timeout);
+}
+
 /*
  * Cancelation Support.
  */
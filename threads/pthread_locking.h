@@ -18,6 +18,14 @@
 #ifndef _OSKIT_PTHREADS_LOCKING_H_
 #define _OSKIT_PTHREADS_LOCKING_H_
 
+/*
+ * The run queues and thread state are touched by more than one CPU
+ * at a time in an SMP build, so the locks had better be real ones.
+ */
+#if defined(SMP) && !defined(THREADS_SPINLOCKS)
+#error "SMP threads need THREADS_SPINLOCKS"
+#endif
+
 #ifdef  THREADS_SPINLOCKS
 #define PTHREAD_LOCK_INITIALIZER SPIN_LOCK_INITIALIZER
 #define pthread_lock_t spin_lock_t
@@ -25,6 +25,21 @@
 /* Protect static initialization against race. */
 static pthread_lock_t static_lock = PTHREAD_LOCK_INITIALIZER;
 
+/*
+ * Give the mutex to pthread, or mark it contended if someone has it.
+ * Called with mlock held.
+ */
+static int
+mutex_grant_or_contend(struct pthread_mutex_impl *pimpl,
+		       pthread_thread_t *pthread)
+{
+	while (! mutex_contend(pimpl)) {
+		if (mutex_grant(pimpl, pthread))
+			return 1;
+	}
+	return 0;
+}
+
 /*
  * Create and initialize a new mutex. For now, I am going to allow
  * a mutex to be reinitialized before being destroyed. This is certainly
@@ -49,6 +64,7 @@ pthread_mutex_init(pthread_mutex_t *m, const pthread_mutexattr_t *attr)
         queue_init(&(pimpl->waiters));
 	pthread_lock_init(&(pimpl->mlock));
 	pthread_lock_init(&(pimpl->dlock));
+	atomic_set(&pimpl->state, MUTEX_FREE);
 	pimpl->holder  = 0;
 	pimpl->inherit = 0;
 	pimpl->count   = 0;
@@ -78,7 +94,7 @@ pthread_mutex_destroy(pthread_mutex_t *m)
 	/*
 	 * If the mutex can be locked, its safe to destroy it.
 	 */
-	if (pimpl->holder == 0) {
+	if (atomic_read(&pimpl->state) == MUTEX_FREE) {
 		sfree(pimpl, sizeof(*pimpl));
 		m->impl = NULL;
 		restore_preemption_enable(enabled);
@@ -128,6 +144,9 @@ pthread_mutex_trylock(pthread_mutex_t *m)
 
 	pimpl = m->impl;
 
+	if (mutex_fast_lock(pimpl))
+		return 0;
+
 	save_preemption_enable(enabled);
 	disable_preemption();
 	
@@ -136,9 +155,7 @@ pthread_mutex_trylock(pthread_mutex_t *m)
 	/*
 	 * Try to get the mutex. If successful, set owner and count.
 	 */
-	if (pimpl->holder == 0) {
-		pimpl->holder = (void *) CURPTHREAD();		
-		pimpl->count  = 1;
+	if (mutex_grant(pimpl, CURPTHREAD())) {
 		pthread_unlock(&pimpl->mlock);
 		restore_preemption_enable(enabled);
 		return 0;
@@ -163,24 +180,19 @@ pthread_mutex_lock(pthread_mutex_t *m)
 
 	pimpl = m->impl;
 
+	/*
+	 * Uncontended; no need for mlock or the scheduler.
+	 */
+	if (mutex_fast_lock(pimpl))
+		return 0;
+
 	save_preemption_enable(enabled);
 	disable_preemption();
 
 	pthread_lock(&pimpl->mlock);
 
 	/*
-	 * Try to get the lock. If successful, set owner and count.
-	 */
-	if (pimpl->holder == 0) {
-		pimpl->holder = (void *) CURPTHREAD();		
-		pimpl->count  = 1;
-		pthread_unlock(&pimpl->mlock);
-		restore_preemption_enable(enabled);
-		return 0;
-	}
-
-	/*
-	 * Can't get it. Look for a recursive lock. 
+	 * Look for a recursive lock. 
 	 */
 	if (pimpl->holder == CURPTHREAD()) {
 		if (pimpl->type == PTHREAD_MUTEX_RECURSIVE) {
@@ -196,10 +208,21 @@ pthread_mutex_lock(pthread_mutex_t *m)
 #ifdef  CPU_INHERIT
   again:
 #endif
+	/*
+	 * Try to get the lock. If it is still held, it is now marked
+	 * contended so that the owner comes through here to unlock it.
+	 */
+	if (mutex_grant_or_contend(pimpl, pthread)) {
+		pthread_unlock(&pimpl->mlock);
+		restore_preemption_enable(enabled);
+		return 0;
+	}
+
 	/*
 	 * Okay, time to block ...
 	 */
 	queue_check(&(pimpl->waiters), pthread);
+	TRACE_EVENT(CONTEND, pthread, m);
 	
 #ifdef	PRI_INHERIT
 	if (pimpl->inherit)
@@ -299,6 +322,12 @@ pthread_mutex_unlock(pthread_mutex_t *m)
 	if (m == NULL || ((pimpl = m->impl) == NULL))
 		return EINVAL;
 
+	/*
+	 * Nobody waiting; no need for mlock or the scheduler.
+	 */
+	if (mutex_fast_unlock(pimpl))
+		return 0;
+
 	/* Can be called from condition code and osenv_unlock. */
 	save_preemption_enable(enabled);
 	disable_preemption();
@@ -336,6 +365,7 @@ pthread_mutex_unlock(pthread_mutex_t *m)
 	if (queue_empty(&(pimpl->waiters))) {
 		pimpl->holder = NULL_THREADPTR;
 		pimpl->count  = 0;
+		atomic_set(&pimpl->state, MUTEX_FREE);
 		pthread_unlock(&pimpl->mlock);
 		restore_preemption_enable(enabled);
 		return 0;
@@ -356,6 +386,9 @@ pthread_mutex_unlock(pthread_mutex_t *m)
 
 	pimpl->holder = pnext;
 	pimpl->count  = 1;
+	if (queue_empty(&(pimpl->waiters)))
+		atomic_set(&pimpl->state, MUTEX_LOCKED);
+	TRACE_EVENT(HANDOFF, pnext, m);
 	pthread_sched_setrunnable(pnext);
 #ifdef  PRI_INHERIT
 	if (pimpl->inherit)
@@ -373,6 +406,46 @@ pthread_mutex_unlock(pthread_mutex_t *m)
         return 0;
 }
 
+/*
+ * Move the threads waiting on a condition over to the mutex queue, so
+ * that pthread_cond_broadcast does not wake them all up just to have
+ * them block again on the mutex. If the mutex is free the first one
+ * gets it, and the rest are handed the mutex one at a time by unlock.
+ * Each thread moved has its mutex_handoff flag set, so that when it
+ * wakes up it knows it owns the mutex and does not lock it again. The
+ * caller has the condition locked, and has cleared the condition wait
+ * state of each thread. Returns zero for mutexes that do priority
+ * inheritance, and for recursive ones (whose waiters may have had them
+ * locked more than once), which the caller has to wake up the old way.
+ */
+int
+pthread_mutex_requeue(pthread_mutex_t *m, queue_head_t *q)
+{
+	struct pthread_mutex_impl	*pimpl = m->impl;
+	pthread_thread_t		*pnext;
+
+	if (pimpl->inherit || pimpl->type == PTHREAD_MUTEX_RECURSIVE)
+		return 0;
+
+	pthread_lock(&pimpl->mlock);
+
+	while (! queue_empty(q)) {
+		pnext = pthread_dequeue_fromQ(q);
+		pnext->mutex_handoff = 1;
+
+		if (mutex_grant_or_contend(pimpl, pnext))
+			pthread_sched_setrunnable(pnext);
+		else {
+			TRACE_EVENT(CONTEND, pnext, m);
+			queue_enter(&(pimpl->waiters),
+				    pnext, pthread_thread_t *, chain);
+		}
+	}
+
+	pthread_unlock(&pimpl->mlock);
+	return 1;
+}
+
 void
 pthread_mutex_panic(pthread_mutex_t *m, char *type, char *msg)
 {
@@ -15,11 +15,24 @@
  * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
  */
 
+#include <oskit/machine/atomic.h>
+
 /*
  * Internal mutex implementation.
+ *
+ * The state word is the lock proper.  A thread takes a free mutex by
+ * swapping it from MUTEX_FREE to MUTEX_LOCKED, and a thread that has
+ * to wait first marks it MUTEX_CONTENDED (under mlock) before going on
+ * the waiters queue.  So an owner that can swap it back from
+ * MUTEX_LOCKED to MUTEX_FREE knows nobody is waiting, and neither side
+ * needs mlock or the scheduler.  Contended unlocks hand the mutex
+ * straight to the next waiter under mlock, as before.  Mutexes that do
+ * priority inheritance always go the slow way, since the waiters look
+ * at the holder.
  */
 struct pthread_mutex_impl {
-	spin_lock_t	mlock;		/* Actual mutex lock */
+	atomic_t	state;		/* MUTEX_FREE, LOCKED or CONTENDED */
+	spin_lock_t	mlock;		/* Lock for the waiters queue */
 	spin_lock_t	dlock;		/* Lock for this data structure */
 	queue_head_t	waiters;	/* queue for mutex */
 	void	       *holder;		/* Opaque to user */
@@ -28,12 +41,82 @@ struct pthread_mutex_impl {
 	int		type;		/* Mutex type. See below */
 };
 
+#define MUTEX_FREE		0
+#define MUTEX_LOCKED		1
+#define MUTEX_CONTENDED		2
+
 /*
  * Inline mutex functions.
  *
  * NOTE: These assume the spl level is set properly before being called.
  */
 
+/*
+ * Internal function. Take the mutex for pthread if it is free.
+ */
+OSKIT_INLINE int
+mutex_grant(struct pthread_mutex_impl *pimpl, pthread_thread_t *pthread)
+{
+	if (! atomic_cmpxchg(&pimpl->state, MUTEX_FREE, MUTEX_LOCKED))
+		return 0;
+
+	pimpl->holder = (void *) pthread;
+	pimpl->count  = 1;
+	return 1;
+}
+
+/*
+ * Internal function. Uncontended lock, without mlock.
+ */
+OSKIT_INLINE int
+mutex_fast_lock(struct pthread_mutex_impl *pimpl)
+{
+	return !pimpl->inherit && mutex_grant(pimpl, CURPTHREAD());
+}
+
+/*
+ * Internal function. Uncontended unlock, without mlock. The holder has
+ * to be cleared before the mutex is free, so it is put back if a waiter
+ * got in first.
+ */
+OSKIT_INLINE int
+mutex_fast_unlock(struct pthread_mutex_impl *pimpl)
+{
+	if (pimpl->inherit || pimpl->count != 1 ||
+	    pimpl->holder != (void *) CURPTHREAD() ||
+	    atomic_read(&pimpl->state) != MUTEX_LOCKED)
+		return 0;
+
+	pimpl->holder = NULL_THREADPTR;
+	pimpl->count  = 0;
+	if (atomic_cmpxchg(&pimpl->state, MUTEX_LOCKED, MUTEX_FREE))
+		return 1;
+
+	pimpl->holder = (void *) CURPTHREAD();
+	pimpl->count  = 1;
+	return 0;
+}
+
+/*
+ * Internal function. Tell the owner there will be a waiter. Called with
+ * mlock held. Returns zero if the mutex turns out to be free instead.
+ */
+OSKIT_INLINE int
+mutex_contend(struct pthread_mutex_impl *pimpl)
+{
+	while (1) {
+		switch (atomic_read(&pimpl->state)) {
+		case MUTEX_FREE:
+			return 0;
+		case MUTEX_CONTENDED:
+			return 1;
+		}
+		if (atomic_cmpxchg(&pimpl->state,
+				   MUTEX_LOCKED, MUTEX_CONTENDED))
+			return 1;
+	}
+}
+
 /*
  * Internal function. Try to lock a mutex. Spinning version.
  */
@@ -43,14 +126,15 @@ fast_mutex_spinlock(pthread_mutex_t *m)
 	struct pthread_mutex_impl	*pimpl = m->impl;
 
 	while (1) {
+		if (mutex_fast_lock(pimpl))
+			return 0;
+
 		pthread_lock(&pimpl->mlock);
 
 		/*
 		 * Try to get the lock. If successful, set owner and count.
 		 */
-		if (pimpl->holder == 0) {
-			pimpl->holder = (void *) CURPTHREAD();		
-			pimpl->count  = 1;
+		if (mutex_grant(pimpl, CURPTHREAD())) {
 			pthread_unlock(&pimpl->mlock);
 			return 0;
 		}
@@ -61,20 +145,8 @@ fast_mutex_spinlock(pthread_mutex_t *m)
 OSKIT_INLINE int
 fast_mutex_lock(pthread_mutex_t *m)
 {
-	struct pthread_mutex_impl	*pimpl = m->impl;
-
-	pthread_lock(&pimpl->mlock);
-
-	/*
-	 * Try to get the lock. If successful, set owner and count.
-	 */
-	if (pimpl->holder == 0) {
-		pimpl->holder = (void *) CURPTHREAD();		
-		pimpl->count  = 1;
-		pthread_unlock(&pimpl->mlock);
+	if (mutex_fast_lock(m->impl))
 		return 0;
-	}
-	pthread_unlock(&pimpl->mlock);
 
 	return pthread_mutex_lock(m);
 }
@@ -82,24 +154,11 @@ fast_mutex_lock(pthread_mutex_t *m)
 OSKIT_INLINE int
 fast_mutex_unlock(pthread_mutex_t *m)
 {
-	struct pthread_mutex_impl	*pimpl = m->impl;
-
-	pthread_lock(&pimpl->mlock);
-
-	/*
-	 * If the queue is empty, the mutex is free, and the lock can be
-	 * released.
-	 */
-	if (queue_empty(&(pimpl->waiters))) {
-		pimpl->holder = NULL_THREADPTR;
-		pimpl->count  = 0;
-		pthread_unlock(&pimpl->mlock);
+	if (mutex_fast_unlock(m->impl))
 		return 0;
-	}
 
 	/*
 	 * Take the slow boat.
 	 */
-	pthread_unlock(&pimpl->mlock);
 	return pthread_mutex_unlock(m);
 }
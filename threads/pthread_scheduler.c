@@ -35,6 +35,21 @@
  */
 pthread_lock_t		pthread_sched_lock    = PTHREAD_LOCK_INITIALIZER;
 
+/*
+ * The POSIX scheduler keeps per-CPU run queues with their own locks.
+ * When it is the only scheduler linked in, there is no need to serialize
+ * every CPU's dispatch on the global lock; the other schedulers still
+ * depend on it though.
+ */
+#if defined(PTHREAD_SCHED_POSIX) && \
+    !defined(PTHREAD_SCHED_STRIDE) && !defined(PTHREAD_SCHED_EDF)
+#define sched_lock()		((void) 0)
+#define sched_unlock()		((void) 0)
+#else
+#define sched_lock()		pthread_lock(&pthread_sched_lock)
+#define sched_unlock()		pthread_unlock(&pthread_sched_lock)
+#endif
+
 #ifdef	SCHED_STATS
 static struct pthread_gstats stats;
 void	dump_scheduler_stats();
@@ -102,7 +117,7 @@ pthread_sched_dispatch(resched_flags_t reason, pthread_thread_t *pnext)
 	/*
 	 * Going to muck with the scheduler queues, so take that lock.
 	 */
-	pthread_lock(&pthread_sched_lock);
+	sched_lock();
 
 	/*
 	 * Decide what to do with the current thread.
@@ -125,12 +140,13 @@ pthread_sched_dispatch(resched_flags_t reason, pthread_thread_t *pnext)
 			pthread_unlock(&pnext->lock);
 			rerun = SCHED_DISPATCH(RESCHED_YIELD, pnext);
 			assert(!rerun);
+			TRACE_EVENT(WAKEUP, pnext, (int) pthread->tid);
 		}
 
 #ifdef	THREAD_STATS
 		pthread->stats.rescheds++;
 #endif
-		pthread_unlock(&pthread_sched_lock);
+		sched_unlock();
 		pthread_unlock(&pthread->schedlock);
 
 		/*
@@ -148,7 +164,7 @@ pthread_sched_dispatch(resched_flags_t reason, pthread_thread_t *pnext)
 		/*
 		 * Locked thread was provided, so done with the scheduler.
 		 */
-		pthread_unlock(&pthread_sched_lock);
+		sched_unlock();
 	}
 	else {
 		int	i;
@@ -176,7 +192,7 @@ pthread_sched_dispatch(resched_flags_t reason, pthread_thread_t *pnext)
 			pnext = IDLETHREAD;
 		}
 		
-		pthread_unlock(&pthread_sched_lock);
+		sched_unlock();
 
 		/*
 		 * Avoid switch into same thread. 
@@ -207,6 +223,17 @@ pthread_sched_dispatch(resched_flags_t reason, pthread_thread_t *pnext)
 	stats.switches++;
 	stats.switch_cycles += STAT_STAMPDIFF(before);
 #endif
+#ifdef	SCHED_TRACE
+	/*
+	 * The idle thread is never on a run queue, but it is always
+	 * runnable, so switching away from it is a preemption.
+	 */
+	if (pthread == IDLETHREAD || pthread->runq.next != 0)
+		TRACE_EVENT(PREEMPT, pthread, reason);
+	else
+		TRACE_EVENT(BLOCK, pthread, reason);
+	TRACE_EVENT(DISPATCH, pnext, (int) pthread->tid);
+#endif
 #ifdef HIGHRES_THREADTIMES
 	{
 		long long sstamp;
@@ -441,12 +468,12 @@ pthread_sched_setrunnable(pthread_thread_t *pthread)
 #ifdef  SCHED_STATS
 	before = STAT_STAMPGET();
 #endif
-	pthread_lock(&pthread_sched_lock);
+	sched_lock();
 
 	assert(pthread->scheduler);
 	resched = pthread->scheduler->setrunnable(pthread);
 	
-	pthread_unlock(&pthread_sched_lock);
+	sched_unlock();
 #ifdef  SCHED_STATS
 	stats.wakeups++;
 	stats.wakeup_cycles += STAT_STAMPDIFF(before);
@@ -454,6 +481,7 @@ pthread_sched_setrunnable(pthread_thread_t *pthread)
 #ifdef	THREAD_STATS
 	pthread->stats.qstamp = STAT_STAMPGET();
 #endif
+	TRACE_EVENT(WAKEUP, pthread, (int) CURPTHREAD()->tid);
 	restore_interrupt_enable(enabled);
 
 	return resched;
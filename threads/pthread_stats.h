@@ -109,6 +109,25 @@ struct pthread_gstats {
 };
 #endif
 
+#ifdef	SCHED_TRACE
+#include <oskit/threads/trace.h>
+
+struct pthread_thread;
+
+extern int	pthread_trace_on;
+void		pthread_trace_event(int event, struct pthread_thread *pthread,
+				    oskit_u32_t arg);
+
+#define TRACE_EVENT(event, pthread, arg)				\
+	do {								\
+		if (pthread_trace_on)					\
+			pthread_trace_event(OSKIT_PTHREAD_TRACE_##event,\
+					    (pthread), (oskit_u32_t) (arg));\
+	} while (0)
+#else
+#define TRACE_EVENT(event, pthread, arg)
+#endif
+
 #ifdef	THREAD_STATS
 #endif
 
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Scheduler trace ring. See oskit/threads/trace.h.
+ */
+#include <threads/pthread_internal.h>
+#include <oskit/threads/trace.h>
+#include <malloc.h>
+
+#ifdef	SCHED_TRACE
+/*
+ * Tested by the TRACE_EVENT macro at each trace point, so turning the
+ * trace off costs one load and branch.
+ */
+int				pthread_trace_on;
+
+/*
+ * The ring is a power of two in size. head and tail count records
+ * written and read since the beginning; the difference is what is
+ * waiting to be read, and anything over the size has been lost.
+ */
+static oskit_pthread_trace_t	*trace_ring;
+static unsigned int		trace_size;
+static unsigned int		trace_head, trace_tail;
+static pthread_lock_t		trace_lock = PTHREAD_LOCK_INITIALIZER;
+
+/*
+ * For converting cycles to time. Set when tracing is first enabled.
+ */
+static stat_stamp_t		trace_stamp0;
+static oskit_u32_t		trace_ticks0;
+
+extern oskit_u32_t		threads_realticks;
+
+/*
+ * Record an event. This can be called at interrupt level, and with
+ * any of the scheduler locks held.
+ */
+void
+pthread_trace_event(int event, pthread_thread_t *pthread, oskit_u32_t arg)
+{
+	oskit_pthread_trace_t	*rec;
+	int			enabled;
+
+	enabled = save_disable_interrupts();
+	pthread_lock(&trace_lock);
+
+	rec = &trace_ring[trace_head++ & (trace_size - 1)];
+	rec->stamp = STAT_STAMPGET();
+	rec->event = event;
+	rec->cpu   = THISCPU;
+	rec->tid   = (int) pthread->tid;
+	rec->arg   = arg;
+
+	pthread_unlock(&trace_lock);
+	restore_interrupt_enable(enabled);
+}
+#endif
+
+oskit_error_t
+oskit_pthread_trace_enable(int nrecs)
+{
+#ifdef	SCHED_TRACE
+	oskit_pthread_trace_t	*ring;
+	unsigned int		size;
+	int			enabled;
+
+	if (nrecs <= 0)
+		return OSKIT_EINVAL;
+
+	if (! trace_ring) {
+		for (size = 1; size < (unsigned int) nrecs; size <<= 1)
+			;
+
+		if ((ring = malloc(size * sizeof(*ring))) == NULL)
+			return OSKIT_ENOMEM;
+
+		enabled = save_disable_interrupts();
+		pthread_lock(&trace_lock);
+		if (! trace_ring) {
+			trace_ring   = ring;
+			trace_size   = size;
+			trace_stamp0 = STAT_STAMPGET();
+			trace_ticks0 = threads_realticks;
+			ring         = 0;
+		}
+		pthread_unlock(&trace_lock);
+		restore_interrupt_enable(enabled);
+
+		if (ring)
+			free(ring);
+	}
+
+	pthread_trace_on = 1;
+	return 0;
+#else
+	return OSKIT_ENOSYS;
+#endif
+}
+
+void
+oskit_pthread_trace_disable(void)
+{
+#ifdef	SCHED_TRACE
+	pthread_trace_on = 0;
+#endif
+}
+
+int
+oskit_pthread_trace_read(oskit_pthread_trace_t *buf, int max, int *lost)
+{
+#ifdef	SCHED_TRACE
+	int		enabled, count = 0, skipped = 0;
+
+	enabled = save_disable_interrupts();
+	pthread_lock(&trace_lock);
+
+	if (trace_head - trace_tail > trace_size) {
+		skipped    = trace_head - trace_tail - trace_size;
+		trace_tail = trace_head - trace_size;
+	}
+	while (count < max && trace_tail != trace_head)
+		buf[count++] = trace_ring[trace_tail++ & (trace_size - 1)];
+
+	pthread_unlock(&trace_lock);
+	restore_interrupt_enable(enabled);
+
+	if (lost)
+		*lost = skipped;
+	return count;
+#else
+	if (lost)
+		*lost = 0;
+	return 0;
+#endif
+}
+
+oskit_u32_t
+oskit_pthread_trace_clock(void)
+{
+#ifdef	SCHED_TRACE
+	oskit_u32_t	ms;
+
+	if (! trace_ring)
+		return 0;
+
+	ms = (threads_realticks - trace_ticks0) * PTHREAD_TICK;
+	if (ms < 100)
+		return 0;
+
+	return (oskit_u32_t) ((STAT_STAMPGET() - trace_stamp0) / ms);
+#else
+	return 0;
+#endif
+}
+
+void
+oskit_pthread_trace_dump(void)
+{
+#ifdef	SCHED_TRACE
+	oskit_pthread_trace_t	recs[32];
+	unsigned char		*p;
+	int			i, j, n, lost, total = 0, totallost = 0;
+
+	pthread_trace_on = 0;
+
+	printf("--- pthread trace begin, %u cycles/ms ---\n",
+	       oskit_pthread_trace_clock());
+
+	while ((n = oskit_pthread_trace_read(recs, 32, &lost)) > 0) {
+		totallost += lost;
+		for (i = 0; i < n; i++) {
+			p = (unsigned char *) &recs[i];
+			printf("T ");
+			for (j = 0; j < (int) sizeof(recs[i]); j++)
+				printf("%02x", p[j]);
+			printf("\n");
+		}
+		total += n;
+	}
+
+	printf("--- pthread trace end, %d records, %d lost ---\n",
+	       total, totallost);
+#else
+	printf("--- pthread trace: not built with SCHED_TRACE ---\n");
+#endif
+}
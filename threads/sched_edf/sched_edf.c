@@ -17,6 +17,7 @@
 
 #ifdef PTHREAD_SCHED_EDF
 #include <threads/pthread_internal.h>
+#include <threads/sched_heap.h>
 #include "sched_realtime.h"
 #include "pthread_signal.h"
 
@@ -46,10 +47,9 @@
 int __drag_in_edf_scheduler__;
 
 /*
- * The run queue is ordered by absolute time.
+ * The run queue is a heap ordered by absolute time.
  */
-static queue_head_t		edf_runq;
-static int			edf_runq_count;
+static sched_heap_t		edf_runq;
 
 /* pthread_scheduler.c */
 extern pthread_lock_t	pthread_sched_lock;
@@ -61,8 +61,8 @@ extern pthread_lock_t	pthread_sched_lock;
 /*
  * Determine if a pthread is on the runq. Use a separate field 
  * since using the flags would require locking the thread. Use the
- * queue chain pointer instead, setting it to zero when a thread is
- * removed from the queue.
+ * queue chain pointer instead, which the heap sets while the thread
+ * is on it and zeroes when it is removed.
  */
 static inline int
 edf_runq_onrunq(pthread_thread_t *pthread)
@@ -75,31 +75,23 @@ edf_runq_onrunq(pthread_thread_t *pthread)
  * and interrupts disabled.
  */
 
+/*
+ * Heap order. As the name implies, the task with the earliest deadline
+ * is the first to get run.
+ */
+static int
+edf_before(pthread_thread_t *a, pthread_thread_t *b)
+{
+	return timespeccmp(&a->deadline, &b->deadline, <);
+}
+
 /*
  * Insert a thread into the EDF runq. The queue is ordered by its deadline.
- * As the name implies, the task with the earliest deadline is the first
- * to get run.
  */
 static inline void
 edf_runq_insert(pthread_thread_t *pthread)
 {
-	pthread_thread_t	*ptmp;
-	
-	if (queue_empty(&edf_runq)) {
-		queue_enter(&edf_runq, pthread, pthread_thread_t *, runq);
-		goto done;
-	}
-	
-	queue_iterate(&edf_runq, ptmp, pthread_thread_t *, runq) {
-		if (timespeccmp(&pthread->deadline, &ptmp->deadline, <=)) {
-			queue_enter_before(&edf_runq, ptmp,
-					   pthread, pthread_thread_t *, runq);
-			goto done;
-		}
-	}
-	queue_enter(&edf_runq, pthread, pthread_thread_t *, runq);
-   done:
-	edf_runq_count++;
+	sched_heap_insert(&edf_runq, pthread, edf_before);
 #ifdef  THREADS_DEBUG
 	/*
 	 * This just keeps the deadlock detection code happy.
@@ -116,10 +108,7 @@ edf_runq_insert(pthread_thread_t *pthread)
 static inline void
 edf_runq_remove(pthread_thread_t *pthread)
 {
-	queue_remove(&edf_runq, pthread, pthread_thread_t *, runq);
-	pthread->runq.next = (queue_entry_t) 0;	
-
-	edf_runq_count--;
+	sched_heap_remove(&edf_runq, pthread, edf_before);
 #ifdef  THREADS_DEBUG
 	/*
 	 * This just keeps the deadlock detection code happy.
@@ -137,7 +126,7 @@ edf_runq_remove(pthread_thread_t *pthread)
 void
 edf_sched_init(void)
 {
-	queue_init(&edf_runq);
+	sched_heap_init(&edf_runq);
 	realtime_clock_init();
 }
 
@@ -363,14 +352,14 @@ edf_sched_thread_next(void)
 	pthread_thread_t	*pnext;
 	extern oskit_timespec_t	threads_realtime;
 	
-	if (queue_empty(&edf_runq))
+	if (sched_heap_empty(&edf_runq))
 		return 0;
 
-	pnext = (pthread_thread_t *) queue_first(&edf_runq);
+	pnext = sched_heap_first(&edf_runq);
 
 	/*
-	 * The queue is ordered. Just look at the first element of the
-	 * queue and see if its deadline is now.
+	 * The queue is ordered. Just look at the head of the heap
+	 * and see if its deadline is now.
 	 */
 	if (timespeccmp(&threads_realtime, &pnext->deadline, <))
 		return 0;
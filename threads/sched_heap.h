@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2002 University of Utah and the Flux Group.
+ * All rights reserved.
+ *
+ * This file is part of the Flux OSKit.  The OSKit is free software, also known
+ * as "open source;" you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License (GPL), version 2, as published by the Free
+ * Software Foundation (FSF).  To explore alternate licensing terms, contact
+ * the University of Utah at csl-dist@cs.utah.edu or +1-801-585-3271.
+ *
+ * The OSKit is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GPL for more details.  You should have
+ * received a copy of the GPL along with the OSKit; see the file COPYING.  If
+ * not, write to the FSF, 59 Temple Place #330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Binary heap of threads, for the ordered run queues (stride by pass,
+ * EDF by deadline), so that insert and remove are O(log n) instead of
+ * a walk down the queue.  Slot 1 is the head.  Each thread records its
+ * slot in runq_slot so it can be removed from the middle, and runq.next
+ * points at the heap while the thread is on it, so the usual onrunq
+ * test still works.  There is room for every thread that can exist, so
+ * nothing is allocated under the scheduler lock.
+ *
+ * The caller supplies the ordering; before(a, b) is true if a must run
+ * before b.  Threads that compare equal come off in no particular order.
+ */
+#ifndef _THREADS_SCHED_HEAP_H_
+#define _THREADS_SCHED_HEAP_H_
+
+#include <threads/pthread_internal.h>
+
+typedef int (*sched_heap_before_t)(pthread_thread_t *a, pthread_thread_t *b);
+
+typedef struct sched_heap {
+	int			count;
+	pthread_thread_t	*slots[THREADS_MAX_THREAD + 1];
+} sched_heap_t;
+
+static inline void
+sched_heap_init(sched_heap_t *heap)
+{
+	heap->count = 0;
+}
+
+static inline int
+sched_heap_empty(sched_heap_t *heap)
+{
+	return heap->count == 0;
+}
+
+static inline pthread_thread_t *
+sched_heap_first(sched_heap_t *heap)
+{
+	return heap->count ? heap->slots[1] : 0;
+}
+
+static inline void
+sched_heap_set(sched_heap_t *heap, int slot, pthread_thread_t *pthread)
+{
+	heap->slots[slot]  = pthread;
+	pthread->runq_slot = slot;
+}
+
+static inline void
+sched_heap_up(sched_heap_t *heap, int slot, sched_heap_before_t before)
+{
+	pthread_thread_t	*pthread = heap->slots[slot];
+
+	while (slot > 1 && before(pthread, heap->slots[slot / 2])) {
+		sched_heap_set(heap, slot, heap->slots[slot / 2]);
+		slot /= 2;
+	}
+	sched_heap_set(heap, slot, pthread);
+}
+
+static inline void
+sched_heap_down(sched_heap_t *heap, int slot, sched_heap_before_t before)
+{
+	pthread_thread_t	*pthread = heap->slots[slot];
+	int			child;
+
+	while ((child = slot * 2) <= heap->count) {
+		if (child < heap->count &&
+		    before(heap->slots[child + 1], heap->slots[child]))
+			child++;
+		if (! before(heap->slots[child], pthread))
+			break;
+		sched_heap_set(heap, slot, heap->slots[child]);
+		slot = child;
+	}
+	sched_heap_set(heap, slot, pthread);
+}
+
+static inline void
+sched_heap_insert(sched_heap_t *heap, pthread_thread_t *pthread,
+		  sched_heap_before_t before)
+{
+	assert(heap->count < THREADS_MAX_THREAD);
+
+	pthread->runq.next = (queue_entry_t) heap;
+	heap->slots[++heap->count] = pthread;
+	sched_heap_up(heap, heap->count, before);
+}
+
+/*
+ * Remove an arbitrary thread. The last thread is moved into the hole
+ * and then goes up or down, whichever way it belongs.
+ */
+static inline void
+sched_heap_remove(sched_heap_t *heap, pthread_thread_t *pthread,
+		  sched_heap_before_t before)
+{
+	int			slot = pthread->runq_slot;
+	pthread_thread_t	*last;
+
+	assert(pthread->runq.next == (queue_entry_t) heap);
+	assert(heap->slots[slot] == pthread);
+
+	last = heap->slots[heap->count--];
+	pthread->runq.next = (queue_entry_t) 0;
+	pthread->runq_slot = 0;
+
+	if (slot > heap->count)
+		return;
+
+	heap->slots[slot] = last;
+	if (slot > 1 && before(last, heap->slots[slot / 2]))
+		sched_heap_up(heap, slot, before);
+	else
+		sched_heap_down(heap, slot, before);
+}
+
+static inline pthread_thread_t *
+sched_heap_dequeue(sched_heap_t *heap, sched_heap_before_t before)
+{
+	pthread_thread_t	*pthread = heap->slots[1];
+
+	sched_heap_remove(heap, pthread, before);
+	return pthread;
+}
+
+/*
+ * Put the heap back in order after the keys of the threads on it have
+ * been changed in place.
+ */
+static inline void
+sched_heap_rebuild(sched_heap_t *heap, sched_heap_before_t before)
+{
+	int			slot;
+
+	for (slot = heap->count / 2; slot >= 1; slot--)
+		sched_heap_down(heap, slot, before);
+}
+
+/*
+ * Visit every thread on the heap, in heap (not run) order.
+ */
+#define sched_heap_iterate(heap, slot, pthread)				\
+	for ((slot) = 1;						\
+	     (slot) <= (heap)->count && ((pthread) = (heap)->slots[slot]);\
+	     (slot)++)
+
+#endif /* _THREADS_SCHED_HEAP_H_ */
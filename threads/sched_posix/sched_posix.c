@@ -24,25 +24,49 @@
 #define  COMPILING_SCHEDULER
 #include "sched_posix.h"
 
-/* pthread_scheduler.c */
-extern pthread_lock_t	pthread_sched_lock;
-
 /*
  * The RunQ is a multilevel queue of doubly linked lists. Use a bitmask
  * to indicate whichrunq is non-empty, with the least significant bit
  * being the highest priority (cause off ffs).
+ *
+ * There is one RunQ per CPU, each with its own lock. A thread is queued
+ * on the RunQ of the CPU it last ran on (pthread->cpu), which is where
+ * it will most likely be run again. A CPU that runs out of threads to
+ * run steals one from the busiest of the other CPUs. The cpu field of a
+ * thread is only changed with the lock of the RunQ it currently names
+ * held, so holding that lock (and checking it is still the right one)
+ * is enough to keep the thread on or off that RunQ.
+ *
+ * In a uniprocessor build there is exactly one RunQ and the locks
+ * compile away, which leaves things as they always were.
  */
 #define MAXPRI		(PRIORITY_MAX + 1)
 
+struct posix_runq {
+	pthread_lock_t	lock;		/* Protects everything below */
+	int		cpu;		/* CPU this RunQ belongs to */
+	int		count;		/* Number of threads queued */
+	oskit_u32_t	which;		/* Bitmask of non-empty queues */
+	queue_head_t	queues[MAXPRI];	/* One queue per priority */
+#ifdef	SCHED_STATS
+	int		steals;		/* Threads stolen from others */
+	int		kicks;		/* Reschedule IPIs sent here */
+#endif
+};
+
 /*
  * These are internal to the scheduler.
  */
-static queue_head_t	threads_runq[MAXPRI] = { {0} };
-static int		threads_runq_count   = 0;
-static oskit_u32_t	threads_whichrunq;
+static struct posix_runq	threads_runqs[MAXCPUS];
+
+#define RUNQ(cpu)	(&threads_runqs[(cpu)])
 
 extern int		ffs();
 
+#ifdef	SCHED_STATS
+static void		posix_sched_dump_stats(void);
+#endif
+
 /*
  * These are the internal routines.
  */
@@ -51,23 +75,23 @@ extern int		ffs();
  * Are there any threads on the runq?
  */
 static inline int
-posix_runq_empty(void)
+posix_runq_empty(struct posix_runq *rq)
 {
-	return (threads_whichrunq == 0);
+	return (rq->which == 0);
 }
 
 /*
  * Get the highest priority scheduled thread.
  */
 static inline int
-posix_runq_maxprio(void)
+posix_runq_maxprio(struct posix_runq *rq)
 {
 	int	prio;
 	
-	if (posix_runq_empty())
+	if (posix_runq_empty(rq))
 		return -1;
 	else {
-		prio = ffs(threads_whichrunq);
+		prio = ffs(rq->which);
 		
 		return PRIORITY_MAX - (prio - 1);
 	}
@@ -85,6 +109,61 @@ posix_runq_onrunq(pthread_thread_t *pthread)
 	return (int) pthread->runq.next;
 }
 
+/*
+ * Lock the RunQ a thread belongs to. The thread can be moved to
+ * another RunQ while we wait for the lock, so check and try again.
+ */
+static inline struct posix_runq *
+posix_runq_lock_thread(pthread_thread_t *pthread)
+{
+	struct posix_runq	*rq;
+
+	while (1) {
+		rq = RUNQ(pthread->cpu);
+		pthread_lock(&rq->lock);
+		if (rq == RUNQ(pthread->cpu))
+			return rq;
+		pthread_unlock(&rq->lock);
+	}
+}
+
+/*
+ * Lock the RunQ a thread belongs to, and the RunQ it is about to be
+ * put on. The locks are always taken in address order.
+ */
+static inline struct posix_runq *
+posix_runq_lock_move(pthread_thread_t *pthread, struct posix_runq *to)
+{
+	struct posix_runq	*from;
+
+	while (1) {
+		from = RUNQ(pthread->cpu);
+		if (from == to)
+			pthread_lock(&to->lock);
+		else if (from < to) {
+			pthread_lock(&from->lock);
+			pthread_lock(&to->lock);
+		}
+		else {
+			pthread_lock(&to->lock);
+			pthread_lock(&from->lock);
+		}
+		if (from == RUNQ(pthread->cpu))
+			return from;
+		pthread_unlock(&to->lock);
+		if (from != to)
+			pthread_unlock(&from->lock);
+	}
+}
+
+static inline void
+posix_runq_unlock_move(struct posix_runq *from, struct posix_runq *to)
+{
+	pthread_unlock(&to->lock);
+	if (from != to)
+		pthread_unlock(&from->lock);
+}
+
 /*
  * Add and remove threads from the runq. The runq lock should be locked,
  * and interrupts disabled.
@@ -94,48 +173,50 @@ posix_runq_onrunq(pthread_thread_t *pthread)
  * Insert at the tail of the runq.
  */
 static inline void
-posix_runq_insert_tail(pthread_thread_t *pthread)
+posix_runq_insert_tail(struct posix_runq *rq, pthread_thread_t *pthread)
 {
 	int		prio  = PRIORITY_MAX - pthread->priority;
-	queue_head_t	*phdr = &threads_runq[prio];
+	queue_head_t	*phdr = &rq->queues[prio];
 
 	queue_enter(phdr, pthread, pthread_thread_t *, runq);
 
-	threads_whichrunq |= (1 << prio);
-	threads_runq_count++;
+	pthread->cpu = rq->cpu;
+	rq->which |= (1 << prio);
+	rq->count++;
 }
 
 /*
  * Insert at the head of the runq.
  */
 static inline void
-posix_runq_insert_head(pthread_thread_t *pthread)
+posix_runq_insert_head(struct posix_runq *rq, pthread_thread_t *pthread)
 {
 	int		prio  = PRIORITY_MAX - pthread->priority;
-	queue_head_t	*phdr = &threads_runq[prio];
+	queue_head_t	*phdr = &rq->queues[prio];
 
 	queue_enter_first(phdr, pthread, pthread_thread_t *, runq);
 
-	threads_whichrunq |= (1 << prio);
-	threads_runq_count++;
+	pthread->cpu = rq->cpu;
+	rq->which |= (1 << prio);
+	rq->count++;
 }
 
 /*
  * Dequeue highest priority pthread.
  */
 static inline pthread_thread_t *
-posix_runq_dequeue(void)
+posix_runq_dequeue(struct posix_runq *rq)
 {
-	int			prio  = ffs(threads_whichrunq) - 1;
-	queue_head_t		*phdr = &threads_runq[prio];
+	int			prio  = ffs(rq->which) - 1;
+	queue_head_t		*phdr = &rq->queues[prio];
 	pthread_thread_t	*pnext;
 
 	queue_remove_first(phdr, pnext, pthread_thread_t *, runq);
 	pnext->runq.next = (queue_entry_t) 0;	
 
-	threads_runq_count--;
+	rq->count--;
 	if (queue_empty(phdr))
-		threads_whichrunq &= ~(1 << prio);
+		rq->which &= ~(1 << prio);
 
 	return pnext;
 }
@@ -144,17 +225,120 @@ posix_runq_dequeue(void)
  * Remove an arbitrary thread from the runq.
  */
 static inline void
-posix_runq_remove(pthread_thread_t *pthread)
+posix_runq_remove(struct posix_runq *rq, pthread_thread_t *pthread)
 {
 	int		prio  = PRIORITY_MAX - pthread->priority;
-	queue_head_t	*phdr = &threads_runq[prio];
+	queue_head_t	*phdr = &rq->queues[prio];
 
 	queue_remove(phdr, pthread, pthread_thread_t *, runq);
 	pthread->runq.next = (queue_entry_t) 0;	
 
-	threads_runq_count--;
+	rq->count--;
 	if (queue_empty(phdr))
-		threads_whichrunq &= ~(1 << prio);
+		rq->which &= ~(1 << prio);
+}
+
+#ifdef	SMP
+/*
+ * Is the given CPU up and running threads?
+ */
+#define CPU_ONLINE(cpu)		(threads_idlethreads[(cpu)] != 0)
+#define CPU_IDLE(cpu)		(threads_curthreads[(cpu)] == \
+				 threads_idlethreads[(cpu)])
+
+/*
+ * Pick the RunQ for a thread that just became runnable. Stay with the
+ * CPU it last ran on unless that CPU is busy and another one is idle.
+ * This looks at other CPUs without any locks; it is only a hint.
+ */
+static inline struct posix_runq *
+posix_runq_choose(pthread_thread_t *pthread)
+{
+	int	cpu = pthread->cpu, i;
+
+	if (CPU_IDLE(cpu))
+		return RUNQ(cpu);
+
+	for (i = 0; i < MAXCPUS; i++) {
+		if (CPU_ONLINE(i) && CPU_IDLE(i) && RUNQ(i)->count == 0)
+			return RUNQ(i);
+	}
+	return RUNQ(cpu);
+}
+
+/*
+ * Take a thread from some other CPU's RunQ. Go after the longest one,
+ * and do not wait on its lock; if someone else is in there, the next
+ * trip through the idle loop will try again.
+ */
+static pthread_thread_t *
+posix_runq_steal(void)
+{
+	struct posix_runq	*rq, *victim = 0;
+	pthread_thread_t	*pnext = 0;
+	int			i, me = THISCPU;
+
+	for (i = 0; i < MAXCPUS; i++) {
+		rq = RUNQ(i);
+		if (i == me || rq->count == 0)
+			continue;
+		if (!victim || rq->count > victim->count)
+			victim = rq;
+	}
+	if (!victim || !pthread_try_lock(&victim->lock))
+		return 0;
+
+	if (! posix_runq_empty(victim)) {
+		pnext = posix_runq_dequeue(victim);
+		pnext->cpu = me;
+#ifdef	SCHED_STATS
+		RUNQ(me)->steals++;
+#endif
+	}
+	pthread_unlock(&victim->lock);
+
+	return pnext;
+}
+
+/*
+ * A thread was put on the RunQ of another CPU. If that CPU is idle, or
+ * running something less important, tell it to reschedule.
+ */
+static inline void
+posix_runq_kick(struct posix_runq *rq)
+{
+	pthread_thread_t	*cur = threads_curthreads[rq->cpu];
+
+	if (CPU_IDLE(rq->cpu) ||
+	    (cur->priority < posix_runq_maxprio(rq) &&
+	     SCHED_POLICY_POSIX(cur->policy))) {
+#ifdef	SCHED_STATS
+		rq->kicks++;
+#endif
+		pthread_smp_resched(rq->cpu);
+	}
+}
+#endif
+
+/*
+ * A thread was added to the given RunQ, or one of its threads changed
+ * priority. Decide whether the current thread should give up the CPU,
+ * or if the RunQ belongs to some other CPU, whether that one should.
+ * The RunQ is locked.
+ */
+static inline int
+posix_runq_check_preempt(struct posix_runq *rq)
+{
+	if (rq->cpu == THISCPU) {
+		if ((CURPTHREAD()->priority < posix_runq_maxprio(rq)) &&
+		    SCHED_POLICY_POSIX(CURPTHREAD()->policy))
+			return PREEMPT_NEEDED = 1;
+		return 0;
+	}
+#ifdef	SMP
+	posix_runq_kick(rq);
+#endif
+	return 0;
 }
 
 /*
@@ -164,10 +348,17 @@ posix_runq_remove(pthread_thread_t *pthread)
 void
 posix_sched_init(void)
 {
-	int	i;
-		
-	for (i = 0; i < MAXPRI; i++)
-		queue_init(&threads_runq[i]);
+	int	i, j;
+
+	for (i = 0; i < MAXCPUS; i++) {
+		pthread_lock_init(&RUNQ(i)->lock);
+		RUNQ(i)->cpu = i;
+		for (j = 0; j < MAXPRI; j++)
+			queue_init(&RUNQ(i)->queues[j]);
+	}
+#ifdef	SCHED_STATS
+	atexit(posix_sched_dump_stats);
+#endif
 }
 
 /*
@@ -188,17 +379,24 @@ posix_sched_schedules(int policy)
 int
 posix_sched_setrunnable(pthread_thread_t *pthread)
 {
-	int	resched = 0;
+	struct posix_runq	*rq, *from;
+	int			resched;
 	
 	if (posix_runq_onrunq(pthread))
 		panic("posix_sched_setrunnable: Already on runQ: 0x%x(%d)",
 		      (int) pthread, pthread->tid);
 
-	posix_runq_insert_tail(pthread);
+#ifdef	SMP
+	rq = posix_runq_choose(pthread);
+#else
+	rq = RUNQ(0);
+#endif
+	from = posix_runq_lock_move(pthread, rq);
+
+	posix_runq_insert_tail(rq, pthread);
+	resched = posix_runq_check_preempt(rq);
 
-	if ((CURPTHREAD()->priority < posix_runq_maxprio()) &&
-	    SCHED_POLICY_POSIX(CURPTHREAD()->policy))
-		resched = PREEMPT_NEEDED = 1;
+	posix_runq_unlock_move(from, rq);
 
 	return resched;
 }
@@ -213,14 +411,16 @@ posix_sched_setrunnable(pthread_thread_t *pthread)
 void
 posix_sched_disassociate(pthread_thread_t *pthread)
 {
-	pthread_lock(&pthread_sched_lock);
+	struct posix_runq	*rq;
+
+	rq = posix_runq_lock_thread(pthread);
 	if (posix_runq_onrunq(pthread)) {
 		/*
 		 * On the scheduler queue, so its not running.
 		 */
-		posix_runq_remove(pthread);
+		posix_runq_remove(rq, pthread);
 	}
-	pthread_unlock(&pthread_sched_lock);
+	pthread_unlock(&rq->lock);
 }
 
 int
@@ -244,6 +444,7 @@ posix_sched_init_schedstate(pthread_thread_t *pthread,
 	pthread->base_priority = param->priority;
 	pthread->priority      = param->priority;
 	pthread->ticks         = SCHED_RR_INTERVAL;
+	pthread->cpu           = THISCPU;
 }
 
 /*
@@ -253,8 +454,9 @@ int
 posix_sched_change_state(pthread_thread_t *pthread,
 			 const struct sched_param *param)
 {
-	int	newprio = param->priority;
-	int	resched = 0;
+	struct posix_runq	*rq;
+	int			newprio = param->priority;
+	int			resched = 0;
 
 	if (! (pthread->policy & (SCHED_FIFO|SCHED_RR)))
 		panic("posix_sched_change_state: Bad policy specified");
@@ -279,13 +481,13 @@ posix_sched_change_state(pthread_thread_t *pthread,
 			pthread->inherits_from = NULL_THREADPTR;
 		}
 	}
-	pthread_lock(&pthread_sched_lock);
+	rq = posix_runq_lock_thread(pthread);
 #else
-	pthread_lock(&pthread_sched_lock);
+	rq = posix_runq_lock_thread(pthread);
 	if (posix_runq_onrunq(pthread)) {
-		posix_runq_remove(pthread);
+		posix_runq_remove(rq, pthread);
 		pthread->priority = newprio;
-		posix_runq_insert_tail(pthread);
+		posix_runq_insert_tail(rq, pthread);
 	}
 	else {
 		/*
@@ -298,11 +500,9 @@ posix_sched_change_state(pthread_thread_t *pthread,
 		pthread->priority = newprio;
 	}
 #endif	
-	if ((CURPTHREAD()->priority < posix_runq_maxprio()) &&
-	    SCHED_POLICY_POSIX(CURPTHREAD()->policy))
-		resched = PREEMPT_NEEDED = 1;
+	resched = posix_runq_check_preempt(rq);
 
-	pthread_unlock(&pthread_sched_lock);
+	pthread_unlock(&rq->lock);
 
  done:
 	return resched;
@@ -314,7 +514,8 @@ posix_sched_change_state(pthread_thread_t *pthread,
 int
 posix_sched_priority_bump(pthread_thread_t *pthread, int newprio)
 {
-	int	resched = 0;
+	struct posix_runq	*rq;
+	int			resched = 0;
 
 	if (pthread->priority == newprio)
 	    goto done;
@@ -329,14 +530,14 @@ posix_sched_priority_bump(pthread_thread_t *pthread, int newprio)
 	if (newprio > PRIORITY_MAX)
 		newprio = PRIORITY_MAX;
 
-	pthread_lock(&pthread_sched_lock);
+	rq = posix_runq_lock_thread(pthread);
 	if (posix_runq_onrunq(pthread)) {
 		/*
 		 * On the scheduler queue, so its not running.
 		 */
-		posix_runq_remove(pthread);
+		posix_runq_remove(rq, pthread);
 		pthread->priority = newprio;
-		posix_runq_insert_tail(pthread);
+		posix_runq_insert_tail(rq, pthread);
 	}
 	else {
 		/*
@@ -348,22 +549,24 @@ posix_sched_priority_bump(pthread_thread_t *pthread, int newprio)
 		 */
 		pthread->priority = newprio;
 	}
-	if ((CURPTHREAD()->priority < posix_runq_maxprio()) &&
-	    SCHED_POLICY_POSIX(CURPTHREAD()->policy))
-		resched = PREEMPT_NEEDED = 1;
+	resched = posix_runq_check_preempt(rq);
 
-	pthread_unlock(&pthread_sched_lock);
+	pthread_unlock(&rq->lock);
 
  done:
 	return resched;
 }
 
 /*
- * Dispatch a thread back to the runq.
+ * Dispatch a thread back to the runq. The thread is the one running on
+ * this CPU, so it goes back on this CPU's RunQ.
  */
 int
 posix_sched_dispatch(resched_flags_t reason, pthread_thread_t *pthread)
 {
+	struct posix_runq	*rq = RUNQ(THISCPU), *from;
+	int			head;
+
 	switch (reason) {
 	case RESCHED_USERYIELD:
 		if (pthread == IDLETHREAD)
@@ -373,7 +576,7 @@ posix_sched_dispatch(resched_flags_t reason, pthread_thread_t *pthread)
 		 * A user directed yield forces the thread to the back
 		 * of the queue.
 		 */
-		posix_runq_insert_tail(pthread);
+		head = 0;
 		break;
 		
 	case RESCHED_YIELD:
@@ -384,7 +587,7 @@ posix_sched_dispatch(resched_flags_t reason, pthread_thread_t *pthread)
 		 * A involuntary yield forces the thread to the front 
 		 * of the queue. It will probably be rerun right away!
 		 */
-		posix_runq_insert_head(pthread);
+		head = 1;
 		break;
 		
 	case RESCHED_PREEMPT:
@@ -403,21 +606,23 @@ posix_sched_dispatch(resched_flags_t reason, pthread_thread_t *pthread)
 		 */
 		if (pthread->policy == SCHED_RR) {
 			if (--pthread->ticks == 0) {
-				posix_runq_insert_tail(pthread);
+				head = 0;
 				pthread->ticks = SCHED_RR_INTERVAL;
 			}
 			else
-				posix_runq_insert_head(pthread);
+				head = 1;
 		}
 		else if (pthread->policy == SCHED_FIFO)
-			posix_runq_insert_head(pthread);
+			head = 1;
+		else
+			return 0;
 		break;
 
 	case RESCHED_INTERNAL:
 		/*
 		 * This will be the idle thread.
 		 */
-		break;
+		return 0;
 		
 	default:
 		/*
@@ -425,22 +630,62 @@ posix_sched_dispatch(resched_flags_t reason, pthread_thread_t *pthread)
 		 */
 		if (pthread == IDLETHREAD)
 			panic("posix_sched_dispatch: Idlethread!\n");
-		break;
+		return 0;
 	}
+
+	/*
+	 * The thread might have been switched to directly from some other
+	 * CPU (a handoff), in which case it still belongs to that RunQ.
+	 */
+	from = posix_runq_lock_move(pthread, rq);
+	if (head)
+		posix_runq_insert_head(rq, pthread);
+	else
+		posix_runq_insert_tail(rq, pthread);
+	posix_runq_unlock_move(from, rq);
+
 	return 0;
 }
 
 /*
- * Return the highest priority thread ready to run.
+ * Return the highest priority thread ready to run. Look on this CPU's
+ * RunQ first, and then try to steal from another CPU.
  */
 pthread_thread_t *
 posix_sched_thread_next(void)
 {
-	if (posix_runq_empty())
-		return 0;
+	struct posix_runq	*rq = RUNQ(THISCPU);
+	pthread_thread_t	*pnext = 0;
 
-	return posix_runq_dequeue();
+	pthread_lock(&rq->lock);
+	if (! posix_runq_empty(rq))
+		pnext = posix_runq_dequeue(rq);
+	pthread_unlock(&rq->lock);
+
+#ifdef	SMP
+	if (!pnext)
+		pnext = posix_runq_steal();
+#endif
+	return pnext;
+}
+
+#ifdef	SCHED_STATS
+static void
+posix_sched_dump_stats(void)
+{
+	int	i;
+
+	printf("POSIX scheduler RunQs:\n");
+	for (i = 0; i < MAXCPUS; i++) {
+#ifdef	SMP
+		if (! CPU_ONLINE(i))
+			continue;
+#endif
+		printf("  CPU %d: queued %d, steals %d, kicks %d\n",
+		       i, RUNQ(i)->count, RUNQ(i)->steals, RUNQ(i)->kicks);
+	}
 }
+#endif
 
 #ifdef  PRI_INHERIT
 #ifdef  SMP
@@ -459,10 +704,12 @@ void	pthread_priority_increasing_recompute(pthread_thread_t *pthread);
 OSKIT_INLINE void
 threads_change_priority(pthread_thread_t *pthread, int newprio)
 {
+	struct posix_runq	*rq = RUNQ(pthread->cpu);
+
 	if (posix_runq_onrunq(pthread)) {
-		posix_runq_remove(pthread);
+		posix_runq_remove(rq, pthread);
 		pthread->priority = newprio;
-		posix_runq_insert_tail(pthread);
+		posix_runq_insert_tail(rq, pthread);
 	}
 	else
 		pthread->priority = newprio;
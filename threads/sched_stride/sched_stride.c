@@ -17,6 +17,7 @@
 
 #ifdef PTHREAD_SCHED_STRIDE
 #include <threads/pthread_internal.h>
+#include <threads/sched_heap.h>
 #include "pthread_signal.h"
 
 /*
@@ -30,10 +31,9 @@
 int __drag_in_stride_scheduler__;
 
 /*
- * The run queue is ordered by the pass value.
+ * The run queue is a heap ordered by the pass value.
  */
-static queue_head_t		stride_runq;
-static int			stride_runq_count;
+static sched_heap_t		stride_runq;
 static int			global_tickets;	
 static int			global_stride;	
 static long long		global_pass;
@@ -72,8 +72,8 @@ static long long	global_pass_save;
 /*
  * Determine if a pthread is on the runq. Use a separate field 
  * since using the flags would require locking the thread. Use the
- * queue chain pointer instead, setting it to zero when a thread is
- * removed from the queue.
+ * queue chain pointer instead, which the heap sets while the thread
+ * is on it and zeroes when it is removed.
  */
 static inline int
 stride_runq_onrunq(pthread_thread_t *pthread)
@@ -87,42 +87,33 @@ stride_runq_onrunq(pthread_thread_t *pthread)
  */
 
 /*
- * Insert into the runq. Simple ordered queue. Might need to be better!
+ * Heap order. The lowest pass runs first.
+ */
+static int
+stride_before(pthread_thread_t *a, pthread_thread_t *b)
+{
+	return PASS(a) < PASS(b);
+}
+
+/*
+ * Insert into the runq.
  */
 static void
 stride_runq_insert(pthread_thread_t *pthread)
 {
-	pthread_thread_t	*ptmp;
-	
-	if (queue_empty(&stride_runq)) {
-		queue_enter(&stride_runq, pthread, pthread_thread_t *, runq);
-		goto done;
-	}
-	
-	queue_iterate(&stride_runq, ptmp, pthread_thread_t *, runq) {
-		if (PASS(pthread) < PASS(ptmp)) {
-			queue_enter_before(&stride_runq, ptmp,
-					   pthread, pthread_thread_t *, runq);
-			goto done;
-		}
-	}
-	queue_enter(&stride_runq, pthread, pthread_thread_t *, runq);
-   done:
-	stride_runq_count++;
+	sched_heap_insert(&stride_runq, pthread, stride_before);
 }
 
 /*
- * Dequeue the highest priority thread, which is the first thread since
- * the list ordered by PASS.
+ * Dequeue the highest priority thread, which is the head of the heap
+ * since it is ordered by PASS.
  */
 static pthread_thread_t *
 stride_runq_dequeue(void)
 {
 	pthread_thread_t	*pnext;
 
-	queue_remove_first(&stride_runq, pnext, pthread_thread_t *, runq);
-	pnext->runq.next = (queue_entry_t) 0;
-	stride_runq_count--;
+	pnext = sched_heap_dequeue(&stride_runq, stride_before);
 	START(pnext) = oskit_pthread_realtime();
 
 	return pnext;
@@ -134,9 +125,7 @@ stride_runq_dequeue(void)
 static inline void
 stride_runq_remove(pthread_thread_t *pthread)
 {
-	queue_remove(&stride_runq, pthread, pthread_thread_t *, runq);
-	pthread->runq.next = (queue_entry_t) 0;	
-	stride_runq_count--;
+	sched_heap_remove(&stride_runq, pthread, stride_before);
 }
 
 /*
@@ -290,11 +279,12 @@ static void
 stride_runq_debug(void)
 {
 	pthread_thread_t	*pthread;
+	int			slot;
 
 	printf(__FUNCTION__ ": GT %d GS %d GP %qd LU %qd\n",
 	       global_tickets, global_stride, global_pass, lastupdate);
 	
-	queue_iterate(&stride_runq, pthread, pthread_thread_t *, runq) {
+	sched_heap_iterate(&stride_runq, slot, pthread) {
 		printf("%p(%d) T %d S %d P %qd R %d S %qd\n",
 		       pthread, (int) pthread->tid,
 		       TICKETS(pthread), STRIDE(pthread), PASS(pthread),
@@ -309,7 +299,7 @@ stride_runq_debug(void)
 void
 stride_sched_init(void)
 {
-	queue_init(&stride_runq);
+	sched_heap_init(&stride_runq);
 }
 
 /*
@@ -541,7 +531,7 @@ stride_sched_thread_next(void)
 	if (stride_debug)
 		stride_runq_debug();
 	
-	if (queue_empty(&stride_runq))
+	if (sched_heap_empty(&stride_runq))
 		return 0;
 
 	pnext = stride_runq_dequeue();
@@ -561,7 +551,7 @@ stride_scheduler_enable(void)
 {
 	int		 enabled;
 	pthread_thread_t *ptmp;
-	queue_head_t	 runq_copy;
+	int		 slot;
 
 	if (!stride_disabled)
 		return;
@@ -570,7 +560,6 @@ stride_scheduler_enable(void)
 
 	stride_runq_debug();
 
-        queue_init(&runq_copy);
 	ptmp              = CURPTHREAD();
 	stride_disabled   = 0;
 	global_tickets    = 0;
@@ -578,32 +567,22 @@ stride_scheduler_enable(void)
 	PASS(ptmp)        = global_pass_save +
 		            (STRIDE(ptmp) * (PTHREAD_TICK * SCALE)) / QUANTUM;
         global_pass       = PASS(ptmp);
-	stride_runq_count = 0;
 
-	if (queue_empty(&stride_runq)) {
+	if (sched_heap_empty(&stride_runq)) {
 		restore_interrupt_enable(enabled);
 		stride_runq_debug();
 		return;
 	}
 		
-	while (! queue_empty(&stride_runq)) {
-		queue_remove_first(&stride_runq,
-				   ptmp, pthread_thread_t *, runq);
-
-		queue_enter(&runq_copy, ptmp, pthread_thread_t *, runq);
-	}
-
-	while (! queue_empty(&runq_copy)) {
-		queue_remove_first(&runq_copy,
-				   ptmp, pthread_thread_t *, runq);
-
+	sched_heap_iterate(&stride_runq, slot, ptmp) {
 		PASS(ptmp) = global_pass_save +
    			     (STRIDE(ptmp) * (PTHREAD_TICK * SCALE)) / QUANTUM;
 		
 		global_tickets_update(TICKETS(ptmp));
-		stride_runq_insert(ptmp);
 	}
-	ptmp = (pthread_thread_t *) queue_first(&stride_runq);
+	sched_heap_rebuild(&stride_runq, stride_before);
+
+	ptmp = sched_heap_first(&stride_runq);
 	global_pass = PASS(ptmp);
 	
 	stride_runq_debug();
@@ -616,6 +595,7 @@ stride_scheduler_disable(void)
 {
 	int		 enabled;
 	pthread_thread_t *ptmp;
+	int		 slot;
 	
 	enabled = save_disable_interrupts();
 
@@ -629,11 +609,12 @@ stride_scheduler_disable(void)
 	PASS(ptmp)       = global_pass +
 		(STRIDE(ptmp) * (PTHREAD_TICK * SCALE)) / QUANTUM;
 
-	queue_iterate(&stride_runq, ptmp, pthread_thread_t *, runq) {
+	sched_heap_iterate(&stride_runq, slot, ptmp) {
 		PASS(ptmp) = global_pass +
 			(STRIDE(ptmp) * (PTHREAD_TICK * SCALE)) / QUANTUM;
 		global_tickets_update(FIXEDTICKETS);
 	}
+	sched_heap_rebuild(&stride_runq, stride_before);
 	
 	stride_runq_debug();
 
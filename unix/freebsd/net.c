@@ -211,6 +211,24 @@ net_push(oskit_netio_t *io, oskit_bufio_t *b, oskit_size_t size)
 	return err == size ? 0 : err;
 }
 
+/*
+ * Send a batch of packets, one at a time.
+ */
+static OSKIT_COMDECL
+net_push_batch(oskit_netio_t *io, oskit_bufio_t **bufs, oskit_size_t *sizes,
+	       unsigned count)
+{
+	oskit_error_t rc, err = 0;
+	unsigned i;
+
+	for (i = 0; i < count; i++) {
+		rc = net_push(io, bufs[i], sizes[i]);
+		if (rc && !err)
+			err = rc;
+	}
+	return err;
+}
+
 /*
  * Unimplemented bufio allocator
  */
@@ -275,6 +293,22 @@ netdev_getdriver(oskit_etherdev_t *intf, oskit_driver_t **out_driver)
 	return OSKIT_ENOTSUP;
 }
 
+/*
+ * Hand a batch of received packets up, and drop our references.
+ */
+static void
+push_packets(bpfnetdev_t *dev, oskit_bufio_t **bufs, oskit_size_t *sizes,
+	     unsigned count)
+{
+	unsigned	i;
+
+	if (count == 0)
+		return;
+	oskit_netio_push_batch(dev->recv, bufs, sizes, count);
+	for (i = 0; i < count; i++)
+		oskit_bufio_release(bufs[i]);
+}
+
 /*
  * read all packets you can from this interface
  */
@@ -286,6 +320,9 @@ read_packets(void *_dev)
 	oskit_bufio_t 	*b;
 	int		r, ofs;
 	struct bpf_hdr  *hdr = (void *)dev->recvbuf;
+	oskit_bufio_t	*bufs[OSKIT_NETIO_BATCH];
+	oskit_size_t	sizes[OSKIT_NETIO_BATCH];
+	unsigned	n = 0;
 
 	r = NATIVEOS(read)(dev->fd, dev->recvbuf, dev->buflen);
 	if (r == -1 && NATIVEOS(errno) != EWOULDBLOCK) {
@@ -343,9 +380,18 @@ read_packets(void *_dev)
 		err = oskit_bufio_unmap(b, p, 0, len);
 		assert(!err);
 
-		if (handup)
-			oskit_netio_push(dev->recv, b, len);
+		if (!handup) {
+			oskit_bufio_release(b);
+			continue;
+		}
+		bufs[n] = b;
+		sizes[n] = len;
+		if (++n == OSKIT_NETIO_BATCH) {
+			push_packets(dev, bufs, sizes, n);
+			n = 0;
+		}
 	}
+	push_packets(dev, bufs, sizes, n);
 
 done:
 	/* please call read_packets(dev) when we can read */
@@ -403,7 +449,7 @@ netdev_get_addr(oskit_etherdev_t *fdev,
 
 static struct oskit_netio_ops netio_ops = {
 	net_query, net_addref, net_release,
-	net_push, net_alloc_bufio
+	net_push, net_alloc_bufio, net_push_batch
 };
 
 static struct oskit_etherdev_ops eth_ops = {
@@ -197,6 +197,24 @@ net_push(oskit_netio_t *io, oskit_bufio_t *b, oskit_size_t size)
 	return err == size ? 0 : err;
 }
 
+/*
+ * Send a batch of packets, one at a time.
+ */
+static OSKIT_COMDECL
+net_push_batch(oskit_netio_t *io, oskit_bufio_t **bufs, oskit_size_t *sizes,
+	       unsigned count)
+{
+	oskit_error_t rc, err = 0;
+	unsigned i;
+
+	for (i = 0; i < count; i++) {
+		rc = net_push(io, bufs[i], sizes[i]);
+		if (rc && !err)
+			err = rc;
+	}
+	return err;
+}
+
 /*
  * Unimplemented bufio allocator
  */
@@ -486,7 +504,7 @@ netdev_rxpoll(oskit_etherdev_t *fdev, int *count, oskit_bufio_t *out_bufios[])
 
 static struct oskit_netio_ops netio_ops = {
 	net_query, net_addref, net_release,
-	net_push, net_alloc_bufio
+	net_push, net_alloc_bufio, net_push_batch
 };
 
 static struct oskit_etherdev_ops eth_ops = {
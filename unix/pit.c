@@ -25,6 +25,17 @@
 #include "native.h"
 #include "support.h"
 
+/*
+ * The dev/x86 timer code counts in PIT units, so the one-shot
+ * emulation below does too.
+ */
+#define UNIX_PIT_HZ	1193182
+#define COUNTS2USEC(c)	((long long)(c) * 1000000 / UNIX_PIT_HZ)
+#define USEC2COUNTS(u)	((long long)(u) * UNIX_PIT_HZ / 1000000)
+
+static int		oneshot_counts;		/* zero if periodic */
+static struct timeval	oneshot_start;
+
 int
 osenv_timer_pit_read()
 {
@@ -56,6 +67,57 @@ osenv_timer_pit_shutdown()
 	struct itimerval	it;
 	memset(&it, 0, sizeof it);
 	NATIVEOS(setitimer)(ITIMER_VIRTUAL, &it, 0);
+	oneshot_counts = 0;
+}
+
+/*
+ * One-shot emulation for tickless mode. The one-shot is armed as an
+ * ITIMER_VIRTUAL with no interval, and the elapsed count is taken from
+ * the real time, so that a late signal shows up as a late tick just as
+ * it would on the hardware. pthread_delay sleeps for whatever is left.
+ */
+int
+osenv_timer_pit_oneshot_max()
+{
+	return UNIX_PIT_HZ;
+}
+
+void
+osenv_timer_pit_oneshot(int counts)
+{
+	struct itimerval	it;
+
+	if (counts < 1)
+		counts = 1;
+	memset(&it, 0, sizeof it);
+	it.it_value.tv_sec = COUNTS2USEC(counts) / 1000000;
+	it.it_value.tv_usec = COUNTS2USEC(counts) % 1000000;
+	if (it.it_value.tv_sec == 0 && it.it_value.tv_usec == 0)
+		it.it_value.tv_usec = 1;
+	NATIVEOS(gettimeofday)(&oneshot_start, 0);
+	NATIVEOS(setitimer)(ITIMER_VIRTUAL, &it, 0);
+	oneshot_counts = counts;
+}
+
+int
+osenv_timer_pit_elapsed()
+{
+	struct timeval	now;
+
+	NATIVEOS(gettimeofday)(&now, 0);
+	return USEC2COUNTS((now.tv_sec - oneshot_start.tv_sec) * 1000000LL +
+			   now.tv_usec - oneshot_start.tv_usec);
+}
+
+void
+osenv_timer_pit_periodic(int freq)
+{
+	struct itimerval	it;
+
+	memset(&it, 0, sizeof it);
+	it.it_value.tv_usec = it.it_interval.tv_usec = 1000000/freq;
+	NATIVEOS(setitimer)(ITIMER_VIRTUAL, &it, 0);
+	oneshot_counts = 0;
 }
 
 /*
@@ -74,11 +136,32 @@ pthread_delay(void)
 {
 	struct timeval timeout = { 0, 10000 };
 
+	/*
+	 * In tickless mode sleep until the one-shot is due, which may be
+	 * right away, since the virtual timer stands still while we sleep.
+	 */
+	if (oneshot_counts) {
+		long long usec;
+
+		usec = COUNTS2USEC(oneshot_counts - osenv_timer_pit_elapsed());
+		if (usec < 0)
+			usec = 0;
+		timeout.tv_sec = usec / 1000000;
+		timeout.tv_usec = usec % 1000000;
+	}
+
 	if (NATIVEOS(select)(0, 0, 0, 0, &timeout) == 0) {
 		/*
 		 * Timed out. Simulate a clock tick
 		 */
 		osenv_intr_disable();
+		if (oneshot_counts) {
+			/* so that it does not go off again later */
+			struct itimerval it;
+
+			memset(&it, 0, sizeof it);
+			NATIVEOS(setitimer)(ITIMER_VIRTUAL, &it, 0);
+		}
 		NATIVEOS(kill)(NATIVEOS(getpid)(), SIGVTALRM);
 		osenv_intr_enable();
 	}
@@ -122,6 +122,39 @@ net_push(oskit_netio_t *ioi, oskit_bufio_t *b, oskit_size_t pkt_size)
 	return oskit_netio_push(nio->forwardto, b, pkt_size);
 }
 
+/*
+ * Dump each packet of a batch, then pass the batch along.
+ */
+static OSKIT_COMDECL
+net_push_batch(oskit_netio_t *ioi, oskit_bufio_t **bufs, oskit_size_t *sizes,
+	       unsigned count)
+{
+	struct netio_link *nio = (struct netio_link *)ioi;
+	void *p;
+	oskit_error_t maperr, rc;
+	oskit_size_t len;
+	unsigned i;
+
+	assert (nio != NULL);
+	assert (nio->count != 0);
+
+	for (i = 0; i < count; i++) {
+		len = sizes[i];
+		maperr = oskit_bufio_map(bufs[i], &p, 0, sizes[i]);
+		if (maperr) {
+			static unsigned char buf[2048];
+			rc = oskit_bufio_read(bufs[i], buf, 0, sizes[i], &len);
+			p = buf;
+			assert(rc == 0);
+		}
+		nio->dump_f(nio->cookie, p, len);
+		if (!maperr)
+			oskit_bufio_unmap(bufs[i], p, 0, sizes[i]);
+	}
+
+	return oskit_netio_push_batch(nio->forwardto, bufs, sizes, count);
+}
+
 /*
  * Unimplemented bufio allocator
  */
@@ -141,7 +174,8 @@ struct oskit_netio_ops netio_ops = {
 	net_addref, 
 	net_release,
 	net_push,
-	net_alloc_bufio
+	net_alloc_bufio,
+	net_push_batch
 };
 
 /*